@@ -0,0 +1,815 @@
+/* Reproducible benchmarks of some core functions; if used as a lib, this file is obsolete.
+
+Usage: delta --bench [<chats> [<msgs> [<contacts>]]]
+
+Two accounts are created in a temporary directory.  "bob" creates plain,
+encrypted and multipart messages that are received by "alice" without any
+network.  Afterwards, typical API calls are timed on alice's account.
+Finally, base64 and quoted-printable decoding are timed with each
+instruction set supported by the CPU, the conversion of a large HTML mail
+to text and the hash table with the workloads of the header parsing and of
+the housekeeping.
+
+The text of the messages is created by a fixed pseudo random generator,
+so two runs with the same arguments work on the same data.  The results are
+written to stdout as one JSON object per line, eg.
+{"name":"receive_imf_plain","count":250,"total_ms":812.310,"avg_us":3249.240}
+*/
+
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/dc_context.h"
+#include "../src/dc_mimefactory.h"
+#include "../src/dc_job.h"
+#include "../src/dc_codec.h"
+#include "../src/dc_simplify.h"
+#include "bench.h"
+
+
+typedef struct bench_timer_t
+{
+	const char* name;
+	int         cnt;
+	double      total_ms;
+} bench_timer_t;
+
+
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000.0 + ts.tv_nsec/1000000.0;
+}
+
+
+static void add_time(bench_timer_t* timer, double start_ms)
+{
+	timer->cnt++;
+	timer->total_ms += now_ms()-start_ms;
+}
+
+
+static void print_timer(const bench_timer_t* timer)
+{
+	printf("{\"name\":\"%s\",\"count\":%i,\"total_ms\":%.3f,\"avg_us\":%.3f}\n",
+		timer->name, timer->cnt, timer->total_ms,
+		timer->cnt? timer->total_ms*1000.0/timer->cnt : 0.0);
+}
+
+
+/*******************************************************************************
+ * Create test data
+ ******************************************************************************/
+
+
+static uint32_t s_rand_state = 1;
+static uint32_t s_server_uid = 0;
+
+
+static uint32_t bench_rand(void)
+{
+	/* a fixed generator, the results of rand() differ between the libc versions */
+	s_rand_state = s_rand_state*1103515245 + 12345;
+	return (s_rand_state>>16) & 0x7FFF;
+}
+
+
+static char* random_text(int words)
+{
+	static const char* s_words[] = { "lorem", "ipsum", "dolor", "sit", "amet", "house", "garden",
+		"meeting", "tomorrow", "zebra", "coffee", "train", "delta", "chat", "message", "photo",
+		"weekend", "Übermorgen", "café", "ok", "thanks", "see", "you", "soon", "the", "and", "a" };
+	dc_strbuilder_t ret;
+	dc_strbuilder_init(&ret, 0);
+
+	for (int i = 0; i<words; i++) {
+		if (i) { dc_strbuilder_cat(&ret, " "); }
+		dc_strbuilder_cat(&ret, s_words[bench_rand() % (sizeof(s_words)/sizeof(s_words[0]))]);
+	}
+
+	return ret.buf;
+}
+
+
+static uintptr_t bench_event(dc_context_t* context, int event, uintptr_t data1, uintptr_t data2)
+{
+	if (event==DC_EVENT_ERROR) {
+		fprintf(stderr, "[DC_EVENT_ERROR] %s\n", (char*)data2);
+	}
+	return 0;
+}
+
+
+static dc_context_t* create_account(const char* dir, const char* name, const char* addr)
+{
+	dc_context_t* context = dc_context_new(bench_event, NULL, "bench");
+	char*         dbfile = dc_mprintf("%s/%s.db", dir, name);
+
+	if (!dc_open(context, dbfile, NULL)) {
+		fprintf(stderr, "Cannot open %s.\n", dbfile);
+		exit(1);
+	}
+
+	/* no network is used, just pretend the account is configured */
+	dc_set_config(context, "addr", addr);
+	dc_set_config(context, "displayname", name);
+	dc_sqlite3_set_config(context->sql, "configured_addr", addr);
+	dc_sqlite3_set_config_int(context->sql, "configured", 1);
+	dc_ensure_secret_key_exists(context);
+
+	free(dbfile);
+	return context;
+}
+
+
+static uint32_t prepare_msg(dc_context_t* context, uint32_t chat_id, int words, int attachment_bytes, int force_plaintext)
+{
+	dc_msg_t* msg = dc_msg_new(context, attachment_bytes? DC_MSG_FILE : DC_MSG_TEXT);
+	char*     text = random_text(words);
+	char*     file = NULL;
+	uint32_t  msg_id = 0;
+
+	dc_msg_set_text(msg, text);
+
+	if (attachment_bytes) {
+		char* blobdir = dc_get_blobdir(context);
+		char* buf = malloc(attachment_bytes);
+		for (int i = 0; i<attachment_bytes; i++) {
+			buf[i] = bench_rand();
+		}
+		file = dc_mprintf("%s/bench-%i.bin", blobdir, (int)s_server_uid);
+		dc_write_file(context, file, buf, attachment_bytes);
+		dc_msg_set_file(msg, file, "application/octet-stream");
+		free(buf);
+		free(blobdir);
+	}
+
+	if (force_plaintext) {
+		dc_param_set_int(msg->param, DC_PARAM_FORCE_PLAINTEXT, DC_FP_ADD_AUTOCRYPT_HEADER);
+	}
+
+	msg_id = dc_prepare_msg(context, chat_id, msg);
+
+	free(file);
+	free(text);
+	dc_msg_unref(msg);
+	return msg_id;
+}
+
+
+static void transfer_msg(dc_context_t* sender, uint32_t msg_id, dc_context_t* receiver,
+                         bench_timer_t* render_timer, bench_timer_t* plain_timer, bench_timer_t* encrypted_timer)
+{
+	/* render a message prepared by the sender and pass it to the receiver as if fetched from the server */
+	dc_mimefactory_t factory;
+	double           start = 0;
+
+	dc_mimefactory_init(&factory, sender);
+
+	if (!dc_mimefactory_load_msg(&factory, msg_id)) {
+		fprintf(stderr, "Cannot load message %i.\n", (int)msg_id);
+		goto cleanup;
+	}
+
+	start = now_ms();
+	if (!dc_mimefactory_render(&factory)) {
+		fprintf(stderr, "Cannot render message %i.\n", (int)msg_id);
+		goto cleanup;
+	}
+	add_time(render_timer, start);
+
+	start = now_ms();
+	dc_receive_imf(receiver, factory.out->str, factory.out->len, "INBOX", ++s_server_uid, 0);
+	add_time(factory.out_encrypted? encrypted_timer : plain_timer, start);
+
+cleanup:
+	dc_mimefactory_empty(&factory);
+}
+
+
+static void run_imex_job(dc_context_t* context, int what, const char* param1)
+{
+	/* run the import/export job on this thread, dc_perform_imap_jobs() would also try to connect */
+	dc_job_t job;
+	memset(&job, 0, sizeof(dc_job_t));
+	job.action = DC_JOB_IMEX_IMAP;
+	job.param  = dc_param_new();
+	dc_param_set_int(job.param, DC_PARAM_CMD,     what);
+	dc_param_set    (job.param, DC_PARAM_CMD_ARG, param1);
+
+	dc_job_do_DC_JOB_IMEX_IMAP(context, &job);
+
+	dc_param_unref(job.param);
+	free(job.pending_error);
+}
+
+
+void bench_delete_dir(const char* dir)
+{
+	DIR*           handle = opendir(dir);
+	struct dirent* entry = NULL;
+
+	while (handle && (entry=readdir(handle))!=NULL) {
+		if (strcmp(entry->d_name, ".")!=0 && strcmp(entry->d_name, "..")!=0) {
+			char*       path = dc_mprintf("%s/%s", dir, entry->d_name);
+			struct stat st;
+			if (stat(path, &st)==0 && S_ISDIR(st.st_mode)) {
+				bench_delete_dir(path);
+			}
+			else {
+				unlink(path);
+			}
+			free(path);
+		}
+	}
+
+	if (handle) {
+		closedir(handle);
+	}
+	rmdir(dir);
+}
+
+
+/*******************************************************************************
+ * Benchmarks
+ ******************************************************************************/
+
+
+static char* qp_text(int words)
+{
+	/* quoted-printable as sent by other MUAs: escaped umlauts and soft line breaks */
+	char*           text = random_text(words);
+	int             col = 0;
+	dc_strbuilder_t ret;
+	dc_strbuilder_init(&ret, 0);
+
+	for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+		if (col>=72) {
+			dc_strbuilder_cat(&ret, "=\r\n");
+			col = 0;
+		}
+		if (*p>=0x80 || *p=='=') {
+			dc_strbuilder_catf(&ret, "=%02X", (int)*p);
+			col += 3;
+		}
+		else {
+			dc_strbuilder_catf(&ret, "%c", (int)*p);
+			col++;
+		}
+	}
+
+	free(text);
+	return ret.buf;
+}
+
+
+static void bench_codecs(void)
+{
+	/* transfer decoding of a base64 attachment and of a quoted-printable text with each available instruction set */
+	#define CODEC_BENCH_BYTES (1024*1024)
+	#define CODEC_REPEAT      20
+	static const char* s_simd_names[] = { "scalar", "ssse3", "avx2" };
+	unsigned char*     bin = malloc(CODEC_BENCH_BYTES);
+	char*              base64 = NULL;
+	char*              wrapped = NULL;
+	char*              qp = qp_text(CODEC_BENCH_BYTES/6);
+	char*              to_unref = NULL;
+	size_t             bytes = 0;
+	double             start = 0;
+
+	for (int i = 0; i<CODEC_BENCH_BYTES; i++) {
+		bin[i] = bench_rand();
+	}
+	base64 = dc_base64_encode(bin, CODEC_BENCH_BYTES);
+	wrapped = dc_insert_breaks(base64, 76, "\r\n");
+
+	dc_codec_set_simd(DC_CODEC_AVX2);
+	int max_simd = dc_codec_get_simd();
+	for (int simd = DC_CODEC_SCALAR; simd<=max_simd; simd++)
+	{
+		char* name_encode = dc_mprintf("base64_encode_1mb_%s", s_simd_names[simd]);
+		char* name_decode = dc_mprintf("base64_decode_1mb_%s", s_simd_names[simd]);
+		char* name_qp     = dc_mprintf("qp_decode_%ikb_%s", (int)(strlen(qp)/1024), s_simd_names[simd]);
+		bench_timer_t t_encode = { name_encode, 0, 0 };
+		bench_timer_t t_decode = { name_decode, 0, 0 };
+		bench_timer_t t_qp     = { name_qp, 0, 0 };
+
+		dc_codec_set_simd(simd);
+		for (int r = 0; r<CODEC_REPEAT; r++) {
+			start = now_ms();
+			free(dc_base64_encode(bin, CODEC_BENCH_BYTES));
+			add_time(&t_encode, start);
+
+			start = now_ms();
+			dc_transfer_decode(wrapped, strlen(wrapped), MAILMIME_MECHANISM_BASE64, &to_unref, &bytes);
+			add_time(&t_decode, start);
+			mmap_string_unref(to_unref);
+
+			start = now_ms();
+			dc_transfer_decode(qp, strlen(qp), MAILMIME_MECHANISM_QUOTED_PRINTABLE, &to_unref, &bytes);
+			add_time(&t_qp, start);
+			mmap_string_unref(to_unref);
+		}
+
+		print_timer(&t_encode);
+		print_timer(&t_decode);
+		print_timer(&t_qp);
+		free(name_encode);
+		free(name_decode);
+		free(name_qp);
+	}
+
+	dc_codec_set_simd(DC_CODEC_AVX2);
+	free(qp);
+	free(wrapped);
+	free(base64);
+	free(bin);
+}
+
+
+
+static char* html_text(int paragraphs)
+{
+	/* HTML as sent by other MUAs: styled paragraphs, links and many entities */
+	static const char* s_entities[] = { "&nbsp;", "&auml;", "&uuml;", "&szlig;", "&amp;", "&ndash;", "&hellip;", "&#8364;", "&#x1F600;" };
+	dc_strbuilder_t ret;
+	dc_strbuilder_init(&ret, 0);
+
+	dc_strbuilder_cat(&ret, "<!DOCTYPE html><html><head><style>p { margin: 0; }</style></head><body>\r\n");
+	for (int i = 0; i<paragraphs; i++) {
+		char* text = random_text(20);
+		dc_strbuilder_catf(&ret, "<p style=\"margin:0\" class=p%i>%s %s <b>%s</b> <a href=\"https://example.org/?a=1&amp;b=%i\">link</a><br>\r\n</p>\r\n",
+			i%10, text, s_entities[bench_rand()%(sizeof(s_entities)/sizeof(s_entities[0]))],
+			s_entities[bench_rand()%(sizeof(s_entities)/sizeof(s_entities[0]))], i);
+		free(text);
+	}
+	dc_strbuilder_cat(&ret, "</body></html>\r\n");
+
+	return ret.buf;
+}
+
+
+static void bench_dehtml(void)
+{
+	#define DEHTML_REPEAT 20
+	char*          html = html_text(10000);
+	char*          name = dc_mprintf("dehtml_%ikb", (int)(strlen(html)/1024));
+	bench_timer_t  t_dehtml = { name, 0, 0 };
+	dc_simplify_t* simplify = dc_simplify_new();
+
+	for (int r = 0; r<DEHTML_REPEAT; r++) {
+		double start = now_ms();
+		free(dc_simplify_simplify(simplify, html, strlen(html), 1, 0));
+		add_time(&t_dehtml, start);
+	}
+
+	print_timer(&t_dehtml);
+	dc_simplify_unref(simplify);
+	free(name);
+	free(html);
+}
+
+
+/* the former implementation of dc_hash_t, the chained hash table taken from sqlite,
+kept as a reference for bench_hash(); reduced to the DC_HASH_STRING keys used there
+and calling the hash and compare functions directly instead of through pointers */
+
+typedef struct ref_hashelem_t
+{
+	struct ref_hashelem_t *next, *prev;
+	void*                  data;
+	void*                  pKey;
+	int                    nKey;
+} ref_hashelem_t;
+
+
+typedef struct ref_hash_t
+{
+	int             copyKey;
+	int             count;
+	ref_hashelem_t* first;
+	int             htsize;
+	struct ref_ht { int count; ref_hashelem_t* chain; } *ht;
+} ref_hash_t;
+
+
+static const unsigned char s_ref_upper_to_lower[] = {
+	0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17,
+	18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35,
+	36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53,
+	54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 97, 98, 99,100,101,102,103,
+	104,105,106,107,108,109,110,111,112,113,114,115,116,117,118,119,120,121,
+	122, 91, 92, 93, 94, 95, 96, 97, 98, 99,100,101,102,103,104,105,106,107,
+	108,109,110,111,112,113,114,115,116,117,118,119,120,121,122,123,124,125,
+	126,127,128,129,130,131,132,133,134,135,136,137,138,139,140,141,142,143,
+	144,145,146,147,148,149,150,151,152,153,154,155,156,157,158,159,160,161,
+	162,163,164,165,166,167,168,169,170,171,172,173,174,175,176,177,178,179,
+	180,181,182,183,184,185,186,187,188,189,190,191,192,193,194,195,196,197,
+	198,199,200,201,202,203,204,205,206,207,208,209,210,211,212,213,214,215,
+	216,217,218,219,220,221,222,223,224,225,226,227,228,229,230,231,232,233,
+	234,235,236,237,238,239,240,241,242,243,244,245,246,247,248,249,250,251,
+	252,253,254,255
+};
+
+
+static int ref_hash_str(const char* z, int n)
+{
+	unsigned int h = 0;
+	if (n<=0) n = strlen(z);
+	while (n > 0) {
+		h = (h<<3) ^ h ^ s_ref_upper_to_lower[(unsigned char)*z++];
+		n--;
+	}
+	return h & 0x7fffffff;
+}
+
+
+static int ref_compare_str(const void* pKey1, int n1, const void* pKey2, int n2)
+{
+	const unsigned char* a = (const unsigned char*)pKey1;
+	const unsigned char* b = (const unsigned char*)pKey2;
+	if (n1!=n2) return 1;
+	while (n1-- > 0 && *a!=0 && s_ref_upper_to_lower[*a]==s_ref_upper_to_lower[*b]) { a++; b++; }
+	return n1<0 ? 0 : s_ref_upper_to_lower[*a] - s_ref_upper_to_lower[*b];
+}
+
+
+static void ref_hash_init(ref_hash_t* pH, int copyKey)
+{
+	memset(pH, 0, sizeof(ref_hash_t));
+	pH->copyKey = copyKey;
+}
+
+
+static void ref_hash_clear(ref_hash_t* pH)
+{
+	ref_hashelem_t* elem = pH->first;
+	free(pH->ht);
+	while (elem) {
+		ref_hashelem_t* next_elem = elem->next;
+		if (pH->copyKey) {
+			free(elem->pKey);
+		}
+		free(elem);
+		elem = next_elem;
+	}
+	memset(pH, 0, sizeof(ref_hash_t));
+}
+
+
+static void ref_insert_element(ref_hash_t* pH, struct ref_ht* pEntry, ref_hashelem_t* pNew)
+{
+	ref_hashelem_t* pHead = pEntry->chain;
+	if (pHead) {
+		pNew->next = pHead;
+		pNew->prev = pHead->prev;
+		if (pHead->prev) { pHead->prev->next = pNew; }
+		else             { pH->first = pNew; }
+		pHead->prev = pNew;
+	}
+	else {
+		pNew->next = pH->first;
+		if (pH->first) { pH->first->prev = pNew; }
+		pNew->prev = 0;
+		pH->first = pNew;
+	}
+	pEntry->count++;
+	pEntry->chain = pNew;
+}
+
+
+static void ref_rehash(ref_hash_t* pH, int new_size)
+{
+	ref_hashelem_t *elem, *next_elem;
+	free(pH->ht);
+	pH->ht = calloc(new_size, sizeof(struct ref_ht));
+	pH->htsize = new_size;
+	for (elem = pH->first, pH->first = 0; elem; elem = next_elem) {
+		int h = ref_hash_str(elem->pKey, elem->nKey) & (new_size-1);
+		next_elem = elem->next;
+		ref_insert_element(pH, &pH->ht[h], elem);
+	}
+}
+
+
+static ref_hashelem_t* ref_find_element(const ref_hash_t* pH, const void* pKey, int nKey, int h)
+{
+	if (pH->ht) {
+		ref_hashelem_t* elem = pH->ht[h].chain;
+		int             count = pH->ht[h].count;
+		while (count-- && elem) {
+			if (ref_compare_str(elem->pKey, elem->nKey, pKey, nKey)==0) {
+				return elem;
+			}
+			elem = elem->next;
+		}
+	}
+	return 0;
+}
+
+
+static void* ref_hash_find(const ref_hash_t* pH, const void* pKey, int nKey)
+{
+	if (pH->ht==0) return 0;
+	ref_hashelem_t* elem = ref_find_element(pH, pKey, nKey, ref_hash_str(pKey, nKey) & (pH->htsize-1));
+	return elem ? elem->data : 0;
+}
+
+
+static void ref_hash_insert(ref_hash_t* pH, const void* pKey, int nKey, void* data)
+{
+	/* as dc_hash_insert() before, without removing elements */
+	int             hraw = ref_hash_str(pKey, nKey);
+	ref_hashelem_t* elem = pH->ht? ref_find_element(pH, pKey, nKey, hraw & (pH->htsize-1)) : NULL;
+	if (elem) {
+		elem->data = data;
+		return;
+	}
+
+	ref_hashelem_t* new_elem = calloc(1, sizeof(ref_hashelem_t));
+	if (pH->copyKey) {
+		new_elem->pKey = malloc(nKey);
+		memcpy(new_elem->pKey, pKey, nKey);
+	}
+	else {
+		new_elem->pKey = (void*)pKey;
+	}
+	new_elem->nKey = nKey;
+	pH->count++;
+
+	if (pH->htsize==0) {
+		ref_rehash(pH, 8);
+	}
+	if (pH->count > pH->htsize) {
+		ref_rehash(pH, pH->htsize*2);
+	}
+	ref_insert_element(pH, &pH->ht[hraw & (pH->htsize-1)], new_elem);
+	new_elem->data = data;
+}
+
+
+static void bench_hash(void)
+{
+	/* the typical use of dc_hash_t: the header of received messages and the files in use checked by the housekeeping */
+	#define HASH_HEADER_REPEAT 100000
+	#define HASH_FILES         50000
+	static const char* s_fields[] = { "Return-Path", "Received", "Received", "DKIM-Signature", "Date", "From", "To", "Cc",
+		"Message-ID", "In-Reply-To", "References", "Subject", "MIME-Version", "Content-Type", "Autocrypt",
+		"Autocrypt-Gossip", "Chat-Version", "Chat-Group-ID", "Chat-Group-Name", "Chat-Disposition-Notification-To",
+		"X-Mailer", "List-Id", "Secure-Join", "Chat-Content" };
+	static const char* s_lookups[] = { "Chat-Version", "Chat-Group-ID", "Chat-Group-Name-Changed", "Chat-Group-Image",
+		"Chat-Group-Member-Removed", "Chat-Group-Member-Added", "Chat-Voice-Message", "Secure-Join", "Chat-Predecessor",
+		"Autocrypt-Setup-Message", "List-Id", "Chat-Content", "Chat-Duration", "Disposition-Notification-To" };
+	#define FIELD_CNT  (int)(sizeof(s_fields)/sizeof(s_fields[0]))
+	#define LOOKUP_CNT (int)(sizeof(s_lookups)/sizeof(s_lookups[0]))
+	bench_timer_t t_header = { "hash_header", 0, 0 };
+	bench_timer_t t_files  = { "hash_files_in_use", 0, 0 };
+	bench_timer_t t_ref_header = { "hash_header_ref", 0, 0 };
+	bench_timer_t t_ref_files  = { "hash_files_in_use_ref", 0, 0 };
+	char**        files = malloc(sizeof(char*)*HASH_FILES*2);
+	uintptr_t     found = 0;
+	double        start = 0;
+
+	start = now_ms();
+	for (int r = 0; r<HASH_HEADER_REPEAT; r++) {
+		dc_hash_t header;
+		dc_hash_init(&header, DC_HASH_STRING, 0);
+		for (int i = 0; i<FIELD_CNT; i++) {
+			int key_len = strlen(s_fields[i]);
+			if (dc_hash_find(&header, s_fields[i], key_len)==NULL) {
+				dc_hash_insert(&header, s_fields[i], key_len, (void*)s_fields[i]);
+			}
+		}
+		for (int i = 0; i<LOOKUP_CNT; i++) {
+			found += (uintptr_t)dc_hash_find_str(&header, s_lookups[i]);
+		}
+		dc_hash_clear(&header);
+	}
+	add_time(&t_header, start);
+
+	/* half of the files in the blob directory are in use */
+	for (int i = 0; i<HASH_FILES*2; i++) {
+		files[i] = dc_mprintf("$BLOBDIR/%08x%04x-%i.jpg", bench_rand()<<16|bench_rand(), bench_rand(), i);
+	}
+	start = now_ms();
+	{
+		dc_hash_t files_in_use;
+		dc_hash_init(&files_in_use, DC_HASH_STRING, DC_HASH_COPY_KEY);
+		for (int i = 0; i<HASH_FILES; i++) {
+			dc_hash_insert_str(&files_in_use, files[i*2], (void*)1);
+		}
+		for (int i = 0; i<HASH_FILES*2; i++) {
+			found += (uintptr_t)dc_hash_find_str(&files_in_use, files[i]);
+		}
+		dc_hash_clear(&files_in_use);
+	}
+	add_time(&t_files, start);
+
+	/* the same with the former implementation */
+	start = now_ms();
+	for (int r = 0; r<HASH_HEADER_REPEAT; r++) {
+		ref_hash_t header;
+		ref_hash_init(&header, 0);
+		for (int i = 0; i<FIELD_CNT; i++) {
+			int key_len = strlen(s_fields[i]);
+			if (ref_hash_find(&header, s_fields[i], key_len)==NULL) {
+				ref_hash_insert(&header, s_fields[i], key_len, (void*)s_fields[i]);
+			}
+		}
+		for (int i = 0; i<LOOKUP_CNT; i++) {
+			found += (uintptr_t)ref_hash_find(&header, s_lookups[i], strlen(s_lookups[i]));
+		}
+		ref_hash_clear(&header);
+	}
+	add_time(&t_ref_header, start);
+
+	start = now_ms();
+	{
+		ref_hash_t files_in_use;
+		ref_hash_init(&files_in_use, 1);
+		for (int i = 0; i<HASH_FILES; i++) {
+			ref_hash_insert(&files_in_use, files[i*2], strlen(files[i*2]), (void*)1);
+		}
+		for (int i = 0; i<HASH_FILES*2; i++) {
+			found += (uintptr_t)ref_hash_find(&files_in_use, files[i], strlen(files[i]));
+		}
+		ref_hash_clear(&files_in_use);
+	}
+	add_time(&t_ref_files, start);
+
+	if (found==0) {
+		printf("hash: nothing found\n");
+	}
+
+	print_timer(&t_header);
+	print_timer(&t_files);
+	print_timer(&t_ref_header);
+	print_timer(&t_ref_files);
+	for (int i = 0; i<HASH_FILES*2; i++) {
+		free(files[i]);
+	}
+	free(files);
+}
+
+
+int bench_functions(int argc, char** argv)
+{
+	int            chat_cnt    = argc>0? atoi(argv[0]) : 20;
+	int            msg_cnt     = argc>1? atoi(argv[1]) : 500;
+	int            contact_cnt = argc>2? atoi(argv[2]) : 100;
+	#define        REPEAT      10
+	char           dir[] = "/tmp/deltachat-bench-XXXXXX";
+	dc_context_t*  alice = NULL;
+	dc_context_t*  bob = NULL;
+	dc_context_t*  restored = NULL;
+	uint32_t*      group_ids = NULL;
+	char*          backup_file = NULL;
+	char*          restored_db = NULL;
+	dc_chatlist_t* chatlist = NULL;
+	double         start = 0;
+
+	bench_timer_t  t_create_contact  = { "create_contact", 0, 0 };
+	bench_timer_t  t_render          = { "mimefactory_render", 0, 0 };
+	bench_timer_t  t_recv_plain      = { "receive_imf_plain", 0, 0 };
+	bench_timer_t  t_recv_encrypted  = { "receive_imf_encrypted", 0, 0 };
+	bench_timer_t  t_recv_multipart  = { "receive_imf_multipart", 0, 0 };
+	bench_timer_t  t_chatlist        = { "get_chatlist_with_summaries", 0, 0 };
+	bench_timer_t  t_chat_msgs       = { "get_chat_msgs", 0, 0 };
+	bench_timer_t  t_search          = { "search_msgs", 0, 0 };
+	bench_timer_t  t_housekeeping    = { "housekeeping", 0, 0 };
+	bench_timer_t  t_export          = { "export_backup", 0, 0 };
+	bench_timer_t  t_import          = { "import_backup", 0, 0 };
+
+	if (chat_cnt<1 || msg_cnt<1 || contact_cnt<1) {
+		fprintf(stderr, "Usage: --bench [<chats> [<msgs> [<contacts>]]]\n");
+		return 1;
+	}
+
+	if (mkdtemp(dir)==NULL) {
+		fprintf(stderr, "Cannot create temporary directory.\n");
+		return 1;
+	}
+
+	printf("{\"bench\":\"deltachat-core\",\"version\":\"%s\",\"chats\":%i,\"msgs\":%i,\"contacts\":%i}\n",
+		DC_VERSION_STR, chat_cnt, msg_cnt, contact_cnt);
+
+	alice = create_account(dir, "alice", "alice@example.org");
+	bob   = create_account(dir, "bob",   "bob@example.org");
+
+	/* contacts, bob adds the same contacts to his groups */
+	for (int i = 0; i<contact_cnt; i++) {
+		char* name = random_text(2);
+		char* addr = dc_mprintf("contact%i@example.org", i);
+		start = now_ms();
+		dc_create_contact(alice, name, addr);
+		add_time(&t_create_contact, start);
+		free(addr);
+		free(name);
+	}
+
+	uint32_t bob_alice_chat = dc_create_chat_by_contact_id(bob, dc_create_contact(bob, "Alice", "alice@example.org"));
+	uint32_t alice_bob_chat = dc_create_chat_by_contact_id(alice, dc_create_contact(alice, "Bob", "bob@example.org"));
+
+	/* exchange keys; afterwards, messages in the one-to-one chat are encrypted */
+	transfer_msg(bob, prepare_msg(bob, bob_alice_chat, 3, 0, 0), alice, &t_render, &t_recv_plain, &t_recv_encrypted);
+	transfer_msg(alice, prepare_msg(alice, alice_bob_chat, 3, 0, 0), bob, &t_render, &t_recv_plain, &t_recv_encrypted);
+
+	group_ids = calloc(chat_cnt, sizeof(uint32_t));
+	for (int i = 0; i<chat_cnt; i++) {
+		char* name = dc_mprintf("Group %i", i);
+		group_ids[i] = dc_create_group_chat(bob, 0, name);
+		dc_add_contact_to_chat(bob, group_ids[i], dc_create_contact(bob, "Alice", "alice@example.org"));
+		for (int j = 0; j<3; j++) {
+			char* addr = dc_mprintf("contact%i@example.org", (int)(bench_rand()%contact_cnt));
+			dc_add_contact_to_chat(bob, group_ids[i], dc_create_contact(bob, NULL, addr));
+			free(addr);
+		}
+		free(name);
+	}
+
+	/* messages: encrypted, plain, group and multipart messages with attachments */
+	for (int i = 0; i<msg_cnt; i++) {
+		uint32_t group_id = group_ids[bench_rand()%chat_cnt];
+		switch (i%4) {
+			case 0: transfer_msg(bob, prepare_msg(bob, bob_alice_chat, 5+bench_rand()%30, 0, 0), alice, &t_render, &t_recv_plain, &t_recv_encrypted); break;
+			case 1: transfer_msg(bob, prepare_msg(bob, bob_alice_chat, 5+bench_rand()%30, 0, 1), alice, &t_render, &t_recv_plain, &t_recv_encrypted); break;
+			case 2: transfer_msg(bob, prepare_msg(bob, group_id,       5+bench_rand()%30, 0, 0), alice, &t_render, &t_recv_plain, &t_recv_encrypted); break;
+			case 3: transfer_msg(bob, prepare_msg(bob, (i%8==3)? bob_alice_chat : group_id, 3, 8*1024+bench_rand()%(64*1024), 0), alice,
+			                     &t_render, &t_recv_multipart, &t_recv_multipart); break;
+		}
+	}
+
+	/* typical calls of the ui */
+	for (int r = 0; r<REPEAT; r++) {
+		start = now_ms();
+		chatlist = dc_get_chatlist(alice, 0, NULL, 0);
+		for (size_t i = 0; i<dc_chatlist_get_cnt(chatlist); i++) {
+			dc_lot_unref(dc_chatlist_get_summary(chatlist, i, NULL));
+		}
+		add_time(&t_chatlist, start);
+
+		for (size_t i = 0; i<dc_chatlist_get_cnt(chatlist); i++) {
+			start = now_ms();
+			dc_array_unref(dc_get_chat_msgs(alice, dc_chatlist_get_chat_id(chatlist, i), 0, 0));
+			add_time(&t_chat_msgs, start);
+		}
+		dc_chatlist_unref(chatlist);
+		chatlist = NULL;
+
+		static const char* s_queries[] = { "zebra", "coffee tomorrow", "caf", "nothing-matches-this" };
+		for (int i = 0; i<sizeof(s_queries)/sizeof(s_queries[0]); i++) {
+			start = now_ms();
+			dc_array_unref(dc_search_msgs(alice, 0, s_queries[i]));
+			add_time(&t_search, start);
+		}
+	}
+
+	start = now_ms();
+	dc_housekeeping(alice);
+	add_time(&t_housekeeping, start);
+
+	/* backup */
+	start = now_ms();
+	run_imex_job(alice, DC_IMEX_EXPORT_BACKUP, dir);
+	add_time(&t_export, start);
+
+	if ((backup_file=dc_imex_has_backup(alice, dir))==NULL) {
+		fprintf(stderr, "Cannot export backup.\n");
+	}
+	else {
+		restored = dc_context_new(bench_event, NULL, "bench");
+		restored_db = dc_mprintf("%s/restored.db", dir);
+		dc_open(restored, restored_db, NULL);
+		start = now_ms();
+		run_imex_job(restored, DC_IMEX_IMPORT_BACKUP, backup_file);
+		add_time(&t_import, start);
+	}
+
+	print_timer(&t_create_contact);
+	print_timer(&t_render);
+	print_timer(&t_recv_plain);
+	print_timer(&t_recv_encrypted);
+	print_timer(&t_recv_multipart);
+	print_timer(&t_chatlist);
+	print_timer(&t_chat_msgs);
+	print_timer(&t_search);
+	print_timer(&t_housekeeping);
+	print_timer(&t_export);
+	print_timer(&t_import);
+
+	bench_codecs();
+	bench_dehtml();
+	bench_hash();
+
+	dc_context_unref(restored);
+	dc_context_unref(bob);
+	dc_context_unref(alice);
+	bench_delete_dir(dir);
+	free(restored_db);
+	free(backup_file);
+	free(group_ids);
+	return 0;
+}
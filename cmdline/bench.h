@@ -0,0 +1,15 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+int  bench_functions  (int argc, char** argv);
+void bench_delete_dir (const char* dir);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __BENCH_H__ */
@@ -418,6 +418,7 @@ char* dc_cmdline(dc_context_t* context, const char* cmdline)
 			ret = dc_strdup(
 				"==========================Database commands==\n"
 				"info\n"
+				"stats [reset]\n"
 				"open <file to open or create>\n"
 				"close\n"
 				"set <configuration-key> [<value>]\n"
@@ -665,6 +666,16 @@ char* dc_cmdline(dc_context_t* context, const char* cmdline)
 			ret = COMMAND_FAILED;
 		}
 	}
+	else if (strcmp(cmd, "stats")==0)
+	{
+		if (arg1 && strcmp(arg1, "reset")==0) {
+			dc_reset_stats(context);
+			ret = COMMAND_SUCCEEDED;
+		}
+		else {
+			ret = dc_get_stats(context);
+		}
+	}
 	else if (strcmp(cmd, "maybenetwork")==0)
 	{
 		dc_maybe_network(context);
@@ -0,0 +1,421 @@
+/* End-to-end load tests against the local test server; if used as a lib, this file is obsolete.
+
+Usage: delta --loadtest [<msgs> [<latency-ms> [<bytes-per-sec> [<drop-after>]]]]
+       delta --testserver [<imap-port> [<smtp-port> [<latency-ms> [<bytes-per-sec> [<drop-after>]]]]]
+
+--loadtest starts the server from testserver.c and configures the two
+accounts "alice" and "bob" in a temporary directory against it.  The accounts
+run the usual IMAP and SMTP threads, so the complete network path is used:
+configure, dc_smtp_send_msg(), IDLE and fetching.  Bob sends <msgs> messages
+to Alice; the time from sending to DC_EVENT_INCOMING_MSG is measured.
+The result is written to stdout as one JSON object, eg.
+{"loadtest":"deltachat-core","msgs":100,"received":100,"msgs_per_sec":41.2,"latency_ms":{...},...}
+
+--testserver runs the server only, until stdin is closed,
+eg. to connect accounts configured by hand. */
+
+
+#include <time.h>
+#include <unistd.h>
+#include "../src/dc_context.h"
+#include "testserver.h"
+#include "bench.h"
+#include "loadtest.h"
+
+
+#define LOADTEST_TIMEOUT_MS 60000 /* give up if nothing was received for this time */
+
+
+typedef struct loadtest_account_t
+{
+	dc_context_t* context;
+	int           run_threads;
+	pthread_t     imap_thread;
+	pthread_t     mvbox_thread;
+	pthread_t     sentbox_thread;
+	pthread_t     smtp_thread;
+	int           configure_result; /* 0=running, 1=success, -1=failure */
+	int           connects;
+} loadtest_account_t;
+
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t*       s_received_ids = NULL;
+static double*         s_received_ms = NULL;
+static int             s_received_cnt = 0;
+static int             s_received_max = 0;
+
+
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000.0 + ts.tv_nsec/1000000.0;
+}
+
+
+static int cmp_double(const void* a, const void* b)
+{
+	double d1 = *(const double*)a;
+	double d2 = *(const double*)b;
+	return d1<d2? -1 : (d1>d2? 1 : 0);
+}
+
+
+static uintptr_t loadtest_event(dc_context_t* context, int event, uintptr_t data1, uintptr_t data2)
+{
+	loadtest_account_t* account = (loadtest_account_t*)dc_get_userdata(context);
+
+	switch (event)
+	{
+		case DC_EVENT_ERROR:
+		case DC_EVENT_ERROR_NETWORK:
+			fprintf(stderr, "[%s] %s\n", context->os_name? context->os_name : "?", (char*)data2);
+			break;
+
+		case DC_EVENT_CONFIGURE_PROGRESS:
+			if (data1==1000 || data1==0) {
+				account->configure_result = data1? 1 : -1;
+			}
+			break;
+
+		case DC_EVENT_IMAP_CONNECTED:
+		case DC_EVENT_SMTP_CONNECTED:
+			pthread_mutex_lock(&s_mutex);
+				account->connects++;
+			pthread_mutex_unlock(&s_mutex);
+			break;
+
+		case DC_EVENT_INCOMING_MSG:
+			/* only remember id and time here, the message text is read after the test */
+			pthread_mutex_lock(&s_mutex);
+				if (s_received_cnt<s_received_max) {
+					s_received_ids[s_received_cnt] = (uint32_t)data2;
+					s_received_ms[s_received_cnt] = now_ms();
+					s_received_cnt++;
+				}
+			pthread_mutex_unlock(&s_mutex);
+			break;
+	}
+
+	return 0;
+}
+
+
+/*******************************************************************************
+ * Accounts and threads
+ ******************************************************************************/
+
+
+static void* imap_thread_entry_point(void* entry_arg)
+{
+	loadtest_account_t* account = (loadtest_account_t*)entry_arg;
+
+	while (account->run_threads) {
+		dc_perform_imap_jobs(account->context);
+		dc_perform_imap_fetch(account->context);
+		if (account->run_threads) {
+			dc_perform_imap_idle(account->context);
+		}
+	}
+
+	return NULL;
+}
+
+
+static void* mvbox_thread_entry_point(void* entry_arg)
+{
+	loadtest_account_t* account = (loadtest_account_t*)entry_arg;
+
+	while (account->run_threads) {
+		dc_perform_mvbox_fetch(account->context);
+		if (account->run_threads) {
+			dc_perform_mvbox_idle(account->context);
+		}
+	}
+
+	return NULL;
+}
+
+
+static void* sentbox_thread_entry_point(void* entry_arg)
+{
+	loadtest_account_t* account = (loadtest_account_t*)entry_arg;
+
+	while (account->run_threads) {
+		dc_perform_sentbox_fetch(account->context);
+		if (account->run_threads) {
+			dc_perform_sentbox_idle(account->context);
+		}
+	}
+
+	return NULL;
+}
+
+
+static void* smtp_thread_entry_point(void* entry_arg)
+{
+	loadtest_account_t* account = (loadtest_account_t*)entry_arg;
+
+	while (account->run_threads) {
+		dc_perform_smtp_jobs(account->context);
+		if (account->run_threads) {
+			dc_perform_smtp_idle(account->context);
+		}
+	}
+
+	return NULL;
+}
+
+
+static loadtest_account_t* create_account(const char* dir, const char* name, testserver_t* server)
+{
+	loadtest_account_t* account = calloc(1, sizeof(loadtest_account_t));
+	char*               dbfile = dc_mprintf("%s/%s.db", dir, name);
+	char*               addr = dc_mprintf("%s@loadtest.local", name);
+	char*               imap_port = dc_mprintf("%i", testserver_get_imap_port(server));
+	char*               smtp_port = dc_mprintf("%i", testserver_get_smtp_port(server));
+	char*               server_flags = dc_mprintf("%i", DC_LP_AUTH_NORMAL|DC_LP_IMAP_SOCKET_PLAIN|DC_LP_SMTP_SOCKET_PLAIN);
+
+	account->context = dc_context_new(loadtest_event, account, name);
+	if (!dc_open(account->context, dbfile, NULL)) {
+		fprintf(stderr, "Cannot open %s.\n", dbfile);
+		exit(1);
+	}
+
+	/* setting the server manually skips autoconfig, TLS is not supported by the test server */
+	dc_set_config(account->context, "addr", addr);
+	dc_set_config(account->context, "mail_pw", "loadtest");
+	dc_set_config(account->context, "mail_server", "127.0.0.1");
+	dc_set_config(account->context, "mail_port", imap_port);
+	dc_set_config(account->context, "send_server", "127.0.0.1");
+	dc_set_config(account->context, "send_port", smtp_port);
+	dc_set_config(account->context, "server_flags", server_flags);
+
+	account->run_threads = 1;
+	pthread_create(&account->imap_thread, NULL, imap_thread_entry_point, account);
+	pthread_create(&account->mvbox_thread, NULL, mvbox_thread_entry_point, account);
+	pthread_create(&account->sentbox_thread, NULL, sentbox_thread_entry_point, account);
+	pthread_create(&account->smtp_thread, NULL, smtp_thread_entry_point, account);
+
+	dc_configure(account->context);
+
+	free(server_flags);
+	free(smtp_port);
+	free(imap_port);
+	free(addr);
+	free(dbfile);
+	return account;
+}
+
+
+static void free_account(loadtest_account_t* account)
+{
+	account->run_threads = 0;
+	dc_interrupt_imap_idle(account->context);
+	dc_interrupt_mvbox_idle(account->context);
+	dc_interrupt_sentbox_idle(account->context);
+	dc_interrupt_smtp_idle(account->context);
+
+	pthread_join(account->imap_thread, NULL);
+	pthread_join(account->mvbox_thread, NULL);
+	pthread_join(account->sentbox_thread, NULL);
+	pthread_join(account->smtp_thread, NULL);
+
+	dc_close(account->context);
+	dc_context_unref(account->context);
+	free(account);
+}
+
+
+static int wait_for_configure(loadtest_account_t* account)
+{
+	double start = now_ms();
+	while (account->configure_result==0 && now_ms()-start<LOADTEST_TIMEOUT_MS) {
+		usleep(50*1000);
+	}
+	return account->configure_result==1;
+}
+
+
+/*******************************************************************************
+ * Load tests
+ ******************************************************************************/
+
+
+static testserver_options_t get_options(int argc, char** argv, int first)
+{
+	testserver_options_t options;
+	memset(&options, 0, sizeof(testserver_options_t));
+	options.latency_ms    = argc>first?   atoi(argv[first])   : 0;
+	options.bytes_per_sec = argc>first+1? atoi(argv[first+1]) : 0;
+	options.drop_after    = argc>first+2? atoi(argv[first+2]) : 0;
+	return options;
+}
+
+
+int loadtest_functions(int argc, char** argv)
+{
+	int                  msg_cnt = argc>0? atoi(argv[0]) : 100;
+	testserver_options_t options = get_options(argc, argv, 1);
+	testserver_t*        server = NULL;
+	testserver_stats_t   stats;
+	char                 dir[] = "/tmp/deltachat-loadtest-XXXXXX";
+	loadtest_account_t*  alice = NULL;
+	loadtest_account_t*  bob = NULL;
+	double*              sent_ms = NULL;
+	double*              latencies = NULL;
+	int                  latency_cnt = 0;
+	double               first_sent_ms = 0;
+	double               last_received_ms = 0;
+	int                  received_cnt = 0;
+	int                  ret = 1;
+
+	if (msg_cnt<1) {
+		fprintf(stderr, "Usage: --loadtest [<msgs> [<latency-ms> [<bytes-per-sec> [<drop-after>]]]]\n");
+		return 1;
+	}
+
+	if (mkdtemp(dir)==NULL) {
+		fprintf(stderr, "Cannot create temporary directory.\n");
+		return 1;
+	}
+
+	if ((server=testserver_start(&options))==NULL) {
+		fprintf(stderr, "Cannot start test server.\n");
+		goto cleanup;
+	}
+
+	s_received_max = msg_cnt;
+	s_received_ids = calloc(msg_cnt, sizeof(uint32_t));
+	s_received_ms  = calloc(msg_cnt, sizeof(double));
+	sent_ms        = calloc(msg_cnt, sizeof(double));
+	latencies      = calloc(msg_cnt, sizeof(double));
+
+	alice = create_account(dir, "alice", server);
+	bob   = create_account(dir, "bob", server);
+	if (!wait_for_configure(alice) || !wait_for_configure(bob)) {
+		fprintf(stderr, "Cannot configure the accounts.\n");
+		goto cleanup;
+	}
+
+	/* alice creates the chat before, otherwise the messages go to the deaddrop without DC_EVENT_INCOMING_MSG */
+	dc_create_chat_by_contact_id(alice->context, dc_create_contact(alice->context, "Bob", "bob@loadtest.local"));
+	uint32_t chat_id = dc_create_chat_by_contact_id(bob->context, dc_create_contact(bob->context, "Alice", "alice@loadtest.local"));
+
+	first_sent_ms = now_ms();
+	for (int i = 0; i<msg_cnt; i++) {
+		char* text = dc_mprintf("loadtest %i", i);
+		sent_ms[i] = now_ms();
+		dc_send_text_msg(bob->context, chat_id, text);
+		free(text);
+	}
+
+	/* wait until all messages are received or nothing happens for some time */
+	{
+		int    last_cnt = 0;
+		double last_progress_ms = now_ms();
+		while (1) {
+			pthread_mutex_lock(&s_mutex);
+				received_cnt = s_received_cnt;
+			pthread_mutex_unlock(&s_mutex);
+
+			if (received_cnt>=msg_cnt) {
+				break;
+			}
+			else if (received_cnt>last_cnt) {
+				last_cnt = received_cnt;
+				last_progress_ms = now_ms();
+			}
+			else if (now_ms()-last_progress_ms>LOADTEST_TIMEOUT_MS) {
+				fprintf(stderr, "Timeout, %i of %i messages received.\n", received_cnt, msg_cnt);
+				break;
+			}
+			usleep(10*1000);
+		}
+	}
+
+	/* match the received messages with the sending time by the text */
+	for (int i = 0; i<received_cnt; i++) {
+		dc_msg_t* msg = dc_get_msg(alice->context, s_received_ids[i]);
+		char*     text = dc_msg_get_text(msg);
+		int       index = -1;
+		if (sscanf(text, "loadtest %i", &index)==1 && index>=0 && index<msg_cnt) {
+			latencies[latency_cnt++] = s_received_ms[i]-sent_ms[index];
+		}
+		if (s_received_ms[i]>last_received_ms) {
+			last_received_ms = s_received_ms[i];
+		}
+		free(text);
+		dc_msg_unref(msg);
+	}
+	qsort(latencies, latency_cnt, sizeof(double), cmp_double);
+
+	double sum_ms = 0;
+	for (int i = 0; i<latency_cnt; i++) {
+		sum_ms += latencies[i];
+	}
+
+	testserver_get_stats(server, &stats);
+
+	/* the first connect of each of the 4 threads per account is not a reconnect */
+	#define PCT(p) (latency_cnt? latencies[(latency_cnt-1)*(p)/100] : 0.0)
+	printf("{\"loadtest\":\"deltachat-core\",\"version\":\"%s\",\"msgs\":%i,\"received\":%i,"
+		"\"latency_ms_option\":%i,\"bytes_per_sec_option\":%i,\"drop_after_option\":%i,"
+		"\"msgs_per_sec\":%.3f,"
+		"\"latency_ms\":{\"min\":%.3f,\"avg\":%.3f,\"p50\":%.3f,\"p95\":%.3f,\"max\":%.3f},"
+		"\"connects\":{\"alice\":%i,\"bob\":%i},"
+		"\"server\":{\"connections\":%i,\"dropped\":%i,\"delivered\":%i,\"bytes_sent\":%llu}}\n",
+		DC_VERSION_STR, msg_cnt, received_cnt,
+		options.latency_ms, options.bytes_per_sec, options.drop_after,
+		(received_cnt && last_received_ms>first_sent_ms)? received_cnt*1000.0/(last_received_ms-first_sent_ms) : 0.0,
+		PCT(0), latency_cnt? sum_ms/latency_cnt : 0.0, PCT(50), PCT(95), PCT(100),
+		alice->connects, bob->connects,
+		stats.connections, stats.dropped, stats.delivered, (unsigned long long)stats.bytes_sent);
+
+	ret = received_cnt==msg_cnt? 0 : 1;
+
+cleanup:
+	if (alice) { free_account(alice); }
+	if (bob) { free_account(bob); }
+	testserver_stop(server);
+	bench_delete_dir(dir);
+	free(s_received_ids);
+	free(s_received_ms);
+	s_received_ids = NULL;
+	s_received_ms = NULL;
+	s_received_cnt = 0;
+	s_received_max = 0;
+	free(sent_ms);
+	free(latencies);
+	return ret;
+}
+
+
+int loadtest_run_server(int argc, char** argv)
+{
+	testserver_options_t options = get_options(argc, argv, 2);
+	testserver_t*        server = NULL;
+	testserver_stats_t   stats;
+
+	options.imap_port = argc>0? atoi(argv[0]) : 0;
+	options.smtp_port = argc>1? atoi(argv[1]) : 0;
+
+	if ((server=testserver_start(&options))==NULL) {
+		fprintf(stderr, "Cannot start test server.\n");
+		return 1;
+	}
+
+	printf("{\"imap_port\":%i,\"smtp_port\":%i}\n", testserver_get_imap_port(server), testserver_get_smtp_port(server));
+	fflush(stdout);
+
+	while (getchar()!=EOF) {
+		;
+	}
+
+	testserver_get_stats(server, &stats);
+	testserver_stop(server);
+	fprintf(stderr, "%i connections, %i dropped, %i delivered, %llu bytes sent\n",
+		stats.connections, stats.dropped, stats.delivered, (unsigned long long)stats.bytes_sent);
+	return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef __LOADTEST_H__
+#define __LOADTEST_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+int loadtest_functions  (int argc, char** argv);
+int loadtest_run_server (int argc, char** argv);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __LOADTEST_H__ */
@@ -12,6 +12,8 @@ all further options can be set using the set-command (type ? for help). */
 #include "../src/dc_context.h"
 #include "cmdline.h"
 #include "stress.h"
+#include "bench.h"
+#include "loadtest.h"
 
 
 /*******************************************************************************
@@ -288,6 +290,19 @@ int main(int argc, char ** argv)
 	dc_context_t* context = dc_context_new(receive_event, NULL, "CLI");
 	int           stresstest_only = 0;
 
+	if (argc>=2 && strcmp(argv[1], "--bench")==0) {
+		dc_context_unref(context);
+		return bench_functions(argc-2, &argv[2]); /* creates its own accounts in a temporary directory */
+	}
+	else if (argc>=2 && strcmp(argv[1], "--loadtest")==0) {
+		dc_context_unref(context);
+		return loadtest_functions(argc-2, &argv[2]); /* runs a local mail server and two accounts */
+	}
+	else if (argc>=2 && strcmp(argv[1], "--testserver")==0) {
+		dc_context_unref(context);
+		return loadtest_run_server(argc-2, &argv[2]); /* runs until stdin is closed */
+	}
+
 	dc_cmdline_skip_auth(context); /* disable the need to enter the command `auth <password>` for all mailboxes. */
 
 	/* open database from the commandline (if omitted, it can be opened using the `open`-command) */
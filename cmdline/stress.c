@@ -5,6 +5,7 @@ $ valgrind --leak-check=full --tool=memcheck ./deltachat-core <db>
 
 
 #include <ctype.h>
+#include <math.h>
 #include <assert.h>
 #include "../src/dc_context.h"
 #include "../src/dc_simplify.h"
@@ -15,6 +16,10 @@ $ valgrind --leak-check=full --tool=memcheck ./deltachat-core <db>
 #include "../src/dc_aheader.h"
 #include "../src/dc_keyring.h"
 #include "../src/dc_saxparser.h"
+#include "../src/dc_codec.h"
+#include "../src/dc_dehtml.h"
+#include "../src/dc_arena.h"
+#include "bench.h"
 
 
 /* some data used for testing
@@ -151,6 +156,185 @@ static const char* s_em_setupfile =
 "-----END PGP MESSAGE-----\n";
 
 
+static void stress_text_cb(void* userdata, const char* text, int len)
+{
+	assert( strlen(text)==(size_t)len );
+}
+
+
+static dc_context_t* stress_create_account(const char* dir, const char* name, const char* addr)
+{
+	/* an account that is not connected to any server, messages are passed using stress_transfer() */
+	dc_context_t* context = dc_context_new(NULL, NULL, "stress");
+	char*         dbfile = dc_mprintf("%s/%s.db", dir, name);
+
+	assert( dc_open(context, dbfile, NULL) );
+	dc_set_config(context, "addr", addr);
+	dc_sqlite3_set_config(context->sql, "configured_addr", addr);
+	dc_sqlite3_set_config_int(context->sql, "configured", 1);
+	dc_ensure_secret_key_exists(context);
+
+	free(dbfile);
+	return context;
+}
+
+
+static void stress_transfer(dc_mimefactory_t* factory, dc_context_t* receiver)
+{
+	/* render a loaded message or read receipt and pass it to the receiver as if fetched from the server */
+	static uint32_t server_uid = 0;
+	assert( dc_mimefactory_render(factory) );
+	dc_receive_imf(receiver, factory->out->str, factory->out->len, "INBOX", ++server_uid, 0);
+	dc_mimefactory_empty(factory);
+}
+
+
+/* the former implementation of dc_simplify_simplify() that splits the text into single strings,
+used to check that the current implementation works exactly the same way
+ ******************************************************************************/
+
+static int ref_is_empty_line(const char* buf)
+{
+	for (const unsigned char* p1 = (const unsigned char*)buf; *p1; p1++) {
+		if (*p1 > ' ') {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+static int ref_is_quoted_headline(const char* buf)
+{
+	int buf_len = strlen(buf);
+	return buf_len<=80 && buf_len>0 && buf[buf_len-1]==':';
+}
+
+
+static char* ref_simplify(dc_simplify_t* simplify, const char* in, int in_bytes, int is_html, int is_msgrmsg)
+{
+	if (in_bytes<=0) {
+		return dc_strdup("");
+	}
+
+	simplify->is_forwarded    = 0;
+	simplify->is_cut_at_begin = 0;
+	simplify->is_cut_at_end   = 0;
+
+	char* out = strndup(in, in_bytes);
+	if (is_html) {
+		char* temp = dc_dehtml(out);
+		free(out);
+		out = temp;
+	}
+	dc_remove_cr_chars(out);
+
+	carray* lines = dc_split_into_lines(out);
+	int     l = 0, l_first = 0, l_last = carray_count(lines)-1;
+	#define REF_LINE(l) ((char*)carray_get(lines, (l)))
+
+	for (l = l_first; l <= l_last; l++) {
+		int footer_mark = strcmp(REF_LINE(l), "-- ")==0 || strcmp(REF_LINE(l), "--  ")==0;
+		if (strcmp(REF_LINE(l), "--")==0 || strcmp(REF_LINE(l), "---")==0 || strcmp(REF_LINE(l), "----")==0) {
+			footer_mark = 1;
+			simplify->is_cut_at_end = 1;
+		}
+		if (footer_mark) {
+			l_last = l - 1;
+			break;
+		}
+	}
+
+	if ((l_last-l_first+1) >= 3
+	 && strcmp(REF_LINE(l_first), "---------- Forwarded message ----------")==0
+	 && strncmp(REF_LINE(l_first+1), "From: ", 6)==0
+	 && REF_LINE(l_first+2)[0]==0) {
+		simplify->is_forwarded = 1;
+		l_first += 3;
+	}
+
+	for (l = l_first; l <= l_last; l++) {
+		if (strncmp(REF_LINE(l), "-----", 5)==0 || strncmp(REF_LINE(l), "_____", 5)==0 || strncmp(REF_LINE(l), "=====", 5)==0
+		 || strncmp(REF_LINE(l), "*****", 5)==0 || strncmp(REF_LINE(l), "~~~~~", 5)==0) {
+			l_last = l - 1;
+			simplify->is_cut_at_end = 1;
+			break;
+		}
+	}
+
+	if (!is_msgrmsg) {
+		int l_lastQuotedLine = -1;
+		for (l = l_last; l >= l_first; l--) {
+			if (REF_LINE(l)[0]=='>') {
+				l_lastQuotedLine = l;
+			}
+			else if (!ref_is_empty_line(REF_LINE(l))) {
+				break;
+			}
+		}
+		if (l_lastQuotedLine != -1) {
+			l_last = l_lastQuotedLine-1;
+			simplify->is_cut_at_end = 1;
+			if (l_last > 0 && ref_is_empty_line(REF_LINE(l_last))) {
+				l_last--;
+			}
+			if (l_last > 0 && ref_is_quoted_headline(REF_LINE(l_last))) {
+				l_last--;
+			}
+		}
+
+		l_lastQuotedLine = -1;
+		int hasQuotedHeadline = 0;
+		for (l = l_first; l <= l_last; l++) {
+			if (REF_LINE(l)[0]=='>') {
+				l_lastQuotedLine = l;
+			}
+			else if (!ref_is_empty_line(REF_LINE(l))) {
+				if (ref_is_quoted_headline(REF_LINE(l)) && !hasQuotedHeadline && l_lastQuotedLine==-1) {
+					hasQuotedHeadline = 1;
+				}
+				else {
+					break;
+				}
+			}
+		}
+		if (l_lastQuotedLine != -1) {
+			l_first = l_lastQuotedLine + 1;
+			simplify->is_cut_at_begin = 1;
+		}
+	}
+
+	dc_strbuilder_t ret;
+	dc_strbuilder_init(&ret, 0);
+	if (simplify->is_cut_at_begin) {
+		dc_strbuilder_cat(&ret, DC_EDITORIAL_ELLIPSE " ");
+	}
+	int pending_linebreaks = 0, content_lines_added = 0;
+	for (l = l_first; l <= l_last; l++) {
+		if (ref_is_empty_line(REF_LINE(l))) {
+			pending_linebreaks++;
+		}
+		else {
+			if (content_lines_added) {
+				for (pending_linebreaks = pending_linebreaks>2? 2 : pending_linebreaks; pending_linebreaks; pending_linebreaks--) {
+					dc_strbuilder_cat(&ret, "\n");
+				}
+			}
+			dc_strbuilder_cat(&ret, REF_LINE(l));
+			content_lines_added++;
+			pending_linebreaks = 1;
+		}
+	}
+	if (simplify->is_cut_at_end && (!simplify->is_cut_at_begin || content_lines_added)) {
+		dc_strbuilder_cat(&ret, " " DC_EDITORIAL_ELLIPSE);
+	}
+
+	dc_free_splitted_lines(lines);
+	free(out);
+	return ret.buf;
+}
+
+
 void stress_functions(dc_context_t* context)
 {
 	/* test dc_saxparser_t
@@ -161,6 +345,24 @@ void stress_functions(dc_context_t* context)
 		dc_saxparser_init(&saxparser, NULL);
 		dc_saxparser_parse(&saxparser, "<tag attr=val="); // should not crash or cause a deadlock
 		dc_saxparser_parse(&saxparser, "<tag attr=\"val\"="); // should not crash or cause a deadlock
+
+		/* random snippets, the decoded text must be null-terminated at the given length */
+		static const char* snippets[] = { "<", ">", "/", "=", "\"", "'", " ", "\r", "\n", "a", "&", "#", "x", "3", ";", "&#", "&#x",
+			"&lt;", "&auml;", "&thetasym;", "&#228;", "&#x20AC;", "&noent;", "<![CDATA[", "]]>", "<!--", "-->", "<?", "?>",
+			"<!DOCTYPE", "]>", "<p", "<a href=", "</" };
+		char     text[256];
+		uint32_t rnd = 1;
+		dc_saxparser_set_text_handler(&saxparser, stress_text_cb);
+		for (int i = 0; i < 50000; i++)
+		{
+			text[0] = 0;
+			rnd = rnd*1103515245 + 12345;
+			for (int j = (rnd>>16)%20; j > 0; j--) {
+				rnd = rnd*1103515245 + 12345;
+				strcat(text, snippets[(rnd>>16)%(sizeof(snippets)/sizeof(snippets[0]))]);
+			}
+			dc_saxparser_parse(&saxparser, text);
+		}
 	}
 
 	/* test dc_simplify_t and dc_saxparser_t (indirectly used by dc_simplify_t)
@@ -189,6 +391,47 @@ void stress_functions(dc_context_t* context)
 		assert( strcmp(plain, "<>\"'& äÄöÖüÜß fooÆçÇ ♦&noent;")==0 );
 		free(plain);
 
+		html = "&amp;lt; &#228;&#xE4;&#x20AC;&#x1F600; &#0;&#x110000;&#xyz;&#65 &auml &thetasym;";
+		plain = dc_simplify_simplify(simplify, html, strlen(html), 1, 0);
+		assert( strcmp(plain, "&lt; ää€😀 &#0;&#x110000;&#xyz;&#65 &auml ϑ")==0 );
+		free(plain);
+
+		html = "<a href=a&amp;b>1</a> <a href=\"c&#x20;d\"/>2</a> <a href\n>3</a>";
+		plain = dc_simplify_simplify(simplify, html, strlen(html), 1, 0);
+		assert( strcmp(plain, "[1](a&b) [](c d)2 [3]()")==0 );
+		free(plain);
+
+		/* compare against the former implementation using texts built from random lines */
+		static const char* pieces[] = { "-- ", "--  ", "--", "---", "----", "----- Original -----", "_____", "=====",
+			"*****", "~~~~~", "> quote", ">", "", " ", "\t", "text", "On 01.02.2016, xy@z wrote:", "From: foo",
+			"---------- Forwarded message ----------", "a:", "\r", "<br>", "<p>para</p>", "<b>bold</b>",
+			"<a href=url>text</a>", "&amp;", "<pre>x\ny</pre>", "<style>x</style>", "\r\n", " \r" };
+		dc_simplify_t* ref = dc_simplify_new();
+		char     text[1024];
+		uint32_t rnd = 1;
+		for (int i = 0; i < 20000; i++)
+		{
+			int text_bytes = 0;
+			rnd = rnd*1103515245 + 12345;
+			for (int j = (rnd>>16)%12; j > 0; j--) {
+				rnd = rnd*1103515245 + 12345;
+				const char* piece = pieces[(rnd>>16)%(sizeof(pieces)/sizeof(pieces[0]))];
+				strcpy(&text[text_bytes], piece);
+				text_bytes += strlen(piece);
+				text[text_bytes++] = (rnd&0x300)? '\n' : ' ';
+			}
+			int is_html = (i%3)==0, is_msgrmsg = (i%4)==0;
+			char* plain1 = ref_simplify(ref, text, text_bytes, is_html, is_msgrmsg);
+			char* plain2 = dc_simplify_simplify(simplify, text, text_bytes, is_html, is_msgrmsg);
+			assert( strcmp(plain1, plain2)==0 );
+			assert( ref->is_forwarded==simplify->is_forwarded );
+			assert( ref->is_cut_at_begin==simplify->is_cut_at_begin );
+			assert( ref->is_cut_at_end==simplify->is_cut_at_end );
+			free(plain1);
+			free(plain2);
+		}
+		dc_simplify_unref(ref);
+
 		dc_simplify_unref(simplify);
 	}
 
@@ -306,6 +549,82 @@ void stress_functions(dc_context_t* context)
 		mailmime_free(mime);
 	}
 
+	/* test base64 and quoted-printable codecs against libetpan, with all instruction sets
+	**************************************************************************/
+
+	{
+		char* enc = dc_base64_encode("foobar", 6);
+		assert( strcmp(enc, "Zm9vYmFy")==0 );
+		free(enc);
+
+		enc = dc_base64_encode("fooba", 5);
+		assert( strcmp(enc, "Zm9vYmE=")==0 );
+		free(enc);
+
+		size_t dec_bytes = 0;
+		char*  dec = dc_base64_decode("Zm9v\r\nYmE=", 10, &dec_bytes);
+		assert( dec_bytes==5 && strncmp(dec, "fooba", 5)==0 );
+		free(dec);
+		assert( dc_base64_decode("\r\n==", 4, &dec_bytes)==NULL && dec_bytes==0 );
+
+		#define CODEC_TEST_BYTES 3000
+		unsigned char* bin = malloc(CODEC_TEST_BYTES);
+		uint32_t       rnd = 1;
+		for (int i = 0; i<CODEC_TEST_BYTES; i++) {
+			rnd = rnd*1103515245 + 12345;
+			bin[i] = rnd>>16;
+		}
+
+		for (int simd = DC_CODEC_SCALAR; simd<=DC_CODEC_AVX2; simd++)
+		{
+			dc_codec_set_simd(simd);
+			for (int bytes = 0; bytes<CODEC_TEST_BYTES; bytes += 1+bytes/3)
+			{
+				enc = dc_base64_encode(bin, bytes);
+				char* ref = encode_base64((const char*)bin, bytes);
+				assert( strcmp(enc, ref)==0 );
+				free(ref);
+
+				/* wrapped as in MIME, an invalid character every now and then */
+				char* wrapped = dc_insert_breaks(enc, 76, "\r\n");
+				if (bytes%7==3) { wrapped[bytes/2] = '!'; }
+
+				size_t indx = 0, ref_bytes = 0;
+				char*  to_unref = NULL;
+				assert( mailmime_base64_body_parse(wrapped, strlen(wrapped), &indx, &ref, &ref_bytes)==MAILIMF_NO_ERROR );
+				assert( dc_transfer_decode(wrapped, strlen(wrapped), MAILMIME_MECHANISM_BASE64, &to_unref, &dec_bytes) );
+				assert( dec_bytes==ref_bytes && memcmp(to_unref, ref, dec_bytes)==0 );
+				mmap_string_unref(to_unref);
+				mmap_string_unref(ref);
+				free(wrapped);
+				free(enc);
+			}
+		}
+
+		const char* qp = "Gr=C3=BC=C3=9Fe_=\r\nund =3D\nnoch=20=\nwas\r\rEnde\r\nab=cd=\r\n=XY=";
+		for (int simd = DC_CODEC_SCALAR; simd<=DC_CODEC_AVX2; simd++)
+		{
+			dc_codec_set_simd(simd);
+			for (size_t len = 0; len<=strlen(qp); len++)
+			{
+				if (len>=2 && qp[len-2]=='=' && qp[len-1]!='\r' && qp[len-1]!='\n') {
+					continue; /* libetpan reads behind the data for an incomplete escape at the end */
+				}
+				size_t indx = 0, ref_bytes = 0;
+				char*  ref = NULL;
+				char*  to_unref = NULL;
+				assert( mailmime_quoted_printable_body_parse(qp, len, &indx, &ref, &ref_bytes, 0)==MAILIMF_NO_ERROR );
+				assert( dc_transfer_decode(qp, len, MAILMIME_MECHANISM_QUOTED_PRINTABLE, &to_unref, &dec_bytes) );
+				assert( dec_bytes==ref_bytes && memcmp(to_unref, ref, dec_bytes)==0 );
+				mmap_string_unref(to_unref);
+				mmap_string_unref(ref);
+			}
+		}
+
+		dc_codec_set_simd(DC_CODEC_AVX2);
+		free(bin);
+	}
+
 	/* test dc_mimeparser_t
 	**************************************************************************/
 
@@ -346,9 +665,119 @@ void stress_functions(dc_context_t* context)
 
 		assert( carray_count(mimeparser->parts) == 1 );
 
+		/* the same object is reused for the next message, the parts come from the reset arena */
+		dc_mimepart_t* part = (dc_mimepart_t*)carray_get(mimeparser->parts, 0);
+		assert( strncmp(part->msg_raw, "test1", 5)==0 );
+
+		raw =
+			"Subject: second-subject\n"
+			"Chat-Version: 1.0\n"
+			"\n"
+			"test2\n";
+		dc_mimeparser_parse(mimeparser, raw, strlen(raw));
+
+		assert( strcmp(mimeparser->subject, "second-subject")==0 );
+		assert( dc_mimeparser_lookup_optional_field(mimeparser, "X-Special-A")==NULL );
+		assert( carray_count(mimeparser->parts) == 1 );
+		part = (dc_mimepart_t*)carray_get(mimeparser->parts, 0);
+		assert( strcmp(part->msg, "test2")==0 );
+		assert( dc_param_exists(part->param, DC_PARAM_GUARANTEE_E2EE)==0 );
+
 		dc_mimeparser_unref(mimeparser);
 	}
 
+	/* test dc_arena_t
+	**************************************************************************/
+
+	{
+		dc_arena_t arena;
+		dc_arena_init(&arena, 1024);
+
+		char* str = dc_arena_strndup(&arena, "ab\0cd", 5);
+		assert( memcmp(str, "ab\0cd\0", 6)==0 );
+		assert( strcmp(dc_arena_strdup(&arena, NULL), "")==0 );
+		assert( strcmp(dc_arena_mprintf(&arena, "%s-%i", "foo", 42), "foo-42")==0 );
+
+		/* small allocations fill several chunks, large ones get chunks of their own */
+		for (int round = 0; round < 2; round++) {
+			char* ptrs[200];
+			for (int i = 0; i < 200; i++) {
+				size_t bytes = (i%10==9)? 5000 : i+1;
+				ptrs[i] = dc_arena_alloc(&arena, bytes);
+				assert( ((uintptr_t)ptrs[i] % 16)==0 );
+				memset(ptrs[i], i, bytes);
+			}
+			for (int i = 0; i < 200; i++) {
+				size_t bytes = (i%10==9)? 5000 : i+1;
+				assert( (unsigned char)ptrs[i][0]==i && (unsigned char)ptrs[i][bytes-1]==i );
+			}
+			dc_arena_reset(&arena);
+		}
+
+		/* after a reset, one chunk is kept for reuse */
+		void* first = dc_arena_alloc(&arena, 8);
+		dc_arena_reset(&arena);
+		assert( dc_arena_alloc(&arena, 8)==first );
+
+		dc_arena_free(&arena);
+		assert( arena.chunks==NULL );
+		dc_arena_free(&arena);
+	}
+
+	/* test dc_hash_t
+	**************************************************************************/
+
+	{
+		dc_hash_t str_hash;
+		dc_hash_init(&str_hash, DC_HASH_STRING, DC_HASH_COPY_KEY);
+		char key[64];
+		strcpy(key, "Chat-Group-ID");
+		assert( dc_hash_insert_str(&str_hash, key, (void*)1)==NULL );
+		strcpy(key, "fingerprint-longer-than-the-inline-key-buffer-0123456789");
+		assert( dc_hash_insert_str(&str_hash, key, (void*)2)==NULL );
+		memset(key, 0, sizeof(key));
+		assert( dc_hash_find_str(&str_hash, "chat-group-id")==(void*)1 );
+		assert( dc_hash_find_str(&str_hash, "CHAT-GROUP-ID")==(void*)1 );
+		assert( dc_hash_find_str(&str_hash, "Chat-Group-IDs")==NULL );
+		assert( dc_hash_find_str(&str_hash, "FINGERPRINT-longer-than-the-inline-key-buffer-0123456789")==(void*)2 );
+		assert( dc_hash_insert_str(&str_hash, "chat-group-id", (void*)3)==(void*)1 );
+		assert( dc_hash_cnt(&str_hash)==2 );
+		assert( dc_hash_insert_str(&str_hash, "CHAT-GROUP-ID", NULL)==(void*)3 );
+		assert( dc_hash_find_str(&str_hash, "Chat-Group-ID")==NULL );
+		assert( dc_hash_cnt(&str_hash)==1 );
+		dc_hash_clear(&str_hash);
+		assert( dc_hash_cnt(&str_hash)==0 );
+		assert( dc_hash_first(&str_hash)==NULL );
+		dc_hash_clear(&str_hash);
+
+		/* random inserts, updates and deletions, checked against a plain array */
+		#define HASH_TEST_KEYS 500
+		dc_hash_t int_hash;
+		uintptr_t expected[HASH_TEST_KEYS];
+		dc_hash_init(&int_hash, DC_HASH_INT, 0);
+		uint32_t  rnd = 1;
+		memset(expected, 0, sizeof(expected));
+		for (int i = 0; i < 20000; i++) {
+			rnd = rnd*1103515245 + 12345;
+			int       k = (rnd>>16)%HASH_TEST_KEYS;
+			uintptr_t d = ((rnd>>28)%4)? (uintptr_t)i+1 : 0;
+			assert( (uintptr_t)dc_hash_insert(&int_hash, NULL, k*65536, (void*)d)==expected[k] );
+			expected[k] = d;
+		}
+		int cnt = 0;
+		for (int k = 0; k < HASH_TEST_KEYS; k++) {
+			assert( (uintptr_t)dc_hash_find(&int_hash, NULL, k*65536)==expected[k] );
+			cnt += expected[k]? 1 : 0;
+		}
+		assert( dc_hash_cnt(&int_hash)==cnt );
+		for (dc_hashelem_t* elem = dc_hash_first(&int_hash); elem; elem = dc_hash_next(elem)) {
+			assert( (uintptr_t)dc_hash_data(elem)==expected[dc_hash_keysize(elem)/65536] );
+			cnt--;
+		}
+		assert( cnt==0 );
+		dc_hash_clear(&int_hash);
+	}
+
 	/* test message helpers
 	 **************************************************************************/
 
@@ -664,6 +1093,45 @@ void stress_functions(dc_context_t* context)
 		str = dc_arr_to_string(arr2, 4);
 		assert( strcmp(str, "0,12,133,1999999")==0 );
 		free(str);
+
+		size_t idx = 0;
+		assert( dc_array_search_id(arr, 666, &idx) && idx==3 ); /* binary search on the sorted array */
+		assert( dc_array_search_id(arr, 0, &idx) && idx==0 );
+		assert( !dc_array_search_id(arr, 8, NULL) );
+		assert( !dc_array_search_id(arr, 6000, NULL) );
+		assert( dc_array_get_raw(arr)[4]==5000 );
+
+		dc_array_empty(arr);
+		dc_array_add_id(arr, 5); dc_array_add_id(arr, 3); dc_array_add_id(arr, 5);
+		dc_array_add_id(arr, 9); dc_array_add_id(arr, 3); dc_array_add_id(arr, 1);
+		assert( dc_array_search_id(arr, 9, &idx) && idx==3 ); /* linear search on the unsorted array */
+		dc_array_unique_ids(arr);
+		str = dc_array_get_string(arr, ",");
+		assert( strcmp(str, "5,3,9,1")==0 ); /* order of the first occurrences is kept */
+		free(str);
+
+		dc_array_t* arr3 = dc_array_new(NULL, 3);
+		dc_array_add_id(arr3, 1); dc_array_add_id(arr3, 1); dc_array_add_id(arr3, 4); dc_array_add_id(arr3, 9);
+		dc_array_unique_ids(arr3);
+		assert( dc_array_get_cnt(arr3)==3 );
+
+		dc_array_t* res = dc_array_union_ids(arr, arr3);
+		str = dc_array_get_string(res, ",");
+		assert( strcmp(str, "1,3,4,5,9")==0 );
+		free(str);
+		dc_array_unref(res);
+
+		res = dc_array_intersect_ids(arr, arr3);
+		str = dc_array_get_string(res, ",");
+		assert( strcmp(str, "1,9")==0 );
+		free(str);
+		dc_array_unref(res);
+
+		res = dc_array_intersect_ids(arr, NULL);
+		assert( dc_array_get_cnt(res)==0 );
+		dc_array_unref(res);
+		dc_array_unref(arr3);
+
 		dc_array_empty(arr);
 
 		dc_array_add_ptr(arr, "XX");
@@ -675,8 +1143,35 @@ void stress_functions(dc_context_t* context)
 		assert( strcmp("aaa",   (char*)dc_array_get_ptr(arr, 1))==0 );
 		assert( strcmp("bbb",   (char*)dc_array_get_ptr(arr, 2))==0 );
 		assert( strcmp("item1", (char*)dc_array_get_ptr(arr, 3))==0 );
+		assert( dc_array_get_raw(arr)==NULL ); /* adding pointers converts the IDs to integers of pointer size */
 
 		dc_array_unref(arr);
+
+		dc_array_t* locations = dc_array_new_typed(NULL, DC_ARRAY_LOCATIONS, 1);
+		for (int i = 0; i < 3; i++) {
+			dc_location_t loc;
+			memset(&loc, 0, sizeof(dc_location_t));
+			loc.location_id = 10+i;
+			loc.latitude = 50.5+i;
+			loc.timestamp = 1000+i;
+			loc.marker = i==1? dc_strdup("x") : NULL;
+			dc_array_add_location(locations, &loc);
+		}
+		dc_array_add_id(locations, 99); /* ignored */
+		assert( dc_array_get_cnt(locations)==3 );
+		assert( dc_array_get_id(locations, 2)==12 );
+		assert( dc_array_get_latitude(locations, 1)>51.4 && dc_array_get_latitude(locations, 1)<51.6 );
+		assert( dc_array_get_timestamp(locations, 2)==1002 );
+		assert( ((dc_location_t*)dc_array_get_ptr(locations, 0))->location_id==10 );
+		assert( dc_array_get_raw(locations)==NULL );
+
+		dc_array_t* locations2 = dc_array_duplicate(locations);
+		dc_array_unref(locations); /* frees the markers */
+		str = dc_array_get_marker(locations2, 1);
+		assert( strcmp(str, "x")==0 );
+		free(str);
+		assert( dc_array_get_marker(locations2, 0)==NULL );
+		dc_array_unref(locations2);
 	}
 
 	/* test dc_param
@@ -700,14 +1195,14 @@ void stress_functions(dc_context_t* context)
 		dc_param_set_int(p1, 'b', 2);
 		dc_param_set    (p1, 'c', NULL);
 		dc_param_set_int(p1, 'd', 4);
-		assert( strcmp(p1->packed, "a=foo\nb=2\nd=4")==0 );
+		assert( strcmp(dc_param_get_packed(p1), "a=foo\nb=2\nd=4")==0 );
 
 		dc_param_set    (p1, 'b', NULL);
-		assert( strcmp(p1->packed, "a=foo\nd=4")==0 );
+		assert( strcmp(dc_param_get_packed(p1), "a=foo\nd=4")==0 );
 
 		dc_param_set    (p1, 'a', NULL);
 		dc_param_set    (p1, 'd', NULL);
-		assert( strcmp(p1->packed, "")==0 );
+		assert( strcmp(dc_param_get_packed(p1), "")==0 );
 
 		dc_param_unref(p1);
 	}
@@ -1068,6 +1563,256 @@ void stress_functions(dc_context_t* context)
 	}
 
 
+	/* test the event queue: coalescing, dropping if full and the minimal log level
+	 **************************************************************************/
+
+	{
+		dc_context_t* ctx = dc_context_new(NULL, NULL, "stress");
+		int           event = 0;
+		uintptr_t     data1 = 0, data2 = 0;
+		dc_enable_event_queue(ctx, 4);
+
+		// repeated changes of the same chat are merged, changes of different chats are not
+		ctx->cb(ctx, DC_EVENT_MSGS_CHANGED, 10, 100);
+		ctx->cb(ctx, DC_EVENT_MSGS_CHANGED, 11, 200);
+		ctx->cb(ctx, DC_EVENT_MSGS_CHANGED, 10, 101);
+		ctx->cb(ctx, DC_EVENT_INCOMING_MSG, 10, 100);
+		ctx->cb(ctx, DC_EVENT_INCOMING_MSG, 10, 102);
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_MSGS_CHANGED && data1==10 && data2==0 );
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_MSGS_CHANGED && data1==11 && data2==200 );
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_INCOMING_MSG && data1==10 && data2==102 );
+		assert( !dc_get_next_event(ctx, &event, &data1, &data2) );
+
+		// if the queue is full, info and warnings are dropped before changes, oldest first;
+		// the number of dropped events is reported first and only once
+		dc_log_info(ctx, 0, "info 1");
+		dc_log_warning(ctx, 0, "warning 1");
+		dc_log_info(ctx, 0, "info 2");
+		ctx->cb(ctx, DC_EVENT_MSGS_CHANGED, 10, 100);
+		ctx->cb(ctx, DC_EVENT_MSGS_CHANGED, 11, 200);
+		ctx->cb(ctx, DC_EVENT_MSGS_CHANGED, 12, 300);
+		dc_log_info(ctx, 0, "info 3");
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_WARNING && strncmp((char*)data2, "3 events dropped", 16)==0 );
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_INFO && strcmp((char*)data2, "info 2")==0 );
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_MSGS_CHANGED && data1==10 );
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_MSGS_CHANGED && data1==11 );
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_MSGS_CHANGED && data1==12 );
+		assert( !dc_get_next_event(ctx, &event, &data1, &data2) );
+
+		// without info and warnings in the queue, the oldest event is dropped
+		for (int i = 1; i <= 5; i++) {
+			ctx->cb(ctx, DC_EVENT_MSGS_CHANGED, i, 0);
+		}
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_WARNING && strncmp((char*)data2, "1 events dropped", 16)==0 );
+		for (int i = 2; i <= 5; i++) {
+			assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_MSGS_CHANGED && data1==(uintptr_t)i );
+		}
+		assert( !dc_get_next_event(ctx, &event, &data1, &data2) );
+
+		// events below the minimal log level are not queued, errors are always queued
+		dc_set_min_log_level(ctx, DC_EVENT_WARNING);
+		dc_log_info(ctx, 0, "info 4");
+		dc_log_warning(ctx, 0, "warning 2");
+		dc_set_min_log_level(ctx, DC_EVENT_ERROR+1);
+		dc_log_warning(ctx, 0, "warning 3");
+		dc_log_error(ctx, 0, "error 1");
+		dc_set_min_log_level(ctx, DC_EVENT_INFO);
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_WARNING && strcmp((char*)data2, "warning 2")==0 );
+		assert( dc_get_next_event(ctx, &event, &data1, &data2) && event==DC_EVENT_ERROR && strcmp((char*)data2, "error 1")==0 );
+		assert( !dc_get_next_event(ctx, &event, &data1, &data2) );
+
+		dc_enable_event_queue(ctx, 0);
+		dc_context_unref(ctx);
+	}
+
+
+	/* test aggregated read receipts: a single MDN marks all listed messages as read
+	 **************************************************************************/
+
+	{
+		#define MDN_TEST_MSGS 3
+		char             dir[] = "/tmp/deltachat-stress-XXXXXX";
+		dc_mimefactory_t factory;
+		uint32_t         sent_ids[MDN_TEST_MSGS];
+
+		assert( mkdtemp(dir)!=NULL );
+		dc_context_t* alice = stress_create_account(dir, "alice", "alice@stress.local");
+		dc_context_t* bob   = stress_create_account(dir, "bob",   "bob@stress.local");
+		uint32_t alice_chat_id = dc_create_chat_by_contact_id(alice, dc_create_contact(alice, "Bob", "bob@stress.local"));
+		uint32_t bob_chat_id   = dc_create_chat_by_contact_id(bob,   dc_create_contact(bob,   "Alice", "alice@stress.local"));
+
+		for (int i = 0; i < MDN_TEST_MSGS; i++) {
+			dc_msg_t* msg = dc_msg_new(alice, DC_MSG_TEXT);
+			dc_msg_set_text(msg, "read me");
+			sent_ids[i] = dc_prepare_msg(alice, alice_chat_id, msg);
+			dc_msg_unref(msg);
+
+			dc_mimefactory_init(&factory, alice);
+			assert( dc_mimefactory_load_msg(&factory, sent_ids[i]) );
+			stress_transfer(&factory, bob);
+		}
+
+		dc_array_t* received_ids = dc_get_chat_msgs(bob, bob_chat_id, 0, 0);
+		assert( dc_array_get_cnt(received_ids)==MDN_TEST_MSGS );
+
+		dc_mimefactory_init(&factory, bob);
+		assert( dc_mimefactory_load_mdn(&factory, received_ids) );
+		assert( factory.mdn_more_mids && strchr(factory.mdn_more_mids, '<')!=strrchr(factory.mdn_more_mids, '<') ); /* two Additional-Message-IDs */
+		stress_transfer(&factory, alice);
+
+		for (int i = 0; i < MDN_TEST_MSGS; i++) {
+			dc_msg_t* msg = dc_get_msg(alice, sent_ids[i]);
+			assert( dc_msg_get_state(msg)==DC_STATE_OUT_MDN_RCVD );
+			dc_msg_unref(msg);
+		}
+
+		dc_array_unref(received_ids);
+		dc_close(alice);
+		dc_close(bob);
+		dc_context_unref(alice);
+		dc_context_unref(bob);
+		bench_delete_dir(dir);
+	}
+
+
+	/* test processed reports: they are found by the precheck until housekeeping forgets them after a year
+	 **************************************************************************/
+
+	{
+		char        dir[] = "/tmp/deltachat-stress-XXXXXX";
+		const char* mids[2] = { "old-report@stress.local", "new-report@stress.local" };
+		uint32_t    msg_ids[2];
+		char*       folders[2];
+		uint32_t    uids[2];
+		int         processed[2];
+
+		assert( mkdtemp(dir)!=NULL );
+		dc_context_t* alice = stress_create_account(dir, "alice", "alice@stress.local");
+
+		dc_add_processed_report(alice, mids[0]);
+		dc_add_processed_report(alice, mids[1]);
+		dc_sqlite3_execute(alice->sql, "UPDATE reports_processed SET timestamp=1 WHERE rfc724_mid='old-report@stress.local';");
+
+		dc_lookup_rfc724_mids(alice, 2, mids, msg_ids, folders, uids, processed);
+		assert( processed[0]==1 && processed[1]==1 );
+		free(folders[0]);
+		free(folders[1]);
+
+		dc_delete_old_processed_reports(alice);
+
+		dc_lookup_rfc724_mids(alice, 2, mids, msg_ids, folders, uids, processed);
+		assert( processed[0]==0 && processed[1]==1 );
+		free(folders[0]);
+		free(folders[1]);
+
+		dc_close(alice);
+		dc_context_unref(alice);
+		bench_delete_dir(dir);
+	}
+
+
+	/* test compact storage of old location tracks: a track going north, turning west
+	and coming back south is simplified to its endpoints and corners, coordinates survive with 1e-6 degrees
+	 **************************************************************************/
+
+	{
+		#define TRACK_TEST_CNT 21
+		char          dir[] = "/tmp/deltachat-stress-XXXXXX";
+		time_t        day_begin = ((time(NULL)-10*24*60*60)/(24*60*60))*(24*60*60);
+		double        lat[TRACK_TEST_CNT], lng[TRACK_TEST_CNT];
+		time_t        timestamp[TRACK_TEST_CNT];
+
+		assert( mkdtemp(dir)!=NULL );
+		dc_context_t* alice = stress_create_account(dir, "alice", "alice@stress.local");
+		uint32_t contact_id = dc_create_contact(alice, "Bob", "bob@stress.local");
+		uint32_t chat_id = dc_create_chat_by_contact_id(alice, contact_id);
+
+		for (int i = 0; i < TRACK_TEST_CNT; i++) {
+			// 11 meter steps on the southern and western hemisphere, so that the deltas of the way back are negative;
+			// point #5 is 2 meters off the way and within the tolerance of 10 meters, #10 and #11 are the corners
+			lat[i] = i<=10? -33.0+i*0.0001 : -33.0+(TRACK_TEST_CNT-1-i)*0.0001;
+			lng[i] = i<=10? (i==5? -70.0+0.00002 : -70.0) : -70.001;
+			timestamp[i] = day_begin + 3600 + i*60;
+
+			sqlite3_stmt* stmt = dc_sqlite3_prepare(alice->sql,
+				"INSERT INTO locations (latitude, longitude, accuracy, timestamp, chat_id, from_id) VALUES (?,?,10,?,?,?);");
+			sqlite3_bind_double(stmt, 1, lat[i]);
+			sqlite3_bind_double(stmt, 2, lng[i]);
+			sqlite3_bind_int64 (stmt, 3, timestamp[i]);
+			sqlite3_bind_int   (stmt, 4, chat_id);
+			sqlite3_bind_int   (stmt, 5, contact_id);
+			assert( sqlite3_step(stmt)==SQLITE_DONE );
+			sqlite3_finalize(stmt);
+		}
+
+		// a recent location is not compacted
+		sqlite3_stmt* stmt = dc_sqlite3_prepare(alice->sql,
+			"INSERT INTO locations (latitude, longitude, accuracy, timestamp, chat_id, from_id) VALUES (-33.5,-70.5,10,?,?,?);");
+		sqlite3_bind_int64(stmt, 1, time(NULL)-60);
+		sqlite3_bind_int  (stmt, 2, chat_id);
+		sqlite3_bind_int  (stmt, 3, contact_id);
+		assert( sqlite3_step(stmt)==SQLITE_DONE );
+		sqlite3_finalize(stmt);
+
+		dc_compact_locations(alice);
+
+		stmt = dc_sqlite3_prepare(alice->sql, "SELECT (SELECT COUNT(*) FROM locations), (SELECT COUNT(*) FROM locations_tracks);");
+		assert( sqlite3_step(stmt)==SQLITE_ROW );
+		assert( sqlite3_column_int(stmt, 0)==1 );
+		assert( sqlite3_column_int(stmt, 1)==1 );
+		sqlite3_finalize(stmt);
+
+		// newest first: the recent location, then the end, the two corners and the start of the track
+		static const int kept[] = { 20, 11, 10, 0 };
+		dc_array_t* locations = dc_get_locations(alice, chat_id, contact_id, 0, 0);
+		assert( dc_array_get_cnt(locations)==5 );
+		assert( dc_array_get_latitude(locations, 0)==-33.5 && dc_array_get_id(locations, 0)!=0 );
+		for (int i = 0; i < 4; i++) {
+			assert( dc_array_get_timestamp(locations, i+1)==timestamp[kept[i]] );
+			assert( fabs(dc_array_get_latitude (locations, i+1)-lat[kept[i]]) <= 0.000001 );
+			assert( fabs(dc_array_get_longitude(locations, i+1)-lng[kept[i]]) <= 0.000001 );
+			assert( dc_array_get_accuracy(locations, i+1)==10.0 );
+			assert( dc_array_get_contact_id(locations, i+1)==contact_id );
+			assert( dc_array_get_id(locations, i+1)==0 );
+		}
+		dc_array_unref(locations);
+
+		// timestamp filter
+		locations = dc_get_locations(alice, chat_id, 0, timestamp[10], timestamp[11]);
+		assert( dc_array_get_cnt(locations)==2 );
+		assert( dc_array_get_timestamp(locations, 0)==timestamp[11] );
+		assert( dc_array_get_timestamp(locations, 1)==timestamp[10] );
+		dc_array_unref(locations);
+
+		// area filter, only the way back is west of -70.0005
+		locations = dc_get_locations_in_area(alice, 0, contact_id, -34.0, -70.002, -32.0, -70.0005, 0, 0, 0);
+		assert( dc_array_get_cnt(locations)==2 );
+		assert( dc_array_get_timestamp(locations, 0)==timestamp[20] );
+		assert( dc_array_get_timestamp(locations, 1)==timestamp[11] );
+		dc_array_unref(locations);
+
+		locations = dc_get_locations_in_area(alice, 0, contact_id, 10.0, -70.002, 20.0, -69.0, 0, 0, 0);
+		assert( dc_array_get_cnt(locations)==0 );
+		dc_array_unref(locations);
+
+		// the spatial index is rebuilt if the database was written by an sqlite library without R*Tree support
+		dc_sqlite3_execute(alice->sql, "DROP TRIGGER locations_rtree_insert;");
+		dc_sqlite3_execute(alice->sql, "INSERT INTO locations (latitude, longitude, timestamp, chat_id, from_id) VALUES (12.0,-69.5,1,1,1);");
+		char* dbfile = dc_mprintf("%s/alice.db", dir);
+		dc_close(alice);
+		assert( dc_open(alice, dbfile, NULL) );
+		free(dbfile);
+
+		locations = dc_get_locations_in_area(alice, 0, 0, 10.0, -70.002, 20.0, -69.0, 0, 0, 0);
+		assert( dc_array_get_cnt(locations)==1 );
+		dc_array_unref(locations);
+
+		dc_close(alice);
+		dc_context_unref(alice);
+		bench_delete_dir(dir);
+	}
+
+
 	/* test out-of-band verification
 	 **************************************************************************/
 
@@ -0,0 +1,1473 @@
+/* A minimal IMAP4rev1 and SMTP server for end-to-end tests without real mail providers;
+if used as a lib, this file is obsolete.
+
+The server listens on the loopback interface only, accepts any login and keeps
+all mailboxes in memory.  Mails sent via SMTP are delivered to the INBOX of
+each recipient.  Latency, bandwidth and dropped connections can be simulated,
+see testserver_options_t.
+
+Only the subset of the protocols used by Delta Chat Core is implemented:
+IMAP4rev1 with IDLE, UIDPLUS and MOVE; SMTP with AUTH PLAIN and AUTH LOGIN.
+TLS is not supported, use DC_LP_IMAP_SOCKET_PLAIN and DC_LP_SMTP_SOCKET_PLAIN.
+
+The file does not depend on the library, so it can also be used by other test tools. */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "testserver.h"
+
+
+#define TS_POLL_MS       200
+#define TS_MAX_ARGS      32
+#define TS_CAPABILITIES  "IMAP4rev1 IDLE UIDPLUS MOVE"
+
+
+typedef struct ts_msg_t
+{
+	uint32_t uid;
+	time_t   internaldate;
+	int      seen;
+	int      deleted;
+	char*    keywords;  /* space separated, never NULL */
+	char*    data;
+	size_t   bytes;
+} ts_msg_t;
+
+
+typedef struct ts_folder_t
+{
+	char*     name;
+	uint32_t  uidvalidity;
+	uint32_t  uidnext;
+	ts_msg_t* msgs;
+	int       cnt;
+	int       allocated;
+} ts_folder_t;
+
+
+typedef struct ts_user_t
+{
+	char*         name;
+	ts_folder_t** folders;
+	int           folder_cnt;
+} ts_user_t;
+
+
+struct _testserver
+{
+	testserver_options_t options;
+	int                  imap_listener;
+	int                  smtp_listener;
+	int                  imap_port;
+	int                  smtp_port;
+	pthread_t            imap_thread;
+	pthread_t            smtp_thread;
+	volatile int         stop;
+
+	pthread_mutex_t      mutex;  /* protects the fields below and all mailboxes */
+	pthread_cond_t       cond;   /* signalled when a connection ends */
+	ts_user_t**          users;
+	int                  user_cnt;
+	int                  active_connections;
+	testserver_stats_t   stats;
+};
+
+
+typedef struct ts_conn_t
+{
+	testserver_t* server;
+	int           fd;
+	int           cmd_cnt;
+	char*         inbuf;
+	size_t        inbuf_len;
+	size_t        inbuf_allocated;
+
+	/* imap state */
+	ts_user_t*    user;
+	char*         selected;
+	int           known_exists;
+} ts_conn_t;
+
+
+typedef struct ts_buf_t
+{
+	char*  buf;
+	size_t len;
+	size_t allocated;
+} ts_buf_t;
+
+
+typedef struct ts_args_t
+{
+	char* v[TS_MAX_ARGS];
+	int   cnt;
+} ts_args_t;
+
+
+/*******************************************************************************
+ * Tools
+ ******************************************************************************/
+
+
+static void* ts_malloc(size_t bytes)
+{
+	void* ret = calloc(1, bytes? bytes : 1);
+	if (ret==NULL) {
+		fprintf(stderr, "testserver: out of memory\n");
+		exit(1);
+	}
+	return ret;
+}
+
+
+static char* ts_strdup(const char* s)
+{
+	char* ret = ts_malloc(strlen(s)+1);
+	strcpy(ret, s);
+	return ret;
+}
+
+
+static void buf_add(ts_buf_t* b, const char* data, size_t bytes)
+{
+	if (b->len+bytes+1 > b->allocated) {
+		b->allocated = (b->len+bytes+1)*2;
+		if ((b->buf=realloc(b->buf, b->allocated))==NULL) {
+			fprintf(stderr, "testserver: out of memory\n");
+			exit(1);
+		}
+	}
+	memcpy(&b->buf[b->len], data, bytes);
+	b->len += bytes;
+	b->buf[b->len] = 0;
+}
+
+
+static void buf_printf(ts_buf_t* b, const char* format, ...)
+{
+	char*   str = NULL;
+	va_list va;
+	va_start(va, format);
+		if (vasprintf(&str, format, va)<0) {
+			exit(1);
+		}
+	va_end(va);
+	buf_add(b, str, strlen(str));
+	free(str);
+}
+
+
+static void buf_add_quoted(ts_buf_t* b, const char* str, size_t bytes)
+{
+	buf_add(b, "\"", 1);
+	for (size_t i = 0; i<bytes; i++) {
+		if (str[i]=='"' || str[i]=='\\') {
+			buf_add(b, "\\", 1);
+		}
+		buf_add(b, &str[i], 1);
+	}
+	buf_add(b, "\"", 1);
+}
+
+
+/*******************************************************************************
+ * Mailboxes, the caller must hold the server mutex
+ ******************************************************************************/
+
+
+static ts_folder_t* find_folder(ts_user_t* user, const char* name)
+{
+	for (int i = 0; user && name && i<user->folder_cnt; i++) {
+		if (strcasecmp(user->folders[i]->name, name)==0
+		 || (strcasecmp(name, "INBOX")==0 && strcasecmp(user->folders[i]->name, "INBOX")==0)) {
+			return user->folders[i];
+		}
+	}
+	return NULL;
+}
+
+
+static ts_folder_t* create_folder(ts_user_t* user, const char* name)
+{
+	ts_folder_t* folder = find_folder(user, name);
+	if (folder==NULL) {
+		folder = ts_malloc(sizeof(ts_folder_t));
+		folder->name        = ts_strdup(name);
+		folder->uidvalidity = (uint32_t)time(NULL) + user->folder_cnt;
+		folder->uidnext     = 1;
+		user->folders = realloc(user->folders, (user->folder_cnt+1)*sizeof(ts_folder_t*));
+		user->folders[user->folder_cnt++] = folder;
+	}
+	return folder;
+}
+
+
+static ts_user_t* find_or_create_user(testserver_t* server, const char* name)
+{
+	ts_user_t* user = NULL;
+
+	for (int i = 0; i<server->user_cnt; i++) {
+		if (strcasecmp(server->users[i]->name, name)==0) {
+			return server->users[i];
+		}
+	}
+
+	user = ts_malloc(sizeof(ts_user_t));
+	user->name = ts_strdup(name);
+	create_folder(user, "INBOX");
+	create_folder(user, "Sent");
+	server->users = realloc(server->users, (server->user_cnt+1)*sizeof(ts_user_t*));
+	server->users[server->user_cnt++] = user;
+	return user;
+}
+
+
+static ts_msg_t* append_msg(ts_folder_t* folder, const char* data, size_t bytes)
+{
+	ts_msg_t* msg = NULL;
+
+	if (folder->cnt>=folder->allocated) {
+		folder->allocated = folder->allocated? folder->allocated*2 : 64;
+		folder->msgs = realloc(folder->msgs, folder->allocated*sizeof(ts_msg_t));
+	}
+
+	msg = &folder->msgs[folder->cnt++];
+	memset(msg, 0, sizeof(ts_msg_t));
+	msg->uid          = folder->uidnext++;
+	msg->internaldate = time(NULL);
+	msg->keywords     = ts_strdup("");
+	msg->data     = ts_malloc(bytes+1);
+	msg->bytes    = bytes;
+	memcpy(msg->data, data, bytes);
+	return msg;
+}
+
+
+static void remove_msg(ts_folder_t* folder, int index)
+{
+	free(folder->msgs[index].keywords);
+	free(folder->msgs[index].data);
+	memmove(&folder->msgs[index], &folder->msgs[index+1], (folder->cnt-index-1)*sizeof(ts_msg_t));
+	folder->cnt--;
+}
+
+
+static void free_users(testserver_t* server)
+{
+	for (int i = 0; i<server->user_cnt; i++) {
+		ts_user_t* user = server->users[i];
+		for (int j = 0; j<user->folder_cnt; j++) {
+			ts_folder_t* folder = user->folders[j];
+			while (folder->cnt) {
+				remove_msg(folder, folder->cnt-1);
+			}
+			free(folder->msgs);
+			free(folder->name);
+			free(folder);
+		}
+		free(user->folders);
+		free(user->name);
+		free(user);
+	}
+	free(server->users);
+	server->users = NULL;
+	server->user_cnt = 0;
+}
+
+
+/*******************************************************************************
+ * Connections
+ ******************************************************************************/
+
+
+static int conn_send(ts_conn_t* conn, const char* data, size_t bytes)
+{
+	/* send data, delayed by the configured latency and limited to the configured bandwidth */
+	testserver_t* server = conn->server;
+	size_t        chunk = bytes;
+
+	if (server->options.latency_ms>0) {
+		usleep(server->options.latency_ms*1000);
+	}
+
+	if (server->options.bytes_per_sec>0) {
+		chunk = server->options.bytes_per_sec/20 + 1;
+	}
+
+	for (size_t sent = 0; sent<bytes; ) {
+		size_t  todo = (bytes-sent)<chunk? (bytes-sent) : chunk;
+		ssize_t r = send(conn->fd, &data[sent], todo, MSG_NOSIGNAL);
+		if (r<=0) {
+			return 0;
+		}
+		sent += r;
+
+		pthread_mutex_lock(&server->mutex);
+			server->stats.bytes_sent += r;
+		pthread_mutex_unlock(&server->mutex);
+
+		if (server->options.bytes_per_sec>0 && sent<bytes) {
+			usleep(50*1000);
+		}
+	}
+
+	return 1;
+}
+
+
+static int conn_sendf(ts_conn_t* conn, const char* format, ...)
+{
+	char*   str = NULL;
+	int     ret = 0;
+	va_list va;
+	va_start(va, format);
+		if (vasprintf(&str, format, va)<0) {
+			exit(1);
+		}
+	va_end(va);
+	ret = conn_send(conn, str, strlen(str));
+	free(str);
+	return ret;
+}
+
+
+static int conn_fill(ts_conn_t* conn, int timeout_ms)
+{
+	/* read more data into the input buffer;
+	returns 1 on success, 0 if the connection is closed or the server stops, -1 on timeout */
+	struct pollfd pfd;
+	int           waited_ms = 0;
+
+	while (1) {
+		if (conn->server->stop) {
+			return 0;
+		}
+
+		pfd.fd      = conn->fd;
+		pfd.events  = POLLIN;
+		pfd.revents = 0;
+		int r = poll(&pfd, 1, TS_POLL_MS);
+		if (r<0) {
+			return 0;
+		}
+		else if (r>0) {
+			break;
+		}
+
+		waited_ms += TS_POLL_MS;
+		if (timeout_ms>=0 && waited_ms>=timeout_ms) {
+			return -1;
+		}
+	}
+
+	if (conn->inbuf_len+4096 > conn->inbuf_allocated) {
+		conn->inbuf_allocated = (conn->inbuf_len+4096)*2;
+		conn->inbuf = realloc(conn->inbuf, conn->inbuf_allocated);
+	}
+
+	ssize_t r = recv(conn->fd, &conn->inbuf[conn->inbuf_len], conn->inbuf_allocated-conn->inbuf_len-1, 0);
+	if (r<=0) {
+		return 0;
+	}
+	conn->inbuf_len += r;
+	return 1;
+}
+
+
+static int conn_read_bytes(ts_conn_t* conn, size_t bytes, char** ret)
+{
+	while (conn->inbuf_len<bytes) {
+		if (conn_fill(conn, -1)!=1) {
+			return 0;
+		}
+	}
+
+	*ret = ts_malloc(bytes+1);
+	memcpy(*ret, conn->inbuf, bytes);
+	memmove(conn->inbuf, &conn->inbuf[bytes], conn->inbuf_len-bytes);
+	conn->inbuf_len -= bytes;
+	return 1;
+}
+
+
+static int conn_read_line(ts_conn_t* conn, char** ret, int timeout_ms)
+{
+	/* returns 1 and the line without the line end, 0 if the connection is closed, -1 on timeout */
+	while (1) {
+		char* lf = conn->inbuf_len? memchr(conn->inbuf, '\n', conn->inbuf_len) : NULL;
+		if (lf) {
+			size_t bytes = lf-conn->inbuf+1;
+			if (!conn_read_bytes(conn, bytes, ret)) {
+				return 0;
+			}
+			while (bytes && ((*ret)[bytes-1]=='\n' || (*ret)[bytes-1]=='\r')) {
+				(*ret)[--bytes] = 0;
+			}
+			return 1;
+		}
+
+		int r = conn_fill(conn, timeout_ms);
+		if (r!=1) {
+			return r;
+		}
+	}
+}
+
+
+static int conn_count_cmd(ts_conn_t* conn)
+{
+	/* returns 0 if the connection should be dropped to simulate a flaky server */
+	testserver_t* server = conn->server;
+
+	conn->cmd_cnt++;
+	if (server->options.drop_after>0 && conn->cmd_cnt>server->options.drop_after) {
+		pthread_mutex_lock(&server->mutex);
+			server->stats.dropped++;
+		pthread_mutex_unlock(&server->mutex);
+		return 0;
+	}
+	return 1;
+}
+
+
+/*******************************************************************************
+ * IMAP
+ ******************************************************************************/
+
+
+static void free_args(ts_args_t* args)
+{
+	for (int i = 0; i<args->cnt; i++) {
+		free(args->v[i]);
+	}
+	args->cnt = 0;
+}
+
+
+static void add_arg(ts_args_t* args, const char* start, size_t bytes)
+{
+	if (args->cnt<TS_MAX_ARGS) {
+		char* arg = ts_malloc(bytes+1);
+		memcpy(arg, start, bytes);
+		args->v[args->cnt++] = arg;
+	}
+}
+
+
+static int read_command(ts_conn_t* conn, ts_args_t* args)
+{
+	/* read a command and split it into arguments; quoted strings and literals are decoded,
+	parenthesized lists are returned as a single argument, including the parentheses */
+	char* line = NULL;
+
+	if (conn_read_line(conn, &line, -1)!=1) {
+		return 0;
+	}
+
+	for (char* p = line; *p; )
+	{
+		if (*p==' ') {
+			p++;
+		}
+		else if (*p=='"') {
+			ts_buf_t b = { NULL, 0, 0 };
+			buf_add(&b, "", 0);
+			for (p++; *p && *p!='"'; p++) {
+				if (*p=='\\' && p[1]) {
+					p++;
+				}
+				buf_add(&b, p, 1);
+			}
+			if (*p=='"') {
+				p++;
+			}
+			add_arg(args, b.buf, b.len);
+			free(b.buf);
+		}
+		else if (*p=='{' && p[strlen(p)-1]=='}') {
+			/* literal at the end of the line, continue with the next line */
+			char* literal = NULL;
+			size_t bytes = strtoul(p+1, NULL, 10);
+			if (p[strlen(p)-2]!='+' && !conn_send(conn, "+ Ready\r\n", 9)) {
+				free(line);
+				return 0;
+			}
+			if (!conn_read_bytes(conn, bytes, &literal)) {
+				free(line);
+				return 0;
+			}
+			add_arg(args, literal, bytes);
+			free(literal);
+			free(line);
+			line = NULL;
+			if (conn_read_line(conn, &line, -1)!=1) {
+				return 0;
+			}
+			p = line;
+		}
+		else {
+			char* start = p;
+			int   depth = 0;
+			int   quoted = 0;
+			for ( ; *p; p++) {
+				if (quoted) {
+					if (*p=='\\' && p[1]) { p++; }
+					else if (*p=='"')     { quoted = 0; }
+				}
+				else if (*p=='"')               { quoted = 1; }
+				else if (*p=='(' || *p=='[')    { depth++; }
+				else if (*p==')' || *p==']')    { depth--; }
+				else if (*p==' ' && depth<=0)   { break; }
+			}
+			add_arg(args, start, p-start);
+		}
+	}
+
+	free(line);
+	return 1;
+}
+
+
+static int in_set(const char* set, uint32_t value, uint32_t largest)
+{
+	/* check if value is in a sequence set as `1,3:5,7:*` */
+	const char* p = set;
+
+	while (*p) {
+		uint32_t first = (*p=='*')? largest : (uint32_t)strtoul(p, NULL, 10);
+		uint32_t last = first;
+		while (*p && *p!=':' && *p!=',') { p++; }
+		if (*p==':') {
+			p++;
+			last = (*p=='*')? largest : (uint32_t)strtoul(p, NULL, 10);
+			while (*p && *p!=',') { p++; }
+		}
+		if (first>last) {
+			uint32_t temp = first; first = last; last = temp;
+		}
+		if (value>=first && value<=last) {
+			return 1;
+		}
+		if (*p==',') {
+			p++;
+		}
+	}
+
+	return 0;
+}
+
+
+static int msg_in_set(ts_folder_t* folder, int index, const char* set, int by_uid)
+{
+	if (by_uid) {
+		return in_set(set, folder->msgs[index].uid, folder->cnt? folder->msgs[folder->cnt-1].uid : 0);
+	}
+	return in_set(set, index+1, folder->cnt);
+}
+
+
+static void add_flags(ts_buf_t* b, const ts_msg_t* msg)
+{
+	buf_printf(b, "FLAGS (%s%s%s%s)",
+		msg->seen? "\\Seen" : "",
+		msg->deleted? (msg->seen? " \\Deleted" : "\\Deleted") : "",
+		(msg->keywords[0] && (msg->seen || msg->deleted))? " " : "",
+		msg->keywords);
+}
+
+
+static void add_envelope(ts_buf_t* b, const ts_msg_t* msg)
+{
+	/* only the Message-ID is filled, this is what is used for prefetching */
+	const char* p = msg->data;
+	const char* end = msg->data+msg->bytes;
+
+	buf_add(b, "ENVELOPE (NIL NIL NIL NIL NIL NIL NIL NIL NIL ", 46);
+	while (p<end && *p!='\r' && *p!='\n') {
+		const char* eol = memchr(p, '\n', end-p);
+		if (eol==NULL) {
+			eol = end;
+		}
+		if (eol-p>11 && strncasecmp(p, "Message-ID:", 11)==0) {
+			const char* v1 = p+11;
+			const char* v2 = eol;
+			while (v1<v2 && isspace((unsigned char)*v1))    { v1++; }
+			while (v2>v1 && isspace((unsigned char)v2[-1])) { v2--; }
+			buf_add_quoted(b, v1, v2-v1);
+			buf_add(b, ")", 1);
+			return;
+		}
+		p = eol+1;
+	}
+	buf_add(b, "NIL)", 4);
+}
+
+
+static void imap_fetch(ts_conn_t* conn, ts_folder_t* folder, const char* set, const char* items_in, int by_uid, ts_buf_t* out)
+{
+	char* items = ts_strdup(items_in);
+	for (char* p = items; *p; p++) {
+		*p = toupper((unsigned char)*p);
+	}
+
+	int want_uid   = by_uid || strstr(items, "UID")!=NULL;
+	int want_flags = strstr(items, "FLAGS")!=NULL;
+	int want_env   = strstr(items, "ENVELOPE")!=NULL;
+	int want_size  = strstr(items, "RFC822.SIZE")!=NULL;
+	int want_body  = strstr(items, "BODY[]")!=NULL || strstr(items, "BODY.PEEK[]")!=NULL;
+	int want_822   = strstr(items, "RFC822")!=NULL && !want_size && strstr(items, "RFC822.HEADER")==NULL;
+
+	for (int i = 0; i<folder->cnt; i++)
+	{
+		if (!msg_in_set(folder, i, set, by_uid)) {
+			continue;
+		}
+
+		ts_msg_t* msg = &folder->msgs[i];
+		int       sep = 0;
+		buf_printf(out, "* %i FETCH (", i+1);
+		if (want_uid)   { buf_printf(out, "UID %u", msg->uid); sep = 1; }
+		if (want_flags) { if (sep) { buf_add(out, " ", 1); } add_flags(out, msg); sep = 1; }
+		if (want_env)   { if (sep) { buf_add(out, " ", 1); } add_envelope(out, msg); sep = 1; }
+		if (want_size)  { buf_printf(out, "%sRFC822.SIZE %lu", sep? " " : "", (unsigned long)msg->bytes); sep = 1; }
+		if (want_body || want_822) {
+			buf_printf(out, "%s%s {%lu}\r\n", sep? " " : "", want_body? "BODY[]" : "RFC822", (unsigned long)msg->bytes);
+			buf_add(out, msg->data, msg->bytes);
+		}
+		buf_add(out, ")\r\n", 3);
+
+		if ((want_body || want_822) && strstr(items, "PEEK")==NULL) {
+			msg->seen = 1;
+		}
+	}
+
+	free(items);
+}
+
+
+static void imap_store(ts_folder_t* folder, const char* set, const char* what, const char* flags_in, int by_uid, ts_buf_t* out)
+{
+	/* what is one of `FLAGS`, `+FLAGS`, `-FLAGS`, optionally followed by `.SILENT` */
+	int   mode = (what[0]=='+')? 1 : ((what[0]=='-')? -1 : 0);
+	int   silent = strcasestr(what, ".SILENT")!=NULL;
+	char* flags = ts_strdup(flags_in);
+
+	for (int i = 0; i<folder->cnt; i++)
+	{
+		if (!msg_in_set(folder, i, set, by_uid)) {
+			continue;
+		}
+
+		ts_msg_t* msg = &folder->msgs[i];
+		if (mode==0) {
+			msg->seen = 0;
+			msg->deleted = 0;
+			free(msg->keywords);
+			msg->keywords = ts_strdup("");
+		}
+
+		char* save = NULL;
+		char* copy = ts_strdup(flags);
+		for (char* flag = strtok_r(copy, "() ", &save); flag; flag = strtok_r(NULL, "() ", &save)) {
+			if (strcasecmp(flag, "\\Seen")==0) {
+				msg->seen = (mode>=0);
+			}
+			else if (strcasecmp(flag, "\\Deleted")==0) {
+				msg->deleted = (mode>=0);
+			}
+			else if (flag[0]!='\\' && mode>=0 && strcasestr(msg->keywords, flag)==NULL) {
+				char* keywords = NULL;
+				if (asprintf(&keywords, "%s%s%s", msg->keywords, msg->keywords[0]? " " : "", flag)<0) {
+					exit(1);
+				}
+				free(msg->keywords);
+				msg->keywords = keywords;
+			}
+		}
+		free(copy);
+
+		if (!silent) {
+			buf_printf(out, "* %i FETCH (", i+1);
+			if (by_uid) {
+				buf_printf(out, "UID %u ", msg->uid);
+			}
+			add_flags(out, msg);
+			buf_add(out, ")\r\n", 3);
+		}
+	}
+
+	free(flags);
+}
+
+
+static const char* imap_copy(ts_folder_t* folder, ts_folder_t* dest, const char* set, int by_uid, int move, ts_buf_t* out, char** ret_copyuid)
+{
+	ts_buf_t src_uids = { NULL, 0, 0 };
+	ts_buf_t dest_uids = { NULL, 0, 0 };
+	buf_add(&src_uids, "", 0);
+	buf_add(&dest_uids, "", 0);
+
+	for (int i = 0; i<folder->cnt; i++)
+	{
+		if (!msg_in_set(folder, i, set, by_uid)) {
+			continue;
+		}
+
+		ts_msg_t* msg = &folder->msgs[i];
+		uint32_t  src_uid = msg->uid;
+		ts_msg_t* copy = append_msg(dest, msg->data, msg->bytes);  /* may realloc dest->msgs, not folder->msgs as dest!=folder */
+		copy->seen = folder->msgs[i].seen;
+		copy->internaldate = folder->msgs[i].internaldate;
+		free(copy->keywords);
+		copy->keywords = ts_strdup(folder->msgs[i].keywords);
+		buf_printf(&src_uids,  "%s%u", src_uids.len? ","  : "", src_uid);
+		buf_printf(&dest_uids, "%s%u", dest_uids.len? "," : "", copy->uid);
+
+		if (move) {
+			folder->msgs[i].deleted = 1;
+		}
+	}
+
+	if (move) {
+		for (int i = folder->cnt-1; i>=0; i--) {
+			if (folder->msgs[i].deleted && msg_in_set(folder, i, set, by_uid)) {
+				remove_msg(folder, i);
+				buf_printf(out, "* %i EXPUNGE\r\n", i+1);
+			}
+		}
+	}
+
+	if (src_uids.len) {
+		if (asprintf(ret_copyuid, "COPYUID %u %s %s", dest->uidvalidity, src_uids.buf, dest_uids.buf)<0) {
+			exit(1);
+		}
+	}
+
+	free(src_uids.buf);
+	free(dest_uids.buf);
+	return NULL;
+}
+
+
+static int parse_search_date(const char* str, time_t* ret_day)
+{
+	/* parse a date as `1-Feb-2019` to the number of days since 1970; times and timezones are ignored by SEARCH */
+	static const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+	char       month[4] = { 0 };
+	const char* m = NULL;
+	struct tm  tm;
+	memset(&tm, 0, sizeof(struct tm));
+
+	if (sscanf(str, "%d-%3s-%d", &tm.tm_mday, month, &tm.tm_year)!=3
+	 || strlen(month)!=3 || (m=strcasestr(months, month))==NULL || (m-months)%3!=0) {
+		return 0;
+	}
+	tm.tm_mon = (m-months)/3;
+	tm.tm_year -= 1900;
+	*ret_day = timegm(&tm) / (24*60*60);
+	return 1;
+}
+
+
+static int imap_search(ts_folder_t* folder, ts_args_t* args, int by_uid, ts_buf_t* out)
+{
+	/* all given keys must match; only ALL, UID, SINCE, BEFORE, SEEN, UNSEEN and sequence sets are supported,
+	returns 0 for other keys, the caller replies BAD then */
+	for (int k = 2; k<args->cnt; k++) {
+		const char* key = args->v[k];
+		time_t      day = 0;
+		if (strcasecmp(key, "ALL")==0 || strcasecmp(key, "SEEN")==0 || strcasecmp(key, "UNSEEN")==0
+		 || isdigit((unsigned char)key[0]) || key[0]=='*') {
+			continue;
+		}
+		else if ((strcasecmp(key, "UID")==0 || strcasecmp(key, "SINCE")==0 || strcasecmp(key, "BEFORE")==0) && k+1<args->cnt) {
+			if (strcasecmp(key, "UID")!=0 && !parse_search_date(args->v[k+1], &day)) {
+				return 0;
+			}
+			k++;
+		}
+		else {
+			return 0;
+		}
+	}
+
+	buf_add(out, "* SEARCH", 8);
+	for (int i = 0; i<folder->cnt; i++)
+	{
+		const ts_msg_t* msg = &folder->msgs[i];
+		int             match = 1;
+		for (int k = 2; k<args->cnt && match; k++) {
+			const char* key = args->v[k];
+			time_t      day = 0;
+			if (strcasecmp(key, "SEEN")==0) {
+				match = msg->seen;
+			}
+			else if (strcasecmp(key, "UNSEEN")==0) {
+				match = !msg->seen;
+			}
+			else if (strcasecmp(key, "UID")==0) {
+				match = msg_in_set(folder, i, args->v[++k], 1);
+			}
+			else if (strcasecmp(key, "SINCE")==0) {
+				parse_search_date(args->v[++k], &day);
+				match = msg->internaldate/(24*60*60) >= day;
+			}
+			else if (strcasecmp(key, "BEFORE")==0) {
+				parse_search_date(args->v[++k], &day);
+				match = msg->internaldate/(24*60*60) < day;
+			}
+			else if (strcasecmp(key, "ALL")!=0) {
+				match = msg_in_set(folder, i, key, 0);
+			}
+		}
+
+		if (match) {
+			buf_printf(out, " %u", by_uid? msg->uid : (uint32_t)i+1);
+		}
+	}
+	buf_add(out, "\r\n", 2);
+	return 1;
+}
+
+
+static int imap_idle(ts_conn_t* conn, const char* tag)
+{
+	/* report new messages in the selected folder until the client sends DONE */
+	testserver_t* server = conn->server;
+	char*         line = NULL;
+
+	if (!conn_send(conn, "+ idling\r\n", 10)) {
+		return 0;
+	}
+
+	while (1)
+	{
+		int r = conn_read_line(conn, &line, TS_POLL_MS);
+		if (r==0) {
+			return 0;
+		}
+		else if (r==1) {
+			int done = strcasecmp(line, "DONE")==0;
+			free(line);
+			if (done) {
+				break;
+			}
+		}
+
+		int exists = -1;
+		pthread_mutex_lock(&server->mutex);
+			ts_folder_t* folder = find_folder(conn->user, conn->selected);
+			if (folder && folder->cnt!=conn->known_exists) {
+				exists = conn->known_exists = folder->cnt;
+			}
+		pthread_mutex_unlock(&server->mutex);
+
+		if (exists>=0 && !conn_sendf(conn, "* %i EXISTS\r\n", exists)) {
+			return 0;
+		}
+	}
+
+	return conn_sendf(conn, "%s OK IDLE terminated\r\n", tag);
+}
+
+
+static int imap_command(ts_conn_t* conn, ts_args_t* args)
+{
+	/* handle a single command, returns 0 if the connection should be closed */
+	testserver_t* server = conn->server;
+	const char*   tag = args->v[0];
+	const char*   cmd = args->cnt>1? args->v[1] : "";
+	int           by_uid = 0;
+	int           keep = 1;
+	char*         code = NULL;
+	const char*   result = NULL;
+	ts_buf_t      out = { NULL, 0, 0 };
+	buf_add(&out, "", 0);
+
+	if (strcasecmp(cmd, "UID")==0 && args->cnt>2) {
+		by_uid = 1;
+		cmd = args->v[2];
+		free(args->v[1]);
+		memmove(&args->v[1], &args->v[2], (args->cnt-2)*sizeof(char*));
+		args->v[--args->cnt] = NULL;
+	}
+
+	#define ARG(i) (args->cnt>(i)? args->v[(i)] : "")
+
+	pthread_mutex_lock(&server->mutex);
+
+	ts_folder_t* folder = find_folder(conn->user, conn->selected);
+
+	if (strcasecmp(cmd, "CAPABILITY")==0) {
+		buf_add(&out, "* CAPABILITY " TS_CAPABILITIES "\r\n", strlen("* CAPABILITY " TS_CAPABILITIES "\r\n"));
+	}
+	else if (strcasecmp(cmd, "NOOP")==0 || strcasecmp(cmd, "CHECK")==0) {
+		if (folder && folder->cnt!=conn->known_exists) {
+			buf_printf(&out, "* %i EXISTS\r\n", folder->cnt);
+			conn->known_exists = folder->cnt;
+		}
+	}
+	else if (strcasecmp(cmd, "LOGOUT")==0) {
+		buf_add(&out, "* BYE logging out\r\n", 19);
+		keep = 0;
+	}
+	else if (strcasecmp(cmd, "LOGIN")==0 && args->cnt>=4) {
+		conn->user = find_or_create_user(server, ARG(2));
+		if (asprintf(&code, "CAPABILITY %s", TS_CAPABILITIES)<0) { exit(1); }
+	}
+	else if (conn->user==NULL) {
+		result = "NO not authenticated";
+	}
+	else if (strcasecmp(cmd, "LIST")==0 || strcasecmp(cmd, "LSUB")==0) {
+		for (int i = 0; i<conn->user->folder_cnt; i++) {
+			const char* name = conn->user->folders[i]->name;
+			buf_printf(&out, "* %s (\\HasNoChildren%s) \"/\" ", cmd, strcmp(name, "Sent")==0? " \\Sent" : "");
+			buf_add_quoted(&out, name, strlen(name));
+			buf_add(&out, "\r\n", 2);
+		}
+	}
+	else if (strcasecmp(cmd, "CREATE")==0 && args->cnt>=3) {
+		if (find_folder(conn->user, ARG(2))) {
+			result = "NO folder exists";
+		}
+		else {
+			create_folder(conn->user, ARG(2));
+		}
+	}
+	else if (strcasecmp(cmd, "SUBSCRIBE")==0 || strcasecmp(cmd, "UNSUBSCRIBE")==0) {
+		;
+	}
+	else if (strcasecmp(cmd, "STATUS")==0 && args->cnt>=3) {
+		ts_folder_t* status = find_folder(conn->user, ARG(2));
+		if (status==NULL) {
+			result = "NO no such folder";
+		}
+		else {
+			int unseen = 0;
+			for (int i = 0; i<status->cnt; i++) { if (!status->msgs[i].seen) { unseen++; } }
+			buf_add(&out, "* STATUS ", 9);
+			buf_add_quoted(&out, status->name, strlen(status->name));
+			buf_printf(&out, " (MESSAGES %i UIDNEXT %u UIDVALIDITY %u UNSEEN %i)\r\n",
+				status->cnt, status->uidnext, status->uidvalidity, unseen);
+		}
+	}
+	else if ((strcasecmp(cmd, "SELECT")==0 || strcasecmp(cmd, "EXAMINE")==0) && args->cnt>=3) {
+		free(conn->selected);
+		conn->selected = NULL;
+		if ((folder=find_folder(conn->user, ARG(2)))==NULL) {
+			result = "NO no such folder";
+		}
+		else {
+			conn->selected = ts_strdup(folder->name);
+			conn->known_exists = folder->cnt;
+			buf_printf(&out,
+				"* FLAGS (\\Seen \\Deleted)\r\n"
+				"* OK [PERMANENTFLAGS (\\Seen \\Deleted \\*)] Flags permitted\r\n"
+				"* %i EXISTS\r\n"
+				"* 0 RECENT\r\n"
+				"* OK [UIDVALIDITY %u] UIDs valid\r\n"
+				"* OK [UIDNEXT %u] Predicted next UID\r\n",
+				folder->cnt, folder->uidvalidity, folder->uidnext);
+			code = ts_strdup(strcasecmp(cmd, "SELECT")==0? "READ-WRITE" : "READ-ONLY");
+		}
+	}
+	else if (strcasecmp(cmd, "IDLE")==0) {
+		if (folder==NULL) {
+			result = "BAD no folder selected";
+		}
+		else {
+			pthread_mutex_unlock(&server->mutex);
+			keep = imap_idle(conn, tag);
+			free(out.buf);
+			return keep;
+		}
+	}
+	else if (folder==NULL) {
+		result = "BAD no folder selected";
+	}
+	else if (strcasecmp(cmd, "FETCH")==0 && args->cnt>=4) {
+		imap_fetch(conn, folder, ARG(2), ARG(3), by_uid, &out);
+	}
+	else if (strcasecmp(cmd, "STORE")==0 && args->cnt>=5) {
+		imap_store(folder, ARG(2), ARG(3), ARG(4), by_uid, &out);
+	}
+	else if ((strcasecmp(cmd, "COPY")==0 || strcasecmp(cmd, "MOVE")==0) && args->cnt>=4) {
+		ts_folder_t* dest = find_folder(conn->user, ARG(3));
+		if (dest==NULL) {
+			result = "NO [TRYCREATE] no such folder";
+		}
+		else if (dest==folder) {
+			result = "NO source and destination are the same";
+		}
+		else {
+			int move = strcasecmp(cmd, "MOVE")==0;
+			imap_copy(folder, dest, ARG(2), by_uid, move, &out, &code);
+			if (move && code) {
+				/* RFC 6851 sends COPYUID untagged before the EXPUNGE responses */
+				char* untagged = NULL;
+				if (asprintf(&untagged, "* OK [%s] Moved\r\n%s", code, out.buf)<0) { exit(1); }
+				free(out.buf);
+				out.buf = untagged;
+				out.len = strlen(untagged);
+				out.allocated = out.len+1;
+			}
+			conn->known_exists = folder->cnt;
+		}
+	}
+	else if (strcasecmp(cmd, "EXPUNGE")==0 || strcasecmp(cmd, "CLOSE")==0) {
+		int silent = strcasecmp(cmd, "CLOSE")==0;
+		for (int i = folder->cnt-1; i>=0; i--) {
+			if (folder->msgs[i].deleted && (!by_uid || msg_in_set(folder, i, ARG(2), 1))) {
+				remove_msg(folder, i);
+				if (!silent) {
+					buf_printf(&out, "* %i EXPUNGE\r\n", i+1);
+				}
+			}
+		}
+		conn->known_exists = folder->cnt;
+		if (silent) {
+			free(conn->selected);
+			conn->selected = NULL;
+		}
+	}
+	else if (strcasecmp(cmd, "UNSELECT")==0) {
+		free(conn->selected);
+		conn->selected = NULL;
+	}
+	else if (strcasecmp(cmd, "SEARCH")==0) {
+		if (!imap_search(folder, args, by_uid, &out)) {
+			result = "BAD search key not supported";
+		}
+	}
+	else {
+		result = "BAD command unknown or arguments invalid";
+	}
+
+	pthread_mutex_unlock(&server->mutex);
+
+	if (result==NULL) {
+		buf_printf(&out, "%s OK %s%s%s%s completed\r\n", tag, code? "[" : "", code? code : "", code? "] " : "", cmd);
+	}
+	else {
+		buf_printf(&out, "%s %s\r\n", tag, result);
+	}
+
+	if (!conn_send(conn, out.buf, out.len)) {
+		keep = 0;
+	}
+
+	free(code);
+	free(out.buf);
+	return keep;
+}
+
+
+static void handle_imap(ts_conn_t* conn)
+{
+	ts_args_t args;
+	memset(&args, 0, sizeof(ts_args_t));
+
+	if (!conn_send(conn, "* OK [CAPABILITY " TS_CAPABILITIES "] testserver ready\r\n",
+	               strlen("* OK [CAPABILITY " TS_CAPABILITIES "] testserver ready\r\n"))) {
+		return;
+	}
+
+	while (read_command(conn, &args))
+	{
+		if (args.cnt<2) {
+			if (!conn_sendf(conn, "%s BAD empty command\r\n", args.cnt? args.v[0] : "*")) {
+				break;
+			}
+		}
+		else if (!conn_count_cmd(conn) || !imap_command(conn, &args)) {
+			break;
+		}
+		free_args(&args);
+	}
+
+	free_args(&args);
+}
+
+
+/*******************************************************************************
+ * SMTP
+ ******************************************************************************/
+
+
+static char* get_path(const char* arg)
+{
+	/* get the address from `FROM:<addr> PARAMS` or `TO:<addr> PARAMS` */
+	const char* p1 = strchr(arg, '<');
+	const char* p2 = p1? strchr(p1, '>') : NULL;
+	if (p1==NULL || p2==NULL) {
+		p1 = strchr(arg, ':');
+		return ts_strdup(p1? p1+1 : arg);
+	}
+	char* ret = ts_malloc(p2-p1);
+	memcpy(ret, p1+1, p2-p1-1);
+	return ret;
+}
+
+
+static void deliver(testserver_t* server, char** rcpts, int rcpt_cnt, const char* data, size_t bytes)
+{
+	pthread_mutex_lock(&server->mutex);
+		for (int i = 0; i<rcpt_cnt; i++) {
+			ts_user_t* user = find_or_create_user(server, rcpts[i]);
+			append_msg(find_folder(user, "INBOX"), data, bytes);
+			server->stats.delivered++;
+		}
+	pthread_mutex_unlock(&server->mutex);
+}
+
+
+static void handle_smtp(ts_conn_t* conn)
+{
+	char*  line = NULL;
+	char** rcpts = NULL;
+	int    rcpt_cnt = 0;
+	int    has_sender = 0;
+
+	if (!conn_send(conn, "220 testserver ESMTP ready\r\n", 28)) {
+		return;
+	}
+
+	while (conn_read_line(conn, &line, -1)==1)
+	{
+		int keep = conn_count_cmd(conn);
+
+		if (!keep) {
+			;
+		}
+		else if (strncasecmp(line, "EHLO", 4)==0) {
+			keep = conn_send(conn, "250-testserver\r\n250-AUTH PLAIN LOGIN\r\n250 8BITMIME\r\n", 52);
+		}
+		else if (strncasecmp(line, "HELO", 4)==0) {
+			keep = conn_send(conn, "250 testserver\r\n", 16);
+		}
+		else if (strncasecmp(line, "AUTH PLAIN", 10)==0) {
+			char* response = NULL;
+			if (line[10]==' ') {
+				response = ts_strdup(&line[11]);
+			}
+			else if (!conn_send(conn, "334 \r\n", 6) || conn_read_line(conn, &response, -1)!=1) {
+				keep = 0;
+			}
+			free(response);
+			keep = keep && conn_send(conn, "235 2.7.0 Authentication successful\r\n", 37);
+		}
+		else if (strncasecmp(line, "AUTH LOGIN", 10)==0) {
+			char* user = NULL;
+			char* pw = NULL;
+			if (line[10]==' ') {
+				user = ts_strdup(&line[11]);
+			}
+			else if (!conn_send(conn, "334 VXNlcm5hbWU6\r\n", 18) || conn_read_line(conn, &user, -1)!=1) {
+				keep = 0;
+			}
+			if (keep && (!conn_send(conn, "334 UGFzc3dvcmQ6\r\n", 18) || conn_read_line(conn, &pw, -1)!=1)) {
+				keep = 0;
+			}
+			free(user);
+			free(pw);
+			keep = keep && conn_send(conn, "235 2.7.0 Authentication successful\r\n", 37);
+		}
+		else if (strncasecmp(line, "MAIL FROM:", 10)==0) {
+			while (rcpt_cnt) { free(rcpts[--rcpt_cnt]); }
+			has_sender = 1;
+			keep = conn_send(conn, "250 2.1.0 Ok\r\n", 14);
+		}
+		else if (strncasecmp(line, "RCPT TO:", 8)==0) {
+			if (!has_sender) {
+				keep = conn_send(conn, "503 5.5.1 Need MAIL first\r\n", 27);
+			}
+			else {
+				rcpts = realloc(rcpts, (rcpt_cnt+1)*sizeof(char*));
+				rcpts[rcpt_cnt++] = get_path(&line[8]);
+				keep = conn_send(conn, "250 2.1.5 Ok\r\n", 14);
+			}
+		}
+		else if (strncasecmp(line, "DATA", 4)==0) {
+			if (rcpt_cnt==0) {
+				keep = conn_send(conn, "503 5.5.1 Need RCPT first\r\n", 27);
+			}
+			else if ((keep=conn_send(conn, "354 End data with <CR><LF>.<CR><LF>\r\n", 37))) {
+				ts_buf_t data = { NULL, 0, 0 };
+				char*    data_line = NULL;
+				buf_add(&data, "", 0);
+				while ((keep=(conn_read_line(conn, &data_line, -1)==1))) {
+					if (strcmp(data_line, ".")==0) {
+						free(data_line);
+						break;
+					}
+					const char* unstuffed = (data_line[0]=='.')? &data_line[1] : data_line;
+					buf_add(&data, unstuffed, strlen(unstuffed));
+					buf_add(&data, "\r\n", 2);
+					free(data_line);
+				}
+				if (keep) {
+					deliver(conn->server, rcpts, rcpt_cnt, data.buf, data.len);
+					keep = conn_send(conn, "250 2.0.0 Ok: queued\r\n", 22);
+				}
+				free(data.buf);
+				while (rcpt_cnt) { free(rcpts[--rcpt_cnt]); }
+				has_sender = 0;
+			}
+		}
+		else if (strncasecmp(line, "RSET", 4)==0) {
+			while (rcpt_cnt) { free(rcpts[--rcpt_cnt]); }
+			has_sender = 0;
+			keep = conn_send(conn, "250 2.0.0 Ok\r\n", 14);
+		}
+		else if (strncasecmp(line, "NOOP", 4)==0) {
+			keep = conn_send(conn, "250 2.0.0 Ok\r\n", 14);
+		}
+		else if (strncasecmp(line, "QUIT", 4)==0) {
+			conn_send(conn, "221 2.0.0 Bye\r\n", 15);
+			keep = 0;
+		}
+		else {
+			keep = conn_send(conn, "502 5.5.2 Command not recognized\r\n", 34);
+		}
+
+		free(line);
+		line = NULL;
+		if (!keep) {
+			break;
+		}
+	}
+
+	free(line);
+	while (rcpt_cnt) { free(rcpts[--rcpt_cnt]); }
+	free(rcpts);
+}
+
+
+/*******************************************************************************
+ * Server
+ ******************************************************************************/
+
+
+typedef struct ts_thread_arg_t
+{
+	ts_conn_t* conn;
+	int        is_imap;
+} ts_thread_arg_t;
+
+
+static void* connection_thread(void* arg_)
+{
+	ts_thread_arg_t* arg = (ts_thread_arg_t*)arg_;
+	ts_conn_t*       conn = arg->conn;
+	testserver_t*    server = conn->server;
+
+	if (arg->is_imap) {
+		handle_imap(conn);
+	}
+	else {
+		handle_smtp(conn);
+	}
+
+	close(conn->fd);
+	free(conn->inbuf);
+	free(conn->selected);
+	free(conn);
+	free(arg);
+
+	pthread_mutex_lock(&server->mutex);
+		server->active_connections--;
+		pthread_cond_broadcast(&server->cond);
+	pthread_mutex_unlock(&server->mutex);
+	return NULL;
+}
+
+
+static int create_listener(int port, int* ret_port)
+{
+	struct sockaddr_in addr;
+	socklen_t          addr_len = sizeof(addr);
+	int                one = 1;
+	int                fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd<0) {
+		return -1;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr*)&addr, sizeof(addr))!=0
+	 || listen(fd, 16)!=0
+	 || getsockname(fd, (struct sockaddr*)&addr, &addr_len)!=0) {
+		close(fd);
+		return -1;
+	}
+
+	*ret_port = ntohs(addr.sin_port);
+	return fd;
+}
+
+
+static void accept_loop(testserver_t* server, int listener, int is_imap)
+{
+	while (!server->stop)
+	{
+		struct pollfd pfd = { listener, POLLIN, 0 };
+		if (poll(&pfd, 1, TS_POLL_MS)<=0) {
+			continue;
+		}
+
+		int fd = accept(listener, NULL, NULL);
+		if (fd<0) {
+			continue;
+		}
+
+		ts_thread_arg_t* arg = ts_malloc(sizeof(ts_thread_arg_t));
+		arg->conn = ts_malloc(sizeof(ts_conn_t));
+		arg->conn->server = server;
+		arg->conn->fd = fd;
+		arg->is_imap = is_imap;
+
+		pthread_mutex_lock(&server->mutex);
+			server->active_connections++;
+			server->stats.connections++;
+		pthread_mutex_unlock(&server->mutex);
+
+		pthread_t      thread;
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		if (pthread_create(&thread, &attr, connection_thread, arg)!=0) {
+			close(fd);
+			free(arg->conn);
+			free(arg);
+			pthread_mutex_lock(&server->mutex);
+				server->active_connections--;
+			pthread_mutex_unlock(&server->mutex);
+		}
+		pthread_attr_destroy(&attr);
+	}
+}
+
+
+static void* imap_accept_thread(void* server)
+{
+	accept_loop((testserver_t*)server, ((testserver_t*)server)->imap_listener, 1);
+	return NULL;
+}
+
+
+static void* smtp_accept_thread(void* server)
+{
+	accept_loop((testserver_t*)server, ((testserver_t*)server)->smtp_listener, 0);
+	return NULL;
+}
+
+
+/**
+ * Start the server on the loopback interface.
+ *
+ * @param options Ports, latency, bandwidth and connection drops, NULL for defaults.
+ * @return The server object, must be freed using testserver_stop(). NULL on errors.
+ */
+testserver_t* testserver_start(const testserver_options_t* options)
+{
+	testserver_t* server = ts_malloc(sizeof(testserver_t));
+
+	if (options) {
+		server->options = *options;
+	}
+
+	pthread_mutex_init(&server->mutex, NULL);
+	pthread_cond_init(&server->cond, NULL);
+
+	if ((server->imap_listener=create_listener(server->options.imap_port, &server->imap_port))<0) {
+		goto cleanup;
+	}
+
+	if ((server->smtp_listener=create_listener(server->options.smtp_port, &server->smtp_port))<0) {
+		close(server->imap_listener);
+		goto cleanup;
+	}
+
+	pthread_create(&server->imap_thread, NULL, imap_accept_thread, server);
+	pthread_create(&server->smtp_thread, NULL, smtp_accept_thread, server);
+	return server;
+
+cleanup:
+	pthread_cond_destroy(&server->cond);
+	pthread_mutex_destroy(&server->mutex);
+	free(server);
+	return NULL;
+}
+
+
+/**
+ * Stop the server, close all connections and free all mailboxes.
+ *
+ * @param server The server object as created by testserver_start(). If NULL is given, nothing is done.
+ * @return None.
+ */
+void testserver_stop(testserver_t* server)
+{
+	if (server==NULL) {
+		return;
+	}
+
+	server->stop = 1;
+	pthread_join(server->imap_thread, NULL);
+	pthread_join(server->smtp_thread, NULL);
+	close(server->imap_listener);
+	close(server->smtp_listener);
+
+	pthread_mutex_lock(&server->mutex);
+		while (server->active_connections>0) {
+			pthread_cond_wait(&server->cond, &server->mutex);
+		}
+		free_users(server);
+	pthread_mutex_unlock(&server->mutex);
+
+	pthread_cond_destroy(&server->cond);
+	pthread_mutex_destroy(&server->mutex);
+	free(server);
+}
+
+
+int testserver_get_imap_port(const testserver_t* server)
+{
+	return server? server->imap_port : 0;
+}
+
+
+int testserver_get_smtp_port(const testserver_t* server)
+{
+	return server? server->smtp_port : 0;
+}
+
+
+void testserver_get_stats(testserver_t* server, testserver_stats_t* ret)
+{
+	if (server==NULL || ret==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&server->mutex);
+		*ret = server->stats;
+	pthread_mutex_unlock(&server->mutex);
+}
@@ -0,0 +1,43 @@
+#ifndef __TESTSERVER_H__
+#define __TESTSERVER_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+
+typedef struct _testserver testserver_t;
+
+
+typedef struct testserver_options_t
+{
+	int imap_port;      /* 0=use any free port, see testserver_get_imap_port() */
+	int smtp_port;      /* 0=use any free port, see testserver_get_smtp_port() */
+	int latency_ms;     /* delay before each response */
+	int bytes_per_sec;  /* 0=unlimited */
+	int drop_after;     /* 0=never, otherwise close each connection after this number of commands */
+} testserver_options_t;
+
+
+typedef struct testserver_stats_t
+{
+	int      connections;
+	int      dropped;
+	int      delivered;
+	uint64_t bytes_sent;
+} testserver_stats_t;
+
+
+testserver_t* testserver_start          (const testserver_options_t*);
+void          testserver_stop           (testserver_t*);
+int           testserver_get_imap_port  (const testserver_t*);
+int           testserver_get_smtp_port  (const testserver_t*);
+void          testserver_get_stats      (testserver_t*, testserver_stats_t*);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __TESTSERVER_H__ */
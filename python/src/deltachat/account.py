@@ -3,6 +3,7 @@
 from __future__ import print_function
 import threading
 import re
+import json
 import time
 import requests
 from array import array
@@ -120,6 +121,18 @@ class Account(object):
         self.check_is_configured()
         return from_dc_charpointer(lib.dc_get_info(self._dc_context))
 
+    def get_stats(self):
+        """ return dictionary of counts and latencies of timed operations.
+
+        :returns: dict mapping operation names as "sql_exec" or "imap_fetch"
+                  to dicts with "count", "total_us", "max_us", percentiles and "histogram".
+        """
+        return json.loads(from_dc_charpointer(lib.dc_get_stats(self._dc_context)))
+
+    def reset_stats(self):
+        """ reset all counters returned by get_stats(). """
+        lib.dc_reset_stats(self._dc_context)
+
     def get_blobdir(self):
         """ return the directory for files.
 
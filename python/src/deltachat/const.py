@@ -64,6 +64,7 @@ DC_EVENT_CHAT_MODIFIED = 2020
 DC_EVENT_CONTACTS_CHANGED = 2030
 DC_EVENT_LOCATION_CHANGED = 2035
 DC_EVENT_CONFIGURE_PROGRESS = 2041
+DC_EVENT_CATCHUP_PROGRESS = 2045
 DC_EVENT_IMEX_PROGRESS = 2051
 DC_EVENT_IMEX_FILE_WRITTEN = 2052
 DC_EVENT_SECUREJOIN_INVITER_PROGRESS = 2060
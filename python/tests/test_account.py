@@ -41,6 +41,16 @@ class TestOfflineAccount:
         out = ac1.get_infostring()
         assert "number_of_chats=0" in out
 
+    def test_get_stats(self, acfactory):
+        ac1 = acfactory.get_configured_offline_account()
+        ac1.get_chats()
+        stats = ac1.get_stats()
+        assert stats["chatlist_load"]["count"] >= 1
+        assert stats["sql_prepare"]["count"] > 0
+        assert len(stats["sql_exec"]["histogram"]) == 32
+        ac1.reset_stats()
+        assert ac1.get_stats()["chatlist_load"]["count"] == 0
+
     def test_selfcontact_configured(self, acfactory):
         ac1 = acfactory.get_configured_offline_account()
         me = ac1.get_self_contact()
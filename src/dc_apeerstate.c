@@ -199,6 +199,7 @@ int dc_apeerstate_save_to_db(const dc_apeerstate_t* peerstate, dc_sqlite3_t* sql
 
 	if ((peerstate->to_save&DC_SAVE_ALL) || create) {
 		dc_reset_gossiped_timestamp(peerstate->context, 0);
+		dc_e2ee_reset_plans(peerstate->context); /* keys or preferences changed, timestamps alone do not affect encryption */
 	}
 
 	success = 1;
@@ -0,0 +1,230 @@
+/* A bump allocator for scratch memory.
+
+Allocations are taken from larger chunks and cannot be freed one by one;
+instead, dc_arena_reset() releases everything at once.  As the first chunk
+is kept for the next use, an arena that is reset after each message
+typically allocates no memory from the system at all. */
+
+
+#include <stdarg.h>
+#include "dc_context.h"
+#include "dc_arena.h"
+
+
+#define ARENA_ALIGN 16 /* enough for all types used in the allocated structures */
+#define ALIGN_UP(a) (((a)+(ARENA_ALIGN-1)) & ~((size_t)ARENA_ALIGN-1))
+
+
+struct _dc_arena_chunk
+{
+	dc_arena_chunk_t* next;
+	size_t            bytes; /* usable bytes, following the header */
+};
+
+#define CHUNK_HEADER     ALIGN_UP(sizeof(dc_arena_chunk_t))
+#define CHUNK_DATA(c)    (((char*)(c)) + CHUNK_HEADER)
+
+
+static dc_arena_chunk_t* new_chunk(size_t bytes)
+{
+	dc_arena_chunk_t* chunk = malloc(CHUNK_HEADER + bytes);
+	if (chunk==NULL) {
+		exit(67);
+	}
+	chunk->next  = NULL;
+	chunk->bytes = bytes;
+	return chunk;
+}
+
+
+/**
+ * Initialize an arena, typically embedded in another object.
+ * No memory is allocated before the first call to dc_arena_alloc().
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena to initialize.
+ * @param chunk_bytes The size of the chunks to allocate from the system;
+ *     should be large enough for all allocations of one usage cycle.
+ * @return None.
+ */
+void dc_arena_init(dc_arena_t* arena, size_t chunk_bytes)
+{
+	if (arena==NULL) {
+		return;
+	}
+
+	arena->chunks      = NULL;
+	arena->used        = 0;
+	arena->chunk_bytes = ALIGN_UP(DC_MAX(chunk_bytes, 1024));
+}
+
+
+/**
+ * Release all memory allocated from the arena at once.
+ * One chunk is kept for further allocations,
+ * so resetting an arena that used only one chunk does not call free().
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena to reset.
+ * @return None.
+ */
+void dc_arena_reset(dc_arena_t* arena)
+{
+	dc_arena_chunk_t* keep = NULL;
+
+	if (arena==NULL) {
+		return;
+	}
+
+	for (dc_arena_chunk_t* chunk = arena->chunks; chunk; ) {
+		dc_arena_chunk_t* next = chunk->next;
+		if (keep==NULL && chunk->bytes==arena->chunk_bytes) {
+			keep = chunk;
+			keep->next = NULL;
+		}
+		else {
+			free(chunk);
+		}
+		chunk = next;
+	}
+
+	arena->chunks = keep;
+	arena->used   = 0;
+}
+
+
+/**
+ * Release all memory of an arena, including the chunk kept by dc_arena_reset().
+ * The arena can be used again afterwards.
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena to free.
+ * @return None.
+ */
+void dc_arena_free(dc_arena_t* arena)
+{
+	if (arena==NULL) {
+		return;
+	}
+
+	dc_arena_reset(arena);
+	free(arena->chunks);
+	arena->chunks = NULL;
+}
+
+
+/**
+ * Allocate memory from the arena.
+ * The memory is valid until dc_arena_reset() or dc_arena_free() is called
+ * and MUST NOT be free()'d.  If the system is out of memory, the program halts.
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena to allocate from.
+ * @param bytes The number of bytes to allocate.
+ * @return Uninitialized memory, aligned for any of the usual types.
+ */
+void* dc_arena_alloc(dc_arena_t* arena, size_t bytes)
+{
+	void* ret = NULL;
+
+	bytes = ALIGN_UP(DC_MAX(bytes, 1));
+
+	if (arena->chunks && arena->used+bytes <= arena->chunks->bytes)
+	{
+		ret = CHUNK_DATA(arena->chunks) + arena->used;
+		arena->used += bytes;
+	}
+	else if (bytes > arena->chunk_bytes/4)
+	{
+		/* large allocations get a chunk of their own, behind the current one, which is still used for small allocations */
+		dc_arena_chunk_t* chunk = new_chunk(bytes);
+		if (arena->chunks) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+		}
+		else {
+			arena->chunks = chunk;
+			arena->used = bytes;
+		}
+		ret = CHUNK_DATA(chunk);
+	}
+	else
+	{
+		dc_arena_chunk_t* chunk = new_chunk(arena->chunk_bytes);
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->used = bytes;
+		ret = CHUNK_DATA(chunk);
+	}
+
+	return ret;
+}
+
+
+void* dc_arena_calloc(dc_arena_t* arena, size_t bytes)
+{
+	void* ret = dc_arena_alloc(arena, bytes);
+	memset(ret, 0, bytes);
+	return ret;
+}
+
+
+/**
+ * Copy a string to the arena.
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena to allocate from.
+ * @param str The string to copy, may be NULL.
+ * @return The copy of the string, an empty string if NULL was given.
+ *     The copy MUST NOT be free()'d.
+ */
+char* dc_arena_strdup(dc_arena_t* arena, const char* str)
+{
+	return dc_arena_strndup(arena, str, str? strlen(str) : 0);
+}
+
+
+/**
+ * Copy the given number of bytes to the arena and add a null-byte.
+ * In contrast to strndup(), null-bytes in the given buffer are copied.
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena to allocate from.
+ * @param buf The data to copy, may be NULL if bytes is 0.
+ * @param bytes The number of bytes to copy.
+ * @return The null-terminated copy, MUST NOT be free()'d.
+ */
+char* dc_arena_strndup(dc_arena_t* arena, const char* buf, size_t bytes)
+{
+	char* ret = dc_arena_alloc(arena, bytes+1);
+	if (bytes) {
+		memcpy(ret, buf, bytes);
+	}
+	ret[bytes] = 0;
+	return ret;
+}
+
+
+char* dc_arena_mprintf(dc_arena_t* arena, const char* format, ...)
+{
+	char    testbuf[1];
+	char*   buf = NULL;
+	int     char_cnt_without_zero = 0;
+	va_list argp;
+	va_list argp_copy;
+
+	va_start(argp, format);
+	va_copy(argp_copy, argp);
+
+	char_cnt_without_zero = vsnprintf(testbuf, 0, format, argp);
+	va_end(argp);
+	if (char_cnt_without_zero < 0) {
+		va_end(argp_copy);
+		return dc_arena_strdup(arena, "ErrFmt");
+	}
+
+	buf = dc_arena_alloc(arena, char_cnt_without_zero+1);
+	vsnprintf(buf, char_cnt_without_zero+1, format, argp_copy);
+	va_end(argp_copy);
+	return buf;
+}
@@ -0,0 +1,38 @@
+#ifndef __DC_ARENA_H__
+#define __DC_ARENA_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+
+
+typedef struct _dc_arena       dc_arena_t;
+typedef struct _dc_arena_chunk dc_arena_chunk_t;
+
+
+// a bump allocator for scratch memory that is released at once by dc_arena_reset(),
+// eg. all the small allocations done while a single message is received
+struct _dc_arena
+{
+	dc_arena_chunk_t* chunks;      // the chunk allocations are taken from, followed by the filled ones
+	size_t            used;        // bytes used in the first chunk
+	size_t            chunk_bytes; // size of a normal chunk, larger allocations get a chunk of their own
+};
+
+
+void     dc_arena_init                   (dc_arena_t*, size_t chunk_bytes);
+void     dc_arena_reset                  (dc_arena_t*);
+void     dc_arena_free                   (dc_arena_t*);
+void*    dc_arena_alloc                  (dc_arena_t*, size_t bytes);
+void*    dc_arena_calloc                 (dc_arena_t*, size_t bytes);
+char*    dc_arena_strdup                 (dc_arena_t*, const char*);
+char*    dc_arena_strndup                (dc_arena_t*, const char*, size_t bytes);
+char*    dc_arena_mprintf                (dc_arena_t*, const char* format, ...);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_ARENA_H__ */
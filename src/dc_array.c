@@ -4,12 +4,24 @@
 #define DC_ARRAY_MAGIC 0x000a11aa
 
 
+static size_t get_item_bytes(int type)
+{
+	switch (type) {
+		case DC_ARRAY_IDS:       return sizeof(uint32_t);
+		case DC_ARRAY_LOCATIONS: return sizeof(dc_location_t);
+		default:                 return sizeof(uintptr_t);
+	}
+}
+
+
 /**
  * Create an array object in memory.
  *
  * @private @memberof dc_array_t
  * @param context The context object that should be stored in the array object. May be NULL.
- * @param type 0 for a standard array of int or one of DC_ARRAY_*.
+ * @param type DC_ARRAY_IDS for 32 bit IDs,
+ *     DC_ARRAY_UINTS for integers of pointer size or pointers,
+ *     DC_ARRAY_LOCATIONS for dc_location_t structures stored inline.
  * @param initsize Initial maximal size of the array. If you add more items, the internal data pointer is reallocated.
  * @return New array object of the requested size, the data should be set directly.
  */
@@ -27,7 +39,8 @@ dc_array_t* dc_array_new_typed(dc_context_t* context, int type, size_t initsize)
 	array->count     = 0;
 	array->allocated = initsize<1? 1 : initsize;
 	array->type      = type;
-	array->array     = malloc(array->allocated * sizeof(uintptr_t));
+	array->sorted    = (type==DC_ARRAY_IDS);
+	array->array     = malloc(array->allocated * get_item_bytes(type));
 	if (array->array==NULL) {
 		exit(48);
 	}
@@ -38,7 +51,39 @@ dc_array_t* dc_array_new_typed(dc_context_t* context, int type, size_t initsize)
 
 dc_array_t* dc_array_new(dc_context_t* context, size_t initsize)
 {
-	return dc_array_new_typed(context, 0, initsize);
+	return dc_array_new_typed(context, DC_ARRAY_IDS, initsize);
+}
+
+
+static void grow(dc_array_t* array)
+{
+	if (array->count==array->allocated) {
+		size_t newsize = (array->allocated * 2) + 10;
+		void*  data = realloc(array->array, newsize*get_item_bytes(array->type));
+		if (data==NULL) {
+			exit(49);
+		}
+		array->array = data;
+		array->allocated = newsize;
+	}
+}
+
+
+static void widen_ids(dc_array_t* array)
+{
+	/* pointers or integers larger than 32 bit are added to an array of IDs;
+	convert it to an array of uintptr_t, this is not expected to happen often */
+	uintptr_t* data = malloc(array->allocated*sizeof(uintptr_t));
+	if (data==NULL) {
+		exit(71);
+	}
+	for (size_t i = 0; i<array->count; i++) {
+		data[i] = array->ids[i];
+	}
+	free(array->ids);
+	array->array  = data;
+	array->type   = DC_ARRAY_UINTS;
+	array->sorted = 0;
 }
 
 
@@ -69,6 +114,7 @@ void dc_array_unref(dc_array_t* array)
 
 /**
  * Calls free() for each item and sets the item to 0 afterwards.
+ * For arrays of locations, the markers are free()'d.
  * The array object itself is not deleted and the size of the array stays the same.
  *
  * @private @memberof dc_array_t
@@ -83,17 +129,20 @@ void dc_array_free_ptr(dc_array_t* array)
 
 	for (size_t i = 0; i<array->count; i++) {
 		if (array->type==DC_ARRAY_LOCATIONS) {
-			free(((struct _dc_location*)array->array[i])->marker);
+			free(array->locations[i].marker);
+			array->locations[i].marker = NULL;
+		}
+		else if (array->type==DC_ARRAY_UINTS) {
+			free((void*)array->array[i]);
+			array->array[i] = 0;
 		}
-		free((void*)array->array[i]);
-		array->array[i] = 0;
 	}
 }
 
 
 /**
  * Duplicates the array, take care if the array contains pointers to objects, take care to free them only once afterwards!
- * If the array only contains integers, you are always save.
+ * If the array only contains integers, you are always save; the markers of locations are duplicated.
  *
  * @private @memberof dc_array_t
  * @param array The array object.
@@ -107,14 +156,29 @@ dc_array_t* dc_array_duplicate(const dc_array_t* array)
 		return NULL;
 	}
 
-	ret = dc_array_new(array->context, array->allocated);
-	ret->count = array->count;
-	memcpy(ret->array, array->array, array->count * sizeof(uintptr_t));
+	ret = dc_array_new_typed(array->context, array->type, array->allocated);
+	ret->count  = array->count;
+	ret->sorted = array->sorted;
+	memcpy(ret->array, array->array, array->count * get_item_bytes(array->type));
+
+	if (array->type==DC_ARRAY_LOCATIONS) {
+		for (size_t i = 0; i<ret->count; i++) {
+			ret->locations[i].marker = dc_strdup_keep_null(array->locations[i].marker);
+		}
+	}
 
 	return ret;
 }
 
 
+static int cmp_uint32_t(const void* p1, const void* p2)
+{
+	uint32_t v1 = *(uint32_t*)p1;
+	uint32_t v2 = *(uint32_t*)p2;
+	return (v1<v2)? -1 : ((v1>v2)? 1 : 0);
+}
+
+
 static int cmp_intptr_t(const void* p1, const void* p2)
 {
 	uintptr_t v1 = *(uintptr_t*)p1;
@@ -125,17 +189,199 @@ static int cmp_intptr_t(const void* p1, const void* p2)
 
 /**
  * Sort the array, assuming it contains unsigned integers.
+ * Afterwards, dc_array_search_id() uses a binary search.
  *
  * @private @memberof dc_array_t
  * @param array The array object.
- * @return The duplicated array.
+ * @return None.
  */
 void dc_array_sort_ids(dc_array_t* array)
 {
-	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || array->count <= 1) {
+	if (array==NULL || array->magic!=DC_ARRAY_MAGIC) {
 		return;
 	}
-	qsort(array->array, array->count, sizeof(uintptr_t), cmp_intptr_t);
+
+	if (array->type==DC_ARRAY_IDS) {
+		if (!array->sorted) {
+			qsort(array->ids, array->count, sizeof(uint32_t), cmp_uint32_t);
+			array->sorted = 1;
+		}
+	}
+	else if (array->type==DC_ARRAY_UINTS && array->count > 1) {
+		qsort(array->array, array->count, sizeof(uintptr_t), cmp_intptr_t);
+	}
+}
+
+
+static size_t lower_bound(const uint32_t* ids, size_t cnt, uint32_t needle)
+{
+	/* index of the first ID not less than needle in sorted IDs, cnt if there is none */
+	size_t lo = 0, hi = cnt;
+	while (lo<hi) {
+		size_t mid = lo + (hi-lo)/2;
+		if (ids[mid]<needle) {
+			lo = mid+1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+
+/**
+ * Remove duplicate IDs from the array, the first occurrence of each ID is kept.
+ * The order of the IDs is not changed.
+ * Takes O(n log n) time for unsorted arrays and O(n) for sorted arrays.
+ *
+ * @private @memberof dc_array_t
+ * @param array The array object.
+ * @return None.
+ */
+void dc_array_unique_ids(dc_array_t* array)
+{
+	uint32_t* sorted = NULL;
+	char*     seen = NULL;
+	size_t    cnt = 0;
+
+	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || array->type!=DC_ARRAY_IDS || array->count <= 1) {
+		return;
+	}
+
+	if (array->sorted) {
+		for (size_t i = 0; i<array->count; i++) {
+			if (cnt==0 || array->ids[i]!=array->ids[cnt-1]) {
+				array->ids[cnt++] = array->ids[i];
+			}
+		}
+	}
+	else {
+		/* look up each ID in a sorted copy and remember which ones were seen */
+		if ((sorted=malloc(array->count*sizeof(uint32_t)))==NULL
+		 || (seen=calloc(array->count, 1))==NULL) {
+			exit(68);
+		}
+		memcpy(sorted, array->ids, array->count*sizeof(uint32_t));
+		qsort(sorted, array->count, sizeof(uint32_t), cmp_uint32_t);
+
+		for (size_t i = 0; i<array->count; i++) {
+			size_t pos = lower_bound(sorted, array->count, array->ids[i]);
+			if (!seen[pos]) {
+				seen[pos] = 1;
+				array->ids[cnt++] = array->ids[i];
+			}
+		}
+	}
+
+	array->count = cnt;
+	free(sorted);
+	free(seen);
+}
+
+
+static dc_array_t* get_sorted_ids(const dc_array_t* array, dc_array_t** to_unref)
+{
+	/* returns the array itself if it is a sorted array of IDs, a sorted copy otherwise */
+	*to_unref = NULL;
+	if (array==NULL || array->magic!=DC_ARRAY_MAGIC) {
+		return *to_unref = dc_array_new(NULL, 1);
+	}
+
+	if (array->type==DC_ARRAY_IDS && array->sorted) {
+		return (dc_array_t*)array;
+	}
+
+	*to_unref = dc_array_new(NULL, array->count);
+	for (size_t i = 0; i<array->count; i++) {
+		dc_array_add_id(*to_unref, dc_array_get_id(array, i));
+	}
+	dc_array_sort_ids(*to_unref);
+	return *to_unref;
+}
+
+
+/**
+ * Get the IDs that are in any of two arrays.
+ * Unsorted arrays are sorted before, so it is faster to pass sorted arrays.
+ *
+ * @private @memberof dc_array_t
+ * @param array1 The first array, NULL is handled as an empty array.
+ * @param array2 The second array, NULL is handled as an empty array.
+ * @return A new, sorted array of IDs, each ID is added only once.
+ *     Must be freed using dc_array_unref() after usage.
+ */
+dc_array_t* dc_array_union_ids(const dc_array_t* array1, const dc_array_t* array2)
+{
+	dc_array_t* unref1 = NULL;
+	dc_array_t* unref2 = NULL;
+	dc_array_t* a = get_sorted_ids(array1, &unref1);
+	dc_array_t* b = get_sorted_ids(array2, &unref2);
+	dc_array_t* ret = dc_array_new(a->context? a->context : b->context, a->count+b->count);
+	size_t      i = 0, j = 0;
+
+	while (i<a->count || j<b->count) {
+		uint32_t id;
+		if (j>=b->count || (i<a->count && a->ids[i]<b->ids[j])) {
+			id = a->ids[i++];
+		}
+		else if (i>=a->count || b->ids[j]<a->ids[i]) {
+			id = b->ids[j++];
+		}
+		else {
+			id = a->ids[i++];
+			j++;
+		}
+
+		if (ret->count==0 || ret->ids[ret->count-1]!=id) {
+			ret->ids[ret->count++] = id;
+		}
+	}
+
+	dc_array_unref(unref1);
+	dc_array_unref(unref2);
+	return ret;
+}
+
+
+/**
+ * Get the IDs that are in both arrays.
+ * Unsorted arrays are sorted before, so it is faster to pass sorted arrays.
+ *
+ * @private @memberof dc_array_t
+ * @param array1 The first array, NULL is handled as an empty array.
+ * @param array2 The second array, NULL is handled as an empty array.
+ * @return A new, sorted array of IDs, each ID is added only once.
+ *     Must be freed using dc_array_unref() after usage.
+ */
+dc_array_t* dc_array_intersect_ids(const dc_array_t* array1, const dc_array_t* array2)
+{
+	dc_array_t* unref1 = NULL;
+	dc_array_t* unref2 = NULL;
+	dc_array_t* a = get_sorted_ids(array1, &unref1);
+	dc_array_t* b = get_sorted_ids(array2, &unref2);
+	dc_array_t* ret = dc_array_new(a->context? a->context : b->context, DC_MIN(a->count, b->count));
+	size_t      i = 0, j = 0;
+
+	while (i<a->count && j<b->count) {
+		if (a->ids[i]<b->ids[j]) {
+			i++;
+		}
+		else if (b->ids[j]<a->ids[i]) {
+			j++;
+		}
+		else {
+			if (ret->count==0 || ret->ids[ret->count-1]!=a->ids[i]) {
+				ret->ids[ret->count++] = a->ids[i];
+			}
+			i++;
+			j++;
+		}
+	}
+
+	dc_array_unref(unref1);
+	dc_array_unref(unref2);
+	return ret;
 }
 
 
@@ -156,7 +402,7 @@ static int cmp_strings_t(const void* p1, const void* p2)
  */
 void dc_array_sort_strings(dc_array_t* array)
 {
-	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || array->count <= 1) {
+	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || array->type!=DC_ARRAY_UINTS || array->count <= 1) {
 		return;
 	}
 	qsort(array->array, array->count, sizeof(char*), cmp_strings_t);
@@ -176,7 +422,8 @@ void dc_array_empty(dc_array_t* array)
 		return;
 	}
 
-	array->count = 0;
+	array->count  = 0;
+	array->sorted = (array->type==DC_ARRAY_IDS);
 }
 
 
@@ -191,19 +438,25 @@ void dc_array_empty(dc_array_t* array)
  */
 void dc_array_add_uint(dc_array_t* array, uintptr_t item)
 {
-	if (array==NULL || array->magic!=DC_ARRAY_MAGIC) {
+	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || array->type==DC_ARRAY_LOCATIONS) {
 		return;
 	}
 
-	if (array->count==array->allocated) {
-		int newsize = (array->allocated * 2) + 10;
-		if ((array->array=realloc(array->array, newsize*sizeof(uintptr_t)))==NULL) {
-			exit(49);
-		}
-		array->allocated = newsize;
+	if (array->type==DC_ARRAY_IDS && item>UINT32_MAX) {
+		widen_ids(array);
 	}
 
-	array->array[array->count] = item;
+	grow(array);
+
+	if (array->type==DC_ARRAY_IDS) {
+		if (array->count>0 && item<array->ids[array->count-1]) {
+			array->sorted = 0;
+		}
+		array->ids[array->count] = (uint32_t)item;
+	}
+	else {
+		array->array[array->count] = item;
+	}
 	array->count++;
 }
 
@@ -234,10 +487,39 @@ void dc_array_add_id(dc_array_t* array, uint32_t item)
  */
 void dc_array_add_ptr(dc_array_t* array, void* item)
 {
+	if (array==NULL || array->magic!=DC_ARRAY_MAGIC) {
+		return;
+	}
+
+	if (array->type==DC_ARRAY_IDS) {
+		widen_ids(array);
+	}
+
 	dc_array_add_uint(array, (uintptr_t)item);
 }
 
 
+/**
+ * Add a location to an array created with the type DC_ARRAY_LOCATIONS.
+ * The location is copied, the array takes the ownership of the marker.
+ *
+ * @private @memberof dc_array_t
+ * @param array The array to add the location to.
+ * @param location The location to add.
+ * @return None.
+ */
+void dc_array_add_location(dc_array_t* array, const dc_location_t* location)
+{
+	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || array->type!=DC_ARRAY_LOCATIONS || location==NULL) {
+		return;
+	}
+
+	grow(array);
+	array->locations[array->count] = *location;
+	array->count++;
+}
+
+
 /**
  * Find out the number of items in an array.
  *
@@ -270,7 +552,11 @@ uintptr_t dc_array_get_uint(const dc_array_t* array, size_t index)
 		return 0;
 	}
 
-	return array->array[index];
+	switch (array->type) {
+		case DC_ARRAY_IDS:       return array->ids[index];
+		case DC_ARRAY_LOCATIONS: return (uintptr_t)&array->locations[index];
+		default:                 return array->array[index];
+	}
 }
 
 
@@ -288,16 +574,18 @@ uint32_t dc_array_get_id(const dc_array_t* array, size_t index)
 		return 0;
 	}
 
-	if (array->type==DC_ARRAY_LOCATIONS) {
-		return ((struct _dc_location*)array->array[index])->location_id;
+	switch (array->type) {
+		case DC_ARRAY_IDS:       return array->ids[index];
+		case DC_ARRAY_LOCATIONS: return array->locations[index].location_id;
+		default:                 return (uint32_t)array->array[index];
 	}
-
-	return (uint32_t)array->array[index];
 }
 
 
 /**
- * Get the item at the given index as an ID.
+ * Get the item at the given index as a pointer.
+ * For arrays of locations, this is a pointer to the location inside the array,
+ * which is valid until the array is modified or free'd.
  *
  * @memberof dc_array_t
  * @param array The array object.
@@ -306,11 +594,7 @@ uint32_t dc_array_get_id(const dc_array_t* array, size_t index)
  */
 void* dc_array_get_ptr(const dc_array_t* array, size_t index)
 {
-	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count) {
-		return 0;
-	}
-
-	return (void*)array->array[index];
+	return (void*)dc_array_get_uint(array, index);
 }
 
 
@@ -326,11 +610,11 @@ void* dc_array_get_ptr(const dc_array_t* array, size_t index)
 double dc_array_get_latitude(const dc_array_t* array, size_t index)
 {
 	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count
-	 || array->type!=DC_ARRAY_LOCATIONS || array->array[index]==0 ) {
+	 || array->type!=DC_ARRAY_LOCATIONS) {
 		return 0;
 	}
 
-	return ((struct _dc_location*)array->array[index])->latitude;
+	return array->locations[index].latitude;
 }
 
 
@@ -346,11 +630,11 @@ double dc_array_get_latitude(const dc_array_t* array, size_t index)
 double dc_array_get_longitude(const dc_array_t* array, size_t index)
 {
 	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count
-	 || array->type!=DC_ARRAY_LOCATIONS || array->array[index]==0 ) {
+	 || array->type!=DC_ARRAY_LOCATIONS) {
 		return 0;
 	}
 
-	return ((struct _dc_location*)array->array[index])->longitude;
+	return array->locations[index].longitude;
 }
 
 
@@ -367,11 +651,11 @@ double dc_array_get_longitude(const dc_array_t* array, size_t index)
 double dc_array_get_accuracy(const dc_array_t* array, size_t index)
 {
 	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count
-	 || array->type!=DC_ARRAY_LOCATIONS || array->array[index]==0 ) {
+	 || array->type!=DC_ARRAY_LOCATIONS) {
 		return 0;
 	}
 
-	return ((struct _dc_location*)array->array[index])->accuracy;
+	return array->locations[index].accuracy;
 }
 
 
@@ -387,11 +671,11 @@ double dc_array_get_accuracy(const dc_array_t* array, size_t index)
 time_t dc_array_get_timestamp(const dc_array_t* array, size_t index)
 {
 	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count
-	 || array->type!=DC_ARRAY_LOCATIONS || array->array[index]==0 ) {
+	 || array->type!=DC_ARRAY_LOCATIONS) {
 		return 0;
 	}
 
-	return ((struct _dc_location*)array->array[index])->timestamp;
+	return array->locations[index].timestamp;
 }
 
 
@@ -407,11 +691,11 @@ time_t dc_array_get_timestamp(const dc_array_t* array, size_t index)
 uint32_t dc_array_get_msg_id(const dc_array_t* array, size_t index)
 {
 	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count
-	 || array->type!=DC_ARRAY_LOCATIONS || array->array[index]==0 ) {
+	 || array->type!=DC_ARRAY_LOCATIONS) {
 		return 0;
 	}
 
-	return ((struct _dc_location*)array->array[index])->msg_id;
+	return array->locations[index].msg_id;
 }
 
 
@@ -427,11 +711,11 @@ uint32_t dc_array_get_msg_id(const dc_array_t* array, size_t index)
 uint32_t dc_array_get_chat_id(const dc_array_t* array, size_t index)
 {
 	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count
-	 || array->type!=DC_ARRAY_LOCATIONS || array->array[index]==0 ) {
+	 || array->type!=DC_ARRAY_LOCATIONS) {
 		return 0;
 	}
 
-	return ((struct _dc_location*)array->array[index])->chat_id;
+	return array->locations[index].chat_id;
 }
 
 
@@ -447,11 +731,11 @@ uint32_t dc_array_get_chat_id(const dc_array_t* array, size_t index)
 uint32_t dc_array_get_contact_id(const dc_array_t* array, size_t index)
 {
 	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count
-	 || array->type!=DC_ARRAY_LOCATIONS || array->array[index]==0 ) {
+	 || array->type!=DC_ARRAY_LOCATIONS) {
 		return 0;
 	}
 
-	return ((struct _dc_location*)array->array[index])->contact_id;
+	return array->locations[index].contact_id;
 }
 
 
@@ -472,11 +756,11 @@ uint32_t dc_array_get_contact_id(const dc_array_t* array, size_t index)
 char* dc_array_get_marker(const dc_array_t* array, size_t index)
 {
 	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count
-	 || array->type!=DC_ARRAY_LOCATIONS || array->array[index]==0 ) {
+	 || array->type!=DC_ARRAY_LOCATIONS) {
 		return 0;
 	}
 
-	return dc_strdup_keep_null(((struct _dc_location*)array->array[index])->marker);
+	return dc_strdup_keep_null(array->locations[index].marker);
 }
 
 
@@ -493,16 +777,17 @@ char* dc_array_get_marker(const dc_array_t* array, size_t index)
 int dc_array_is_independent(const dc_array_t* array, size_t index)
 {
 	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || index>=array->count
-	 || array->type!=DC_ARRAY_LOCATIONS || array->array[index]==0 ) {
+	 || array->type!=DC_ARRAY_LOCATIONS) {
 		return 0;
 	}
 
-	return ((struct _dc_location*)array->array[index])->independent;
+	return array->locations[index].independent;
 }
 
 
 /**
  * Check if a given ID is present in an array.
+ * If the array is sorted, a binary search is used.
  *
  * @private @memberof dc_array_t
  * @param array The array object to search in.
@@ -516,11 +801,22 @@ int dc_array_search_id(const dc_array_t* array, uint32_t needle, size_t* ret_ind
 		return 0;
 	}
 
-	uintptr_t* data = array->array;
 	size_t i, cnt = array->count;
+	if (array->type==DC_ARRAY_IDS && array->sorted)
+	{
+		i = lower_bound(array->ids, cnt, needle);
+		if (i<cnt && array->ids[i]==needle) {
+			if (ret_index) {
+				*ret_index = i;
+			}
+			return 1;
+		}
+		return 0;
+	}
+
 	for (i=0; i<cnt; i++)
 	{
-		if (data[i]==needle) {
+		if (dc_array_get_id(array, i)==needle) {
 			if (ret_index) {
 				*ret_index = i;
 			}
@@ -533,19 +829,22 @@ int dc_array_search_id(const dc_array_t* array, uint32_t needle, size_t* ret_ind
 
 
 /**
- * Get raw pointer to the data.
+ * Get raw pointer to the IDs, without copying them.
+ * This is useful for bindings that want to convert large lists of IDs at once.
  *
  * @memberof dc_array_t
- * @param array The array object.
- * @return Raw pointer to the array. You MUST NOT free the data. You MUST NOT access the data beyond the current item count.
+ * @param array The array object, eg. as returned by dc_get_chat_msgs().
+ * @return Raw pointer to the IDs, dc_array_get_cnt() IDs of 32 bit each.
+ *     You MUST NOT free the data. You MUST NOT access the data beyond the current item count.
  *     It is not possible to enlarge the array this way.  Calling any other dc_array*()-function may discard the returned pointer.
+ *     NULL if the array does not contain IDs, eg. for arrays returned by dc_get_locations().
  */
-const uintptr_t* dc_array_get_raw(const dc_array_t* array)
+const uint32_t* dc_array_get_raw(const dc_array_t* array)
 {
-	if (array==NULL || array->magic!=DC_ARRAY_MAGIC) {
+	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || array->type!=DC_ARRAY_IDS) {
 		return NULL;
 	}
-	return array->array;
+	return array->ids;
 }
 
 
@@ -561,15 +860,16 @@ char* dc_arr_to_string(const uint32_t* arr, int cnt)
 
 	/* use a macro to allow using integers of different bitwidths */
 	#define INT_ARR_TO_STR(a, c) { \
-		int i; \
-		ret = malloc((c)*(11+strlen(sep))/*sign,10 digits,sep*/+1/*terminating zero*/); \
+		size_t i, pos = 0, sep_len = strlen(sep); \
+		ret = malloc((c)*((sizeof((a)[0])>4? 21 : 11)+sep_len)/*sign,10 resp. 20 digits,sep*/+1/*terminating zero*/); \
 		if (ret==NULL) { exit(35); } \
 		ret[0] = 0; \
-		for (i=0; i<(c); i++) { \
+		for (i=0; i<(size_t)(c); i++) { \
 			if (i) { \
-				strcat(ret, sep); \
+				memcpy(&ret[pos], sep, sep_len); \
+				pos += sep_len; \
 			} \
-			sprintf(&ret[strlen(ret)], "%lu", (unsigned long)(a)[i]); \
+			pos += sprintf(&ret[pos], "%lu", (unsigned long)(a)[i]); \
 		} \
 	}
 
@@ -583,11 +883,17 @@ char* dc_array_get_string(const dc_array_t* array, const char* sep)
 {
 	char* ret = NULL;
 
-	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || sep==NULL) {
+	if (array==NULL || array->magic!=DC_ARRAY_MAGIC || sep==NULL
+	 || array->type==DC_ARRAY_LOCATIONS) {
 		return dc_strdup("");
 	}
 
-	INT_ARR_TO_STR(array->array, array->count);
+	if (array->type==DC_ARRAY_IDS) {
+		INT_ARR_TO_STR(array->ids, array->count);
+	}
+	else {
+		INT_ARR_TO_STR(array->array, array->count);
+	}
 
 	return ret;
 }
@@ -5,6 +5,11 @@ extern "C" {
 #endif
 
 
+// the types of arrays, see dc_array_new_typed(); DC_ARRAY_LOCATIONS is defined with dc_location_t
+#define DC_ARRAY_IDS        0
+#define DC_ARRAY_UINTS      2
+
+
 /** the structure behind dc_array_t */
 struct _dc_array
 {
@@ -14,8 +19,13 @@ struct _dc_array
 	dc_context_t*   context;     /**< The context the array belongs to. May be NULL when NULL is given to dc_array_new(). */
 	size_t          allocated;   /**< The number of allocated items. Initially ~ 200. */
 	size_t          count;       /**< The number of used items. Initially 0. */
-	int             type;
-	uintptr_t*      array;       /**< The data items, can be used between data[0] and data[cnt-1]. Never NULL. */
+	int             type;        /**< DC_ARRAY_IDS, DC_ARRAY_UINTS or DC_ARRAY_LOCATIONS, defines the member of the union that is used. */
+	int             sorted;      /**< 1 if the IDs are known to be in ascending order, used for binary searching. DC_ARRAY_IDS only. */
+	union {
+		uint32_t*            ids;       /**< DC_ARRAY_IDS: The IDs, can be used between ids[0] and ids[cnt-1]. Never NULL. */
+		uintptr_t*           array;     /**< DC_ARRAY_UINTS: The data items, can be used between array[0] and array[cnt-1]. Never NULL. */
+		struct _dc_location* locations; /**< DC_ARRAY_LOCATIONS: The locations, stored inline. Never NULL. */
+	};
 };
 
 
@@ -25,6 +35,10 @@ void             dc_array_empty               (dc_array_t*);
 void             dc_array_free_ptr            (dc_array_t*);
 dc_array_t*      dc_array_duplicate           (const dc_array_t*);
 void             dc_array_sort_ids            (dc_array_t*);
+void             dc_array_unique_ids          (dc_array_t*);
+dc_array_t*      dc_array_union_ids           (const dc_array_t*, const dc_array_t*);
+dc_array_t*      dc_array_intersect_ids       (const dc_array_t*, const dc_array_t*);
+void             dc_array_add_location        (dc_array_t*, const struct _dc_location*);
 void             dc_array_sort_strings        (dc_array_t*);
 char*            dc_array_get_string          (const dc_array_t*, const char* sep);
 char*            dc_arr_to_string             (const uint32_t* arr, int cnt);
@@ -247,7 +247,7 @@ char* dc_chat_get_profile_image(const dc_chat_t* chat)
 	else if(chat->type==DC_CHAT_TYPE_SINGLE) {
 		contacts = dc_get_chat_contacts(chat->context, chat->id);
 		if (contacts->count >= 1) {
-			contact = dc_get_contact(chat->context, contacts->array[0]);
+			contact = dc_get_contact(chat->context, dc_array_get_id(contacts, 0));
 			image_abs = dc_contact_get_profile_image(contact);
 		}
 	}
@@ -285,7 +285,7 @@ uint32_t dc_chat_get_color(const dc_chat_t* chat)
 	if(chat->type==DC_CHAT_TYPE_SINGLE) {
 		contacts = dc_get_chat_contacts(chat->context, chat->id);
 		if (contacts->count >= 1) {
-			contact = dc_get_contact(chat->context, contacts->array[0]);
+			contact = dc_get_contact(chat->context, dc_array_get_id(contacts, 0));
 			color = dc_str_to_color(contact->addr);
 		}
 	}
@@ -412,7 +412,7 @@ int dc_chat_update_param(dc_chat_t* chat)
 	int success = 0;
 	sqlite3_stmt* stmt = dc_sqlite3_prepare(chat->context->sql,
 		"UPDATE chats SET param=? WHERE id=?");
-	sqlite3_bind_text(stmt, 1, chat->param->packed, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 1, dc_param_get_packed(chat->param), -1, SQLITE_STATIC);
 	sqlite3_bind_int (stmt, 2, chat->id);
 	success = (sqlite3_step(stmt)==SQLITE_DONE)? 1 : 0;
 	sqlite3_finalize(stmt);
@@ -577,10 +577,48 @@ int dc_add_to_chat_contacts_table(dc_context_t* context, uint32_t chat_id, uint3
 	sqlite3_bind_int(stmt, 2, contact_id);
 	ret = (sqlite3_step(stmt)==SQLITE_DONE)? 1 : 0;
 	sqlite3_finalize(stmt);
+
+	if (ret && contact_id!=DC_CONTACT_ID_SELF) {
+		dc_update_chat_members_key(context, chat_id);
+	}
 	return ret;
 }
 
 
+void dc_update_chat_members_key(dc_context_t* context, uint32_t chat_id)
+{
+	/* chats.members_key is the sorted, comma-separated list of the member IDs without SELF,
+	used to find ad-hoc groups by their members; must be called whenever chats_contacts is modified.
+	the list is sorted here as SQLite does not guarantee the order of group_concat() */
+	sqlite3_stmt* stmt = NULL;
+	dc_array_t*   contact_ids = dc_array_new(context, 16);
+	char*         members_key = NULL;
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT contact_id FROM chats_contacts WHERE chat_id=? AND contact_id!=?;");
+	sqlite3_bind_int(stmt, 1, chat_id);
+	sqlite3_bind_int(stmt, 2, DC_CONTACT_ID_SELF);
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_array_add_id(contact_ids, sqlite3_column_int(stmt, 0));
+	}
+	sqlite3_finalize(stmt);
+
+	dc_array_sort_ids(contact_ids);
+	dc_array_unique_ids(contact_ids);
+	members_key = dc_array_get_string(contact_ids, ",");
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"UPDATE chats SET members_key=? WHERE id=?;");
+	sqlite3_bind_text(stmt, 1, members_key, -1, SQLITE_STATIC);
+	sqlite3_bind_int (stmt, 2, chat_id);
+	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	free(members_key);
+	dc_array_unref(contact_ids);
+}
+
+
 /**
  * Get chat object by a chat ID.
  *
@@ -1055,8 +1093,7 @@ cleanup:
  */
 dc_array_t* dc_get_chat_msgs(dc_context_t* context, uint32_t chat_id, uint32_t flags, uint32_t marker1before)
 {
-	//clock_t       start = clock();
-
+	uint64_t      stats_start = dc_stats_now();
 	int           success = 0;
 	dc_array_t*   ret = dc_array_new(context, 512);
 	sqlite3_stmt* stmt = NULL;
@@ -1140,7 +1177,7 @@ dc_array_t* dc_get_chat_msgs(dc_context_t* context, uint32_t chat_id, uint32_t f
 cleanup:
 	sqlite3_finalize(stmt);
 
-	//dc_log_info(context, 0, "Message list for chat #%i created in %.3f ms.", chat_id, (double)(clock()-start)*1000.0/CLOCKS_PER_SEC);
+	dc_stats_add(context, DC_STATS_GET_CHAT_MSGS, stats_start);
 
 	if (success) {
 		return ret;
@@ -1228,7 +1265,7 @@ static int set_draft_raw(dc_context_t* context, uint32_t chat_id, dc_msg_t* msg)
 	sqlite3_bind_int  (stmt,  4, msg->type);
 	sqlite3_bind_int  (stmt,  5, DC_STATE_OUT_DRAFT);
 	sqlite3_bind_text (stmt,  6, msg->text? msg->text : "",  -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt,  7, msg->param->packed, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt,  7, dc_param_get_packed(msg->param), -1, SQLITE_STATIC);
 	sqlite3_bind_int  (stmt,  8, 1);
 	if (sqlite3_step(stmt)!=SQLITE_DONE) {
 		goto cleanup;
@@ -1408,6 +1445,8 @@ void dc_create_or_lookup_nchat_by_contact_id(dc_context_t* context, uint32_t con
 		goto cleanup;
 	}
 
+	dc_update_chat_members_key(context, chat_id);
+
 	sqlite3_free(q);
 	q = NULL;
 	sqlite3_finalize(stmt);
@@ -2148,6 +2187,7 @@ int dc_remove_contact_from_chat(dc_context_t* context, uint32_t chat_id, uint32_
 	if (!dc_sqlite3_execute(context->sql, q3)) {
 		goto cleanup;
 	}
+	dc_update_chat_members_key(context, chat_id);
 
 	context->cb(context, DC_EVENT_CHAT_MODIFIED, chat_id, 0);
 
@@ -2427,7 +2467,7 @@ static uint32_t prepare_msg_raw(dc_context_t* context, dc_chat_t* chat, const dc
 	sqlite3_bind_int  (stmt,  6, msg->type);
 	sqlite3_bind_int  (stmt,  7, msg->state);
 	sqlite3_bind_text (stmt,  8, msg->text? msg->text : "",  -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt,  9, msg->param->packed, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt,  9, dc_param_get_packed(msg->param), -1, SQLITE_STATIC);
 	sqlite3_bind_int  (stmt, 10, msg->hidden);
 	sqlite3_bind_text (stmt, 11, new_in_reply_to, -1, SQLITE_STATIC);
 	sqlite3_bind_text (stmt, 12, new_references, -1, SQLITE_STATIC);
@@ -2438,6 +2478,7 @@ static uint32_t prepare_msg_raw(dc_context_t* context, dc_chat_t* chat, const dc
 	}
 
 	msg_id = dc_sqlite3_get_rowid(context->sql, "msgs", "rfc724_mid", new_rfc724_mid);
+	dc_add_known_rfc724_mid(context, new_rfc724_mid);
 
 cleanup:
 	free(parent_rfc724_mid);
@@ -2790,7 +2831,7 @@ void dc_forward_msgs(dc_context_t* context, const uint32_t* msg_ids, int msg_cnt
 				goto cleanup;
 			}
 
-			dc_param_set_packed(original_param, msg->param->packed);
+			dc_param_set_packed(original_param, dc_param_get_packed(msg->param));
 
 			// do not mark own messages as being forwarded.
 			// this allows sort of broadcasting
@@ -39,6 +39,7 @@ int             dc_chat_update_param               (dc_chat_t*);
 
 // Context functions to work with chats
 int             dc_add_to_chat_contacts_table              (dc_context_t*, uint32_t chat_id, uint32_t contact_id);
+void            dc_update_chat_members_key                 (dc_context_t*, uint32_t chat_id);
 int             dc_is_contact_in_chat                      (dc_context_t*, uint32_t chat_id, uint32_t contact_id);
 size_t          dc_get_chat_cnt                            (dc_context_t*);
 uint32_t        dc_get_chat_id_by_grpid                    (dc_context_t*, const char* grpid, int* ret_blocked, int* ret_verified);
@@ -267,8 +267,7 @@ cleanup:
  */
 static int dc_chatlist_load_from_db(dc_chatlist_t* chatlist, int listflags, const char* query__, uint32_t query_contact_id)
 {
-	//clock_t       start = clock();
-
+	uint64_t      stats_start = dc_stats_now();
 	int           success = 0;
 	int           add_archived_link_item = 0;
 	sqlite3_stmt* stmt = NULL;
@@ -368,7 +367,7 @@ static int dc_chatlist_load_from_db(dc_chatlist_t* chatlist, int listflags, cons
 	success = 1;
 
 cleanup:
-	//dc_log_info(chatlist->context, 0, "Chatlist for search \"%s\" created in %.3f ms.", query__?query__:"", (double)(clock()-start)*1000.0/CLOCKS_PER_SEC);
+	dc_stats_add(chatlist->context, DC_STATS_CHATLIST_LOAD, stats_start);
 	sqlite3_finalize(stmt);
 	free(query);
 	free(strLikeCmd);
@@ -0,0 +1,630 @@
+/* Base64 and quoted-printable codecs for the transfer encoding of MIME parts and keys.
+
+Attachments are base64 encoded, so decoding is a visible part of receiving
+media.  On x86, 16 or 32 characters are decoded at once if the CPU supports
+SSSE3 or AVX2, this is checked at runtime.  Other platforms and everything
+that does not fit into a full block, eg. line ends, use the scalar code.
+
+The decoders return the same as libetpan's mailmime_base64_body_parse()
+and mailmime_quoted_printable_body_parse(), see the tests in stress.c.
+Characters that are not part of the base64 alphabet are skipped, this
+includes the padding. */
+
+
+#include "dc_context.h"
+#include "dc_codec.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DC_CODEC_X86 1
+#include <immintrin.h>
+#endif
+
+
+static const char s_base64_chars[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+static const signed char s_base64_values[256] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+	52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+	-1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+	-1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+
+// the block decoders may write up to 4 bytes behind the decoded data
+#define BASE64_DECODED_MAX(in_bytes) ((in_bytes)/4*3 + 8)
+
+
+static int s_simd_detected = -1;
+static int s_simd_max = DC_CODEC_AVX2;
+
+
+static int detect_simd(void)
+{
+	#ifdef DC_CODEC_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			return DC_CODEC_AVX2;
+		}
+		if (__builtin_cpu_supports("ssse3")) {
+			return DC_CODEC_SSSE3;
+		}
+	#endif
+	return DC_CODEC_SCALAR;
+}
+
+
+/**
+ * Get the instruction set used by the codecs.
+ *
+ * @private @memberof dc_context_t
+ * @return One of DC_CODEC_SCALAR, DC_CODEC_SSSE3 or DC_CODEC_AVX2.
+ */
+int dc_codec_get_simd(void)
+{
+	if (s_simd_detected<0) {
+		s_simd_detected = detect_simd(); // a race is harmless, all threads detect the same
+	}
+	return s_simd_detected<s_simd_max? s_simd_detected : s_simd_max;
+}
+
+
+/**
+ * Limit the instruction set used by the codecs, used by tests and benchmarks
+ * to compare the implementations.  Instruction sets not supported by the CPU
+ * are never used.
+ *
+ * @private @memberof dc_context_t
+ * @param max_level DC_CODEC_SCALAR, DC_CODEC_SSSE3 or DC_CODEC_AVX2 (default).
+ * @return None.
+ */
+void dc_codec_set_simd(int max_level)
+{
+	s_simd_max = max_level;
+}
+
+
+/*******************************************************************************
+ * Block codecs
+ ******************************************************************************/
+
+
+#ifdef DC_CODEC_X86
+
+
+/* encoding takes 12 bytes per 128-bit lane and spreads the 6-bit groups to
+one byte each, see http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html */
+__attribute__((target("ssse3")))
+static inline __m128i encode_lane_ssse3(__m128i in)
+{
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	__m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+	__m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+	__m128i indices = _mm_or_si128(t0, t1);
+
+	/* map 0..25 to 13, 26..51 to 0, 52..61 to 1..10, 62 to 11, 63 to 12 and add the offset found there */
+	__m128i reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+	__m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+	reduced = _mm_or_si128(reduced, _mm_and_si128(less, _mm_set1_epi8(13)));
+	__m128i offsets = _mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+		'0'-52, '0'-52, '0'-52, '0'-52, '+'-62, '/'-63, 'A', 0, 0);
+	return _mm_add_epi8(_mm_shuffle_epi8(offsets, reduced), indices);
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i encode_lanes_avx2(__m256i in)
+{
+	in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+	                                             10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	__m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+	__m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+	__m256i indices = _mm256_or_si256(t0, t1);
+
+	__m256i reduced = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+	__m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+	reduced = _mm256_or_si256(reduced, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+	__m256i offsets = _mm256_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+		'0'-52, '0'-52, '0'-52, '0'-52, '+'-62, '/'-63, 'A', 0, 0,
+		'a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+		'0'-52, '0'-52, '0'-52, '0'-52, '+'-62, '/'-63, 'A', 0, 0);
+	return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, reduced), indices);
+}
+
+
+/* decoding validates 16 characters per lane using the high and low nibbles,
+see https://github.com/aklomp/base64; returns 0 if there is any character
+outside the alphabet, otherwise the 12 bytes are in the first bytes of the lane */
+__attribute__((target("ssse3")))
+static inline int decode_lane_ssse3(__m128i* in_out)
+{
+	const __m128i lut_lo   = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m128i lut_hi   = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i nibble   = _mm_set1_epi8(0x0f);
+
+	__m128i str = *in_out;
+	__m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), nibble);
+	__m128i lo_nibbles = _mm_and_si128(str, nibble);
+	__m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo_nibbles), _mm_shuffle_epi8(lut_hi, hi_nibbles));
+	if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128()))!=0xFFFF) {
+		return 0;
+	}
+
+	__m128i eq_2f = _mm_cmpeq_epi8(str, _mm_set1_epi8('/'));
+	str = _mm_add_epi8(str, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles)));
+
+	str = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+	str = _mm_madd_epi16(str, _mm_set1_epi32(0x00011000));
+	*in_out = _mm_shuffle_epi8(str, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+	return 1;
+}
+
+
+__attribute__((target("avx2")))
+static inline int decode_lanes_avx2(__m256i* in_out)
+{
+	const __m256i lut_lo   = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+	                                          0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m256i lut_hi   = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+	                                          0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+	                                          0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i nibble   = _mm256_set1_epi8(0x0f);
+
+	__m256i str = *in_out;
+	__m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), nibble);
+	__m256i lo_nibbles = _mm256_and_si256(str, nibble);
+	__m256i invalid = _mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo_nibbles), _mm256_shuffle_epi8(lut_hi, hi_nibbles));
+	if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(invalid, _mm256_setzero_si256()))!=-1) {
+		return 0;
+	}
+
+	__m256i eq_2f = _mm256_cmpeq_epi8(str, _mm256_set1_epi8('/'));
+	str = _mm256_add_epi8(str, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles)));
+
+	str = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+	str = _mm256_madd_epi16(str, _mm256_set1_epi32(0x00011000));
+	*in_out = _mm256_shuffle_epi8(str, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+	                                                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+	return 1;
+}
+
+
+// all block functions return the number of input bytes consumed and advance *out
+__attribute__((target("ssse3")))
+static size_t encode_blocks_ssse3(const unsigned char* in, size_t in_bytes, char** out)
+{
+	size_t i = 0;
+	char*  p = *out;
+	for (; in_bytes-i>=16; i += 12, p += 16) { // 16 bytes are loaded, 12 are used
+		_mm_storeu_si128((__m128i*)p, encode_lane_ssse3(_mm_loadu_si128((const __m128i*)(in+i))));
+	}
+	*out = p;
+	return i;
+}
+
+
+__attribute__((target("avx2")))
+static size_t encode_blocks_avx2(const unsigned char* in, size_t in_bytes, char** out)
+{
+	size_t i = 0;
+	char*  p = *out;
+	for (; in_bytes-i>=28; i += 24, p += 32) {
+		__m256i lanes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in+i))),
+			_mm_loadu_si128((const __m128i*)(in+i+12)), 1);
+		_mm256_storeu_si256((__m256i*)p, encode_lanes_avx2(lanes));
+	}
+	*out = p;
+	return i;
+}
+
+
+__attribute__((target("ssse3")))
+static size_t decode_blocks_ssse3(const char* in, size_t in_bytes, unsigned char** out)
+{
+	size_t         i = 0;
+	unsigned char* p = *out;
+	for (; in_bytes-i>=16; i += 16, p += 12) {
+		__m128i lane = _mm_loadu_si128((const __m128i*)(in+i));
+		if (!decode_lane_ssse3(&lane)) {
+			break;
+		}
+		_mm_storeu_si128((__m128i*)p, lane);
+	}
+	*out = p;
+	return i;
+}
+
+
+__attribute__((target("avx2")))
+static size_t decode_blocks_avx2(const char* in, size_t in_bytes, unsigned char** out)
+{
+	size_t         i = 0;
+	unsigned char* p = *out;
+	for (; in_bytes-i>=32; i += 32, p += 24) {
+		__m256i lanes = _mm256_loadu_si256((const __m256i*)(in+i));
+		if (!decode_lanes_avx2(&lanes)) {
+			break;
+		}
+		_mm_storeu_si128((__m128i*)p, _mm256_castsi256_si128(lanes));
+		_mm_storeu_si128((__m128i*)(p+12), _mm256_extracti128_si256(lanes, 1));
+	}
+	*out = p;
+	return i;
+}
+
+
+// returns the index of the first '=', '\r' or '\n', or in_bytes if there is none
+__attribute__((target("sse2")))
+static size_t find_qp_special_sse2(const char* in, size_t in_bytes)
+{
+	size_t i = 0;
+	for (; in_bytes-i>=16; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(in+i));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('=')),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')))));
+		if (mask) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+	for (; i<in_bytes; i++) {
+		if (in[i]=='=' || in[i]=='\r' || in[i]=='\n') {
+			return i;
+		}
+	}
+	return in_bytes;
+}
+
+
+__attribute__((target("avx2")))
+static size_t find_qp_special_avx2(const char* in, size_t in_bytes)
+{
+	size_t i = 0;
+	for (; in_bytes-i>=32; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(in+i));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('=')),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')))));
+		if (mask) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + find_qp_special_sse2(in+i, in_bytes-i);
+}
+
+
+#endif /* DC_CODEC_X86 */
+
+
+static size_t find_qp_special(const char* in, size_t in_bytes, int simd)
+{
+	#ifdef DC_CODEC_X86
+		if (simd>=DC_CODEC_AVX2) {
+			return find_qp_special_avx2(in, in_bytes);
+		}
+		else if (simd>=DC_CODEC_SSSE3) {
+			return find_qp_special_sse2(in, in_bytes);
+		}
+	#endif
+
+	for (size_t i = 0; i<in_bytes; i++) {
+		if (in[i]=='=' || in[i]=='\r' || in[i]=='\n') {
+			return i;
+		}
+	}
+	return in_bytes;
+}
+
+
+/*******************************************************************************
+ * Base64
+ ******************************************************************************/
+
+
+static size_t base64_encode(const unsigned char* in, size_t in_bytes, char* out)
+{
+	/* `out` must have room for 4*((in_bytes+2)/3) characters */
+	size_t i = 0;
+	char*  p = out;
+
+	#ifdef DC_CODEC_X86
+		int simd = dc_codec_get_simd();
+		if (simd>=DC_CODEC_AVX2) {
+			i += encode_blocks_avx2(in, in_bytes, &p);
+		}
+		if (simd>=DC_CODEC_SSSE3) {
+			i += encode_blocks_ssse3(in+i, in_bytes-i, &p);
+		}
+	#endif
+
+	for (; in_bytes-i>=3; i += 3) {
+		uint32_t v = (in[i]<<16) | (in[i+1]<<8) | in[i+2];
+		*p++ = s_base64_chars[v>>18];
+		*p++ = s_base64_chars[(v>>12)&0x3F];
+		*p++ = s_base64_chars[(v>>6)&0x3F];
+		*p++ = s_base64_chars[v&0x3F];
+	}
+
+	if (in_bytes-i==1) {
+		*p++ = s_base64_chars[in[i]>>2];
+		*p++ = s_base64_chars[(in[i]&0x03)<<4];
+		*p++ = '=';
+		*p++ = '=';
+	}
+	else if (in_bytes-i==2) {
+		*p++ = s_base64_chars[in[i]>>2];
+		*p++ = s_base64_chars[((in[i]&0x03)<<4) | (in[i+1]>>4)];
+		*p++ = s_base64_chars[(in[i+1]&0x0F)<<2];
+		*p++ = '=';
+	}
+
+	return p-out;
+}
+
+
+static size_t base64_decode(const char* in, size_t in_bytes, unsigned char* out)
+{
+	/* `out` must have room for BASE64_DECODED_MAX(in_bytes) bytes */
+	size_t         i = 0;
+	unsigned char* p = out;
+	uint32_t       chunk = 0;
+	int            chunk_cnt = 0;
+	int            simd = dc_codec_get_simd();
+	size_t         scalar_until = (simd==DC_CODEC_SCALAR)? in_bytes : 0;
+
+	while (i<in_bytes)
+	{
+		/* decode full blocks; they stop at line ends or at the end of the data,
+		where the scalar code goes on for a while before blocks are tried again */
+		#ifdef DC_CODEC_X86
+			if (simd!=DC_CODEC_SCALAR && chunk_cnt==0 && i>=scalar_until) {
+				if (simd>=DC_CODEC_AVX2) {
+					i += decode_blocks_avx2(in+i, in_bytes-i, &p);
+				}
+				i += decode_blocks_ssse3(in+i, in_bytes-i, &p);
+				scalar_until = i + 16;
+			}
+		#endif
+
+		while (i<in_bytes) {
+			signed char value = s_base64_values[(unsigned char)in[i++]];
+			if (value>=0) {
+				chunk = (chunk<<6) | value;
+				if (++chunk_cnt==4) {
+					*p++ = chunk>>16;
+					*p++ = chunk>>8;
+					*p++ = chunk;
+					chunk = 0;
+					chunk_cnt = 0;
+					if (i>=scalar_until) {
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	/* like libetpan, a single character left over results in one byte */
+	if (chunk_cnt==1) {
+		*p++ = chunk<<2;
+	}
+	else if (chunk_cnt==2) {
+		*p++ = chunk>>4;
+	}
+	else if (chunk_cnt==3) {
+		*p++ = chunk>>10;
+		*p++ = chunk>>2;
+	}
+
+	return p-out;
+}
+
+
+/**
+ * Encode binary data as base64 without line breaks.
+ *
+ * @private @memberof dc_context_t
+ * @param buf The data to encode.
+ * @param buf_bytes The number of bytes in buf.
+ * @return The null-terminated base64 string, must be free()'d after usage.
+ */
+char* dc_base64_encode(const void* buf, size_t buf_bytes)
+{
+	char*  ret = NULL;
+	size_t ret_bytes = 0;
+
+	if ((ret=malloc((buf_bytes+2)/3*4+1))==NULL) {
+		exit(63);
+	}
+
+	if (buf) {
+		ret_bytes = base64_encode((const unsigned char*)buf, buf_bytes, ret);
+	}
+	ret[ret_bytes] = 0;
+
+	return ret;
+}
+
+
+/**
+ * Decode base64 data.  Characters outside the alphabet, eg. line breaks,
+ * are ignored.
+ *
+ * @private @memberof dc_context_t
+ * @param in The base64 data, does not need to be null-terminated.
+ * @param in_bytes The number of characters in `in`.
+ * @param[out] ret_bytes The number of decoded bytes.
+ * @return The decoded data, must be free()'d after usage.
+ *     NULL if there is nothing to decode.
+ */
+void* dc_base64_decode(const char* in, size_t in_bytes, size_t* ret_bytes)
+{
+	unsigned char* ret = NULL;
+
+	*ret_bytes = 0;
+	if (in==NULL || in_bytes==0) {
+		return NULL;
+	}
+
+	if ((ret=malloc(BASE64_DECODED_MAX(in_bytes)))==NULL) {
+		exit(64);
+	}
+
+	if ((*ret_bytes=base64_decode(in, in_bytes, ret))==0) {
+		free(ret);
+		return NULL;
+	}
+
+	return ret;
+}
+
+
+/*******************************************************************************
+ * Quoted-printable
+ ******************************************************************************/
+
+
+static int hex_value(char c)
+{
+	if (c>='0' && c<='9') { return c-'0'; }
+	if (c>='a' && c<='f') { return c-'a'+10; }
+	if (c>='A' && c<='F') { return c-'A'+10; }
+	return 0;
+}
+
+
+static size_t qp_decoded_max(const char* in, size_t in_bytes)
+{
+	/* a line end may become two characters, everything else does not grow */
+	size_t ret = in_bytes;
+	for (size_t i = 0; i<in_bytes; i++) {
+		if (in[i]=='\r' || in[i]=='\n') {
+			ret++;
+		}
+	}
+	return ret;
+}
+
+
+static size_t qp_decode(const char* in, size_t in_bytes, char* out)
+{
+	/* `out` must have room for qp_decoded_max() bytes.
+	line ends are converted to CRLF, soft line breaks are removed. */
+	size_t i = 0;
+	char*  p = out;
+	int    simd = dc_codec_get_simd();
+
+	while (i<in_bytes)
+	{
+		size_t run = find_qp_special(in+i, in_bytes-i, simd);
+		memcpy(p, in+i, run);
+		p += run;
+		i += run;
+		if (i>=in_bytes) {
+			break;
+		}
+
+		if (in[i]=='\n') {
+			*p++ = '\r';
+			*p++ = '\n';
+			i++;
+		}
+		else if (in[i]=='\r') {
+			if (i+1>=in_bytes) {
+				break; // a CR at the end is dropped
+			}
+			*p++ = '\r';
+			*p++ = '\n';
+			i += (in[i+1]=='\n')? 2 : 1;
+		}
+		else if (i+1>=in_bytes) {
+			*p++ = '='; // a single `=` at the end is kept
+			i++;
+		}
+		else if (in[i+1]=='\n') {
+			i += 2;
+		}
+		else if (in[i+1]=='\r') {
+			if (i+2>=in_bytes) {
+				break;
+			}
+			i += (in[i+2]=='\n')? 3 : 2;
+		}
+		else if (i+2>=in_bytes) {
+			i++; // incomplete escape at the end, keep the character after `=`
+		}
+		else {
+			*p++ = (hex_value(in[i+1])<<4) | hex_value(in[i+2]);
+			i += 3;
+		}
+	}
+
+	return p-out;
+}
+
+
+/*******************************************************************************
+ * MIME parts
+ ******************************************************************************/
+
+
+/**
+ * Decode the body of a MIME part, replaces mailmime_part_parse().
+ * Base64 and quoted-printable are decoded by the codecs above,
+ * other encodings are passed to libetpan.
+ *
+ * @private @memberof dc_context_t
+ * @param in The encoded body.
+ * @param in_bytes The number of bytes in `in`.
+ * @param mechanism The transfer encoding, one of MAILMIME_MECHANISM_*.
+ * @param[out] ret_to_mmap_string_unref The decoded data, must be freed using mmap_string_unref().
+ * @param[out] ret_bytes The number of decoded bytes.
+ * @return 1=success, 0=error.
+ */
+int dc_transfer_decode(const char* in, size_t in_bytes, int mechanism, char** ret_to_mmap_string_unref, size_t* ret_bytes)
+{
+	MMAPString* str = NULL;
+	size_t      cur_token = 0;
+
+	if (in==NULL || ret_to_mmap_string_unref==NULL || ret_bytes==NULL) {
+		return 0;
+	}
+
+	if (mechanism!=MAILMIME_MECHANISM_BASE64 && mechanism!=MAILMIME_MECHANISM_QUOTED_PRINTABLE) {
+		return mailmime_part_parse(in, in_bytes, &cur_token, mechanism, ret_to_mmap_string_unref, ret_bytes)==MAILIMF_NO_ERROR;
+	}
+
+	if ((str=mmap_string_sized_new(mechanism==MAILMIME_MECHANISM_BASE64?
+	        BASE64_DECODED_MAX(in_bytes) : qp_decoded_max(in, in_bytes)))==NULL) {
+		return 0;
+	}
+
+	if (mechanism==MAILMIME_MECHANISM_BASE64) {
+		str->len = base64_decode(in, in_bytes, (unsigned char*)str->str);
+	}
+	else {
+		str->len = qp_decode(in, in_bytes, str->str);
+	}
+	str->str[str->len] = 0;
+
+	if (mmap_string_ref(str)<0) {
+		mmap_string_free(str);
+		return 0;
+	}
+
+	*ret_to_mmap_string_unref = str->str;
+	*ret_bytes = str->len;
+	return 1;
+}
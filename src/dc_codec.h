@@ -0,0 +1,24 @@
+#ifndef __DC_CODEC_H__
+#define __DC_CODEC_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// the instruction sets used by the codecs, see dc_codec_set_simd()
+#define DC_CODEC_SCALAR  0
+#define DC_CODEC_SSSE3   1
+#define DC_CODEC_AVX2    2
+
+
+char*    dc_base64_encode                (const void* buf, size_t buf_bytes);
+void*    dc_base64_decode                (const char* in, size_t in_bytes, size_t* ret_bytes);
+int      dc_transfer_decode              (const char* in, size_t in_bytes, int mechanism, char** ret_to_mmap_string_unref, size_t* ret_bytes);
+int      dc_codec_get_simd               (void);
+void     dc_codec_set_simd               (int max_level);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_CODEC_H__ */
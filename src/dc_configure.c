@@ -416,6 +416,454 @@ cleanup:
 }
 
 
+/*******************************************************************************
+ * Run probes concurrently
+ ******************************************************************************/
+
+
+/* Autoconfig URLs and connection settings are tested by probes that run in
+parallel threads.  A probe may be started delayed so that the settings most
+likely to work get a head start, "happy eyeballs"-like.  The threads are joined
+only by probeset_unref(), so waiting for the result of a probe does not wait for
+the timeouts of others. */
+
+
+#define PROBE_MOZ_AUTOCONFIG     1
+#define PROBE_OUTLK_AUTODISCOVER 2
+#define PROBE_IMAP               3
+#define PROBE_SMTP               4
+
+#define PROBES_MAX              10
+#define PROBE_STAGGER_MS       250
+
+
+typedef struct probeset_t probeset_t;
+
+
+typedef struct probe_t
+{
+	probeset_t*      set;
+	int              type;
+	char*            url;       // for autoconfig probes
+	dc_loginparam_t* param;     // for autoconfig probes the parameters to query for, otherwise the settings to test
+	int              delay_ms;
+	int              log_connect_errors;
+
+	pthread_t        thread;
+	int              thread_started;
+
+	// guarded by set->mutex
+	int              done;
+	dc_loginparam_t* autoconfig; // result of autoconfig probes, NULL on errors
+	int              connected;  // result of connection probes
+} probe_t;
+
+
+struct probeset_t
+{
+	dc_context_t*    context;
+	pthread_mutex_t  mutex;
+	pthread_cond_t   cond;
+	int              decided;   // set if the result is known, probes not yet started are skipped then
+	probe_t*         probes[PROBES_MAX];
+	int              cnt;
+};
+
+
+static probeset_t* probeset_new(dc_context_t* context)
+{
+	probeset_t* set = NULL;
+
+	if ((set=calloc(1, sizeof(probeset_t)))==NULL) {
+		exit(59);
+	}
+
+	set->context = context;
+	pthread_mutex_init(&set->mutex, NULL);
+	pthread_cond_init(&set->cond, NULL);
+
+	return set;
+}
+
+
+static void probeset_add(probeset_t* set, int type, const char* url, const dc_loginparam_t* param, int delay_ms)
+{
+	probe_t* probe = NULL;
+
+	if (set==NULL || set->cnt>=PROBES_MAX) {
+		return;
+	}
+
+	if ((probe=calloc(1, sizeof(probe_t)))==NULL) {
+		exit(60);
+	}
+
+	probe->set                = set;
+	probe->type               = type;
+	probe->url                = dc_strdup_keep_null(url);
+	probe->param              = dc_loginparam_duplicate(param);
+	probe->delay_ms           = delay_ms;
+	probe->log_connect_errors = (set->cnt==0); // only the first probe may start a sequence of connection errors in the ui
+
+	set->probes[set->cnt++] = probe;
+}
+
+
+static void* probe_thread_entry_point(void* entry_arg)
+{
+	probe_t*         probe = (probe_t*)entry_arg;
+	probeset_t*      set = probe->set;
+	dc_context_t*    context = set->context;
+	dc_loginparam_t* autoconfig = NULL;
+	int              connected = 0;
+	int              skip = 0;
+
+	if (probe->delay_ms) {
+		struct timespec  wakeup_at;
+		struct timeval   now;
+		gettimeofday(&now, NULL);
+		wakeup_at.tv_sec  = now.tv_sec + (now.tv_usec/1000 + probe->delay_ms)/1000;
+		wakeup_at.tv_nsec = ((now.tv_usec/1000 + probe->delay_ms)%1000) * 1000000;
+
+		pthread_mutex_lock(&set->mutex);
+			while (!set->decided
+			 && pthread_cond_timedwait(&set->cond, &set->mutex, &wakeup_at)==0) {
+				;
+			}
+			skip = set->decided;
+		pthread_mutex_unlock(&set->mutex);
+	}
+	else {
+		pthread_mutex_lock(&set->mutex);
+			skip = set->decided;
+		pthread_mutex_unlock(&set->mutex);
+	}
+
+	if (!skip)
+	{
+		switch (probe->type)
+		{
+			case PROBE_MOZ_AUTOCONFIG:
+				autoconfig = moz_autoconfigure(context, probe->url, probe->param);
+				break;
+
+			case PROBE_OUTLK_AUTODISCOVER:
+				autoconfig = outlk_autodiscover(context, probe->url, probe->param);
+				break;
+
+			case PROBE_IMAP:
+				{
+					dc_imap_t* imap = dc_imap_new(NULL, NULL, NULL, NULL, NULL, context);
+					imap->log_connect_errors = probe->log_connect_errors;
+					{ char* r = dc_loginparam_get_readable(probe->param); dc_log_info(context, 0, "Trying: %s", r); free(r); }
+					connected = dc_imap_connect(imap, probe->param);
+					dc_imap_disconnect(imap);
+					dc_imap_unref(imap);
+				}
+				break;
+
+			case PROBE_SMTP:
+				{
+					dc_smtp_t* smtp = dc_smtp_new(context);
+					smtp->log_connect_errors = probe->log_connect_errors;
+					{ char* r = dc_loginparam_get_readable(probe->param); dc_log_info(context, 0, "Trying: %s", r); free(r); }
+					connected = dc_smtp_connect(smtp, probe->param);
+					dc_smtp_disconnect(smtp);
+					dc_smtp_unref(smtp);
+				}
+				break;
+		}
+	}
+
+	pthread_mutex_lock(&set->mutex);
+		probe->autoconfig = autoconfig;
+		probe->connected  = connected;
+		probe->done       = 1;
+		pthread_cond_broadcast(&set->cond);
+	pthread_mutex_unlock(&set->mutex);
+
+	return NULL;
+}
+
+
+static void probeset_start(probeset_t* set)
+{
+	for (int i = 0; i<set->cnt; i++) {
+		probe_t* probe = set->probes[i];
+		if (pthread_create(&probe->thread, NULL, probe_thread_entry_point, probe)==0) {
+			probe->thread_started = 1;
+		}
+		else {
+			probe->done = 1; // as if failed
+		}
+	}
+}
+
+
+static int probe_succeeded(const probe_t* probe)
+{
+	return probe->done && (probe->autoconfig!=NULL || probe->connected);
+}
+
+
+/* wait until a probe succeeds and return its index or -1 if all probes failed
+or the ongoing process is stopped by dc_stop_ongoing_process().
+With PROBE_IN_ORDER, a probe is only used if all probes added before have failed,
+otherwise the first probe that succeeds is used. */
+#define PROBE_IN_ORDER  0x01
+#define PROBE_ANY_ORDER 0x00
+static int probeset_wait(probeset_t* set, int flags)
+{
+	int winner = -1;
+
+	pthread_mutex_lock(&set->mutex);
+		while (!set->context->shall_stop_ongoing)
+		{
+			int pending = 0;
+			for (int i = 0; i<set->cnt; i++) {
+				if (probe_succeeded(set->probes[i])) {
+					winner = i;
+					break;
+				}
+				if (!set->probes[i]->done) {
+					pending++;
+					if (flags&PROBE_IN_ORDER) {
+						break;
+					}
+				}
+			}
+
+			if (winner>=0 || pending==0) {
+				break;
+			}
+
+			// wake up regularly to check shall_stop_ongoing
+			struct timespec  wakeup_at;
+			struct timeval   now;
+			gettimeofday(&now, NULL);
+			wakeup_at.tv_sec  = now.tv_sec + (now.tv_usec/1000 + 200)/1000;
+			wakeup_at.tv_nsec = ((now.tv_usec/1000 + 200)%1000) * 1000000;
+			pthread_cond_timedwait(&set->cond, &set->mutex, &wakeup_at);
+		}
+
+		set->decided = 1;
+		pthread_cond_broadcast(&set->cond);
+	pthread_mutex_unlock(&set->mutex);
+
+	return winner;
+}
+
+
+/* returns a copy of the autoconfig found by the given probe, the result must be unref'd */
+static dc_loginparam_t* probeset_get_param(probeset_t* set, int index)
+{
+	dc_loginparam_t* ret = NULL;
+
+	if (set==NULL || index<0 || index>=set->cnt) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&set->mutex);
+		probe_t* probe = set->probes[index];
+		ret = dc_loginparam_duplicate(probe->autoconfig? probe->autoconfig : probe->param);
+	pthread_mutex_unlock(&set->mutex);
+
+	return ret;
+}
+
+
+static void probeset_unref(probeset_t* set)
+{
+	if (set==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&set->mutex);
+		set->decided = 1;
+		pthread_cond_broadcast(&set->cond);
+	pthread_mutex_unlock(&set->mutex);
+
+	for (int i = 0; i<set->cnt; i++) {
+		probe_t* probe = set->probes[i];
+		if (probe->thread_started) {
+			pthread_join(probe->thread, NULL);
+		}
+		free(probe->url);
+		dc_loginparam_unref(probe->param);
+		dc_loginparam_unref(probe->autoconfig);
+		free(probe);
+	}
+
+	pthread_cond_destroy(&set->cond);
+	pthread_mutex_destroy(&set->mutex);
+	free(set);
+}
+
+
+/* probes that are still running when the result is known are not waited for,
+they are joined by the next configuration or when the context is released */
+static void probeset_release(dc_context_t* context, probeset_t* set)
+{
+	if (set==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&set->mutex);
+		set->decided = 1;
+		pthread_cond_broadcast(&set->cond);
+	pthread_mutex_unlock(&set->mutex);
+
+	if (context->configure_probes==NULL) {
+		context->configure_probes = carray_new(4);
+	}
+	carray_add(context->configure_probes, set, NULL);
+}
+
+
+/**
+ * Wait for probes started by a previous configuration and free them.
+ *
+ * @private @memberof dc_context_t
+ * @param context The context object.
+ * @return None.
+ */
+void dc_configure_join_probes(dc_context_t* context)
+{
+	if (context==NULL || context->configure_probes==NULL) {
+		return;
+	}
+
+	for (int i = 0; i<carray_count(context->configure_probes); i++) {
+		probeset_unref((probeset_t*)carray_get(context->configure_probes, i));
+	}
+
+	carray_free(context->configure_probes);
+	context->configure_probes = NULL;
+}
+
+
+/*******************************************************************************
+ * Remember the settings found for a domain
+ ******************************************************************************/
+
+
+/* the settings that worked for a domain are stored in the config-key `autoconfig_<domain>`
+as `<mail_server> <mail_port> <send_server> <send_port> <server_flags> <login>`,
+login is `addr` if the whole email-address is used as login name and `localpart` if only the part before the `@` is used.
+this makes a reconfiguration for the same domain, eg. after a password change, instant. */
+
+
+static char* get_autoconfig_cache_key(const char* domain)
+{
+	char* domain_lower = dc_strlower(domain);
+	char* key = dc_mprintf("autoconfig_%s", domain_lower);
+	free(domain_lower);
+	return key;
+}
+
+
+static dc_loginparam_t* read_autoconfig_cache(dc_context_t* context, const char* domain, const dc_loginparam_t* param_in)
+{
+	dc_loginparam_t* ret = NULL;
+	char*            key = get_autoconfig_cache_key(domain);
+	char*            value = dc_sqlite3_get_config(context->sql, key, NULL);
+	clist*           fields = NULL;
+	char*            f[6];
+	int              i = 0;
+
+	if (value==NULL || param_in->addr==NULL) {
+		goto cleanup;
+	}
+
+	fields = dc_str_to_clist(value, " ");
+	if (clist_count(fields)!=6) {
+		goto cleanup;
+	}
+
+	for (clistiter* cur=clist_begin(fields); cur!=NULL; cur=clist_next(cur)) {
+		f[i++] = (char*)clist_content(cur);
+	}
+
+	ret = dc_loginparam_new();
+	ret->mail_server  = dc_strdup(f[0]);
+	ret->mail_port    = atoi(f[1]);
+	ret->send_server  = dc_strdup(f[2]);
+	ret->send_port    = atoi(f[3]);
+	ret->server_flags = atoi(f[4]) & ~DC_LP_AUTH_OAUTH2;
+	if (param_in->mail_user) {
+		ret->mail_user = dc_strdup(param_in->mail_user); // a login name entered by the user is used as is
+	}
+	else {
+		ret->mail_user = dc_strdup(param_in->addr);
+		if (strcmp(f[5], "localpart")==0) {
+			char* at = strchr(ret->mail_user, '@');
+			if (at) { *at = 0; }
+		}
+	}
+	ret->send_user    = dc_strdup(ret->mail_user);
+
+	if (ret->mail_server[0]==0 || ret->mail_port==0
+	 || ret->send_server[0]==0 || ret->send_port==0) {
+		dc_loginparam_unref(ret);
+		ret = NULL;
+	}
+
+cleanup:
+	if (fields) {
+		clist_free_content(fields);
+		clist_free(fields);
+	}
+	free(value);
+	free(key);
+	return ret;
+}
+
+
+static void write_autoconfig_cache(dc_context_t* context, const char* domain, const dc_loginparam_t* param)
+{
+	char*       key = get_autoconfig_cache_key(domain);
+	char*       value = NULL;
+	char*       localpart = dc_strdup(param->addr);
+	const char* login = NULL;
+
+	char* at = strchr(localpart, '@');
+	if (at) { *at = 0; }
+
+	if (param->mail_user && param->send_user && strcmp(param->mail_user, param->send_user)==0) {
+		if (strcmp(param->mail_user, param->addr)==0) {
+			login = "addr";
+		}
+		else if (strcmp(param->mail_user, localpart)==0) {
+			login = "localpart";
+		}
+	}
+
+	if (login==NULL // other login names are not remembered, they are not derived from the address
+	 || strchr(param->mail_server, ' ') || strchr(param->send_server, ' ')) {
+		goto cleanup;
+	}
+
+	value = dc_mprintf("%s %i %s %i %i %s",
+		param->mail_server, (int)param->mail_port,
+		param->send_server, (int)param->send_port,
+		param->server_flags & ~DC_LP_AUTH_OAUTH2, login);
+	dc_sqlite3_set_config(context->sql, key, value);
+
+cleanup:
+	free(value);
+	free(localpart);
+	free(key);
+}
+
+
+static void delete_autoconfig_cache(dc_context_t* context, const char* domain)
+{
+	char* key = get_autoconfig_cache_key(domain);
+	dc_sqlite3_set_config(context->sql, key, NULL);
+	free(key);
+}
+
+
 /*******************************************************************************
  * Configure folders
  ******************************************************************************/
@@ -691,6 +1139,8 @@ void dc_job_do_DC_JOB_CONFIGURE_IMAP(dc_context_t* context, dc_job_t* job)
 	char*            param_domain = NULL; /* just a pointer inside param, must not be freed! */
 	char*            param_addr_urlencoded = NULL;
 	dc_loginparam_t* param_autoconfig = NULL;
+	int              param_autoconfig_cached = 0;
+	int              autoconfig_wanted = 0;
 
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
 		goto cleanup;
@@ -701,6 +1151,8 @@ void dc_job_do_DC_JOB_CONFIGURE_IMAP(dc_context_t* context, dc_job_t* job)
 	}
 	ongoing_allocated_here = 1;
 
+	dc_configure_join_probes(context);
+
 	#define PROGRESS(p) \
 				if (context->shall_stop_ongoing) { goto cleanup; } \
 				context->cb(context, DC_EVENT_CONFIGURE_PROGRESS, (p)<1? 1 : ((p)>999? 999 : (p)), 0);
@@ -786,50 +1238,51 @@ void dc_job_do_DC_JOB_CONFIGURE_IMAP(dc_context_t* context, dc_job_t* job)
 	{
 		int keep_flags = param->server_flags & DC_LP_AUTH_OAUTH2;
 
-		/* A.  Search configurations from the domain used in the email-address, prefer encrypted */
-		if (param_autoconfig==NULL) {
-			char* url = dc_mprintf("https://autoconfig.%s/mail/config-v1.1.xml?emailaddress=%s", param_domain, param_addr_urlencoded);
-			param_autoconfig = moz_autoconfigure(context, url, param);
-			free(url);
-			PROGRESS(300)
+		/* A.  Use the settings found for the domain before */
+		autoconfig_wanted = 1;
+		if ((param_autoconfig=read_autoconfig_cache(context, param_domain, param))!=NULL) {
+			dc_log_info(context, 0, "Using the settings found before for %s.", param_domain);
+			param_autoconfig_cached = 1;
 		}
 
-		if (param_autoconfig==NULL) {
-			char* url = dc_mprintf("https://%s/.well-known/autoconfig/mail/config-v1.1.xml?emailaddress=%s", param_domain, param_addr_urlencoded); // the doc does not mention `emailaddress=`, however, Thunderbird adds it, see https://releases.mozilla.org/pub/thunderbird/ ,  which makes some sense
-			param_autoconfig = moz_autoconfigure(context, url, param);
+		/* B.  Search configurations from the domain used in the email-address, prefer encrypted,
+		and in Thunderbird's central database.  All URLs are requested at the same time,
+		the first one in this order that returns a usable configuration is used. */
+		if (param_autoconfig==NULL)
+		{
+			probeset_t* probes = probeset_new(context);
+			char*       url = NULL;
+
+			url = dc_mprintf("https://autoconfig.%s/mail/config-v1.1.xml?emailaddress=%s", param_domain, param_addr_urlencoded);
+			probeset_add(probes, PROBE_MOZ_AUTOCONFIG, url, param, 0);
+			free(url);
+
+			url = dc_mprintf("https://%s/.well-known/autoconfig/mail/config-v1.1.xml?emailaddress=%s", param_domain, param_addr_urlencoded); // the doc does not mention `emailaddress=`, however, Thunderbird adds it, see https://releases.mozilla.org/pub/thunderbird/ ,  which makes some sense
+			probeset_add(probes, PROBE_MOZ_AUTOCONFIG, url, param, 0);
 			free(url);
-			PROGRESS(310)
-		}
 
-		for (int i = 0; i <= 1; i++) {
-			if (param_autoconfig==NULL) {
-				char* url = dc_mprintf("https://%s%s/autodiscover/autodiscover.xml", i==0?"":"autodiscover.", param_domain); /* Outlook uses always SSL but different domains */
-				param_autoconfig = outlk_autodiscover(context, url, param);
+			for (int i = 0; i <= 1; i++) {
+				url = dc_mprintf("https://%s%s/autodiscover/autodiscover.xml", i==0?"":"autodiscover.", param_domain); /* Outlook uses always SSL but different domains */
+				probeset_add(probes, PROBE_OUTLK_AUTODISCOVER, url, param, 0);
 				free(url);
-				PROGRESS(320+i*10)
 			}
-		}
 
-		if (param_autoconfig==NULL) {
-			char* url = dc_mprintf("http://autoconfig.%s/mail/config-v1.1.xml?emailaddress=%s", param_domain, param_addr_urlencoded);
-			param_autoconfig = moz_autoconfigure(context, url, param);
+			url = dc_mprintf("http://autoconfig.%s/mail/config-v1.1.xml?emailaddress=%s", param_domain, param_addr_urlencoded);
+			probeset_add(probes, PROBE_MOZ_AUTOCONFIG, url, param, 0);
 			free(url);
-			PROGRESS(340)
-		}
 
-		if (param_autoconfig==NULL) {
-			char* url = dc_mprintf("http://%s/.well-known/autoconfig/mail/config-v1.1.xml", param_domain); // do not transfer the email-address unencrypted
-			param_autoconfig = moz_autoconfigure(context, url, param);
+			url = dc_mprintf("http://%s/.well-known/autoconfig/mail/config-v1.1.xml", param_domain); // do not transfer the email-address unencrypted
+			probeset_add(probes, PROBE_MOZ_AUTOCONFIG, url, param, 0);
 			free(url);
-			PROGRESS(350)
-		}
 
-		/* B.  If we have no configuration yet, search configuration in Thunderbird's centeral database */
-		if (param_autoconfig==NULL)
-		{
-			char* url = dc_mprintf("https://autoconfig.thunderbird.net/v1.1/%s", param_domain); /* always SSL for Thunderbird's database */
-			param_autoconfig = moz_autoconfigure(context, url, param);
+			url = dc_mprintf("https://autoconfig.thunderbird.net/v1.1/%s", param_domain); /* always SSL for Thunderbird's database */
+			probeset_add(probes, PROBE_MOZ_AUTOCONFIG, url, param, 0);
 			free(url);
+
+			probeset_start(probes);
+			param_autoconfig = probeset_get_param(probes, probeset_wait(probes, PROBE_IN_ORDER));
+			probeset_release(context, probes);
+
 			PROGRESS(500)
 		}
 
@@ -938,78 +1391,122 @@ void dc_job_do_DC_JOB_CONFIGURE_IMAP(dc_context_t* context, dc_job_t* job)
 	PROGRESS(600)
 
 	/* try to connect to IMAP - if we did not got an autoconfig,
-	do some further tries with different settings and username variations */
-	for (int username_variation=0; username_variation<=1; username_variation++)
+	probe further settings and username variations at the same time.
+	the variations are started one after another with a little delay so that
+	the more likely ones get a head start; the first one that connects is used. */
+	if (param_autoconfig)
 	{
-		// probe given settings, SSL/993 by default
 		{ char* r = dc_loginparam_get_readable(param); dc_log_info(context, 0, "Trying: %s", r); free(r); }
-		if (dc_imap_connect(context->inbox, param)) {
-			break;
+		if (!dc_imap_connect(context->inbox, param)) {
+			if (param_autoconfig_cached) {
+				delete_autoconfig_cache(context, param_domain); // the next try will search the settings again
+			}
+			goto cleanup;
 		}
+	}
+	else
+	{
+		probeset_t*      probes = probeset_new(context);
+		dc_loginparam_t* variant = dc_loginparam_duplicate(param);
+		dc_loginparam_t* found = NULL;
 
-		if (param_autoconfig) {
-			goto cleanup;
+		for (int username_variation=0; username_variation<=1; username_variation++)
+		{
+			// probe given settings, SSL/993 by default
+			probeset_add(probes, PROBE_IMAP, NULL, variant, probes->cnt*PROBE_STAGGER_MS);
+
+			// probe STARTTLS/993
+			variant->server_flags &= ~DC_LP_IMAP_SOCKET_FLAGS;
+			variant->server_flags |=  DC_LP_IMAP_SOCKET_STARTTLS;
+			probeset_add(probes, PROBE_IMAP, NULL, variant, probes->cnt*PROBE_STAGGER_MS);
+
+			// probe STARTTLS/143
+			variant->mail_port = TYPICAL_IMAP_STARTTLS_PORT;
+			probeset_add(probes, PROBE_IMAP, NULL, variant, probes->cnt*PROBE_STAGGER_MS);
+
+			// next probe round with only the localpart of the email-address as the loginname
+			variant->server_flags &= ~DC_LP_IMAP_SOCKET_FLAGS;
+			variant->server_flags |=  DC_LP_IMAP_SOCKET_SSL;
+			variant->mail_port    =   TYPICAL_IMAP_SSL_PORT;
+			char* at = strchr(variant->mail_user, '@');
+			if (at) { *at = 0; }
+			at = strchr(variant->send_user, '@');
+			if (at) { *at = 0; }
 		}
 
-		// probe STARTTLS/993
-		PROGRESS(650+username_variation*30)
-		param->server_flags &= ~DC_LP_IMAP_SOCKET_FLAGS;
-		param->server_flags |=  DC_LP_IMAP_SOCKET_STARTTLS;
+		probeset_start(probes);
+		found = probeset_get_param(probes, probeset_wait(probes, PROBE_ANY_ORDER));
+		probeset_release(context, probes);
+		dc_loginparam_unref(variant);
 
-		{ char* r = dc_loginparam_get_readable(param); dc_log_info(context, 0, "Trying: %s", r); free(r); }
-		if (dc_imap_connect(context->inbox, param)) {
-			break;
+		if (found==NULL) {
+			goto cleanup;
 		}
 
-		// probe STARTTLS/143
-		PROGRESS(660+username_variation*30)
-		param->mail_port = TYPICAL_IMAP_STARTTLS_PORT;
-		{ char* r = dc_loginparam_get_readable(param); dc_log_info(context, 0, "Trying: %s", r); free(r); }
-		if (dc_imap_connect(context->inbox, param)) {
-			break;
-		}
-		else if (username_variation) {
+		free(param->mail_user);
+		param->mail_user    = dc_strdup_keep_null(found->mail_user);
+		free(param->send_user);
+		param->send_user    = dc_strdup_keep_null(found->send_user);
+		param->mail_port    = found->mail_port;
+		param->server_flags = found->server_flags;
+		dc_loginparam_unref(found);
+
+		PROGRESS(700)
+
+		{ char* r = dc_loginparam_get_readable(param); dc_log_info(context, 0, "Using: %s", r); free(r); }
+		if (!dc_imap_connect(context->inbox, param)) {
 			goto cleanup;
 		}
-
-		// next probe round with only the localpart of the email-address as the loginname
-		PROGRESS(670+username_variation*30)
-		param->server_flags &= ~DC_LP_IMAP_SOCKET_FLAGS;
-		param->server_flags |=  DC_LP_IMAP_SOCKET_SSL;
-		param->mail_port    =   TYPICAL_IMAP_SSL_PORT;
-		char* at = strchr(param->mail_user, '@');
-		if (at) { *at = 0; }
-		at = strchr(param->send_user, '@');
-		if (at) { *at = 0; }
 	}
 
 	imap_connected_here = 1;
 
 	PROGRESS(800)
 
-	/* try to connect to SMTP - if we did not got an autoconfig, the first try was SSL-465 and we do a second try with STARTTLS-587 */
-	if (!dc_smtp_connect(context->smtp, param))  {
-		if (param_autoconfig) {
+	/* try to connect to SMTP - if we did not got an autoconfig, SSL/465 is probed together with STARTTLS/587 and STARTTLS/25 */
+	if (param_autoconfig)
+	{
+		if (!dc_smtp_connect(context->smtp, param)) {
+			if (param_autoconfig_cached) {
+				delete_autoconfig_cache(context, param_domain);
+			}
 			goto cleanup;
 		}
+	}
+	else
+	{
+		probeset_t*      probes = probeset_new(context);
+		dc_loginparam_t* variant = dc_loginparam_duplicate(param);
+		dc_loginparam_t* found = NULL;
 
-		PROGRESS(850)
+		probeset_add(probes, PROBE_SMTP, NULL, variant, 0);
 
-		param->server_flags &= ~DC_LP_SMTP_SOCKET_FLAGS;
-		param->server_flags |=  DC_LP_SMTP_SOCKET_STARTTLS;
-		param->send_port    =   TYPICAL_SMTP_STARTTLS_PORT;
-		{ char* r = dc_loginparam_get_readable(param); dc_log_info(context, 0, "Trying: %s", r); free(r); }
+		variant->server_flags &= ~DC_LP_SMTP_SOCKET_FLAGS;
+		variant->server_flags |=  DC_LP_SMTP_SOCKET_STARTTLS;
+		variant->send_port    =   TYPICAL_SMTP_STARTTLS_PORT;
+		probeset_add(probes, PROBE_SMTP, NULL, variant, PROBE_STAGGER_MS);
+
+		variant->send_port    =   TYPICAL_SMTP_PLAIN_PORT;
+		probeset_add(probes, PROBE_SMTP, NULL, variant, 2*PROBE_STAGGER_MS);
+
+		probeset_start(probes);
+		found = probeset_get_param(probes, probeset_wait(probes, PROBE_ANY_ORDER));
+		probeset_release(context, probes);
+		dc_loginparam_unref(variant);
+
+		if (found==NULL) {
+			goto cleanup;
+		}
 
+		param->send_port    = found->send_port;
+		param->server_flags = found->server_flags;
+		dc_loginparam_unref(found);
+
+		PROGRESS(850)
+
+		{ char* r = dc_loginparam_get_readable(param); dc_log_info(context, 0, "Using: %s", r); free(r); }
 		if (!dc_smtp_connect(context->smtp, param)) {
-			PROGRESS(860)
-
-			param->server_flags &= ~DC_LP_SMTP_SOCKET_FLAGS;
-			param->server_flags |=  DC_LP_SMTP_SOCKET_STARTTLS;
-			param->send_port    =   TYPICAL_SMTP_PLAIN_PORT;
-			{ char* r = dc_loginparam_get_readable(param); dc_log_info(context, 0, "Trying: %s", r); free(r); }
-			if (!dc_smtp_connect(context->smtp, param)) {
-				goto cleanup;
-			}
+			goto cleanup;
 		}
 	}
 
@@ -1029,6 +1526,10 @@ void dc_job_do_DC_JOB_CONFIGURE_IMAP(dc_context_t* context, dc_job_t* job)
 	dc_loginparam_write(param, context->sql, "configured_" /*the trailing underscore is correct*/);
 	dc_sqlite3_set_config_int(context->sql, "configured", 1);
 
+	if (autoconfig_wanted) {
+		write_autoconfig_cache(context, param_domain, param);
+	}
+
 	PROGRESS(920)
 
 	// we generate the keypair just now - we could also postpone this until the first message is sent, however,
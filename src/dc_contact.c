@@ -8,6 +8,9 @@
 #define DC_CONTACT_MAGIC 0x0c047ac7
 
 
+static char* get_self_addr(dc_context_t*);
+
+
 /**
  * Create a new contact object in memory.
  * Typically the user does not call this function directly but gets contact
@@ -538,7 +541,8 @@ int dc_addr_equals_self(dc_context_t* context, const char* addr)
 
 	normalized_addr = dc_addr_normalize(addr);
 
-	if (NULL==(self_addr=dc_sqlite3_get_config(context->sql, "configured_addr", NULL))) {
+	self_addr = get_self_addr(context);
+	if (self_addr[0]==0) {
 		goto cleanup;
 	}
 
@@ -571,6 +575,253 @@ int dc_addr_equals_contact(dc_context_t* context, const char* addr, uint32_t con
 }
 
 
+/*******************************************************************************
+ * Contact cache
+ ******************************************************************************/
+
+
+// the receive path looks up the same few addresses again and again;
+// the cache is bounded and simply dropped when it gets too large.
+// entries are added inside open transactions, so dc_sqlite3_rollback() drops the cache as well.
+#define CONTACT_CACHE_MAX_ENTRIES 2000
+
+#define CONTACT_CACHE_LOCK   { pthread_mutex_lock(&context->contact_cache_critical); }
+#define CONTACT_CACHE_UNLOCK { pthread_mutex_unlock(&context->contact_cache_critical); }
+
+
+typedef struct contact_cache_entry_t
+{
+	uint32_t id;
+	char*    name;
+	char*    addr;
+	char*    authname;
+	int      origin;
+	int      blocked;
+	time_t   last_seen;
+} contact_cache_entry_t;
+
+
+static void contact_cache_entry_free(contact_cache_entry_t* entry)
+{
+	if (entry) {
+		free(entry->name);
+		free(entry->addr);
+		free(entry->authname);
+		free(entry);
+	}
+}
+
+
+static void contact_cache_clear(dc_context_t* context)
+{
+	/* the caller must hold contact_cache_critical */
+	dc_hashelem_t* elem;
+	for (elem = dc_hash_first(&context->contact_cache); elem; elem = dc_hash_next(elem)) {
+		contact_cache_entry_free((contact_cache_entry_t*)dc_hash_data(elem));
+	}
+	dc_hash_clear(&context->contact_cache);
+	dc_hash_clear(&context->contact_cache_ids);
+}
+
+
+static void contact_cache_remove(dc_context_t* context, uint32_t contact_id)
+{
+	/* the caller must hold contact_cache_critical */
+	contact_cache_entry_t* entry = dc_hash_find(&context->contact_cache_ids, NULL, contact_id);
+	if (entry) {
+		dc_hash_insert(&context->contact_cache_ids, NULL, contact_id, NULL);
+		dc_hash_insert_str(&context->contact_cache, entry->addr, NULL);
+		contact_cache_entry_free(entry);
+	}
+}
+
+
+static void contact_cache_put(dc_context_t* context, uint32_t contact_id,
+                              const char* name, const char* addr, const char* authname,
+                              int origin, int blocked, time_t last_seen)
+{
+	contact_cache_entry_t* entry = NULL;
+
+	if (contact_id<=DC_CONTACT_ID_LAST_SPECIAL || addr==NULL) {
+		return;
+	}
+
+	if ((entry=calloc(1, sizeof(contact_cache_entry_t)))==NULL) {
+		exit(58);
+	}
+	entry->id        = contact_id;
+	entry->name      = dc_strdup(name);
+	entry->addr      = dc_strdup(addr);
+	entry->authname  = dc_strdup(authname);
+	entry->origin    = origin;
+	entry->blocked   = blocked;
+	entry->last_seen = last_seen;
+
+	CONTACT_CACHE_LOCK
+		contact_cache_remove(context, contact_id);
+
+		/* the address may have been used by another record before, eg. after a deletion */
+		contact_cache_entry_t* old = dc_hash_find_str(&context->contact_cache, addr);
+		if (old) {
+			contact_cache_remove(context, old->id);
+		}
+
+		if (dc_hash_cnt(&context->contact_cache) >= CONTACT_CACHE_MAX_ENTRIES) {
+			contact_cache_clear(context);
+		}
+
+		dc_hash_insert_str(&context->contact_cache, entry->addr, entry);
+		dc_hash_insert(&context->contact_cache_ids, NULL, contact_id, entry);
+	CONTACT_CACHE_UNLOCK
+}
+
+
+static char* get_self_addr(dc_context_t* context)
+{
+	/* returns the normalized configured address or an empty string, must be free()'d */
+	char* ret = NULL;
+
+	CONTACT_CACHE_LOCK
+		if (context->contact_cache_self_addr==NULL) {
+			context->contact_cache_self_addr = dc_sqlite3_get_config(context->sql, "configured_addr", "");
+		}
+		ret = dc_strdup(context->contact_cache_self_addr);
+	CONTACT_CACHE_UNLOCK
+
+	return ret;
+}
+
+
+/**
+ * Forget all cached contacts and the cached self-address.
+ * Called when the database is closed or the configured address changes.
+ *
+ * @private @memberof dc_context_t
+ */
+void dc_reset_contact_cache(dc_context_t* context)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return;
+	}
+
+	CONTACT_CACHE_LOCK
+		contact_cache_clear(context);
+		free(context->contact_cache_self_addr);
+		context->contact_cache_self_addr = NULL;
+	CONTACT_CACHE_UNLOCK
+}
+
+
+/**
+ * Remove a single contact from the cache.
+ * Must be called whenever a contact is modified outside of dc_add_or_lookup_contact().
+ *
+ * @private @memberof dc_context_t
+ */
+void dc_invalidate_cached_contact(dc_context_t* context, uint32_t contact_id)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return;
+	}
+
+	CONTACT_CACHE_LOCK
+		contact_cache_remove(context, contact_id);
+	CONTACT_CACHE_UNLOCK
+}
+
+
+/*******************************************************************************
+ * Contact search index
+ ******************************************************************************/
+
+
+// contacts seen in messages get their last_seen timestamp updated
+// at most once in this interval, this is used to rank search results
+#define CONTACT_LAST_SEEN_RESOLUTION (60*60)
+
+#define IS_MSG_ORIGIN(origin) ((origin)<DC_ORIGIN_INTERNAL \
+ && (origin)!=DC_ORIGIN_UNHANDLED_QR_SCAN && (origin)!=DC_ORIGIN_CREATE_CHAT)
+
+
+static char* normalize_search_str(const char* in)
+{
+	/* lowercase the string and collapse all whitespace to single spaces;
+	the same normalization is used for the index and for the queries */
+	char*       out = malloc(strlen(in?in:"")+1);
+	char*       p2 = out;
+	const char* p1 = in? in : "";
+	int         space = 0;
+
+	if (out==NULL) {
+		exit(56);
+	}
+
+	for ( ; *p1; p1++) {
+		if (*p1==' ' || *p1=='\t' || *p1=='\r' || *p1=='\n') {
+			space = 1;
+		}
+		else {
+			if (space && p2!=out) {
+				*p2++ = ' ';
+			}
+			space = 0;
+			*p2++ = (*p1>='A' && *p1<='Z')? *p1-'A'+'a' : *p1;
+		}
+	}
+	*p2 = 0;
+	return out;
+}
+
+
+static void add_search_tokens(sqlite3_stmt* stmt, uint32_t contact_id, const char* str, const char* delimiters)
+{
+	/* add all suffixes of str that start at a word boundary,
+	so that a prefix search finds eg. "Smith" in "John Smith" or "example" in "foo@example.org" */
+	char* normalized = normalize_search_str(str);
+
+	for (const char* p = normalized; *p; p++) {
+		if (p==normalized || strchr(delimiters, p[-1])) {
+			sqlite3_reset    (stmt);
+			sqlite3_bind_text(stmt, 1, p, -1, SQLITE_STATIC);
+			sqlite3_bind_int (stmt, 2, contact_id);
+			sqlite3_step     (stmt);
+		}
+	}
+
+	free(normalized);
+}
+
+
+/**
+ * Update the search index used by dc_get_contacts() for a contact.
+ * Called whenever the name or the address of a contact changes.
+ *
+ * @private @memberof dc_context_t
+ */
+void dc_update_contact_search_index(dc_context_t* context, uint32_t contact_id, const char* name, const char* addr)
+{
+	sqlite3_stmt* stmt = NULL;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || contact_id<=DC_CONTACT_ID_LAST_SPECIAL) {
+		goto cleanup;
+	}
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"DELETE FROM contacts_search WHERE contact_id=?;");
+	sqlite3_bind_int(stmt, 1, contact_id);
+	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"INSERT INTO contacts_search (token, contact_id) VALUES (?, ?);");
+	add_search_tokens(stmt, contact_id, name, " -.,;()\"'");
+	add_search_tokens(stmt, contact_id, addr, "-._+@");
+
+cleanup:
+	sqlite3_finalize(stmt);
+}
+
+
 /*******************************************************************************
  * Context functions to work with contacts
  ******************************************************************************/
@@ -636,9 +887,13 @@ uint32_t dc_add_or_lookup_contact( dc_context_t* context,
 	int           dummy = 0;
 	char*         addr = NULL;
 	char*         addr_self = NULL;
+	int           row_exists = 0;
 	char*         row_name = NULL;
 	char*         row_addr = NULL;
 	char*         row_authname = NULL;
+	int           row_origin = 0;
+	int           row_blocked = 0;
+	time_t        row_last_seen = 0;
 
 	if (sth_modified==NULL) {
 		sth_modified = &dummy;
@@ -654,7 +909,7 @@ uint32_t dc_add_or_lookup_contact( dc_context_t* context,
 	- remove leading `mailto:` */
 	addr = dc_addr_normalize(addr__);
 
-	addr_self = dc_sqlite3_get_config(context->sql, "configured_addr", "");
+	addr_self = get_self_addr(context);
 	if (strcasecmp(addr, addr_self)==0) {
 		row_id = DC_CONTACT_ID_SELF;
 		goto cleanup;
@@ -667,22 +922,44 @@ uint32_t dc_add_or_lookup_contact( dc_context_t* context,
 	}
 
 	/* insert email-address to database or modify the record with the given email-address.
-	we treat all email-addresses case-insensitive. */
-	stmt = dc_sqlite3_prepare(context->sql,
-		"SELECT id, name, addr, origin, authname FROM contacts WHERE addr=? COLLATE NOCASE;");
-	sqlite3_bind_text(stmt, 1, (const char*)addr, -1, SQLITE_STATIC);
-	if (sqlite3_step(stmt)==SQLITE_ROW)
-	{
-
-		int         row_origin, update_addr = 0, update_name = 0, update_authname = 0;
+	we treat all email-addresses case-insensitive, so does the cache. */
+	CONTACT_CACHE_LOCK
+		contact_cache_entry_t* entry = dc_hash_find_str(&context->contact_cache, addr);
+		if (entry) {
+			row_exists    = 1;
+			row_id        = entry->id;
+			row_name      = dc_strdup(entry->name);
+			row_addr      = dc_strdup(entry->addr);
+			row_origin    = entry->origin;
+			row_blocked   = entry->blocked;
+			row_authname  = dc_strdup(entry->authname);
+			row_last_seen = entry->last_seen;
+		}
+	CONTACT_CACHE_UNLOCK
 
-		row_id       = sqlite3_column_int(stmt, 0);
-		row_name     = dc_strdup((char*)sqlite3_column_text(stmt, 1));
-		row_addr     = dc_strdup((char*)sqlite3_column_text(stmt, 2));
-		row_origin   = sqlite3_column_int(stmt, 3);
-		row_authname = dc_strdup((char*)sqlite3_column_text(stmt, 4));
-		sqlite3_finalize (stmt);
+	if (!row_exists)
+	{
+		stmt = dc_sqlite3_prepare(context->sql,
+			"SELECT id, name, addr, origin, authname, last_seen, blocked FROM contacts WHERE addr=? COLLATE NOCASE;");
+		sqlite3_bind_text(stmt, 1, (const char*)addr, -1, SQLITE_STATIC);
+		if (sqlite3_step(stmt)==SQLITE_ROW)
+		{
+			row_exists    = 1;
+			row_id        = sqlite3_column_int(stmt, 0);
+			row_name      = dc_strdup((char*)sqlite3_column_text(stmt, 1));
+			row_addr      = dc_strdup((char*)sqlite3_column_text(stmt, 2));
+			row_origin    = sqlite3_column_int(stmt, 3);
+			row_authname  = dc_strdup((char*)sqlite3_column_text(stmt, 4));
+			row_last_seen = sqlite3_column_int64(stmt, 5);
+			row_blocked   = sqlite3_column_int(stmt, 6);
+		}
+		sqlite3_finalize(stmt);
 		stmt = NULL;
+	}
+
+	if (row_exists)
+	{
+		int update_addr = 0, update_name = 0, update_authname = 0;
 
 		if (name && name[0]) {
 			if (row_name[0]) {
@@ -716,6 +993,11 @@ uint32_t dc_add_or_lookup_contact( dc_context_t* context,
 			sqlite3_finalize (stmt);
 			stmt = NULL;
 
+			if (update_name || update_addr) {
+				dc_update_contact_search_index(context, row_id,
+					update_name? name : row_name, update_addr? addr : row_addr);
+			}
+
 			if (update_name)
 			{
 				/* Update the contact name also if it is used as a group name.
@@ -730,20 +1012,38 @@ uint32_t dc_add_or_lookup_contact( dc_context_t* context,
 
 			*sth_modified = CONTACT_MODIFIED;
 		}
+
+		if (IS_MSG_ORIGIN(origin) && time(NULL)-row_last_seen > CONTACT_LAST_SEEN_RESOLUTION)
+		{
+			row_last_seen = time(NULL);
+			sqlite3_finalize(stmt);
+			stmt = dc_sqlite3_prepare(context->sql,
+				"UPDATE contacts SET last_seen=? WHERE id=?;");
+			sqlite3_bind_int64(stmt, 1, row_last_seen);
+			sqlite3_bind_int  (stmt, 2, row_id);
+			sqlite3_step      (stmt);
+		}
+
+		contact_cache_put(context, row_id,
+			update_name?     name : row_name,
+			update_addr?     addr : row_addr,
+			update_authname? name : row_authname,
+			origin>row_origin? origin : row_origin, row_blocked, row_last_seen);
 	}
 	else
 	{
-		sqlite3_finalize (stmt);
-		stmt = NULL;
-
+		row_last_seen = IS_MSG_ORIGIN(origin)? time(NULL) : 0;
 		stmt = dc_sqlite3_prepare(context->sql,
-			"INSERT INTO contacts (name, addr, origin) VALUES(?, ?, ?);");
-		sqlite3_bind_text(stmt, 1, name? name : "", -1, SQLITE_STATIC); /* avoid NULL-fields in column */
-		sqlite3_bind_text(stmt, 2, addr,    -1, SQLITE_STATIC);
-		sqlite3_bind_int (stmt, 3, origin);
+			"INSERT INTO contacts (name, addr, origin, last_seen) VALUES(?, ?, ?, ?);");
+		sqlite3_bind_text (stmt, 1, name? name : "", -1, SQLITE_STATIC); /* avoid NULL-fields in column */
+		sqlite3_bind_text (stmt, 2, addr,    -1, SQLITE_STATIC);
+		sqlite3_bind_int  (stmt, 3, origin);
+		sqlite3_bind_int64(stmt, 4, row_last_seen);
 		if (sqlite3_step(stmt)==SQLITE_DONE)
 		{
 			row_id = dc_sqlite3_get_rowid(context->sql, "contacts", "addr", addr);
+			dc_update_contact_search_index(context, row_id, name, addr);
+			contact_cache_put(context, row_id, name? name : "", addr, "", origin, 0, row_last_seen);
 			*sth_modified = CONTACT_CREATED;
 		}
 		else
@@ -776,6 +1076,13 @@ void dc_scaleup_contact_origin(dc_context_t* context, uint32_t contact_id, int o
 	sqlite3_bind_int(stmt, 3, origin);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
+
+	CONTACT_CACHE_LOCK
+		contact_cache_entry_t* entry = dc_hash_find(&context->contact_cache_ids, NULL, contact_id);
+		if (entry && entry->origin<origin) {
+			entry->origin = origin;
+		}
+	CONTACT_CACHE_UNLOCK
 }
 
 
@@ -803,6 +1110,21 @@ int dc_get_contact_origin(dc_context_t* context, uint32_t contact_id, int* ret_b
 
 	*ret_blocked = 0;
 
+	if (context && context->magic==DC_CONTEXT_MAGIC) {
+		int found = 0;
+		CONTACT_CACHE_LOCK
+			contact_cache_entry_t* entry = dc_hash_find(&context->contact_cache_ids, NULL, contact_id);
+			if (entry) {
+				found = 1;
+				*ret_blocked = entry->blocked;
+				ret = entry->blocked? 0 : entry->origin;
+			}
+		CONTACT_CACHE_UNLOCK
+		if (found) {
+			goto cleanup;
+		}
+	}
+
 	if (!dc_contact_load_from_db(contact, context->sql, contact_id)) { /* we could optimize this by loading only the needed fields */
 		goto cleanup;
 	}
@@ -1013,30 +1335,16 @@ cleanup:
 }
 
 
-/**
- * Returns known and unblocked contacts.
- *
- * To get information about a single contact, see dc_get_contact().
- *
- * @memberof dc_context_t
- * @param context The context object as created by dc_context_new().
- * @param listflags A combination of flags:
- *     - if the flag DC_GCL_ADD_SELF is set, SELF is added to the list unless filtered by other parameters
- *     - if the flag DC_GCL_VERIFIED_ONLY is set, only verified contacts are returned.
- *       if DC_GCL_VERIFIED_ONLY is not set, verified and unverified contacts are returned.
- * @param query A string to filter the list.  Typically used to implement an
- *     incremental search.  NULL for no filtering.
- * @return An array containing all contact IDs.  Must be dc_array_unref()'d
- *     after usage.
- */
-dc_array_t* dc_get_contacts(dc_context_t* context, uint32_t listflags, const char* query)
+static dc_array_t* get_contacts(dc_context_t* context, uint32_t listflags, const char* query, int max_cnt)
 {
 	char*         self_addr = NULL;
 	char*         self_name = NULL;
 	char*         self_name2 = NULL;
 	int           add_self = 0;
 	dc_array_t*   ret = dc_array_new(context, 100);
-	char*         s3strLikeCmd = NULL;
+	char*         query_norm = NULL;
+	char*         query_end = NULL;
+	char*         q3 = NULL;
 	sqlite3_stmt* stmt = NULL;
 
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
@@ -1047,23 +1355,34 @@ dc_array_t* dc_get_contacts(dc_context_t* context, uint32_t listflags, const cha
 
 	if ((listflags&DC_GCL_VERIFIED_ONLY) || query)
 	{
-		if ((s3strLikeCmd=sqlite3_mprintf("%%%s%%", query? query : ""))==NULL) {
-			goto cleanup;
-		}
-		// see comments in dc_search_msgs() about the LIKE operator
-		stmt = dc_sqlite3_prepare(context->sql,
+		/* the query is looked up as a prefix of the words in names and addresses using the contacts_search index,
+		all tokens starting with the query are in the range [query, query+0xFF). */
+		query_norm = normalize_search_str(query);
+		query_end = dc_mprintf("%s\xFF", query_norm);
+
+		/* search results are ranked: contacts we have written to or added manually come first,
+		then the contacts seen recently in messages */
+		q3 = sqlite3_mprintf(
 			"SELECT c.id FROM contacts c"
 				" LEFT JOIN acpeerstates ps ON c.addr=ps.addr "
 				" WHERE c.addr!=?1 AND c.id>?2 AND c.origin>=?3"
-				" AND c.blocked=0 AND (c.name LIKE ?4 OR c.addr LIKE ?5)"
+				" AND c.blocked=0"
+				" AND (?4='' OR c.id IN (SELECT contact_id FROM contacts_search WHERE token>=?4 AND token<?5))"
 				" AND (1=?6 OR LENGTH(ps.verified_key_fingerprint)!=0) "
-				" ORDER BY LOWER(c.name||c.addr),c.id;");
+				" ORDER BY %s LOWER(c.name||c.addr),c.id"
+				" LIMIT ?8;",
+			query_norm[0]? "c.origin>=?7 DESC, c.last_seen DESC, c.origin DESC," : "");
+		stmt = dc_sqlite3_prepare(context->sql, q3);
 		sqlite3_bind_text(stmt, 1, self_addr, -1, SQLITE_STATIC);
 		sqlite3_bind_int (stmt, 2, DC_CONTACT_ID_LAST_SPECIAL);
 		sqlite3_bind_int (stmt, 3, DC_ORIGIN_MIN_CONTACT_LIST);
-		sqlite3_bind_text(stmt, 4, s3strLikeCmd, -1, SQLITE_STATIC);
-		sqlite3_bind_text(stmt, 5, s3strLikeCmd, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 4, query_norm, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 5, query_end, -1, SQLITE_STATIC);
 		sqlite3_bind_int (stmt, 6, (listflags&DC_GCL_VERIFIED_ONLY)? 0/*force checking for verified_key*/ : 1/*force statement being always true*/);
+		if (query_norm[0]) {
+			sqlite3_bind_int(stmt, 7, DC_ORIGIN_OUTGOING_BCC);
+		}
+		sqlite3_bind_int (stmt, 8, max_cnt>0? max_cnt : -1);
 
 		self_name  = dc_sqlite3_get_config(context->sql, "displayname", "");
 		self_name2 = dc_stock_str(context, DC_STR_SELF);
@@ -1076,10 +1395,12 @@ dc_array_t* dc_get_contacts(dc_context_t* context, uint32_t listflags, const cha
 		stmt = dc_sqlite3_prepare(context->sql,
 			"SELECT id FROM contacts"
 				" WHERE addr!=?1 AND id>?2 AND origin>=?3 AND blocked=0"
-				" ORDER BY LOWER(name||addr),id;");
+				" ORDER BY LOWER(name||addr),id"
+				" LIMIT ?4;");
 		sqlite3_bind_text(stmt, 1, self_addr, -1, SQLITE_STATIC);
 		sqlite3_bind_int (stmt, 2, DC_CONTACT_ID_LAST_SPECIAL);
 		sqlite3_bind_int (stmt, 3, DC_ORIGIN_MIN_CONTACT_LIST);
+		sqlite3_bind_int (stmt, 4, max_cnt>0? max_cnt : -1);
 
 		add_self = 1;
 	}
@@ -1095,7 +1416,9 @@ dc_array_t* dc_get_contacts(dc_context_t* context, uint32_t listflags, const cha
 
 cleanup:
 	sqlite3_finalize(stmt);
-	sqlite3_free(s3strLikeCmd);
+	sqlite3_free(q3);
+	free(query_norm);
+	free(query_end);
 	free(self_addr);
 	free(self_name);
 	free(self_name2);
@@ -1103,6 +1426,53 @@ cleanup:
 }
 
 
+/**
+ * Returns known and unblocked contacts.
+ *
+ * To get information about a single contact, see dc_get_contact().
+ *
+ * @memberof dc_context_t
+ * @param context The context object as created by dc_context_new().
+ * @param listflags A combination of flags:
+ *     - if the flag DC_GCL_ADD_SELF is set, SELF is added to the list unless filtered by other parameters
+ *     - if the flag DC_GCL_VERIFIED_ONLY is set, only verified contacts are returned.
+ *       if DC_GCL_VERIFIED_ONLY is not set, verified and unverified contacts are returned.
+ * @param query A string to filter the list.  Typically used to implement an
+ *     incremental search.  NULL for no filtering.
+ *     Contacts are returned if a word of the name or a part of the address starts with the query,
+ *     the search is case-insensitive for ASCII characters.
+ * @return An array containing all contact IDs.  Must be dc_array_unref()'d
+ *     after usage.
+ *     Without query, the contacts are sorted by name;
+ *     with a query, contacts we have written to or added manually come first, then the contacts seen recently.
+ */
+dc_array_t* dc_get_contacts(dc_context_t* context, uint32_t listflags, const char* query)
+{
+	return get_contacts(context, listflags, query, 0);
+}
+
+
+/**
+ * Search contacts and return at most the given number of results.
+ * Works as dc_get_contacts() but returns only the best results,
+ * this is useful for incremental searches in large address books.
+ *
+ * @memberof dc_context_t
+ * @param context The context object as created by dc_context_new().
+ * @param listflags A combination of the flags DC_GCL_ADD_SELF and DC_GCL_VERIFIED_ONLY,
+ *     see dc_get_contacts() for details.
+ * @param query A string to filter the list, see dc_get_contacts() for details.
+ * @param max_cnt Maximal number of contact IDs to return, not counting DC_CONTACT_ID_SELF.
+ *     0 for no limit.
+ * @return An array containing the contact IDs.  Must be dc_array_unref()'d
+ *     after usage.
+ */
+dc_array_t* dc_search_contacts(dc_context_t* context, uint32_t listflags, const char* query, int max_cnt)
+{
+	return get_contacts(context, listflags, query, max_cnt);
+}
+
+
 /**
  * Get blocked contacts.
  *
@@ -1253,6 +1623,8 @@ void dc_block_contact(dc_context_t* context, uint32_t contact_id, int new_blocki
 			sqlite3_finalize(stmt);
 			stmt = NULL;
 
+			dc_invalidate_cached_contact(context, contact_id);
+
 			/* also (un)block all chats with _only_ this contact - we do not delete them to allow a non-destructive blocking->unblocking.
 			(Maybe, beside normal chats (type=100) we should also block group chats with only this user.
 			However, I'm not sure about this point; it may be confusing if the user wants to add other people;
@@ -1439,6 +1811,14 @@ int dc_delete_contact(dc_context_t* context, uint32_t contact_id)
 	if (sqlite3_step(stmt)!=SQLITE_DONE) {
 		goto cleanup;
 	}
+	sqlite3_finalize(stmt);
+
+	dc_invalidate_cached_contact(context, contact_id);
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"DELETE FROM contacts_search WHERE contact_id=?;");
+	sqlite3_bind_int(stmt, 1, contact_id);
+	sqlite3_step(stmt);
 
 	context->cb(context, DC_EVENT_CONTACTS_CHANGED, 0, 0);
 
@@ -73,6 +73,9 @@ int          dc_addr_equals_contact              (dc_context_t*, const char* add
 // Context functions to work with contacts
 size_t       dc_get_real_contact_cnt             (dc_context_t*);
 uint32_t     dc_add_or_lookup_contact            (dc_context_t*, const char* display_name /*can be NULL*/, const char* addr_spec, int origin, int* sth_modified);
+void         dc_update_contact_search_index      (dc_context_t*, uint32_t contact_id, const char* name, const char* addr);
+void         dc_reset_contact_cache              (dc_context_t*);
+void         dc_invalidate_cached_contact        (dc_context_t*, uint32_t contact_id);
 int          dc_get_contact_origin               (dc_context_t*, uint32_t contact_id, int* ret_blocked);
 int          dc_is_contact_blocked               (dc_context_t*, uint32_t contact_id);
 int          dc_real_contact_exists              (dc_context_t*, uint32_t contact_id);
@@ -39,6 +39,8 @@ static const char* config_keys[] = {
 	,"mvbox_move"
 	,"show_emails"
 	,"save_mime_headers"
+	,"imap_catchup_days"
+	,"imap_catchup_msgs"
 	,"configured_addr"
 	,"configured_mail_server"
 	,"configured_mail_user"
@@ -95,51 +97,69 @@ static void cb_set_config(dc_imap_t* imap, const char* key, const char* value)
 }
 
 
-static int cb_precheck_imf(dc_imap_t* imap, const char* rfc724_mid,
-                           const char* server_folder, uint32_t server_uid)
+static void cb_precheck_imf(dc_imap_t* imap, const char* server_folder, int cnt,
+                            const char** rfc724_mids, const uint32_t* server_uids,
+                            int* ret_exists)
 {
-	int      rfc724_mid_exists = 0;
-	uint32_t msg_id = 0;
-	char*    old_server_folder = NULL;
-	uint32_t old_server_uid = 0;
-	int      mark_seen = 0;
+	uint32_t* msg_ids = calloc(cnt+1, sizeof(uint32_t));
+	char**    old_server_folders = calloc(cnt+1, sizeof(char*));
+	uint32_t* old_server_uids = calloc(cnt+1, sizeof(uint32_t));
+	int*      processed_reports = calloc(cnt+1, sizeof(int));
 
-	msg_id = dc_rfc724_mid_exists(imap->context, rfc724_mid,
-		&old_server_folder, &old_server_uid);
+	if (msg_ids==NULL || old_server_folders==NULL || old_server_uids==NULL || processed_reports==NULL) {
+		goto cleanup; /* nothing exists, the messages are downloaded and checked by dc_receive_imf() */
+	}
 
-	if (msg_id!=0)
-	{
-		rfc724_mid_exists = 1;
+	dc_lookup_rfc724_mids(imap->context, cnt, rfc724_mids,
+		msg_ids, old_server_folders, old_server_uids, processed_reports);
 
-		if (old_server_folder[0]==0 && old_server_uid==0) {
-			dc_log_info(imap->context, 0, "[move] detected bbc-self %s", rfc724_mid);
-			mark_seen = 1;
-		}
-		else if (strcmp(old_server_folder, server_folder)!=0) {
-			dc_log_info(imap->context, 0, "[move] detected moved message %s", rfc724_mid);
-			dc_update_msg_move_state(imap->context, rfc724_mid, DC_MOVE_STATE_STAY);
+	for (int i = 0; i < cnt; i++)
+	{
+		const char* rfc724_mid = rfc724_mids[i];
+		uint32_t    msg_id = msg_ids[i];
+		int         mark_seen = 0;
+
+		if (msg_id!=0)
+		{
+			ret_exists[i] = 1;
+
+			if (old_server_folders[i][0]==0 && old_server_uids[i]==0) {
+				dc_log_info(imap->context, 0, "[move] detected bbc-self %s", rfc724_mid);
+				mark_seen = 1;
+			}
+			else if (strcmp(old_server_folders[i], server_folder)!=0) {
+				dc_log_info(imap->context, 0, "[move] detected moved message %s", rfc724_mid);
+				dc_update_msg_move_state(imap->context, rfc724_mid, DC_MOVE_STATE_STAY);
+			}
+
+			if (strcmp(old_server_folders[i], server_folder)!=0
+			 || old_server_uids[i]!=server_uids[i]) {
+				dc_update_server_uid(imap->context, rfc724_mid, server_folder, server_uids[i]);
+			}
+
+			dc_do_heuristics_moves(imap->context, server_folder, msg_id);
+
+			if (mark_seen) {
+				dc_job_add(imap->context, DC_JOB_MARKSEEN_MSG_ON_IMAP, msg_id, NULL, 0);
+			}
 		}
-
-		if (strcmp(old_server_folder, server_folder)!=0
-		 || old_server_uid!=server_uid) {
-			dc_update_server_uid(imap->context, rfc724_mid, server_folder, server_uid);
+		else if (processed_reports[i])
+		{
+			// reports as MDNs are typically read from the INBOX, moved to the MVBOX and popping up there again
+			ret_exists[i] = 1;
 		}
+	}
 
-		dc_do_heuristics_moves(imap->context, server_folder, msg_id);
-
-		if (mark_seen) {
-			dc_job_add(imap->context, DC_JOB_MARKSEEN_MSG_ON_IMAP, msg_id, NULL, 0);
+cleanup:
+	if (old_server_folders) {
+		for (int i = 0; i < cnt; i++) {
+			free(old_server_folders[i]);
 		}
 	}
-
-	// TODO: also optimize for already processed report/mdn Message-IDs.
-	// this happens regulary as eg. mdns are typically read from the INBOX,
-	// moved to MVBOX and popping up from there.
-	// when modifying tables for this purpose, maybe also target #112 (mdn cleanup)
-
-	free(old_server_folder);
-
-	return rfc724_mid_exists;
+	free(msg_ids);
+	free(old_server_folders);
+	free(old_server_uids);
+	free(processed_reports);
 }
 
 
@@ -187,6 +207,16 @@ dc_context_t* dc_context_new(dc_callback_t cb, void* userdata, const char* os_na
 	}
 
 	pthread_mutex_init(&context->smear_critical, NULL);
+	pthread_mutex_init(&context->known_mids_critical, NULL);
+	pthread_mutex_init(&context->contact_cache_critical, NULL);
+	pthread_mutex_init(&context->event_queue_critical, NULL);
+	pthread_mutex_init(&context->stats_critical, NULL);
+	dc_hash_init(&context->contact_cache, DC_HASH_STRING, DC_HASH_COPY_KEY);
+	dc_hash_init(&context->contact_cache_ids, DC_HASH_INT, 0);
+	pthread_mutex_init(&context->e2ee_plans_critical, NULL);
+	dc_hash_init(&context->e2ee_plans, DC_HASH_STRING, DC_HASH_COPY_KEY);
+	pthread_mutex_init(&context->mimeparser_pool_critical, NULL);
+	context->mimeparser_pool = carray_new(4);
 	pthread_mutex_init(&context->bobs_qr_critical, NULL);
 	pthread_mutex_init(&context->inboxidle_condmutex, NULL);
 	dc_jobthread_init(&context->sentbox_thread, context, "SENTBOX", "configured_sentbox_folder");
@@ -246,6 +276,8 @@ void dc_context_unref(dc_context_t* context)
 
 	dc_pgp_exit();
 
+	dc_configure_join_probes(context);
+
 	if (dc_is_open(context)) {
 		dc_close(context);
 	}
@@ -259,6 +291,17 @@ void dc_context_unref(dc_context_t* context)
 	dc_openssl_exit();
 
 	pthread_mutex_destroy(&context->smear_critical);
+	pthread_mutex_destroy(&context->known_mids_critical);
+	dc_reset_contact_cache(context);
+	pthread_mutex_destroy(&context->contact_cache_critical);
+	dc_e2ee_reset_plans(context);
+	pthread_mutex_destroy(&context->e2ee_plans_critical);
+	dc_reset_mimeparser_pool(context);
+	carray_free(context->mimeparser_pool);
+	pthread_mutex_destroy(&context->mimeparser_pool_critical);
+	dc_enable_event_queue(context, 0);
+	pthread_mutex_destroy(&context->event_queue_critical);
+	pthread_mutex_destroy(&context->stats_critical);
 	pthread_mutex_destroy(&context->bobs_qr_critical);
 	pthread_mutex_destroy(&context->inboxidle_condmutex);
 	dc_jobthread_exit(&context->sentbox_thread);
@@ -522,6 +565,13 @@ static char* get_sys_config_str(const char* key)
  * - `save_mime_headers` = 1=save mime headers
  *                    and make dc_get_mime_headers() work for subsequent calls,
  *                    0=do not save mime headers (default)
+ * - `imap_catchup_days` = when a folder is fetched for the first time,
+ *                    also download the messages of the last given number of days,
+ *                    0=download only messages that arrive from now on (default)
+ * - `imap_catchup_msgs` = when a folder is fetched for the first time,
+ *                    also download up to the given number of recent messages,
+ *                    if `imap_catchup_days` is set, this limits the messages downloaded for these days,
+ *                    0=no limit resp. download only messages that arrive from now on (default)
  *
  * If you want to retrieve a value, use dc_get_config().
  *
@@ -887,6 +937,10 @@ char* dc_get_info(dc_context_t* context)
 	dc_strbuilder_cat(&ret, temp);
 	free(temp);
 
+	temp = dc_stats_get_readable(context);
+	dc_strbuilder_cat(&ret, temp);
+	free(temp);
+
 	/* free data */
 	dc_loginparam_unref(l);
 	dc_loginparam_unref(l2);
@@ -970,8 +1024,7 @@ cleanup:
  */
 dc_array_t* dc_search_msgs(dc_context_t* context, uint32_t chat_id, const char* query)
 {
-	//clock_t       start = clock();
-
+	uint64_t      stats_start = dc_stats_now();
 	int           success = 0;
 	dc_array_t*   ret = dc_array_new(context, 100);
 	char*         strLikeInText = NULL;
@@ -1039,7 +1092,7 @@ cleanup:
 	free(real_query);
 	sqlite3_finalize(stmt);
 
-	//dc_log_info(context, 0, "Message list for search \"%s\" in chat #%i created in %.3f ms.", query, chat_id, (double)(clock()-start)*1000.0/CLOCKS_PER_SEC);
+	dc_stats_add(context, DC_STATS_SEARCH_MSGS, stats_start);
 
 	if (success) {
 		return ret;
@@ -34,6 +34,15 @@ preferrably, this should be done in the project configuration currently */
 #include "dc_job.h"
 #include "dc_mimeparser.h"
 #include "dc_hash.h"
+#include "dc_stats.h"
+
+
+typedef struct _dc_event_slot
+{
+	int       event;
+	uintptr_t data1;
+	uintptr_t data2;
+} dc_event_slot_t;
 
 
 /** Structure behind dc_context_t */
@@ -73,6 +82,20 @@ struct _dc_context
 
 	dc_callback_t    cb;                    /**< Internal */
 
+	// events that do not need an answer may be queued and fetched using dc_get_next_event(),
+	// if the queue is enabled, `cb` is replaced by an internal function and the original callback is saved in `queue_user_cb`
+	dc_callback_t    queue_user_cb;
+	dc_event_slot_t* event_queue;
+	int              event_queue_size;
+	int              event_queue_first;
+	int              event_queue_cnt;
+	int              event_queue_dropped;
+	dc_event_slot_t  event_current;
+	pthread_mutex_t  event_queue_critical;
+
+	// DC_EVENT_INFO and DC_EVENT_WARNING events below this level are not even formatted
+	int              min_log_level;
+
 	char*            os_name;               /**< Internal, may be NULL */
 
 	uint32_t         cmdline_sel_chat_id;   /**< Internal */
@@ -91,9 +114,38 @@ struct _dc_context
 	time_t           last_smeared_timestamp;
 	pthread_mutex_t  smear_critical;
 
+	// bloom filter of the Message-IDs in the database, used to precheck fetched messages; built on first use
+	uint8_t*         known_mids_bloom;
+	size_t           known_mids_bloom_bits;
+	size_t           known_mids_cnt;
+	pthread_mutex_t  known_mids_critical;
+
+	// normalized address -> contact cache used by the receive path, bounded, owned entries are also indexed by the contact id
+	dc_hash_t        contact_cache;
+	dc_hash_t        contact_cache_ids;
+	char*            contact_cache_self_addr;
+	pthread_mutex_t  contact_cache_critical;
+
+	// recipients -> keys to encrypt to and gossip headers, and the own keys; see dc_e2ee_encrypt()
+	dc_hash_t        e2ee_plans;
+	struct _dc_e2ee_self* e2ee_self;
+	int              e2ee_plans_generation;
+	pthread_mutex_t  e2ee_plans_critical;
+
+	// emptied mime parsers kept for the next dc_receive_imf(), at most one per receiving thread is needed
+	carray*          mimeparser_pool;
+	pthread_mutex_t  mimeparser_pool_critical;
+
+	// counts and latency histograms of the hot paths, see dc_get_stats()
+	dc_stats_entry_t stats[DC_STATS_CNT];
+	pthread_mutex_t  stats_critical;
+
 	// handling ongoing processes initiated by the user
 	int              ongoing_running;
 	int              shall_stop_ongoing;
+
+	// probes of the last configuration that may still run, joined by dc_configure_join_probes()
+	carray*          configure_probes;
 };
 
 void            dc_log_event         (dc_context_t*, int event_code, int data1, const char* msg, ...);
@@ -103,6 +155,7 @@ void            dc_log_warning       (dc_context_t*, int data1, const char* msg,
 void            dc_log_info          (dc_context_t*, int data1, const char* msg, ...);
 
 void            dc_receive_imf       (dc_context_t*, const char* imf_raw_not_terminated, size_t imf_raw_bytes, const char* server_folder, uint32_t server_uid, uint32_t flags);
+void            dc_reset_mimeparser_pool (dc_context_t*);
 
 #define         DC_NOT_CONNECTED     0
 #define         DC_ALREADY_CONNECTED 1
@@ -112,6 +165,7 @@ int             dc_connect_to_configured_imap (dc_context_t*, dc_imap_t*);
 #define         DC_CREATE_MVBOX      0x01
 #define         DC_FOLDERS_CONFIGURED_VERSION 3
 void            dc_configure_folders (dc_context_t*, dc_imap_t*, int flags);
+void            dc_configure_join_probes (dc_context_t*);
 
 
 void            dc_do_heuristics_moves(dc_context_t*, const char* folder, uint32_t msg_id);
@@ -151,6 +205,7 @@ char*           dc_get_message_kml        (dc_context_t*, time_t timestamp, doub
 void            dc_set_kml_sent_timestamp (dc_context_t*, uint32_t chat_id, time_t);
 void            dc_set_msg_location_id    (dc_context_t*, uint32_t msg_id, uint32_t location_id);
 uint32_t        dc_save_locations         (dc_context_t*, uint32_t chat_id, uint32_t contact_id, const dc_array_t*, int independent);
+void            dc_compact_locations      (dc_context_t*);
 dc_kml_t*       dc_kml_parse              (dc_context_t*, const char* content, size_t content_bytes);
 void            dc_kml_unref              (dc_kml_t*);
 void            dc_job_do_DC_JOB_MAYBE_SEND_LOCATIONS (dc_context_t*, dc_job_t*);
@@ -181,6 +236,7 @@ void            dc_job_do_DC_JOB_MAYBE_SEND_LOC_ENDED (dc_context_t*, dc_job_t*)
 
 
 typedef struct _dc_e2ee_helper dc_e2ee_helper_t;
+typedef struct _dc_e2ee_self   dc_e2ee_self_t;
 
 
 /* library private: end-to-end-encryption */
@@ -200,6 +256,7 @@ void            dc_e2ee_encrypt      (dc_context_t*, const clist* recipients_add
                                       int force_plaintext, int e2ee_guaranteed, int min_verified,
                                       int do_gossip, struct mailmime* in_out_message, dc_e2ee_helper_t*);
 void            dc_e2ee_decrypt      (dc_context_t*, struct mailmime* in_out_message, dc_e2ee_helper_t*); /* returns 1 if sth. was decrypted, 0 in other cases */
+void            dc_e2ee_reset_plans  (dc_context_t*);
 void            dc_e2ee_thanks       (dc_e2ee_helper_t*); /* frees data referenced by "mailmime" but not freed by mailmime_free(). After calling this function, in_out_message cannot be used any longer! */
 int             dc_ensure_secret_key_exists (dc_context_t*); /* makes sure, the private key exists, needed only for exporting keys and the case no message was sent before */
 char*           dc_create_setup_code (dc_context_t*);
@@ -4,6 +4,7 @@
 #include "dc_keyring.h"
 #include "dc_mimeparser.h"
 #include "dc_apeerstate.h"
+#include "dc_codec.h"
 
 
 /*******************************************************************************
@@ -281,6 +282,328 @@ cleanup:
 }
 
 
+/*******************************************************************************
+ * Encryption plans
+ ******************************************************************************/
+
+
+// for a given set of recipients, the keys to encrypt to and the gossip headers
+// only change if a peerstate or an own key changes.  they are cached per set of recipients,
+// on any such change, dc_e2ee_reset_plans() drops the whole cache.
+// membership changes need no invalidation as they result in another set of recipients.
+#define E2EE_PLANS_MAX_ENTRIES 64
+
+#define E2EE_PLANS_LOCK   { pthread_mutex_lock(&context->e2ee_plans_critical); }
+#define E2EE_PLANS_UNLOCK { pthread_mutex_unlock(&context->e2ee_plans_critical); }
+
+
+typedef struct e2ee_plan_t
+{
+	int        can_encrypt; // 0 if at least one recipient has no usable key
+	int        cnt;
+	dc_key_t** keys;        // public keys of the recipients, SELF is not included
+	char**     gossip;      // rendered Autocrypt-Gossip headers, same order as keys, entries may be NULL
+} e2ee_plan_t;
+
+
+struct _dc_e2ee_self
+{
+	char*      addr;
+	int        prefer_encrypt;
+	dc_key_t*  public_key;
+	dc_key_t*  private_key; // NULL if not yet needed
+};
+
+
+static void e2ee_plan_free(e2ee_plan_t* plan)
+{
+	/* the caller must hold e2ee_plans_critical as the keys may be referenced by keyrings */
+	if (plan) {
+		for (int i = 0; i<plan->cnt; i++) {
+			dc_key_unref(plan->keys[i]);
+			free(plan->gossip[i]);
+		}
+		free(plan->keys);
+		free(plan->gossip);
+		free(plan);
+	}
+}
+
+
+static void e2ee_self_free(dc_e2ee_self_t* self)
+{
+	if (self) {
+		free(self->addr);
+		dc_key_unref(self->public_key);
+		dc_key_unref(self->private_key);
+		free(self);
+	}
+}
+
+
+static void e2ee_plans_drop(dc_context_t* context)
+{
+	/* the caller must hold e2ee_plans_critical */
+	dc_hashelem_t* elem;
+	for (elem = dc_hash_first(&context->e2ee_plans); elem; elem = dc_hash_next(elem)) {
+		e2ee_plan_free((e2ee_plan_t*)dc_hash_data(elem));
+	}
+	dc_hash_clear(&context->e2ee_plans);
+}
+
+
+static void e2ee_plans_clear(dc_context_t* context)
+{
+	/* the caller must hold e2ee_plans_critical */
+	e2ee_plans_drop(context);
+	e2ee_self_free(context->e2ee_self);
+	context->e2ee_self = NULL;
+	context->e2ee_plans_generation++;
+}
+
+
+/**
+ * Forget all cached encryption plans and own keys.
+ * Must be called whenever a peerstate, an own key, `e2ee_enabled` or `configured_addr` changes
+ * and when the database is closed.
+ *
+ * @private @memberof dc_context_t
+ * @param context The context object.
+ * @return None.
+ */
+void dc_e2ee_reset_plans(dc_context_t* context)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return;
+	}
+
+	E2EE_PLANS_LOCK
+		e2ee_plans_clear(context);
+	E2EE_PLANS_UNLOCK
+}
+
+
+static char* get_plan_key(const clist* recipients_addr, int e2ee_guaranteed, int min_verified)
+{
+	dc_strbuilder_t ret;
+	dc_array_t*     addrs = dc_array_new(NULL, clist_count(recipients_addr));
+
+	for (clistiter* iter=clist_begin(recipients_addr); iter!=NULL; iter=clist_next(iter)) {
+		dc_array_add_ptr(addrs, dc_strlower((const char*)clist_content(iter)));
+	}
+	dc_array_sort_strings(addrs);
+
+	dc_strbuilder_init(&ret, 0);
+	dc_strbuilder_catf(&ret, "%i %i", e2ee_guaranteed? 1 : 0, min_verified);
+	for (size_t i = 0; i<dc_array_get_cnt(addrs); i++) {
+		dc_strbuilder_cat(&ret, " ");
+		dc_strbuilder_cat(&ret, (const char*)dc_array_get_ptr(addrs, i));
+	}
+
+	dc_array_free_ptr(addrs);
+	dc_array_unref(addrs);
+	return ret.buf;
+}
+
+
+static e2ee_plan_t* load_plan(dc_context_t* context, const clist* recipients_addr, const char* self_addr,
+                              int e2ee_guaranteed, int min_verified)
+{
+	e2ee_plan_t* plan = NULL;
+	int          recipients_cnt = clist_count(recipients_addr);
+
+	if ((plan=calloc(1, sizeof(e2ee_plan_t)))==NULL
+	 || (plan->keys=calloc(recipients_cnt+1, sizeof(dc_key_t*)))==NULL
+	 || (plan->gossip=calloc(recipients_cnt+1, sizeof(char*)))==NULL) {
+		exit(61);
+	}
+
+	plan->can_encrypt = 1;
+
+	for (clistiter* iter=clist_begin(recipients_addr); iter!=NULL; iter=clist_next(iter)) {
+		const char*      recipient_addr = clist_content(iter);
+		dc_apeerstate_t* peerstate = dc_apeerstate_new(context);
+		dc_key_t*        key_to_use = NULL;
+		if (strcasecmp(recipient_addr, self_addr)==0)
+		{
+			; // encrypt to SELF, this key is added by the caller
+		}
+		else if (dc_apeerstate_load_by_addr(peerstate, context->sql, recipient_addr)
+		      && (key_to_use=dc_apeerstate_peek_key(peerstate, min_verified))!=NULL
+		      && (peerstate->prefer_encrypt==DC_PE_MUTUAL || e2ee_guaranteed))
+		{
+			plan->keys[plan->cnt] = dc_key_ref(key_to_use); /* we always add all recipients (even on IMAP upload) as otherwise forwarding may fail */
+			plan->gossip[plan->cnt] = dc_apeerstate_render_gossip_header(peerstate, min_verified);
+			plan->cnt++;
+		}
+		else
+		{
+			plan->can_encrypt = 0; /* if we cannot encrypt to a single recipient, we cannot encrypt the message at all */
+		}
+		dc_apeerstate_unref(peerstate);
+
+		if (!plan->can_encrypt) {
+			break;
+		}
+	}
+
+	return plan;
+}
+
+
+static int apply_plan(const e2ee_plan_t* plan, dc_keyring_t* keyring, clist* gossip_headers)
+{
+	/* the caller must hold e2ee_plans_critical.
+	gossip is added only if there are at least two peers to encrypt to,
+	no matter if a gossip header could be rendered for each of them */
+	for (int i = 0; i<plan->cnt; i++) {
+		dc_keyring_add(keyring, plan->keys[i]);
+		if (gossip_headers && plan->cnt > 1 && plan->gossip[i]) {
+			clist_append(gossip_headers, dc_strdup(plan->gossip[i]));
+		}
+	}
+	return plan->can_encrypt;
+}
+
+
+/* adds the keys of the recipients to the keyring and, if wanted, the gossip headers to the list;
+the keyring must be unref'd while holding e2ee_plans_critical. returns 1 if the message can be encrypted. */
+static int use_plan(dc_context_t* context, const clist* recipients_addr, const char* self_addr,
+                    int e2ee_guaranteed, int min_verified,
+                    dc_keyring_t* keyring, clist* gossip_headers)
+{
+	int          can_encrypt = 0;
+	char*        key = get_plan_key(recipients_addr, e2ee_guaranteed, min_verified);
+	e2ee_plan_t* plan = NULL;
+	int          generation = 0;
+
+	E2EE_PLANS_LOCK
+		if ((plan=dc_hash_find_str(&context->e2ee_plans, key))!=NULL) {
+			can_encrypt = apply_plan(plan, keyring, gossip_headers);
+		}
+		generation = context->e2ee_plans_generation;
+	E2EE_PLANS_UNLOCK
+
+	if (plan) {
+		goto cleanup;
+	}
+
+	plan = load_plan(context, recipients_addr, self_addr, e2ee_guaranteed, min_verified);
+
+	E2EE_PLANS_LOCK
+		can_encrypt = apply_plan(plan, keyring, gossip_headers);
+
+		// do not cache the plan if peerstates were changed while it was loaded
+		if (generation==context->e2ee_plans_generation
+		 && dc_hash_find_str(&context->e2ee_plans, key)==NULL) {
+			if (dc_hash_cnt(&context->e2ee_plans) >= E2EE_PLANS_MAX_ENTRIES) {
+				e2ee_plans_drop(context);
+			}
+			dc_hash_insert_str(&context->e2ee_plans, key, plan);
+			plan = NULL;
+		}
+
+		e2ee_plan_free(plan); // the keys are still referenced by the keyring
+	E2EE_PLANS_UNLOCK
+
+cleanup:
+	free(key);
+	return can_encrypt;
+}
+
+
+/* fills the address, preference and public key of the Autocrypt header from the cache
+or from the database; a missing key is generated. returns 0 on errors. */
+static int load_self_aheader(dc_context_t* context, dc_aheader_t* autocryptheader, struct mailmime* random_data_mime)
+{
+	int             success = 0;
+	int             generation = 0;
+	dc_e2ee_self_t* self = NULL;
+
+	E2EE_PLANS_LOCK
+		if (context->e2ee_self) {
+			autocryptheader->prefer_encrypt = context->e2ee_self->prefer_encrypt;
+			autocryptheader->addr = dc_strdup(context->e2ee_self->addr);
+			dc_key_set_from_key(autocryptheader->public_key, context->e2ee_self->public_key);
+			success = 1;
+		}
+		generation = context->e2ee_plans_generation;
+	E2EE_PLANS_UNLOCK
+
+	if (success) {
+		goto cleanup;
+	}
+
+	if ((self=calloc(1, sizeof(dc_e2ee_self_t)))==NULL) {
+		exit(62);
+	}
+
+	self->prefer_encrypt = DC_PE_NOPREFERENCE;
+	if (dc_sqlite3_get_config_int(context->sql, "e2ee_enabled", DC_E2EE_DEFAULT_ENABLED)) {
+		self->prefer_encrypt = DC_PE_MUTUAL;
+	}
+
+	self->addr = dc_sqlite3_get_config(context->sql, "configured_addr", NULL);
+	if (self->addr==NULL) {
+		goto cleanup;
+	}
+
+	self->public_key = dc_key_new();
+	if (!load_or_generate_self_public_key(context, self->public_key, self->addr, random_data_mime)) {
+		goto cleanup;
+	}
+
+	autocryptheader->prefer_encrypt = self->prefer_encrypt;
+	autocryptheader->addr = dc_strdup(self->addr);
+	dc_key_set_from_key(autocryptheader->public_key, self->public_key);
+	success = 1;
+
+	E2EE_PLANS_LOCK
+		if (generation==context->e2ee_plans_generation && context->e2ee_self==NULL) {
+			context->e2ee_self = self;
+			self = NULL;
+		}
+	E2EE_PLANS_UNLOCK
+
+cleanup:
+	e2ee_self_free(self);
+	return success;
+}
+
+
+static int load_self_private(dc_context_t* context, dc_key_t* private_key, const char* self_addr)
+{
+	int success = 0;
+	int generation = 0;
+
+	E2EE_PLANS_LOCK
+		if (context->e2ee_self && context->e2ee_self->private_key) {
+			success = dc_key_set_from_key(private_key, context->e2ee_self->private_key);
+		}
+		generation = context->e2ee_plans_generation;
+	E2EE_PLANS_UNLOCK
+
+	if (success) {
+		return 1;
+	}
+
+	if (!dc_key_load_self_private(private_key, self_addr, context->sql)) {
+		return 0;
+	}
+
+	E2EE_PLANS_LOCK
+		if (generation==context->e2ee_plans_generation
+		 && context->e2ee_self && context->e2ee_self->private_key==NULL
+		 && strcmp(context->e2ee_self->addr, self_addr)==0) {
+			context->e2ee_self->private_key = dc_key_new();
+			dc_key_set_from_key(context->e2ee_self->private_key, private_key);
+		}
+	E2EE_PLANS_UNLOCK
+
+	return 1;
+}
+
+
 /*******************************************************************************
  * Encrypt
  ******************************************************************************/
@@ -302,7 +625,7 @@ void dc_e2ee_encrypt(dc_context_t* context, const clist* recipients_addr,
 	MMAPString*             plain = mmap_string_new("");
 	char*                   ctext = NULL;
 	size_t                  ctext_bytes = 0;
-	dc_array_t*             peerstates = dc_array_new(NULL, 10);
+	clist*                  gossip_headers = clist_new();
 
 	if (helper) { memset(helper, 0, sizeof(dc_e2ee_helper_t)); }
 
@@ -312,53 +635,21 @@ void dc_e2ee_encrypt(dc_context_t* context, const clist* recipients_addr,
 		goto cleanup;
 	}
 
-		/* init autocrypt header from db */
-		autocryptheader->prefer_encrypt = DC_PE_NOPREFERENCE;
-		if (dc_sqlite3_get_config_int(context->sql, "e2ee_enabled", DC_E2EE_DEFAULT_ENABLED)) {
-			autocryptheader->prefer_encrypt = DC_PE_MUTUAL;
-		}
-
-		autocryptheader->addr = dc_sqlite3_get_config(context->sql, "configured_addr", NULL);
-		if (autocryptheader->addr==NULL) {
+		/* init autocrypt header, the own address and keys are cached */
+		if (!load_self_aheader(context, autocryptheader, in_out_message/*only for random-seed*/)) {
 			goto cleanup;
 		}
 
-		if (!load_or_generate_self_public_key(context, autocryptheader->public_key, autocryptheader->addr, in_out_message/*only for random-seed*/)) {
-			goto cleanup;
-		}
-
-		/* load peerstate information etc. */
+		/* load peerstate information etc., this is also cached for the given recipients */
 		if (autocryptheader->prefer_encrypt==DC_PE_MUTUAL || e2ee_guaranteed)
 		{
-			do_encrypt = 1;
-			clistiter*      iter1;
-			for (iter1 = clist_begin(recipients_addr); iter1!=NULL ; iter1=clist_next(iter1)) {
-				const char* recipient_addr = clist_content(iter1);
-				dc_apeerstate_t* peerstate = dc_apeerstate_new(context);
-				dc_key_t* key_to_use = NULL;
-				if (strcasecmp(recipient_addr, autocryptheader->addr)==0)
-				{
-					; // encrypt to SELF, this key is added below
-				}
-				else if (dc_apeerstate_load_by_addr(peerstate, context->sql, recipient_addr)
-				      && (key_to_use=dc_apeerstate_peek_key(peerstate, min_verified))!=NULL
-				      && (peerstate->prefer_encrypt==DC_PE_MUTUAL || e2ee_guaranteed))
-				{
-					dc_keyring_add(keyring, key_to_use); /* we always add all recipients (even on IMAP upload) as otherwise forwarding may fail */
-					dc_array_add_ptr(peerstates, peerstate);
-				}
-				else
-				{
-					dc_apeerstate_unref(peerstate);
-					do_encrypt = 0;
-					break; /* if we cannot encrypt to a single recipient, we cannot encrypt the message at all */
-				}
-			}
+			do_encrypt = use_plan(context, recipients_addr, autocryptheader->addr, e2ee_guaranteed, min_verified,
+				keyring, do_gossip? gossip_headers : NULL);
 		}
 
 		if (do_encrypt) {
 			dc_keyring_add(keyring, autocryptheader->public_key); /* we always add ourself as otherwise forwarded messages are not readable */
-			if (!dc_key_load_self_private(sign_key, autocryptheader->addr, context->sql)) {
+			if (!load_self_private(context, sign_key, autocryptheader->addr)) {
 				do_encrypt = 0;
 			}
 		}
@@ -383,16 +674,11 @@ void dc_e2ee_encrypt(dc_context_t* context, const clist* recipients_addr,
 		struct mailmime* message_to_encrypt = mailmime_new(MAILMIME_MESSAGE, NULL, 0, mailmime_fields_new_empty(), /* mailmime_new_message_data() calls mailmime_fields_new_with_version() which would add the unwanted MIME-Version:-header */
 			mailmime_get_content_message(), NULL, NULL, NULL, NULL, imffields_encrypted, part_to_encrypt);
 
-		/* gossip keys */
-		if (do_gossip) {
-			int iCnt = dc_array_get_cnt(peerstates);
-			if (iCnt > 1) {
-				for (int i = 0; i < iCnt; i++) {
-					char* p = dc_apeerstate_render_gossip_header((dc_apeerstate_t*)dc_array_get_ptr(peerstates, i), min_verified);
-					if (p) {
-						mailimf_fields_add(imffields_encrypted, mailimf_field_new_custom(strdup("Autocrypt-Gossip"), p/*takes ownership*/));
-					}
-				}
+		/* gossip keys, see apply_plan() */
+		if (clist_count(gossip_headers) > 0) {
+			for (clistiter* iter=clist_begin(gossip_headers); iter!=NULL; iter=clist_next(iter)) {
+				mailimf_fields_add(imffields_encrypted, mailimf_field_new_custom(strdup("Autocrypt-Gossip"), (char*)clist_content(iter)/*takes ownership*/));
+				iter->data = NULL;
 			}
 		}
 
@@ -438,10 +724,14 @@ void dc_e2ee_encrypt(dc_context_t* context, const clist* recipients_addr,
 		}
 		//char* t1=dc_null_terminate(plain->str,plain->len);printf("PLAIN:\n%s\n",t1);free(t1); // DEBUG OUTPUT
 
+		uint64_t stats_start = dc_stats_now();
 		if (!dc_pgp_pk_encrypt(context, plain->str, plain->len, keyring, sign_key, 1/*use_armor*/, (void**)&ctext, &ctext_bytes)) {
 			goto cleanup;
 		}
+		dc_stats_add(context, DC_STATS_PGP_ENCRYPT, stats_start);
 		helper->cdata_to_free = ctext;
+		mmap_string_free(plain); /* not needed any longer, free before the message is rendered */
+		plain = NULL;
 		//char* t2=dc_null_terminate(ctext,ctext_bytes);printf("ENCRYPTED:\n%s\n",t2);free(t2); // DEBUG OUTPUT
 
 		/* create MIME-structure that will contain the encrypted text */
@@ -474,12 +764,18 @@ void dc_e2ee_encrypt(dc_context_t* context, const clist* recipients_addr,
 
 cleanup:
 	dc_aheader_unref(autocryptheader);
-	dc_keyring_unref(keyring);
+	if (context && context->magic==DC_CONTEXT_MAGIC) {
+		E2EE_PLANS_LOCK
+			dc_keyring_unref(keyring); // the keys are shared with the cached plans
+		E2EE_PLANS_UNLOCK
+	}
+	else {
+		dc_keyring_unref(keyring);
+	}
 	dc_key_unref(sign_key);
 	if (plain) { mmap_string_free(plain); }
-
-	for (int i=dc_array_get_cnt(peerstates)-1; i>=0; i--) { dc_apeerstate_unref((dc_apeerstate_t*)dc_array_get_ptr(peerstates, i)); }
-	dc_array_unref(peerstates);
+	clist_free_content(gossip_headers);
+	clist_free(gossip_headers);
 }
 
 
@@ -583,12 +879,9 @@ static int decrypt_part(dc_context_t*       context,
 	}
 	else
 	{
-		int r;
-		size_t current_index = 0;
-		r = mailmime_part_parse(mime_data->dt_data.dt_text.dt_data, mime_data->dt_data.dt_text.dt_length,
-			&current_index, mime_transfer_encoding,
-			&transfer_decoding_buffer, &decoded_data_bytes);
-		if (r!=MAILIMF_NO_ERROR || transfer_decoding_buffer==NULL || decoded_data_bytes <= 0) {
+		if (!dc_transfer_decode(mime_data->dt_data.dt_text.dt_data, mime_data->dt_data.dt_text.dt_length,
+		        mime_transfer_encoding, &transfer_decoding_buffer, &decoded_data_bytes)
+		 || transfer_decoding_buffer==NULL || decoded_data_bytes <= 0) {
 			goto cleanup;
 		}
 		decoded_data = transfer_decoding_buffer;
@@ -602,10 +895,12 @@ static int decrypt_part(dc_context_t*       context,
 	dc_hash_t* add_signatures = dc_hash_cnt(ret_valid_signatures)<=0?
 		ret_valid_signatures : NULL; /*if we already have fingerprints, do not add more; this ensures, only the fingerprints from the outer-most part are collected */
 
+	uint64_t stats_start = dc_stats_now();
 	if (!dc_pgp_pk_decrypt(context, decoded_data, decoded_data_bytes, private_keyring, public_keyring_for_validate, 1, &plain_buf, &plain_bytes, add_signatures)
 	 || plain_buf==NULL || plain_bytes<=0) {
 		goto cleanup;
 	}
+	dc_stats_add(context, DC_STATS_PGP_DECRYPT, stats_start);
 
 	//{char* t1=dc_null_terminate(plain_buf,plain_bytes);printf("\n**********\n%s\n**********\n",t1);free(t1);}
 
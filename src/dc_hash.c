@@ -8,19 +8,17 @@
 
 
 /*
-** Based upon hash.c from sqlite which author disclaims copyright to this source code. In place of
+** The API is based upon hash.c from sqlite which author disclaims copyright to this source code. In place of
 ** a legal notice, here is a blessing:
 **
 ** May you do good and not evil.
 ** May you find forgiveness for yourself and forgive others.
 ** May you share freely, never taking more than you give.
+**
+** Other than the original, the table uses open addressing with linear probing
+** and the keys are hashed by the wyhash algorithm of Wang Yi, which was released
+** into the public domain.
 */
-#define Addr(X)  ((uintptr_t)X)
-
-static void*    sjhashMalloc(long bytes) { void* p=malloc(bytes); if (p) memset(p, 0, bytes); return p; }
-#define         sjhashMallocRaw(a) malloc((a))
-#define         sjhashFree(a) free((a))
-
 
 
 /* An array to map all upper-case characters into their corresponding
@@ -45,339 +43,317 @@ static const unsigned char sjhashUpperToLower[] = {
 };
 
 
-
-/* Some systems have stricmp().  Others have strcasecmp().  Because
- * there is no consistency, we will define our own.
+/* Compare N bytes case-insensitively, returns true if they are equal.
+ * Keys mostly match with the same case, so try memcmp() first.
  */
-static int sjhashStrNICmp(const char *zLeft, const char *zRight, int N)
+static int sjhashStrNEqual(const char *zLeft, const char *zRight, int N)
 {
-	register unsigned char *a, *b;
-	a = (unsigned char *)zLeft;
-	b = (unsigned char *)zRight;
-	while (N-- > 0 && *a!=0 && sjhashUpperToLower[*a]==sjhashUpperToLower[*b]) { a++; b++; }
-	return N<0 ? 0 : sjhashUpperToLower[*a] - sjhashUpperToLower[*b];
-}
-
-
-
-/* This function computes a hash on the name of a keyword.
- * Case is not significant.
- */
-static int sjhashNoCase(const char *z, int n)
-{
-	int h = 0;
-	if (n<=0) n = strlen(z);
-	while (n > 0) {
-		h = (h<<3) ^ h ^ sjhashUpperToLower[(unsigned char)*z++];
-		n--;
+	const unsigned char *a = (const unsigned char *)zLeft;
+	const unsigned char *b = (const unsigned char *)zRight;
+	if (N<=0 || memcmp(a, b, N)==0) return 1;
+	while (N-- > 0) {
+		if (sjhashUpperToLower[*a++]!=sjhashUpperToLower[*b++]) return 0;
 	}
-	return h & 0x7fffffff;
+	return 1;
 }
 
 
 
-/* Turn bulk memory into a hash table object by initializing the
- * fields of the Hash structure.
- *
- * "pNew" is a pointer to the hash table that is to be initialized.
- * keyClass is one of the constants SJHASH_INT, SJHASH_POINTER,
- * SJHASH_BINARY, or SJHASH_STRING.  The value of keyClass
- * determines what kind of key the hash table will use.  "copyKey" is
- * true if the hash table should make its own private copy of keys and
- * false if it should just use the supplied pointer.  CopyKey only makes
- * sense for SJHASH_STRING and SJHASH_BINARY and is ignored
- * for other key classes.
+/* The hash function: wyhash, as a 64 bit hash on all platforms;
+ * for DC_HASH_STRING, ASCII upper-case characters are folded
+ * to lower-case while reading.
  */
-void dc_hash_init(dc_hash_t *pNew, int keyClass, int copyKey)
-{
-	assert( pNew!=0);
-	assert( keyClass>=DC_HASH_INT && keyClass<=DC_HASH_BINARY);
-	pNew->keyClass = keyClass;
-
-	if (keyClass==DC_HASH_POINTER || keyClass==DC_HASH_INT) copyKey = 0;
-
-	pNew->copyKey = copyKey;
-	pNew->first = 0;
-	pNew->count = 0;
-	pNew->htsize = 0;
-	pNew->ht = 0;
-}
+static const uint64_t wySecret[4] = { 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull };
 
-
-
-/* Remove all entries from a hash table.  Reclaim all memory.
- * Call this routine to delete a hash table or to reset a hash table
- * to the empty state.
- */
-void dc_hash_clear(dc_hash_t *pH)
+static inline void wyMum(uint64_t *A, uint64_t *B)
 {
-	dc_hashelem_t *elem;         /* For looping over all elements of the table */
-
-	if (pH == NULL) {
-		return;
-	}
-
-	elem = pH->first;
-	pH->first = 0;
-	if (pH->ht) sjhashFree(pH->ht);
-	pH->ht = 0;
-	pH->htsize = 0;
-	while (elem)
-	{
-		dc_hashelem_t *next_elem = elem->next;
-		if (pH->copyKey && elem->pKey)
-		{
-			sjhashFree(elem->pKey);
-		}
-		sjhashFree(elem);
-		elem = next_elem;
-	}
-	pH->count = 0;
+#ifdef __SIZEOF_INT128__
+	__uint128_t r = *A;
+	r *= *B;
+	*A = (uint64_t)r;
+	*B = (uint64_t)(r>>64);
+#else
+	uint64_t ha = *A>>32, hb = *B>>32, la = (uint32_t)*A, lb = (uint32_t)*B;
+	uint64_t rh = ha*hb, rm0 = ha*lb, rm1 = hb*la, rl = la*lb;
+	uint64_t t = rl+(rm0<<32), c = t<rl, lo = t+(rm1<<32);
+	c += lo<t;
+	*A = lo;
+	*B = rh+(rm0>>32)+(rm1>>32)+c;
+#endif
 }
 
-
-
-/* Hash and comparison functions when the mode is SJHASH_INT
- */
-static int intHash(const void *pKey, int nKey)
+static inline uint64_t wyMix(uint64_t A, uint64_t B)
 {
-	return nKey ^ (nKey<<8) ^ (nKey>>8);
+	wyMum(&A, &B);
+	return A^B;
 }
 
-static int intCompare(const void *pKey1, int n1, const void *pKey2, int n2)
+static inline uint64_t foldLower64(uint64_t x)
 {
-	return n2 - n1;
+	/* add 0x20 to all bytes in the range 'A'..'Z', without branches */
+	uint64_t a = x & 0x7f7f7f7f7f7f7f7full;
+	uint64_t ge_A = a + 0x3f3f3f3f3f3f3f3full;
+	uint64_t gt_Z = a + 0x2525252525252525ull;
+	return x | (((ge_A & ~gt_Z & ~x) & 0x8080808080808080ull) >> 2);
 }
 
-
-
-/* Hash and comparison functions when the mode is SJHASH_POINTER
- */
-static int ptrHash(const void *pKey, int nKey)
+static inline uint64_t wyRead8(const unsigned char *p, int fold)
 {
-	uintptr_t x = Addr(pKey);
-	return x ^ (x<<8) ^ (x>>8);
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return fold? foldLower64(v) : v;
 }
 
-static int ptrCompare(const void *pKey1, int n1, const void *pKey2, int n2)
+static inline uint64_t wyRead4(const unsigned char *p, int fold)
 {
-	if (pKey1==pKey2) return 0;
-	if (pKey1<pKey2) return -1;
-	return 1;
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return fold? (uint32_t)foldLower64(v) : v;
 }
 
-
-
-/* Hash and comparison functions when the mode is SJHASH_STRING
- */
-static int strHash(const void *pKey, int nKey)
+static inline uint64_t wyRead3(const unsigned char *p, size_t k, int fold)
 {
-	return sjhashNoCase((const char*)pKey, nKey);
+	if (fold) {
+		return (((uint64_t)sjhashUpperToLower[p[0]])<<16) | (((uint64_t)sjhashUpperToLower[p[k>>1]])<<8) | sjhashUpperToLower[p[k-1]];
+	}
+	return (((uint64_t)p[0])<<16) | (((uint64_t)p[k>>1])<<8) | p[k-1];
 }
 
-static int strCompare(const void *pKey1, int n1, const void *pKey2, int n2)
+static inline uint64_t wyHash(const void *key, size_t len, int fold)
 {
-	if (n1!=n2) return 1;
-	return sjhashStrNICmp((const char*)pKey1,(const char*)pKey2,n1);
-}
+	const unsigned char *p = (const unsigned char *)key;
+	uint64_t seed = wyMix(wySecret[0], wySecret[1]);
+	uint64_t a, b;
+
+	if (len<=16) {
+		if (len>=4) {
+			a = (wyRead4(p, fold)<<32) | wyRead4(p+((len>>3)<<2), fold);
+			b = (wyRead4(p+len-4, fold)<<32) | wyRead4(p+len-4-((len>>3)<<2), fold);
+		}
+		else if (len>0) {
+			a = wyRead3(p, len, fold);
+			b = 0;
+		}
+		else {
+			a = b = 0;
+		}
+	}
+	else {
+		size_t i = len;
+		if (i>48) {
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = wyMix(wyRead8(p, fold)^wySecret[1], wyRead8(p+8, fold)^seed);
+				see1 = wyMix(wyRead8(p+16, fold)^wySecret[2], wyRead8(p+24, fold)^see1);
+				see2 = wyMix(wyRead8(p+32, fold)^wySecret[3], wyRead8(p+40, fold)^see2);
+				p += 48;
+				i -= 48;
+			} while (i>48);
+			seed ^= see1^see2;
+		}
+		while (i>16) {
+			seed = wyMix(wyRead8(p, fold)^wySecret[1], wyRead8(p+8, fold)^seed);
+			i -= 16;
+			p += 16;
+		}
+		a = wyRead8(p+i-16, fold);
+		b = wyRead8(p+i-8, fold);
+	}
 
+	a ^= wySecret[1];
+	b ^= seed;
+	wyMum(&a, &b);
+	return wyMix(a^wySecret[0]^len, b^wySecret[1]);
+}
 
 
-/* Hash and comparison functions when the mode is SJHASH_BINARY
+/* Compute the hash of a key, depending on the key class.
  */
-static int binHash(const void *pKey, int nKey)
+static uint32_t hashKey(int keyClass, const void *pKey, int nKey)
 {
-	int h = 0;
-	const char *z = (const char *)pKey;
-	while (nKey-- > 0)
+	switch (keyClass)
 	{
-		h = (h<<3) ^ h ^ *(z++);
+		case DC_HASH_INT:     return (uint32_t)wyMix(((uint64_t)(unsigned int)nKey)^wySecret[0], wySecret[1]);
+		case DC_HASH_POINTER: return (uint32_t)wyMix(((uint64_t)(uintptr_t)pKey)^wySecret[0], wySecret[1]);
+		case DC_HASH_STRING:  return (uint32_t)wyHash(pKey, nKey>0? nKey : 0, 1);
+		default:              return (uint32_t)wyHash(pKey, nKey>0? nKey : 0, 0);
 	}
-	return h & 0x7fffffff;
-}
-
-static int binCompare(const void *pKey1, int n1, const void *pKey2, int n2)
-{
-	if (n1!=n2) return 1;
-	return memcmp(pKey1,pKey2,n1);
 }
 
 
-
-/* Return a pointer to the appropriate hash function given the key class.
- *
- * About the syntax:
- * The name of the function is "hashFunction".  The function takes a
- * single parameter "keyClass".  The return value of hashFunction()
- * is a pointer to another function.  Specifically, the return value
- * of hashFunction() is a pointer to a function that takes two parameters
- * with types "const void*" and "int" and returns an "int".
+/* Check if the key of an element matches the given key.
  */
-static int (*hashFunction(int keyClass))(const void*,int)
+static int keyEquals(const dc_hash_t *pH, const dc_hashelem_t *elem, const void *pKey, int nKey)
 {
-	switch (keyClass)
+	switch (pH->keyClass)
 	{
-		case DC_HASH_INT:    return &intHash;
-		case DC_HASH_POINTER:return &ptrHash;
-		case DC_HASH_STRING: return &strHash;
-		case DC_HASH_BINARY: return &binHash;;
-		default:            break;
+		case DC_HASH_INT:     return elem->nKey==nKey;
+		case DC_HASH_POINTER: return elem->key.ptr==pKey;
+		case DC_HASH_STRING:  return elem->nKey==nKey && sjhashStrNEqual(dc_hash_key(elem), pKey, nKey);
+		default:              return elem->nKey==nKey && (nKey<=0 || memcmp(dc_hash_key(elem), pKey, nKey)==0);
 	}
-	return 0;
 }
 
 
 
-/* Return a pointer to the appropriate hash function given the key class.
+/* Turn bulk memory into a hash table object by initializing the
+ * fields of the Hash structure.
+ *
+ * "pNew" is a pointer to the hash table that is to be initialized.
+ * keyClass is one of the constants DC_HASH_INT, DC_HASH_POINTER,
+ * DC_HASH_BINARY, or DC_HASH_STRING.  The value of keyClass
+ * determines what kind of key the hash table will use.  "copyKey" is
+ * true if the hash table should make its own private copy of keys and
+ * false if it should just use the supplied pointer.  CopyKey only makes
+ * sense for DC_HASH_STRING and DC_HASH_BINARY and is ignored
+ * for other key classes.
  */
-static int (*compareFunction(int keyClass))(const void*,int,const void*,int)
+void dc_hash_init(dc_hash_t *pNew, int keyClass, int copyKey)
 {
-	switch (keyClass)
-	{
-		case DC_HASH_INT:     return &intCompare;
-		case DC_HASH_POINTER: return &ptrCompare;
-		case DC_HASH_STRING:  return &strCompare;
-		case DC_HASH_BINARY:  return &binCompare;
-		default: break;
-	}
-	return 0;
+	assert( pNew!=0);
+	assert( keyClass>=DC_HASH_INT && keyClass<=DC_HASH_BINARY);
+	pNew->keyClass = keyClass;
+
+	if (keyClass==DC_HASH_POINTER || keyClass==DC_HASH_INT) copyKey = 0;
+
+	pNew->copyKey = copyKey;
+	pNew->count = 0;
+	pNew->alloc = 0;
+	pNew->elems = 0;
+	pNew->htsize = 0;
+	pNew->ht = 0;
 }
 
 
 
-/* Link an element into the hash table
+/* Remove all entries from a hash table.  Reclaim all memory.
+ * Call this routine to delete a hash table or to reset a hash table
+ * to the empty state.
  */
-static void insertElement(dc_hash_t *pH,           /* The complete hash table */
-                          struct _ht *pEntry,   /* The entry into which pNew is inserted */
-                          dc_hashelem_t *pNew)     /* The element to be inserted */
+void dc_hash_clear(dc_hash_t *pH)
 {
-	dc_hashelem_t *pHead; /* First element already in pEntry */
-	pHead = pEntry->chain;
-	if (pHead)
-	{
-		pNew->next = pHead;
-		pNew->prev = pHead->prev;
-		if (pHead->prev) { pHead->prev->next = pNew; }
-		else             { pH->first = pNew; }
-		pHead->prev = pNew;
+	if (pH == NULL) {
+		return;
 	}
-	else
+
+	if (pH->copyKey)
 	{
-		pNew->next = pH->first;
-		if (pH->first) { pH->first->prev = pNew; }
-		pNew->prev = 0;
-		pH->first = pNew;
+		for (int i = 0; i < pH->count; i++) {
+			if (!pH->elems[i].inlineKey) {
+				free(pH->elems[i].key.ptr);
+			}
+		}
 	}
-	pEntry->count++;
-	pEntry->chain = pNew;
+
+	free(pH->elems);
+	free(pH->ht);
+	pH->elems = 0;
+	pH->ht = 0;
+	pH->alloc = 0;
+	pH->htsize = 0;
+	pH->count = 0;
 }
 
 
 
-/* Resize the hash table so that it cantains "new_size" buckets.
- * "new_size" must be a power of 2.  The hash table might fail
- * to resize if sjhashMalloc() fails.
+/* Resize the hash table so that it contains "new_size" slots.
+ * "new_size" must be a power of 2.  Returns 0 and leaves the table
+ * unchanged if the allocation fails.
  */
-static void rehash(dc_hash_t *pH, int new_size)
+static int rehash(dc_hash_t *pH, int new_size)
 {
-	struct _ht *new_ht;            /* The new hash table */
-	dc_hashelem_t *elem, *next_elem;    /* For looping over existing elements */
-	int (*xHash)(const void*,int); /* The hash function */
+	struct _ht *new_ht;
+	uint32_t mask = new_size-1;
 
 	assert( (new_size & (new_size-1))==0);
-	new_ht = (struct _ht *)sjhashMalloc( new_size*sizeof(struct _ht));
-	if (new_ht==0) return;
-	if (pH->ht) sjhashFree(pH->ht);
-	pH->ht = new_ht;
-	pH->htsize = new_size;
-	xHash = hashFunction(pH->keyClass);
-	for(elem=pH->first, pH->first=0; elem; elem = next_elem)
+	new_ht = (struct _ht *)calloc(new_size, sizeof(struct _ht));
+	if (new_ht==0) return 0;
+
+	for (int i = 0; i < pH->count; i++)
 	{
-		int h = (*xHash)(elem->pKey, elem->nKey) & (new_size-1);
-		next_elem = elem->next;
-		insertElement(pH, &new_ht[h], elem);
+		uint32_t h = pH->elems[i].hash & mask;
+		while (new_ht[h].idx) {
+			h = (h+1) & mask;
+		}
+		new_ht[h].hash = pH->elems[i].hash;
+		new_ht[h].idx = i+1;
 	}
+
+	free(pH->ht);
+	pH->ht = new_ht;
+	pH->htsize = new_size;
+	return 1;
 }
 
 
 
-/* This function (for internal use only) locates an element in an
- * hash table that matches the given key.  The hash for this key has
- * already been computed and is passed as the 4th parameter.
+/* This function (for internal use only) locates the slot of the hash table
+ * referring to the element that matches the given key.  The hash for this key
+ * has already been computed and is passed as the 4th parameter.
+ * Returns -1 if there is no such element.
  */
-static dc_hashelem_t *findElementGivenHash(const dc_hash_t *pH,   /* The pH to be searched */
-                                        const void *pKey,   /* The key we are searching for */
-                                        int nKey,
-                                        int h)              /* The hash for this key. */
+static int findSlotGivenHash(const dc_hash_t *pH, const void *pKey, int nKey, uint32_t hash)
 {
-	dc_hashelem_t *elem; /* Used to loop thru the element list */
-	int count; /* Number of elements left to test */
-	int (*xCompare)(const void*,int,const void*,int);  /* comparison function */
+	uint32_t mask, h;
+
+	if (pH->htsize==0) return -1;
 
-	if (pH->ht)
+	mask = pH->htsize-1;
+	for (h = hash & mask; pH->ht[h].idx; h = (h+1) & mask)
 	{
-		struct _ht *pEntry = &pH->ht[h];
-		elem = pEntry->chain;
-		count = pEntry->count;
-		xCompare = compareFunction(pH->keyClass);
-		while (count-- && elem)
+		if (pH->ht[h].hash==hash
+		 && keyEquals(pH, &pH->elems[pH->ht[h].idx-1], pKey, nKey))
 		{
-			if ((*xCompare)(elem->pKey,elem->nKey,pKey,nKey)==0)
-			{
-				return elem;
-			}
-			elem = elem->next;
+			return h;
 		}
 	}
-	return 0;
+	return -1;
 }
 
 
 
-/* Remove a single entry from the hash table given a pointer to that
- * element and a hash on the element's key.
+/* Remove a single entry from the hash table given the slot referring to it.
+ * The following slots are shifted back so that no tombstones are needed,
+ * the last element is moved to the place of the removed one.
  */
-static void removeElementGivenHash(dc_hash_t *pH,         /* The pH containing "elem" */
-                                   dc_hashelem_t* elem,   /* The element to be removed from the pH */
-                                   int h)              /* Hash value for the element */
+static void removeSlot(dc_hash_t *pH, uint32_t slot)
 {
-	struct _ht *pEntry;
+	uint32_t mask = pH->htsize-1;
+	uint32_t e = pH->ht[slot].idx-1;
+	uint32_t last = pH->count-1;
+	uint32_t i = slot, j = slot;
 
-	if (elem->prev)
+	if (pH->copyKey && !pH->elems[e].inlineKey)
 	{
-		elem->prev->next = elem->next;
+		free(pH->elems[e].key.ptr);
 	}
-	else
-	{
-		pH->first = elem->next;
-	}
-
-	if (elem->next)
-	{
-		elem->next->prev = elem->prev;
-	}
-
-	pEntry = &pH->ht[h];
 
-	if (pEntry->chain==elem)
+	for (;;)
 	{
-		pEntry->chain = elem->next;
-	}
-
-	pEntry->count--;
-
-	if (pEntry->count<=0)
-	{
-		pEntry->chain = 0;
+		j = (j+1) & mask;
+		if (pH->ht[j].idx==0) break;
+		uint32_t k = pH->ht[j].hash & mask;
+		if (((j-k) & mask) >= ((j-i) & mask)) {
+			pH->ht[i] = pH->ht[j];
+			i = j;
+		}
 	}
+	pH->ht[i].idx = 0;
 
-	if (pH->copyKey && elem->pKey)
+	if (e!=last)
 	{
-		sjhashFree(elem->pKey);
+		pH->elems[e] = pH->elems[last];
+		pH->elems[e].last = 0;
+		for (j = pH->elems[e].hash & mask; pH->ht[j].idx!=last+1; j = (j+1) & mask) {
+			;
+		}
+		pH->ht[j].idx = e+1;
 	}
 
-	sjhashFree( elem);
 	pH->count--;
+	if (pH->count > 0) {
+		pH->elems[pH->count-1].last = 1;
+	}
 }
 
 
@@ -388,17 +364,11 @@ static void removeElementGivenHash(dc_hash_t *pH,         /* The pH containing "
  */
 void* dc_hash_find(const dc_hash_t *pH, const void *pKey, int nKey)
 {
-	int h;             /* A hash on key */
-	dc_hashelem_t *elem;    /* The element that matches key */
-	int (*xHash)(const void*,int);  /* The hash function */
-
-	if (pH==0 || pH->ht==0) return 0;
-	xHash = hashFunction(pH->keyClass);
-	assert( xHash!=0);
-	h = (*xHash)(pKey,nKey);
-	assert( (pH->htsize & (pH->htsize-1))==0);
-	elem = findElementGivenHash(pH,pKey,nKey, h & (pH->htsize-1));
-	return elem ? elem->data : 0;
+	int slot;
+
+	if (pH==0 || pH->htsize==0) return 0;
+	slot = findSlotGivenHash(pH, pKey, nKey, hashKey(pH->keyClass, pKey, nKey));
+	return slot>=0 ? pH->elems[pH->ht[slot].idx-1].data : 0;
 }
 
 
@@ -417,29 +387,27 @@ void* dc_hash_find(const dc_hash_t *pH, const void *pKey, int nKey)
  *
  * If the "data" parameter to this function is NULL, then the
  * element corresponding to "key" is removed from the hash table.
+ *
+ * Inserting or removing elements may move other elements,
+ * pointers to elements are invalid afterwards.
  */
 void* dc_hash_insert(dc_hash_t *pH, const void *pKey, int nKey, void *data)
 {
-	int hraw;                       /* Raw hash value of the key */
-	int h;                          /* the hash of the key modulo hash table size */
-	dc_hashelem_t *elem;               /* Used to loop thru the element list */
-	dc_hashelem_t *new_elem;           /* New element added to the pH */
-	int (*xHash)(const void*,int);  /* The hash function */
+	uint32_t       hash;
+	int            slot;
+	dc_hashelem_t* new_elem;
 
 	assert( pH!=0);
-	xHash = hashFunction(pH->keyClass);
-	assert( xHash!=0);
-	hraw = (*xHash)(pKey, nKey);
-	assert( (pH->htsize & (pH->htsize-1))==0);
-	h = hraw & (pH->htsize-1);
-	elem = findElementGivenHash(pH,pKey,nKey,h);
-
-	if (elem)
+	hash = hashKey(pH->keyClass, pKey, nKey);
+	slot = findSlotGivenHash(pH, pKey, nKey, hash);
+
+	if (slot>=0)
 	{
+		dc_hashelem_t *elem = &pH->elems[pH->ht[slot].idx-1];
 		void *old_data = elem->data;
 		if (data==0)
 		{
-			removeElementGivenHash(pH,elem,h);
+			removeSlot(pH, slot);
 		}
 		else
 		{
@@ -450,49 +418,55 @@ void* dc_hash_insert(dc_hash_t *pH, const void *pKey, int nKey, void *data)
 
 	if (data==0) return 0;
 
-	new_elem = (dc_hashelem_t*)sjhashMalloc( sizeof(dc_hashelem_t));
+	/* keep the load factor below 3/4; the initial sizes are enough for
+	 * the header of most messages, so that there is no need to grow */
+	if ((pH->count+1)*4 > pH->htsize*3)
+	{
+		if (!rehash(pH, pH->htsize? pH->htsize*2 : 32)) return data;
+	}
 
-	if (new_elem==0) return data;
+	if (pH->count==pH->alloc)
+	{
+		int new_alloc = pH->alloc? pH->alloc*2 : 16;
+		dc_hashelem_t *new_elems = realloc(pH->elems, new_alloc*sizeof(dc_hashelem_t));
+		if (new_elems==0) return data;
+		pH->elems = new_elems;
+		pH->alloc = new_alloc;
+	}
 
-	if (pH->copyKey && pKey!=0)
+	new_elem = &pH->elems[pH->count];
+	if (pH->copyKey && pKey!=0 && nKey<=DC_HASH_INLINE_KEY)
 	{
-		new_elem->pKey = sjhashMallocRaw( nKey);
-		if (new_elem->pKey==0)
-		{
-			sjhashFree(new_elem);
-			return data;
-		}
-		memcpy((void*)new_elem->pKey, pKey, nKey);
+		if (nKey>0) memcpy(new_elem->key.buf, pKey, nKey);
+		new_elem->inlineKey = 1;
+	}
+	else if (pH->copyKey && pKey!=0)
+	{
+		new_elem->key.ptr = malloc(nKey);
+		if (new_elem->key.ptr==0) return data;
+		memcpy(new_elem->key.ptr, pKey, nKey);
+		new_elem->inlineKey = 0;
 	}
 	else
 	{
-		new_elem->pKey = (void*)pKey;
+		new_elem->key.ptr = (void*)pKey;
+		new_elem->inlineKey = 0;
 	}
-
+	new_elem->data = data;
 	new_elem->nKey = nKey;
-	pH->count++;
-
-	if (pH->htsize==0)
-	{
-		rehash(pH,8);
-		if (pH->htsize==0)
-		{
-			pH->count = 0;
-			sjhashFree(new_elem);
-			return data;
-		}
+	new_elem->hash = hash;
+	new_elem->last = 1;
+	if (pH->count > 0) {
+		pH->elems[pH->count-1].last = 0;
 	}
+	pH->count++;
 
-	if (pH->count > pH->htsize)
-	{
-		rehash(pH,pH->htsize*2);
+	uint32_t mask = pH->htsize-1;
+	uint32_t h = hash & mask;
+	while (pH->ht[h].idx) {
+		h = (h+1) & mask;
 	}
-
-	assert( pH->htsize>0);
-	assert( (pH->htsize & (pH->htsize-1))==0);
-	h = hraw & (pH->htsize-1);
-	insertElement(pH, &pH->ht[h], new_elem);
-	new_elem->data = data;
+	pH->ht[h].hash = hash;
+	pH->ht[h].idx = pH->count;
 	return 0;
 }
-
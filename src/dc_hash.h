@@ -6,6 +6,9 @@ extern "C"
 #endif
 
 
+#include <stdint.h>
+
+
 /* Forward declarations of structures.
  */
 typedef struct _dc_hash       dc_hash_t;
@@ -19,34 +22,52 @@ typedef struct _dc_hashelem   dc_hashelem_t;
  * However, many of the "procedures" and "functions" for modifying and
  * accessing this structure are really macros, so we can't really make
  * this structure opaque.
+ *
+ * The elements are stored densely in an array, the hash table itself
+ * uses open addressing with linear probing and refers to the elements
+ * by their index.
  */
 struct _dc_hash
 {
-	char              keyClass;       /* SJHASH_INT, _POINTER, _STRING, _BINARY */
+	char              keyClass;       /* DC_HASH_INT, _POINTER, _STRING, _BINARY */
 	char              copyKey;        /* True if copy of key made on insert */
 	int               count;          /* Number of entries in this table */
-	dc_hashelem_t     *first;         /* The first element of the array */
-	int               htsize;         /* Number of buckets in the hash table */
+	int               alloc;          /* Number of allocated entries in elems */
+	dc_hashelem_t     *elems;         /* The elements, elems[0] to elems[count-1] are used */
+	int               htsize;         /* Number of slots in the hash table, 0 or a power of 2 */
 	struct _ht
 	{	/* the hash table */
-		int           count;          /* Number of entries with this hash */
-		dc_hashelem_t *chain;         /* Pointer to first entry with this hash */
+		uint32_t      hash;           /* The hash of the key, to skip most comparisons */
+		uint32_t      idx;            /* Index of the element plus 1, 0 for unused slots */
 	} *ht;
 };
 
 
+/* Keys copied on insert that are not longer than this are stored inline
+ * in the element.  The size is chosen so that an element takes 64 bytes
+ * on 64 bit systems; fingerprints and most addresses fit.
+ */
+#define DC_HASH_INLINE_KEY 40
+
+
 /* Each element in the hash table is an instance of the following
- * structure.  All elements are stored on a single doubly-linked list.
+ * structure.  All elements are stored in a single array;
+ * inserting or removing elements may move the other elements.
  *
  * Again, this structure is intended to be opaque, but it can't really
  * be opaque because it is used by macros.
  */
 struct _dc_hashelem
 {
-	dc_hashelem_t     *next, *prev;   /* Next and previous elements in the table */
 	void*             data;           /* Data associated with this element */
-	void*             pKey;           /* Key associated with this element */
 	int               nKey;           /* Key associated with this element */
+	uint32_t          hash;           /* The hash of the key */
+	char              inlineKey;      /* True if the key is stored in key.buf */
+	char              last;           /* True for the last element of the array */
+	union {
+		void*         ptr;            /* Key associated with this element */
+		char          buf[DC_HASH_INLINE_KEY];
+	} key;
 };
 
 
@@ -95,18 +116,20 @@ void    dc_hash_clear    (dc_hash_t*);
  * Macros for looping over all elements of a hash table.  The idiom is
  * like this:
  *
- *   SjHash h;
- *   SjHashElem *p;
+ *   dc_hash_t h;
+ *   dc_hashelem_t *p;
  *   ...
  *   for(p=dc_hash_first(&h); p; p=dc_hash_next(p)){
  *     SomeStructure *pData = dc_hash_data(p);
  *     // do something with pData
  *   }
+ *
+ * The hash table must not be modified while looping.
  */
-#define dc_hash_first(H)      ((H)->first)
-#define dc_hash_next(E)       ((E)->next)
+#define dc_hash_first(H)      ((H)->count? (H)->elems : NULL)
+#define dc_hash_next(E)       ((E)->last? NULL : (E)+1)
 #define dc_hash_data(E)       ((E)->data)
-#define dc_hash_key(E)        ((E)->pKey)
+#define dc_hash_key(E)        ((E)->inlineKey? (void*)(E)->key.buf : (E)->key.ptr)
 #define dc_hash_keysize(E)    ((E)->nKey)
 
 
@@ -111,6 +111,15 @@ static void set_config_lastseenuid(dc_imap_t* imap, const char* folder, uint32_t
 }
 
 
+static int get_config_int(dc_imap_t* imap, const char* key, int def)
+{
+	char* str = imap->get_config(imap, key, NULL);
+	int   ret = (str && str[0])? atoi(str) : def;
+	free(str);
+	return ret;
+}
+
+
 /*******************************************************************************
  * Handle folders
  ******************************************************************************/
@@ -145,7 +154,9 @@ static int select_folder(dc_imap_t* imap, const char* folder /*may be NULL*/)
 
 	/* select new folder */
 	if (folder) {
+		uint64_t stats_start = dc_stats_now();
 		int r = mailimap_select(imap->etpan, folder);
+		dc_stats_add(imap->context, DC_STATS_IMAP_SELECT, stats_start);
 		if (dc_imap_is_error(imap, r) || imap->etpan->imap_selection_info==NULL) {
 			dc_log_info(imap->context, 0, "Cannot select folder; code=%i, imap_response=%s", r,
 				imap->etpan->imap_response? imap->etpan->imap_response : "<none>");
@@ -344,9 +355,11 @@ static int fetch_single_msg(dc_imap_t* imap, const char* folder, uint32_t server
 
 
 	{
+		uint64_t stats_start = dc_stats_now();
 		struct mailimap_set* set = mailimap_set_new_single(server_uid);
 			r = mailimap_uid_fetch(imap->etpan, set, imap->fetch_type_body, &fetch_result);
 		FREE_SET(set);
+		dc_stats_add(imap->context, DC_STATS_IMAP_FETCH, stats_start);
 	}
 
 	if (dc_imap_is_error(imap, r) || fetch_result==NULL) {
@@ -378,6 +391,91 @@ cleanup:
 }
 
 
+static uint32_t get_catchup_lastseenuid(dc_imap_t* imap, const char* folder, uint32_t largest_uid)
+{
+	/* On the first selection of a folder, we normally start with the largest UID and ignore the history.
+	If `imap_catchup_days` and/or `imap_catchup_msgs` are set, we return a smaller UID instead,
+	so that recent messages are downloaded through the normal receive path.
+	If both are set, the days define the window and the number of messages limits it. */
+	uint32_t             lastseenuid = 0;
+	int                  catchup_days = get_config_int(imap, "imap_catchup_days", 0);
+	int                  catchup_msgs = get_config_int(imap, "imap_catchup_msgs", 0);
+	int                  r = 0;
+	clist*               search_result = NULL;
+	clist*               fetch_result = NULL;
+	struct mailimap_set* set = NULL;
+	clistiter*           cur = NULL;
+
+	if (catchup_days<=0 && catchup_msgs<=0) {
+		return largest_uid;
+	}
+
+	if (catchup_days>0)
+	{
+		/* `UID SEARCH SINCE <date>`, SINCE ignores the time and the timezone, so we may get one day more */
+		time_t     since = time(NULL) - catchup_days*24*60*60;
+		struct tm  since_tm;
+		memset(&since_tm, 0, sizeof(struct tm));
+		gmtime_r(&since, &since_tm);
+
+		struct mailimap_search_key* key = mailimap_search_key_new_since(
+			mailimap_date_new(since_tm.tm_mday, since_tm.tm_mon+1, since_tm.tm_year+1900));
+			r = mailimap_uid_search(imap->etpan, NULL, key, &search_result);
+		mailimap_search_key_free(key);
+
+		if (dc_imap_is_error(imap, r) || search_result==NULL) {
+			search_result = NULL;
+			dc_log_warning(imap->context, 0, "Cannot search history of folder \"%s\", no catch-up.", folder);
+			lastseenuid = largest_uid;
+			goto cleanup;
+		}
+
+		lastseenuid = largest_uid;
+		for (cur = clist_begin(search_result); cur!=NULL; cur = clist_next(cur)) {
+			uint32_t uid = *((uint32_t*)clist_content(cur));
+			if (uid > 0 && uid-1 < lastseenuid) {
+				lastseenuid = uid-1;
+			}
+		}
+	}
+
+	if (catchup_msgs>0
+	 && imap->etpan->imap_selection_info->sel_has_exists
+	 && imap->etpan->imap_selection_info->sel_exists > (uint32_t)catchup_msgs)
+	{
+		/* `FETCH <exists-msgs+1> (UID)` gets the UID of the oldest message to catch up with */
+		set = mailimap_set_new_single(imap->etpan->imap_selection_info->sel_exists - catchup_msgs + 1);
+			r = mailimap_fetch(imap->etpan, set, imap->fetch_type_prefetch, &fetch_result);
+		FREE_SET(set);
+
+		uint32_t first_uid = 0;
+		if (!dc_imap_is_error(imap, r) && fetch_result && (cur=clist_begin(fetch_result))!=NULL) {
+			first_uid = peek_uid((struct mailimap_msg_att*)clist_content(cur));
+		}
+
+		if (first_uid==0) {
+			dc_log_warning(imap->context, 0, "Cannot get UID to catch up with in folder \"%s\", no catch-up.", folder);
+			lastseenuid = largest_uid;
+			goto cleanup;
+		}
+
+		lastseenuid = DC_MAX(lastseenuid, first_uid-1);
+	}
+	else if (catchup_msgs>0 && !imap->etpan->imap_selection_info->sel_has_exists && catchup_days<=0)
+	{
+		/* without EXISTS, we do not know where to start; fetching the whole folder is not what the user wants */
+		lastseenuid = largest_uid;
+	}
+
+cleanup:
+	if (search_result) {
+		mailimap_search_result_free(search_result);
+	}
+	FREE_FETCH_LIST(fetch_result);
+	return DC_MIN(lastseenuid, largest_uid);
+}
+
+
 static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 {
 	int                  r;
@@ -389,6 +487,13 @@ static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 	size_t               read_errors = 0;
 	clistiter*           cur;
 	struct mailimap_set* set = NULL;
+	uint32_t             catchup_until_uid = 0;
+	int                  catchup_cnt = 0;
+	int                  catchup_done = 0;
+	int                  new_cnt = 0;
+	uint32_t*            new_uids = NULL;
+	char**               new_mids = NULL;
+	int*                 new_exists = NULL;
 
 	if (imap==NULL) {
 		goto cleanup;
@@ -461,6 +566,15 @@ static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 		if (uidvalidity > 0 && lastseenuid > 1) {
 			lastseenuid -= 1;
 		}
+		else if (uidvalidity==0) {
+			/* first selection of the folder, maybe download some history */
+			uint32_t catchup_lastseenuid = get_catchup_lastseenuid(imap, folder, lastseenuid);
+			if (catchup_lastseenuid < lastseenuid) {
+				dc_log_info(imap->context, 0, "Catching up with UIDs %i..%i in %s.", (int)catchup_lastseenuid+1, (int)lastseenuid, folder);
+				catchup_until_uid = lastseenuid;
+				lastseenuid = catchup_lastseenuid;
+			}
+		}
 
 		/* store calculated uidvalidity/lastseenuid */
 		uidvalidity = imap->etpan->imap_selection_info->sel_uidvalidity;
@@ -470,9 +584,11 @@ static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 
 	/* fetch messages with larger UID than the last one seen (`UID FETCH lastseenuid+1:*)`, see RFC 4549 */
 	/* CAVE: some servers return UID smaller or equal to the requested ones under some circumstances! */
+	uint64_t stats_start = dc_stats_now();
 	set = mailimap_set_new_interval(lastseenuid+1, 0);
 		r = mailimap_uid_fetch(imap->etpan, set, imap->fetch_type_prefetch, &fetch_result);
 	FREE_SET(set);
+	dc_stats_add(imap->context, DC_STATS_IMAP_PREFETCH, stats_start);
 
 	if (dc_imap_is_error(imap, r) || fetch_result==NULL)
 	{
@@ -485,40 +601,83 @@ static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 		goto cleanup;
 	}
 
-	/* go through all mails in folder (this is typically _fast_ as we already have the whole list) */
+	/* when catching up, count the history messages to report progress */
+	if (catchup_until_uid) {
+		for (cur = clist_begin(fetch_result); cur!=NULL ; cur = clist_next(cur)) {
+			uint32_t cur_uid = peek_uid((struct mailimap_msg_att*)clist_content(cur));
+			if (cur_uid > lastseenuid && cur_uid <= catchup_until_uid) {
+				catchup_cnt++;
+			}
+		}
+	}
+
+	/* collect the new mails in folder (this is typically _fast_ as we already have the whole list)
+	and precheck all of them at once */
+	new_uids = calloc(clist_count(fetch_result)+1, sizeof(uint32_t));
+	new_mids = calloc(clist_count(fetch_result)+1, sizeof(char*));
+	new_exists = calloc(clist_count(fetch_result)+1, sizeof(int));
+	if (new_uids==NULL || new_mids==NULL || new_exists==NULL) {
+		goto cleanup;
+	}
+
 	for (cur = clist_begin(fetch_result); cur!=NULL ; cur = clist_next(cur))
 	{
 		struct mailimap_msg_att* msg_att = (struct mailimap_msg_att*)clist_content(cur); /* mailimap_msg_att is a list of attributes: list is a list of message attributes */
 		uint32_t cur_uid = peek_uid(msg_att);
 		if (cur_uid > lastseenuid /* `UID FETCH <lastseenuid+1>:*` may include lastseenuid if "*"==lastseenuid - and also smaller uids may be returned! */)
 		{
-			char* rfc724_mid = unquote_rfc724_mid(peek_rfc724_mid(msg_att));
+			new_uids[new_cnt] = cur_uid;
+			new_mids[new_cnt] = unquote_rfc724_mid(peek_rfc724_mid(msg_att));
+			new_cnt++;
+		}
+	}
 
-			read_cnt++;
-			if (!imap->precheck_imf(imap, rfc724_mid, folder, cur_uid)) {
-				if (fetch_single_msg(imap, folder, cur_uid)==0/* 0=try again later*/) {
-					dc_log_info(imap->context, 0, "Read error for message %s from \"%s\", trying over later.", rfc724_mid, folder);
-					read_errors++; // with read_errors, lastseenuid is not written
-				}
-			}
-			else {
-				dc_log_info(imap->context, 0, "Skipping message %s from \"%s\" by precheck.", rfc724_mid, folder);
+	if (new_cnt > 0) {
+		imap->precheck_imf(imap, folder, new_cnt, (const char**)new_mids, new_uids, new_exists);
+	}
+
+	for (int i = 0; i < new_cnt; i++)
+	{
+		uint32_t cur_uid = new_uids[i];
+		char*    rfc724_mid = new_mids[i];
+
+		if (catchup_cnt>0 && cur_uid <= catchup_until_uid) {
+			catchup_done++;
+			if (catchup_done%10==0 && catchup_done<catchup_cnt) {
+				imap->context->cb(imap->context, DC_EVENT_CATCHUP_PROGRESS, DC_MAX(1, catchup_done*1000/catchup_cnt), 0);
 			}
+		}
 
-			if (cur_uid > new_lastseenuid) {
-				new_lastseenuid = cur_uid;
+		read_cnt++;
+		if (!new_exists[i]) {
+			if (fetch_single_msg(imap, folder, cur_uid)==0/* 0=try again later*/) {
+				dc_log_info(imap->context, 0, "Read error for message %s from \"%s\", trying over later.", rfc724_mid, folder);
+				read_errors++; // with read_errors, lastseenuid is not written
 			}
+		}
+		else {
+			dc_log_info(imap->context, 0, "Skipping message %s from \"%s\" by precheck.", rfc724_mid, folder);
+		}
 
-			free(rfc724_mid);
+		if (cur_uid > new_lastseenuid) {
+			new_lastseenuid = cur_uid;
 		}
 	}
 
+	if (read_cnt > 0) {
+		imap->last_arrival = time(NULL);
+	}
+
 	if (!read_errors && new_lastseenuid > 0) {
 		// TODO: it might be better to increase the lastseenuid also on partial errors.
 		// however, this requires to sort the list before going through it above.
 		set_config_lastseenuid(imap, folder, uidvalidity, new_lastseenuid);
 	}
 
+	if (catchup_cnt>0) {
+		imap->context->cb(imap->context, DC_EVENT_CATCHUP_PROGRESS, read_errors? 0 : 1000, 0);
+	}
+
 	/* done */
 cleanup:
 
@@ -529,6 +688,12 @@ cleanup:
 		dc_log_info(imap->context, 0, "%i mails read from \"%s\".", (int)read_cnt, folder);
 	}
 
+	for (int i = 0; i < new_cnt; i++) {
+		free(new_mids[i]);
+	}
+	free(new_uids);
+	free(new_mids);
+	free(new_exists);
 	FREE_FETCH_LIST(fetch_result);
 	return read_cnt;
 }
@@ -539,6 +704,96 @@ cleanup:
  ******************************************************************************/
 
 
+static int notify_covers_folders(dc_imap_t* imap)
+{
+	/* the caller should hold watch_condmutex or be the thread that owns the connection */
+	return (imap->connected && imap->can_idle && imap->has_notify && !imap->notify_failed
+	     && imap->notify_folders && carray_count(imap->notify_folders)>0);
+}
+
+
+static int notify_is_active(dc_imap_t* imap)
+{
+	/* NOTIFY SET succeeded on this connection; before that, the other folders are watched separately */
+	return (imap->notify_set_up && notify_covers_folders(imap));
+}
+
+
+static int fetch_from_watched_folders(dc_imap_t* imap)
+{
+	int read_cnt = fetch_from_single_folder(imap, imap->watch_folder);
+
+	// folders watched via NOTIFY are not fetched by other threads, so we have to do this here
+	if (notify_is_active(imap)) {
+		for (int i = 0; i < carray_count(imap->notify_folders); i++) {
+			read_cnt += fetch_from_single_folder(imap, (char*)carray_get(imap->notify_folders, i));
+		}
+	}
+
+	return read_cnt;
+}
+
+
+static char* quote_folder(const char* folder)
+{
+	/* quote a folder name for use in a raw IMAP command, see `quoted` in RFC 3501 */
+	dc_strbuilder_t ret;
+	dc_strbuilder_init(&ret, 0);
+	dc_strbuilder_cat(&ret, "\"");
+	for (const char* p = folder; *p; p++) {
+		if (*p=='"' || *p=='\\') {
+			dc_strbuilder_cat(&ret, "\\");
+		}
+		char c[2] = {*p, 0};
+		dc_strbuilder_cat(&ret, c);
+	}
+	dc_strbuilder_cat(&ret, "\"");
+	return ret.buf;
+}
+
+
+static int setup_notify_if_needed(dc_imap_t* imap)
+{
+	/* With NOTIFY (RFC 5465), the inbox-connection also gets informed about changes in other folders
+	(eg. the mvbox and the sentbox); these changes are sent as untagged STATUS responses
+	that cancel IDLE just as new messages in the selected folder do.
+	Using NOTIFY saves one connection and one idling thread per additional folder. */
+	int             r = 0;
+	dc_strbuilder_t cmd;
+	dc_strbuilder_init(&cmd, 0);
+
+	if (imap->notify_set_up || !notify_covers_folders(imap)) {
+		goto cleanup;
+	}
+
+	dc_strbuilder_cat(&cmd, "NOTIFY SET (selected (MessageNew MessageExpunge)) (mailboxes");
+	for (int i = 0; i < carray_count(imap->notify_folders); i++) {
+		char* quoted = quote_folder((char*)carray_get(imap->notify_folders, i));
+		dc_strbuilder_catf(&cmd, " %s", quoted);
+		free(quoted);
+	}
+	dc_strbuilder_cat(&cmd, " (MessageNew MessageExpunge))");
+
+	r = mailimap_custom_command(imap->etpan, cmd.buf);
+	if (dc_imap_is_error(imap, r)) {
+		dc_log_info(imap->context, 0, "IMAP-NOTIFY not available (%i), folders are watched separately.", r);
+		pthread_mutex_lock(&imap->watch_condmutex);
+			imap->notify_failed = 1;
+		pthread_mutex_unlock(&imap->watch_condmutex);
+		goto cleanup;
+	}
+
+	dc_log_info(imap->context, 0, "IMAP-NOTIFY set up for %i additional folders.", (int)carray_count(imap->notify_folders));
+	pthread_mutex_lock(&imap->watch_condmutex);
+		imap->notify_set_up = 1;
+	pthread_mutex_unlock(&imap->watch_condmutex);
+
+cleanup:
+	free(cmd.buf);
+	return imap->notify_set_up;
+}
+
+
 int dc_imap_fetch(dc_imap_t* imap)
 {
 	int   success = 0;
@@ -552,7 +807,7 @@ int dc_imap_fetch(dc_imap_t* imap)
 	// as during the fetch commands, new messages may arrive, we fetch until we do not
 	// get any more. if IDLE is called directly after, there is only a small chance that
 	// messages are missed and delayed until the next IDLE call
-	while (fetch_from_single_folder(imap, imap->watch_folder) > 0) {
+	while (fetch_from_watched_folders(imap) > 0) {
 		;
 	}
 
@@ -563,6 +818,20 @@ cleanup:
 }
 
 
+static time_t get_fake_idle_seconds(dc_imap_t* imap, time_t fake_idle_start_time)
+{
+	/* poll often if messages arrived recently and back off the longer the folder stays quiet:
+	every 5 seconds in the first 3 minutes, growing linearly to every 60 seconds after ~36 minutes.
+	if we cannot connect, fake_idle_start_time is 0 and we always use the maximum. */
+	#define FAKE_IDLE_MIN_SECONDS  5
+	#define FAKE_IDLE_MAX_SECONDS 60
+	time_t last_activity = DC_MAX(imap->last_arrival, fake_idle_start_time);
+	time_t quiet_seconds = time(NULL) - last_activity;
+	time_t seconds_to_wait = quiet_seconds / (3*60/FAKE_IDLE_MIN_SECONDS);
+	return DC_MAX(FAKE_IDLE_MIN_SECONDS, DC_MIN(seconds_to_wait, FAKE_IDLE_MAX_SECONDS));
+}
+
+
 static void fake_idle(dc_imap_t* imap)
 {
 	/* Idle using timeouts. This is also needed if we're not yet configured -
@@ -576,8 +845,8 @@ static void fake_idle(dc_imap_t* imap)
 	int do_fake_idle = 1;
 	while (do_fake_idle)
 	{
-		// wait a moment: every 5 seconds in the first 3 minutes after a new message, after that every 60 seconds
-		seconds_to_wait = (time(NULL)-fake_idle_start_time < 3*60)? 5 : 60;
+		// wait a moment, the interval adapts to the time since the last message arrived
+		seconds_to_wait = fake_idle_start_time? get_fake_idle_seconds(imap, fake_idle_start_time) : FAKE_IDLE_MAX_SECONDS;
 		pthread_mutex_lock(&imap->watch_condmutex);
 
 			int r = 0;
@@ -602,7 +871,7 @@ static void fake_idle(dc_imap_t* imap)
 		// are also downloaded, however, typically this would take place in the FETCH command
 		// following IDLE otherwise, so this seems okay here.
 		if (setup_handle_if_needed(imap)) { // the handle may not be set up if configure is not yet done
-			if (fetch_from_single_folder(imap, imap->watch_folder)) {
+			if (fetch_from_watched_folders(imap)) {
 				do_fake_idle = 0;
 			}
 		}
@@ -645,6 +914,8 @@ void dc_imap_idle(dc_imap_t* imap)
 			goto cleanup;
 		}
 
+		setup_notify_if_needed(imap);
+
 		r = mailimap_idle(imap->etpan);
 		if (dc_imap_is_error(imap, r)) {
 			dc_log_warning(imap->context, 0, "IMAP-IDLE: Cannot start.");
@@ -833,6 +1104,9 @@ static void unsetup_handle(dc_imap_t* imap)
 
 		mailimap_free(imap->etpan);
 		imap->etpan = NULL;
+		pthread_mutex_lock(&imap->watch_condmutex);
+			imap->notify_set_up = 0;
+		pthread_mutex_unlock(&imap->watch_condmutex);
 
 		dc_log_info(imap->context, 0, "IMAP disconnected.");
 	}
@@ -869,6 +1143,12 @@ static void free_connect_param(dc_imap_t* imap)
 	imap->imap_port = 0;
 	imap->can_idle  = 0;
 	imap->has_xlist = 0;
+
+	pthread_mutex_lock(&imap->watch_condmutex);
+		imap->has_notify = 0;
+		imap->notify_failed = 0;
+		imap->notify_set_up = 0;
+	pthread_mutex_unlock(&imap->watch_condmutex);
 }
 
 
@@ -893,13 +1173,16 @@ int dc_imap_connect(dc_imap_t* imap, const dc_loginparam_t* lp)
 	imap->imap_pw      = dc_strdup(lp->mail_pw);
 	imap->server_flags = lp->server_flags;
 
+	uint64_t stats_start = dc_stats_now();
 	if (!setup_handle_if_needed(imap)) {
 		goto cleanup;
 	}
+	dc_stats_add(imap->context, DC_STATS_IMAP_CONNECT, stats_start);
 
 	/* we set the following flags here and not in setup_handle_if_needed() as they must not change during connection */
 	imap->can_idle = mailimap_has_idle(imap->etpan);
 	imap->has_xlist = mailimap_has_xlist(imap->etpan);
+	imap->has_notify = mailimap_has_extension(imap->etpan, "NOTIFY");
 
 	#ifdef __APPLE__
 	imap->can_idle = 0; // HACK to force iOS not to work IMAP-IDLE which does not work for now, see also (*)
@@ -972,6 +1255,64 @@ void dc_imap_set_watch_folder(dc_imap_t* imap, const char* watch_folder)
 }
 
 
+void dc_imap_set_notify_folders(dc_imap_t* imap, carray* folders)
+{
+	/* set the folders to watch in addition to the watch folder, this requires NOTIFY support;
+	must be called from the thread that uses the connection */
+	if (imap==NULL || folders==NULL) {
+		return;
+	}
+
+	int changed = (carray_count(folders)!=carray_count(imap->notify_folders));
+	for (int i = 0; !changed && i < carray_count(folders); i++) {
+		if (strcmp((char*)carray_get(folders, i), (char*)carray_get(imap->notify_folders, i))!=0) {
+			changed = 1;
+		}
+	}
+
+	if (changed)
+	{
+		pthread_mutex_lock(&imap->watch_condmutex);
+			for (int i = 0; i < carray_count(imap->notify_folders); i++) {
+				free(carray_get(imap->notify_folders, i));
+			}
+			carray_set_size(imap->notify_folders, 0);
+			for (int i = 0; i < carray_count(folders); i++) {
+				carray_add(imap->notify_folders, dc_strdup((char*)carray_get(folders, i)), NULL);
+			}
+			imap->notify_set_up = 0; // a new NOTIFY SET replaces the old one
+		pthread_mutex_unlock(&imap->watch_condmutex);
+	}
+}
+
+
+int dc_imap_is_notify_watching(dc_imap_t* imap, const char* folder)
+{
+	/* returns 1 if the given folder is watched by this connection via NOTIFY,
+	in this case, there is no need to watch the folder on another connection.
+	as long as NOTIFY SET was not accepted by the server, 0 is returned.
+	may be called from any thread. */
+	int watching = 0;
+
+	if (imap==NULL || folder==NULL) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&imap->watch_condmutex);
+		if (notify_is_active(imap)) {
+			for (int i = 0; i < carray_count(imap->notify_folders); i++) {
+				if (strcmp((char*)carray_get(imap->notify_folders, i), folder)==0) {
+					watching = 1;
+					break;
+				}
+			}
+		}
+	pthread_mutex_unlock(&imap->watch_condmutex);
+
+	return watching;
+}
+
+
 /*******************************************************************************
  * Main interface
  ******************************************************************************/
@@ -1003,6 +1344,7 @@ dc_imap_t* dc_imap_new(dc_get_config_t get_config, dc_set_config_t set_config,
 
 	imap->watch_folder = calloc(1, 1);
 	imap->selected_folder = calloc(1, 1);
+	imap->notify_folders = carray_new(2);
 
 	/* create some useful objects */
 
@@ -1042,6 +1384,7 @@ void dc_imap_unref(dc_imap_t* imap)
 	pthread_mutex_destroy(&imap->watch_condmutex);
 	free(imap->watch_folder);
 	free(imap->selected_folder);
+	dc_free_splitted_lines(imap->notify_folders);
 	if (imap->fetch_type_prefetch)   { mailimap_fetch_type_free(imap->fetch_type_prefetch); }
 	if (imap->fetch_type_body)       { mailimap_fetch_type_free(imap->fetch_type_body); }
 	if (imap->fetch_type_flags)      { mailimap_fetch_type_free(imap->fetch_type_flags); }
@@ -1065,7 +1408,9 @@ static int add_flag(dc_imap_t* imap, uint32_t server_uid, struct mailimap_flag*
 
 	store_att_flags = mailimap_store_att_flags_new_add_flags(flag_list); /* FLAGS.SILENT does not return the new value */
 
+	uint64_t stats_start = dc_stats_now();
 	r = mailimap_uid_store(imap->etpan, set, store_att_flags);
+	dc_stats_add(imap->context, DC_STATS_IMAP_STORE, stats_start);
 	if (dc_imap_is_error(imap, r)) {
 		goto cleanup;
 	}
@@ -1111,7 +1456,9 @@ dc_imap_res dc_imap_move(dc_imap_t* imap, const char* folder, uint32_t uid,
 	/* TODO/TOCHECK: UIDPLUS extension may not be supported on servers;
 	if in doubt, we can find out the resulting UID using "imap_selection_info->sel_uidnext" then */
 
+	uint64_t stats_start = dc_stats_now();
 	r = mailimap_uidplus_uid_move(imap->etpan, set, dest_folder, &res_uid, &res_setsrc, &res_setdest);
+	dc_stats_add(imap->context, DC_STATS_IMAP_MOVE, stats_start);
 	if (dc_imap_is_error(imap, r)) {
 		FREE_SET(res_setsrc);
 		FREE_SET(res_setdest);
@@ -19,9 +19,9 @@ typedef struct _dc_imap       dc_imap_t;
 typedef char*    (*dc_get_config_t)    (dc_imap_t*, const char*, const char*);
 typedef void     (*dc_set_config_t)    (dc_imap_t*, const char*, const char*);
 
-typedef int      (*dc_precheck_imf_t)  (dc_imap_t*, const char* rfc724_mid,
-                                        const char* server_folder,
-                                        uint32_t server_uid);
+typedef void     (*dc_precheck_imf_t)  (dc_imap_t*, const char* server_folder, int cnt,
+                                        const char** rfc724_mids, const uint32_t* server_uids,
+                                        int* ret_exists); /* all messages of a prefetch at once */
 
 #define DC_IMAP_SEEN 0x0001L
 typedef void     (*dc_receive_imf_t)   (dc_imap_t*, const char* imf_raw_not_terminated, size_t imf_raw_bytes, const char* server_folder, uint32_t server_uid, uint32_t flags);
@@ -57,6 +57,12 @@ struct _dc_imap
 	pthread_cond_t        watch_cond;
 	pthread_mutex_t       watch_condmutex;
 	int                   watch_condflag;
+	time_t                last_arrival;  /* time of the last fetch that returned messages, used to adapt fake-idle polling */
+
+	int                   has_notify;    /* server supports NOTIFY, RFC 5465 */
+	int                   notify_failed; /* NOTIFY SET was rejected; do not try again before reconnect */
+	int                   notify_set_up; /* NOTIFY SET succeeded on the current connection; protected by watch_condmutex */
+	carray*               notify_folders;/* additional folders watched on this connection via NOTIFY; protected by watch_condmutex */
 
 	struct mailimap_fetch_type* fetch_type_prefetch;
 	struct mailimap_fetch_type* fetch_type_body;
@@ -90,6 +96,8 @@ void       dc_imap_unref             (dc_imap_t*);
 
 int        dc_imap_connect           (dc_imap_t*, const dc_loginparam_t*);
 void       dc_imap_set_watch_folder  (dc_imap_t*, const char* watch_folder);
+void       dc_imap_set_notify_folders(dc_imap_t*, carray* folders);
+int        dc_imap_is_notify_watching(dc_imap_t*, const char* folder);
 void       dc_imap_disconnect        (dc_imap_t*);
 int        dc_imap_is_connected      (const dc_imap_t*);
 int        dc_imap_fetch             (dc_imap_t*);
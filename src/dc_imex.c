@@ -2,7 +2,6 @@
 #include <dirent.h>
 #include <unistd.h> /* for sleep() */
 #include <openssl/rand.h>
-#include <libetpan/mmapstring.h>
 #include "dc_context.h"
 #include "dc_mimeparser.h"
 #include "dc_loginparam.h"
@@ -10,6 +9,7 @@
 #include "dc_apeerstate.h"
 #include "dc_pgp.h"
 #include "dc_mimefactory.h"
+#include "dc_codec.h"
 #include "dc_job.h"
 
 
@@ -197,9 +197,8 @@ char* dc_decrypt_setup_file(dc_context_t* context, const char* passphrase, const
 	char*         fc_buf = NULL;
 	const char*   fc_headerline = NULL;
 	const char*   fc_base64 = NULL;
-	char*         binary = NULL;
+	void*         binary = NULL;
 	size_t        binary_bytes = 0;
-	size_t        indx = 0;
 	void*         plain = NULL;
 	size_t        plain_bytes = 0;
 	char*         payload = NULL;
@@ -212,8 +211,7 @@ char* dc_decrypt_setup_file(dc_context_t* context, const char* passphrase, const
 	}
 
 	/* convert base64 to binary */
-	if (mailmime_base64_body_parse(fc_base64, strlen(fc_base64), &indx, &binary/*must be freed using mmap_string_unref()*/, &binary_bytes)!=MAILIMF_NO_ERROR
-	 || binary==NULL || binary_bytes==0) {
+	if ((binary=dc_base64_decode(fc_base64, strlen(fc_base64), &binary_bytes))==NULL) {
 		goto cleanup;
 	}
 
@@ -226,7 +224,7 @@ char* dc_decrypt_setup_file(dc_context_t* context, const char* passphrase, const
 cleanup:
 	free(plain);
 	free(fc_buf);
-	if (binary) { mmap_string_unref(binary); }
+	free(binary);
 	return payload;
 }
 
@@ -1046,7 +1044,7 @@ void dc_imex(dc_context_t* context, int what, const char* param1, const char* pa
 	dc_param_set    (param, DC_PARAM_CMD_ARG2, param2);
 
 	dc_job_kill_action(context, DC_JOB_IMEX_IMAP);
-	dc_job_add(context, DC_JOB_IMEX_IMAP, 0, param->packed, 0); // results in a call to dc_job_do_DC_JOB_IMEX_IMAP()
+	dc_job_add(context, DC_JOB_IMEX_IMAP, 0, dc_param_get_packed(param), 0); // results in a call to dc_job_do_DC_JOB_IMEX_IMAP()
 
 	dc_param_unref(param);
 }
@@ -28,6 +28,30 @@ static int connect_to_inbox(dc_context_t* context)
 
 	dc_imap_set_watch_folder(context->inbox, "INBOX");
 
+	// if the server supports NOTIFY, the inbox-connection also watches the mvbox and the sentbox;
+	// the mvbox- and sentbox-threads check dc_imap_is_notify_watching() then and do not connect on their own.
+	// if inbox_watch is disabled, dc_perform_imap_fetch() does not fetch, so we cannot take over other folders.
+	{
+		carray* notify_folders = carray_new(2);
+		char*   folder = NULL;
+		int     inbox_watch = dc_sqlite3_get_config_int(context->sql, "inbox_watch", DC_INBOX_WATCH_DEFAULT);
+
+		if (inbox_watch
+		 && dc_sqlite3_get_config_int(context->sql, "mvbox_watch", DC_MVBOX_WATCH_DEFAULT)
+		 && (folder=dc_sqlite3_get_config(context->sql, "configured_mvbox_folder", NULL))!=NULL) {
+			carray_add(notify_folders, folder, NULL);
+		}
+
+		if (inbox_watch
+		 && dc_sqlite3_get_config_int(context->sql, "sentbox_watch", DC_SENTBOX_WATCH_DEFAULT)
+		 && (folder=dc_sqlite3_get_config(context->sql, "configured_sentbox_folder", NULL))!=NULL) {
+			carray_add(notify_folders, folder, NULL);
+		}
+
+		dc_imap_set_notify_folders(context->inbox, notify_folders);
+		dc_free_splitted_lines(notify_folders);
+	}
+
 cleanup:
 	return ret_connected;
 }
@@ -205,40 +229,43 @@ cleanup:
  * @param mimefactory An instance of dc_mimefactory_t with a loaded and rendered message or MDN
  * @return 1=success, 0=error
  */
-static int dc_add_smtp_job(dc_context_t* context, int action, dc_mimefactory_t* mimefactory)
+static char* render_to_blobfile(dc_context_t* context, dc_mimefactory_t* mimefactory)
 {
-	char*            pathNfilename = NULL;
-	int              success = 0;
-	char*            recipients = NULL;
-	dc_param_t*      param = dc_param_new();
-
-	// find a free file name in the blob directory
-	pathNfilename = dc_get_fine_pathNfilename(context, "$BLOBDIR", mimefactory->rfc724_mid);
+	// the message is written to the file directly, so that large attachments are not held in memory several times
+	char* pathNfilename = dc_get_fine_pathNfilename(context, "$BLOBDIR", mimefactory->rfc724_mid);
 	if (!pathNfilename) {
 		dc_log_error(context, 0, "Could not find free file name for message with ID <%s>.", mimefactory->rfc724_mid);
-		goto cleanup;
+		return NULL;
 	}
 
-	// write the file
-	if (!dc_write_file(context, pathNfilename, mimefactory->out->str, mimefactory->out->len)) {
-		dc_log_error(context, 0, "Could not write message <%s> to \"%s\".", mimefactory->rfc724_mid, pathNfilename);
-		goto cleanup;
+	if (!dc_mimefactory_render_to_file(mimefactory, pathNfilename)) {
+		if (mimefactory->error==NULL) {
+			dc_log_error(context, 0, "Could not write message <%s> to \"%s\".", mimefactory->rfc724_mid, pathNfilename);
+		}
+		dc_delete_file(context, pathNfilename);
+		free(pathNfilename);
+		return NULL;
 	}
 
+	return pathNfilename;
+}
+
+
+static int dc_add_smtp_job(dc_context_t* context, int action, dc_mimefactory_t* mimefactory, const char* pathNfilename)
+{
+	char*            recipients = NULL;
+	dc_param_t*      param = dc_param_new();
+
 	// store recipients in job param
 	recipients = dc_str_from_clist(mimefactory->recipients_addr, "\x1e");
 	dc_param_set(param, DC_PARAM_FILE, pathNfilename);
 	dc_param_set(param, DC_PARAM_RECIPIENTS, recipients);
 
-	dc_job_add(context, action, mimefactory->loaded==DC_MF_MSG_LOADED ? mimefactory->msg->id : 0, param->packed, 0);
+	dc_job_add(context, action, mimefactory->loaded==DC_MF_MSG_LOADED ? mimefactory->msg->id : 0, dc_param_get_packed(param), 0);
 
-	success = 1;
-
-cleanup:
 	dc_param_unref(param);
 	free(recipients);
-	free(pathNfilename);
-	return success;
+	return 1;
 }
 
 
@@ -252,6 +279,7 @@ cleanup:
 int dc_job_send_msg(dc_context_t* context, uint32_t msg_id)
 {
 	int success = 0;
+	char* pathNfilename = NULL;
 	dc_mimefactory_t mimefactory;
 	dc_mimefactory_init(&mimefactory, context);
 
@@ -286,14 +314,17 @@ int dc_job_send_msg(dc_context_t* context, uint32_t msg_id)
 
 	/* create message */
 	{
-		if (!dc_mimefactory_render(&mimefactory)) {
-			dc_set_msg_failed(context, msg_id, mimefactory.error);
+		if ((pathNfilename=render_to_blobfile(context, &mimefactory))==NULL) {
+			if (mimefactory.error) {
+				dc_set_msg_failed(context, msg_id, mimefactory.error);
+			}
 			goto cleanup; // no redo, no IMAP - this will also fail next time
 		}
 
 		/* have we guaranteed encryption but cannot fulfill it for any reason? Do not send the message then.*/
 		if (dc_param_get_int(mimefactory.msg->param, DC_PARAM_GUARANTEE_E2EE, 0) && !mimefactory.out_encrypted) {
 			dc_set_msg_failed(context, msg_id, "End-to-end-encryption unavailable unexpectedly.");
+			dc_delete_file(context, pathNfilename);
 			goto cleanup; /* unrecoverable */
 		}
 
@@ -327,10 +358,11 @@ int dc_job_send_msg(dc_context_t* context, uint32_t msg_id)
 
 	dc_sqlite3_commit(context->sql);
 
-	success = dc_add_smtp_job(context, DC_JOB_SEND_MSG_TO_SMTP, &mimefactory);
+	success = dc_add_smtp_job(context, DC_JOB_SEND_MSG_TO_SMTP, &mimefactory, pathNfilename);
 
 cleanup:
 	dc_mimefactory_empty(&mimefactory);
+	free(pathNfilename);
 	return success;
 }
 
@@ -430,26 +462,111 @@ cleanup:
 }
 
 
+/* read receipts are not sent at once but collected for some seconds;
+all receipts for the same sender are then sent as a single MDN.
+a sender is due when the oldest receipt waits for MAYBE_SEND_MDNS_WAIT_SECONDS,
+so messages that are marked as seen one after another are still reported together. */
+#define MAYBE_SEND_MDNS_WAIT_SECONDS 10
+#define MDNS_PER_REPORT_MAX          50
+
+
 static void dc_send_mdn(dc_context_t* context, uint32_t msg_id)
 {
-	dc_mimefactory_t mimefactory;
-	dc_mimefactory_init(&mimefactory, context);
+	sqlite3_stmt* stmt = NULL;
 
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
 		return;
 	}
 
-    if (!dc_mimefactory_load_mdn(&mimefactory, msg_id)
-     || !dc_mimefactory_render(&mimefactory)) {
-		goto cleanup;
-    }
+	stmt = dc_sqlite3_prepare(context->sql,
+		"INSERT INTO mdns_pending (msg_id, from_id, timestamp)"
+		" SELECT id, from_id, ? FROM msgs WHERE id=?;");
+	sqlite3_bind_int64(stmt, 1, time(NULL));
+	sqlite3_bind_int  (stmt, 2, msg_id);
+	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
 
-	//char* t1=dc_null_terminate(mimefactory.out->str,mimefactory.out->len);printf("~~~~~MDN~~~~~\n%s\n~~~~~/MDN~~~~~",t1);free(t1); // DEBUG OUTPUT
+	if (!dc_job_action_exists(context, DC_JOB_MAYBE_SEND_MDNS)) {
+		dc_job_add(context, DC_JOB_MAYBE_SEND_MDNS, 0, NULL, MAYBE_SEND_MDNS_WAIT_SECONDS);
+	}
+}
 
-	dc_add_smtp_job(context, DC_JOB_SEND_MDN, &mimefactory);
 
-cleanup:
-	dc_mimefactory_empty(&mimefactory);
+static void dc_job_do_DC_JOB_MAYBE_SEND_MDNS(dc_context_t* context, dc_job_t* job)
+{
+	sqlite3_stmt*    stmt = NULL;
+	dc_array_t*      from_ids = dc_array_new(context, 16);
+	dc_array_t*      msg_ids = dc_array_new(context, MDNS_PER_REPORT_MAX);
+	char*            pathNfilename = NULL;
+	time_t           now = time(NULL);
+	time_t           next_due = 0;
+	dc_mimefactory_t mimefactory;
+	dc_mimefactory_init(&mimefactory, context);
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT from_id, MIN(timestamp) FROM mdns_pending GROUP BY from_id;");
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		time_t due = sqlite3_column_int64(stmt, 1) + MAYBE_SEND_MDNS_WAIT_SECONDS;
+		if (due<=now || due>now+MAYBE_SEND_MDNS_WAIT_SECONDS/*the clock was set back*/) {
+			dc_array_add_id(from_ids, sqlite3_column_int(stmt, 0));
+		}
+		else if (next_due==0 || due<next_due) {
+			next_due = due;
+		}
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	// receipts of other senders are still waiting for more messages being marked as seen
+	if (next_due) {
+		dc_job_add(context, DC_JOB_MAYBE_SEND_MDNS, 0, NULL, (int)DC_MIN(next_due-now, MAYBE_SEND_MDNS_WAIT_SECONDS));
+	}
+
+	for (size_t i = 0; i<dc_array_get_cnt(from_ids); i++)
+	{
+		uint32_t from_id = dc_array_get_id(from_ids, i);
+		int      last_id = 0;
+
+		do {
+			dc_array_empty(msg_ids);
+
+			stmt = dc_sqlite3_prepare(context->sql,
+				"SELECT id, msg_id FROM mdns_pending WHERE from_id=? ORDER BY id LIMIT " DC_STRINGIFY(MDNS_PER_REPORT_MAX) ";");
+			sqlite3_bind_int(stmt, 1, from_id);
+			while (sqlite3_step(stmt)==SQLITE_ROW) {
+				last_id = sqlite3_column_int(stmt, 0);
+				dc_array_add_id(msg_ids, sqlite3_column_int(stmt, 1));
+			}
+			sqlite3_finalize(stmt);
+
+			if (dc_array_get_cnt(msg_ids)==0) {
+				break;
+			}
+
+			dc_log_info(context, 0, "Sending read receipt for %i message(s) to contact #%i.", (int)dc_array_get_cnt(msg_ids), (int)from_id);
+
+			if (dc_mimefactory_load_mdn(&mimefactory, msg_ids)
+			 && (pathNfilename=render_to_blobfile(context, &mimefactory))!=NULL) {
+				dc_add_smtp_job(context, DC_JOB_SEND_MDN, &mimefactory, pathNfilename);
+			}
+			dc_mimefactory_empty(&mimefactory);
+			free(pathNfilename);
+			pathNfilename = NULL;
+
+			// read receipts are sent on a best effort basis, we do not retry failed ones
+			stmt = dc_sqlite3_prepare(context->sql,
+				"DELETE FROM mdns_pending WHERE from_id=? AND id<=?;");
+			sqlite3_bind_int(stmt, 1, from_id);
+			sqlite3_bind_int(stmt, 2, last_id);
+			sqlite3_step(stmt);
+			sqlite3_finalize(stmt);
+			stmt = NULL;
+
+		} while (dc_array_get_cnt(msg_ids)==MDNS_PER_REPORT_MAX);
+	}
+
+	dc_array_unref(from_ids);
+	dc_array_unref(msg_ids);
 }
 
 
@@ -585,7 +702,7 @@ static void dc_job_update(dc_context_t* context, const dc_job_t* job)
 		" WHERE id=?;");
 	sqlite3_bind_int64(stmt, 1, job->desired_timestamp);
 	sqlite3_bind_int64(stmt, 2, job->tries);
-	sqlite3_bind_text (stmt, 3, job->param->packed, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 3, dc_param_get_packed(job->param), -1, SQLITE_STATIC);
 	sqlite3_bind_int  (stmt, 4, job->job_id);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
@@ -692,6 +809,7 @@ static void dc_job_perform(dc_context_t* context, int thread, int probe_network)
 
 		for (int tries = 0; tries <= 1; tries++)
 		{
+			uint64_t stats_start = dc_stats_now();
 			job.try_again = DC_DONT_TRY_AGAIN; // this can be modified by a job using dc_job_try_again_later()
 
 			switch (job.action) {
@@ -705,8 +823,10 @@ static void dc_job_perform(dc_context_t* context, int thread, int probe_network)
 				case DC_JOB_IMEX_IMAP:            dc_job_do_DC_JOB_IMEX_IMAP            (context, &job); break;
 				case DC_JOB_MAYBE_SEND_LOCATIONS: dc_job_do_DC_JOB_MAYBE_SEND_LOCATIONS (context, &job); break;
 				case DC_JOB_MAYBE_SEND_LOC_ENDED: dc_job_do_DC_JOB_MAYBE_SEND_LOC_ENDED (context, &job); break;
+				case DC_JOB_MAYBE_SEND_MDNS:      dc_job_do_DC_JOB_MAYBE_SEND_MDNS      (context, &job); break;
 				case DC_JOB_HOUSEKEEPING:         dc_housekeeping                       (context);       break;
 			}
+			dc_stats_add(context, DC_STATS_JOB, stats_start);
 
 			if (job.try_again!=DC_AT_ONCE) {
 				break;
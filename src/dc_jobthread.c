@@ -94,6 +94,21 @@ void dc_jobthread_suspend(dc_jobthread_t* jobthread, int suspend)
  ******************************************************************************/
 
 
+// while the folder is watched by the inbox-connection, we re-check this state from time to time
+#define NOTIFY_RECHECK_SECONDS 60
+
+
+static int is_watched_by_inbox(dc_jobthread_t* jobthread)
+{
+	// if the inbox-connection watches our folder using IMAP NOTIFY, messages are fetched there
+	// and we do not need a connection on our own.
+	char* folder = dc_sqlite3_get_config(jobthread->context->sql, jobthread->folder_config_name, NULL);
+	int   watched = dc_imap_is_notify_watching(jobthread->context->inbox, folder);
+	free(folder);
+	return watched;
+}
+
+
 static int connect_to_imap(dc_jobthread_t* jobthread)
 {
 	int   ret_connected = DC_NOT_CONNECTED;
@@ -146,6 +161,14 @@ void dc_jobthread_fetch(dc_jobthread_t* jobthread, int use_network)
 		goto cleanup;
 	}
 
+	if (is_watched_by_inbox(jobthread)) {
+		if (dc_imap_is_connected(jobthread->imap)) {
+			dc_log_info(jobthread->context, 0, "%s is watched by the INBOX-connection, disconnecting.", jobthread->name);
+			dc_imap_disconnect(jobthread->imap);
+		}
+		goto cleanup;
+	}
+
 	clock_t start = clock();
 
 	if (!connect_to_imap(jobthread)) {
@@ -209,6 +232,24 @@ void dc_jobthread_idle(dc_jobthread_t* jobthread, int use_network)
 		return;
 	}
 
+	if (is_watched_by_inbox(jobthread)) {
+		// the inbox-connection does the work; wake up from time to time
+		// to take over if NOTIFY stops working there
+		dc_log_info(jobthread->context, 0, "%s is watched by the INBOX-connection.", jobthread->name);
+		pthread_mutex_lock(&jobthread->mutex);
+			jobthread->using_handle = 0;
+			int r = 0;
+			struct timespec wakeup_at;
+			memset(&wakeup_at, 0, sizeof(wakeup_at));
+			wakeup_at.tv_sec  = time(NULL)+NOTIFY_RECHECK_SECONDS;
+			while (jobthread->idle_condflag==0 && r==0) {
+				r = pthread_cond_timedwait(&jobthread->idle_cond, &jobthread->mutex, &wakeup_at); /* unlock mutex -> wait -> lock mutex */
+			}
+			jobthread->idle_condflag = 0;
+		pthread_mutex_unlock(&jobthread->mutex);
+		return;
+	}
+
 	connect_to_imap(jobthread);
 
 	dc_log_info(jobthread->context, 0, "%s-IDLE started...", jobthread->name);
@@ -3,6 +3,7 @@
 #include "dc_context.h"
 #include "dc_key.h"
 #include "dc_pgp.h"
+#include "dc_codec.h"
 #include "dc_tools.h"
 
 
@@ -111,8 +112,8 @@ int dc_key_set_from_stmt(dc_key_t* key, sqlite3_stmt* stmt, int index, int type)
 
 int dc_key_set_from_base64(dc_key_t* key, const char* base64, int type)
 {
-	size_t indx = 0, result_len = 0;
-	char* result = NULL;
+	size_t result_len = 0;
+	void*  result = NULL;
 
 	dc_key_empty(key);
 
@@ -120,13 +121,12 @@ int dc_key_set_from_base64(dc_key_t* key, const char* base64, int type)
 		return 0;
 	}
 
-	if (mailmime_base64_body_parse(base64, strlen(base64), &indx, &result/*must be freed using mmap_string_unref()*/, &result_len)!=MAILIMF_NO_ERROR
-	 || result==NULL || result_len==0) {
+	if ((result=dc_base64_decode(base64, strlen(base64), &result_len))==NULL) {
 		return 0; /* bad key */
 	}
 
 	dc_key_set_from_binary(key, result, result_len, type);
-	mmap_string_unref(result);
+	free(result);
 
 	return 1;
 }
@@ -226,6 +226,8 @@ int dc_key_save_self_keypair(const dc_key_t* public_key, const dc_key_t* private
 		goto cleanup;
 	}
 
+	dc_e2ee_reset_plans(sql->context);
+
 	success = 1;
 
 cleanup:
@@ -315,9 +317,7 @@ char* dc_render_base64(const void* buf, size_t buf_bytes, int break_every, const
 		goto cleanup;
 	}
 
-	if ((ret = encode_base64((const char*)buf, buf_bytes))==NULL) {
-		goto cleanup;
-	}
+	ret = dc_base64_encode(buf, buf_bytes);
 
 	#if 0
 	if (add_checksum==1/*appended checksum*/) {
@@ -346,7 +346,7 @@ char* dc_render_base64(const void* buf, size_t buf_bytes, int break_every, const
 		c[0] = (uint8_t)((checksum >> 16)&0xFF);
 		c[1] = (uint8_t)((checksum >> 8)&0xFF);
 		c[2] = (uint8_t)((checksum)&0xFF);
-		char* c64 = encode_base64((const char*)c, 3);
+		char* c64 = dc_base64_encode(c, 3);
 			char* temp = ret;
 				ret = dc_mprintf("%s%s=%s", temp, break_chars, c64);
 			free(temp);
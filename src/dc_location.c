@@ -1,8 +1,421 @@
+#include <math.h>
 #include "dc_context.h"
 #include "dc_saxparser.h"
 #include "dc_mimefactory.h"
 
 
+/*******************************************************************************
+ * simplify tracks
+ ******************************************************************************/
+
+
+// a point of a track may be dropped if it is closer to the simplified track
+// than its accuracy; the accuracy is clipped to this range
+#define TRACK_TOLERANCE_MIN_METERS  5.0
+#define TRACK_TOLERANCE_MAX_METERS 50.0
+
+
+static double get_distance_to_segment(const dc_location_t* p, const dc_location_t* a, const dc_location_t* b)
+{
+	/* distance in meters of p to the segment a-b, using an equirectangular projection;
+	this is exact enough for the short segments of a track */
+	#define EARTH_RADIUS_METERS 6371000.0
+	#define DEG_TO_METERS       (EARTH_RADIUS_METERS*3.14159265358979323846/180.0)
+	double cos_lat = cos(a->latitude*3.14159265358979323846/180.0);
+	double bx = (b->longitude-a->longitude) * cos_lat * DEG_TO_METERS;
+	double by = (b->latitude -a->latitude)            * DEG_TO_METERS;
+	double px = (p->longitude-a->longitude) * cos_lat * DEG_TO_METERS;
+	double py = (p->latitude -a->latitude)            * DEG_TO_METERS;
+
+	double len2 = bx*bx + by*by;
+	double t = len2>0.0? (px*bx + py*by)/len2 : 0.0;
+	t = DC_MAX(0.0, DC_MIN(t, 1.0));
+
+	double dx = px - t*bx;
+	double dy = py - t*by;
+	return sqrt(dx*dx + dy*dy);
+}
+
+
+static double get_tolerance(const dc_location_t* p)
+{
+	return DC_MAX(TRACK_TOLERANCE_MIN_METERS, DC_MIN(p->accuracy, TRACK_TOLERANCE_MAX_METERS));
+}
+
+
+static void simplify_track(const dc_location_t* points, int cnt, char* keep)
+{
+	/* Douglas-Peucker simplification of a track sorted by timestamp:
+	keep[] is set to 1 for all points that are needed to represent the track,
+	the first and the last point are always kept. */
+	int* stack = NULL;
+	int  stack_cnt = 0;
+
+	for (int i = 0; i < cnt; i++) {
+		keep[i] = (i==0 || i==cnt-1)? 1 : 0;
+	}
+
+	if (cnt<=2 || (stack=malloc(sizeof(int)*cnt*2))==NULL) {
+		memset(keep, 1, cnt);
+		goto cleanup;
+	}
+
+	stack[stack_cnt++] = 0;
+	stack[stack_cnt++] = cnt-1;
+	while (stack_cnt>0)
+	{
+		int last  = stack[--stack_cnt];
+		int first = stack[--stack_cnt];
+		int farthest = 0;
+		double farthest_ratio = 1.0;
+
+		for (int i = first+1; i < last; i++) {
+			double ratio = get_distance_to_segment(&points[i], &points[first], &points[last]) / get_tolerance(&points[i]);
+			if (ratio > farthest_ratio) {
+				farthest_ratio = ratio;
+				farthest = i;
+			}
+		}
+
+		if (farthest) {
+			keep[farthest] = 1;
+			stack[stack_cnt++] = first;
+			stack[stack_cnt++] = farthest;
+			stack[stack_cnt++] = farthest;
+			stack[stack_cnt++] = last;
+		}
+	}
+
+cleanup:
+	free(stack);
+}
+
+
+static int cmp_locations_by_timestamp(const void* p1, const void* p2)
+{
+	const dc_location_t* l1 = (const dc_location_t*)p1;
+	const dc_location_t* l2 = (const dc_location_t*)p2;
+	return l1->timestamp<l2->timestamp? -1 : (l1->timestamp>l2->timestamp? 1 : 0);
+}
+
+
+static int cmp_locations_newest_first(const void* p1, const void* p2)
+{
+	const dc_location_t* l1 = (const dc_location_t*)p1;
+	const dc_location_t* l2 = (const dc_location_t*)p2;
+	if (l1->timestamp!=l2->timestamp) {
+		return l1->timestamp>l2->timestamp? -1 : 1;
+	}
+	return l1->location_id>l2->location_id? -1 : (l1->location_id<l2->location_id? 1 : 0);
+}
+
+
+/*******************************************************************************
+ * compact storage of old tracks
+ ******************************************************************************/
+
+
+// tracks older than this are moved from the `locations` table
+// to the compact `locations_tracks` table by dc_housekeeping(), one row per chat, contact and day;
+// only days that end before this age are compacted.
+// compacted points have no location-id; locations bound to a message are not compacted, so no msg-id is lost.
+#define COMPACT_TRACKS_OLDER_THAN_SECONDS (7*24*60*60)
+
+// coordinates are stored as multiples of 1e-6 degrees, this is about 0.1 meters
+#define TRACK_COORD_SCALE 1000000.0
+
+
+static void put_varint(unsigned char** p, int64_t v)
+{
+	/* zigzag-encode the value and write it as a little-endian base-128 varint */
+	uint64_t u = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+	while (u >= 0x80) {
+		*(*p)++ = (unsigned char)(u | 0x80);
+		u >>= 7;
+	}
+	*(*p)++ = (unsigned char)u;
+}
+
+
+static int get_varint(const unsigned char** p, const unsigned char* end, int64_t* v)
+{
+	uint64_t u = 0;
+	int      shift = 0;
+	while (*p < end && shift < 64) {
+		unsigned char c = *(*p)++;
+		u |= (uint64_t)(c & 0x7F) << shift;
+		if (!(c & 0x80)) {
+			*v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+			return 1;
+		}
+		shift += 7;
+	}
+	return 0;
+}
+
+
+static unsigned char* encode_track(const dc_location_t* points, int cnt, const char* keep, time_t timestamp_begin, size_t* ret_bytes)
+{
+	/* each kept point is stored as the deltas of timestamp, latitude and longitude
+	to the previous point plus the accuracy in meters, all as zigzag varints */
+	unsigned char* buf = malloc(cnt*4*10 + 1);
+	unsigned char* p = buf;
+	int64_t        prev_timestamp = timestamp_begin, prev_lat = 0, prev_lng = 0;
+
+	if (buf==NULL) {
+		exit(55);
+	}
+
+	for (int i = 0; i < cnt; i++) {
+		if (keep[i]) {
+			int64_t lat = (int64_t)llround(points[i].latitude  * TRACK_COORD_SCALE);
+			int64_t lng = (int64_t)llround(points[i].longitude * TRACK_COORD_SCALE);
+			put_varint(&p, points[i].timestamp - prev_timestamp);
+			put_varint(&p, lat - prev_lat);
+			put_varint(&p, lng - prev_lng);
+			put_varint(&p, llround(points[i].accuracy));
+			prev_timestamp = points[i].timestamp;
+			prev_lat = lat;
+			prev_lng = lng;
+		}
+	}
+
+	*ret_bytes = p - buf;
+	return buf;
+}
+
+
+typedef struct track_filter_t
+{
+	time_t timestamp_from;
+	time_t timestamp_to;
+	int    has_area;
+	double latitude_min, longitude_min, latitude_max, longitude_max;
+	int    step;
+	int*   row;
+} track_filter_t;
+
+
+static int is_in_longitude_range(double longitude, double longitude_min, double longitude_max)
+{
+	if (longitude_min>longitude_max) {
+		/* the range crosses the antimeridian */
+		return (longitude>=longitude_min || longitude<=longitude_max);
+	}
+	return (longitude>=longitude_min && longitude<=longitude_max);
+}
+
+
+static void add_compacted_locations(dc_context_t* context, dc_array_t* ret,
+                                    const char* filter, const track_filter_t* tf)
+{
+	/* decode the compacted tracks matching filter and timespan
+	and add the points that are inside the area, if any;
+	afterwards, ret is sorted again as the points are older than most of the others */
+	sqlite3_stmt* stmt = NULL;
+	char*         q3 = NULL;
+	size_t        cnt_before = dc_array_get_cnt(ret);
+
+	q3 = sqlite3_mprintf(
+			"SELECT chat_id, from_id, timestamp_begin, points"
+			" FROM locations_tracks l"
+			" WHERE %s AND l.timestamp_end>=? AND l.timestamp_begin<=?"
+			"   AND (? OR (l.latitude_max>=? AND l.latitude_min<=? AND (l.longitude_max>=? %s l.longitude_min<=?)));",
+			filter, tf->longitude_min>tf->longitude_max? "OR" : "AND"/*area crosses the antimeridian*/);
+	stmt = dc_sqlite3_prepare(context->sql, q3);
+	sqlite3_bind_int64 (stmt, 1, tf->timestamp_from);
+	sqlite3_bind_int64 (stmt, 2, tf->timestamp_to);
+	sqlite3_bind_int   (stmt, 3, tf->has_area? 0 : 1);
+	sqlite3_bind_double(stmt, 4, tf->latitude_min);
+	sqlite3_bind_double(stmt, 5, tf->latitude_max);
+	sqlite3_bind_double(stmt, 6, tf->longitude_min);
+	sqlite3_bind_double(stmt, 7, tf->longitude_max);
+	while (sqlite3_step(stmt)==SQLITE_ROW)
+	{
+		uint32_t             chat_id   = sqlite3_column_int  (stmt, 0);
+		uint32_t             from_id   = sqlite3_column_int  (stmt, 1);
+		int64_t              timestamp = sqlite3_column_int64(stmt, 2);
+		const unsigned char* p         = sqlite3_column_blob (stmt, 3);
+		const unsigned char* end       = p + sqlite3_column_bytes(stmt, 3);
+		int64_t              lat = 0, lng = 0, d_timestamp, d_lat, d_lng, accuracy;
+
+		while (get_varint(&p, end, &d_timestamp) && get_varint(&p, end, &d_lat)
+		    && get_varint(&p, end, &d_lng) && get_varint(&p, end, &accuracy))
+		{
+			timestamp += d_timestamp;
+			lat += d_lat;
+			lng += d_lng;
+
+			if (timestamp<tf->timestamp_from || timestamp>tf->timestamp_to) {
+				continue;
+			}
+
+			if (tf->has_area
+			 && (lat/TRACK_COORD_SCALE<tf->latitude_min || lat/TRACK_COORD_SCALE>tf->latitude_max
+			  || !is_in_longitude_range(lng/TRACK_COORD_SCALE, tf->longitude_min, tf->longitude_max))) {
+				continue;
+			}
+
+			if (tf->row && ((*tf->row)++)%tf->step!=0) {
+				continue;
+			}
+
+			dc_location_t loc;
+			memset(&loc, 0, sizeof(dc_location_t));
+			loc.latitude   = lat/TRACK_COORD_SCALE;
+			loc.longitude  = lng/TRACK_COORD_SCALE;
+			loc.accuracy   = accuracy;
+			loc.timestamp  = timestamp;
+			loc.contact_id = from_id;
+			loc.chat_id    = chat_id;
+			dc_array_add_location(ret, &loc);
+		}
+	}
+
+	if (dc_array_get_cnt(ret)!=cnt_before) {
+		qsort(ret->locations, dc_array_get_cnt(ret), sizeof(dc_location_t), cmp_locations_newest_first);
+	}
+	sqlite3_finalize(stmt);
+	sqlite3_free(q3);
+}
+
+
+static void compact_track(dc_context_t* context, uint32_t chat_id, uint32_t from_id,
+                          time_t day_begin, time_t day_end)
+{
+	sqlite3_stmt*  stmt = NULL;
+	dc_array_t*    points = dc_array_new_typed(context, DC_ARRAY_LOCATIONS, 100);
+	char*          keep = NULL;
+	unsigned char* blob = NULL;
+	size_t         blob_bytes = 0;
+	double         latitude_min = 90.0, latitude_max = -90.0, longitude_min = 180.0, longitude_max = -180.0;
+
+	// locations bound to messages are kept as they are
+	#define COMPACTABLE_LOCATIONS \
+		" FROM locations" \
+		" WHERE chat_id=? AND from_id=? AND timestamp>=? AND timestamp<? AND independent=0" \
+		"   AND id NOT IN (SELECT location_id FROM msgs WHERE location_id!=0)"
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT latitude, longitude, accuracy, timestamp" COMPACTABLE_LOCATIONS " ORDER BY timestamp;");
+	sqlite3_bind_int  (stmt, 1, chat_id);
+	sqlite3_bind_int  (stmt, 2, from_id);
+	sqlite3_bind_int64(stmt, 3, day_begin);
+	sqlite3_bind_int64(stmt, 4, day_end);
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_location_t loc;
+		memset(&loc, 0, sizeof(dc_location_t));
+		loc.latitude  = sqlite3_column_double(stmt, 0);
+		loc.longitude = sqlite3_column_double(stmt, 1);
+		loc.accuracy  = sqlite3_column_double(stmt, 2);
+		loc.timestamp = sqlite3_column_int64 (stmt, 3);
+		latitude_min  = DC_MIN(latitude_min,  loc.latitude);
+		latitude_max  = DC_MAX(latitude_max,  loc.latitude);
+		longitude_min = DC_MIN(longitude_min, loc.longitude);
+		longitude_max = DC_MAX(longitude_max, loc.longitude);
+		dc_array_add_location(points, &loc);
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	int cnt = dc_array_get_cnt(points);
+	if (cnt==0) {
+		goto cleanup;
+	}
+
+	keep = malloc(cnt);
+	simplify_track(points->locations, cnt, keep);
+	blob = encode_track(points->locations, cnt, keep, day_begin, &blob_bytes);
+
+	// dc_sqlite3_begin_transaction() may be compiled out,
+	// however, the day must not be stored twice if we get interrupted between INSERT and DELETE
+	if (!dc_sqlite3_execute(context->sql, "BEGIN;")) {
+		goto cleanup;
+	}
+
+		stmt = dc_sqlite3_prepare(context->sql,
+			"INSERT INTO locations_tracks"
+			" (chat_id, from_id, timestamp_begin, timestamp_end, latitude_min, latitude_max, longitude_min, longitude_max, points)"
+			" VALUES (?,?,?,?, ?,?,?,?, ?);");
+		sqlite3_bind_int   (stmt, 1, chat_id);
+		sqlite3_bind_int   (stmt, 2, from_id);
+		sqlite3_bind_int64 (stmt, 3, day_begin);
+		sqlite3_bind_int64 (stmt, 4, points->locations[cnt-1].timestamp);
+		sqlite3_bind_double(stmt, 5, latitude_min);
+		sqlite3_bind_double(stmt, 6, latitude_max);
+		sqlite3_bind_double(stmt, 7, longitude_min);
+		sqlite3_bind_double(stmt, 8, longitude_max);
+		sqlite3_bind_blob  (stmt, 9, blob, blob_bytes, SQLITE_STATIC);
+		if (sqlite3_step(stmt)!=SQLITE_DONE) {
+			dc_sqlite3_execute(context->sql, "ROLLBACK;");
+			goto cleanup;
+		}
+		sqlite3_finalize(stmt);
+
+		stmt = dc_sqlite3_prepare(context->sql, "DELETE" COMPACTABLE_LOCATIONS ";");
+		sqlite3_bind_int  (stmt, 1, chat_id);
+		sqlite3_bind_int  (stmt, 2, from_id);
+		sqlite3_bind_int64(stmt, 3, day_begin);
+		sqlite3_bind_int64(stmt, 4, day_end);
+		if (sqlite3_step(stmt)!=SQLITE_DONE) {
+			dc_sqlite3_execute(context->sql, "ROLLBACK;");
+			goto cleanup;
+		}
+
+	if (!dc_sqlite3_execute(context->sql, "COMMIT;")) {
+		goto cleanup;
+	}
+
+	dc_log_info(context, 0, "Compacted %i locations of chat #%i, contact #%i to %i bytes.",
+		cnt, (int)chat_id, (int)from_id, (int)blob_bytes);
+
+cleanup:
+	sqlite3_finalize(stmt);
+	dc_array_unref(points);
+	free(keep);
+	free(blob);
+}
+
+
+void dc_compact_locations(dc_context_t* context)
+{
+	/* called by dc_housekeeping(); move the old tracks to compact storage, one row per chat, contact and day */
+	sqlite3_stmt* stmt = NULL;
+	dc_array_t*   tracks = dc_array_new(context, 30);
+	#define SECONDS_PER_DAY (24*60*60)
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		goto cleanup;
+	}
+
+	// collect the tracks first as compact_track() deletes from the table we're reading;
+	// only days that are completely older than COMPACT_TRACKS_OLDER_THAN_SECONDS are compacted
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT chat_id, from_id, timestamp/" DC_STRINGIFY(SECONDS_PER_DAY) " AS day"
+		" FROM locations"
+		" WHERE timestamp<? AND independent=0"
+		" GROUP BY chat_id, from_id, day;");
+	sqlite3_bind_int64(stmt, 1, ((time(NULL)-COMPACT_TRACKS_OLDER_THAN_SECONDS)/SECONDS_PER_DAY)*SECONDS_PER_DAY);
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_array_add_id  (tracks, sqlite3_column_int  (stmt, 0));
+		dc_array_add_id  (tracks, sqlite3_column_int  (stmt, 1));
+		dc_array_add_uint(tracks, sqlite3_column_int64(stmt, 2));
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	for (size_t i = 0; i+2 < dc_array_get_cnt(tracks); i += 3) {
+		time_t day_begin = dc_array_get_uint(tracks, i+2)*SECONDS_PER_DAY;
+		compact_track(context, dc_array_get_id(tracks, i), dc_array_get_id(tracks, i+1),
+			day_begin, day_begin+SECONDS_PER_DAY);
+	}
+
+cleanup:
+	sqlite3_finalize(stmt);
+	dc_array_unref(tracks);
+}
+
+
 /*******************************************************************************
  * create kml-files
  ******************************************************************************/
@@ -30,6 +443,8 @@ char* dc_get_location_kml(dc_context_t* context, uint32_t chat_id,
 	time_t           locations_send_until = 0;
 	time_t           locations_last_sent = 0;
 	int              location_count = 0;
+	dc_array_t*      locations = dc_array_new_typed(context, DC_ARRAY_LOCATIONS, 100);
+	char*            keep = NULL;
 	dc_strbuilder_t  ret;
 	dc_strbuilder_init(&ret, 1000);
 
@@ -80,11 +495,33 @@ char* dc_get_location_kml(dc_context_t* context, uint32_t chat_id,
 	sqlite3_bind_int   (stmt, 4, DC_CONTACT_ID_SELF);
 	while (sqlite3_step(stmt)==SQLITE_ROW)
 	{
-		uint32_t location_id = sqlite3_column_int(stmt, 0);
-		char*    latitude    = dc_ftoa(sqlite3_column_double(stmt, 1));
-		char*    longitude   = dc_ftoa(sqlite3_column_double(stmt, 2));
-		char*    accuracy    = dc_ftoa(sqlite3_column_double(stmt, 3));
-		char*    timestamp   = get_kml_timestamp(sqlite3_column_int64 (stmt, 4));
+		dc_location_t location;
+		memset(&location, 0, sizeof(dc_location_t));
+		location.location_id = sqlite3_column_int   (stmt, 0);
+		location.latitude    = sqlite3_column_double(stmt, 1);
+		location.longitude   = sqlite3_column_double(stmt, 2);
+		location.accuracy    = sqlite3_column_double(stmt, 3);
+		location.timestamp   = sqlite3_column_int64 (stmt, 4);
+		dc_array_add_location(locations, &location);
+	}
+
+	// send only the points needed to draw the track
+	location_count = dc_array_get_cnt(locations);
+	keep = malloc(location_count+1);
+	simplify_track(locations->locations, location_count, keep);
+
+	for (int i = 0; i < location_count; i++)
+	{
+		const dc_location_t* location = dc_array_get_ptr(locations, i);
+		if (!keep[i]) {
+			continue;
+		}
+
+		uint32_t location_id = location->location_id;
+		char*    latitude    = dc_ftoa(location->latitude);
+		char*    longitude   = dc_ftoa(location->longitude);
+		char*    accuracy    = dc_ftoa(location->accuracy);
+		char*    timestamp   = get_kml_timestamp(location->timestamp);
 
 		dc_strbuilder_catf(&ret,
 			"<Placemark>"
@@ -96,8 +533,6 @@ char* dc_get_location_kml(dc_context_t* context, uint32_t chat_id,
 			longitude, // reverse order!
 			latitude);
 
-		location_count++;
-
 		if (last_added_location_id) {
 			*last_added_location_id = location_id;
 		}
@@ -120,6 +555,8 @@ char* dc_get_location_kml(dc_context_t* context, uint32_t chat_id,
 
 cleanup:
 	sqlite3_finalize(stmt);
+	dc_array_unref(locations);
+	free(keep);
 	free(self_addr);
 	if (!success) {
 		free(ret.buf);
@@ -303,9 +740,7 @@ static void kml_endtag_cb(void* userdata, const char* tag)
 		if (kml->tag&TAG_PLACEMARK && kml->curr.timestamp
 		 && kml->curr.latitude && kml->curr.longitude)
 		{
-			dc_location_t* location = calloc(1, sizeof(dc_location_t));
-			*location = kml->curr;
-			dc_array_add_ptr(kml->locations, location);
+			dc_array_add_location(kml->locations, &kml->curr);
 		}
 		kml->tag = 0;
 	}
@@ -365,15 +800,34 @@ uint32_t dc_save_locations(dc_context_t* context,
                            const dc_array_t* locations,
                            int independent)
 {
-	sqlite3_stmt* stmt_test = NULL;
-	sqlite3_stmt* stmt_insert = NULL;
-	time_t        newest_timestamp = 0;
-	uint32_t      newest_location_id = 0;
+	sqlite3_stmt*   stmt_test = NULL;
+	sqlite3_stmt*   stmt_insert = NULL;
+	time_t          newest_timestamp = 0;
+	uint32_t        newest_location_id = 0;
+	dc_location_t*  sorted = NULL;
+	char*           keep = NULL;
+	int             cnt = 0;
 
 	if (context==NULL ||  context->magic!=DC_CONTEXT_MAGIC
-	 || chat_id<=DC_CHAT_ID_LAST_SPECIAL || locations==NULL) {
+	 || chat_id<=DC_CHAT_ID_LAST_SPECIAL || locations==NULL || locations->type!=DC_ARRAY_LOCATIONS) {
+		goto cleanup;
+	}
+
+	// tracks are simplified before they are stored, independent locations are stored as they are
+	cnt = dc_array_get_cnt(locations);
+	sorted = malloc(sizeof(dc_location_t)*cnt + 1);
+	keep = malloc(cnt + 1);
+	if (sorted==NULL || keep==NULL) {
 		goto cleanup;
 	}
+	memcpy(sorted, locations->locations, sizeof(dc_location_t)*cnt);
+	if (independent) {
+		memset(keep, 1, cnt);
+	}
+	else {
+		qsort(sorted, cnt, sizeof(dc_location_t), cmp_locations_by_timestamp);
+		simplify_track(sorted, cnt, keep);
+	}
 
 	stmt_test = dc_sqlite3_prepare(context->sql,
 		"SELECT id FROM locations WHERE timestamp=? AND from_id=?");
@@ -383,9 +837,12 @@ uint32_t dc_save_locations(dc_context_t* context,
 		" (timestamp,from_id,chat_id, latitude,longitude,accuracy, independent)"
 		" VALUES (?,?,?, ?,?,?, ?);");
 
-	for (int i=0; i<dc_array_get_cnt(locations); i++)
+	for (int i=0; i<cnt; i++)
 	{
-		dc_location_t* location = dc_array_get_ptr(locations, i);
+		const dc_location_t* location = &sorted[i];
+		if (!keep[i]) {
+			continue;
+		}
 
 		sqlite3_reset     (stmt_test);
 		sqlite3_bind_int64(stmt_test, 1, location->timestamp);
@@ -414,6 +871,8 @@ uint32_t dc_save_locations(dc_context_t* context,
 cleanup:
 	sqlite3_finalize(stmt_test);
 	sqlite3_finalize(stmt_insert);
+	free(sorted);
+	free(keep);
 	return newest_location_id;
 }
 
@@ -733,6 +1192,7 @@ int dc_set_location(dc_context_t* context,
 	{
 		uint32_t chat_id = sqlite3_column_int(stmt_chats, 0);
 
+		sqlite3_finalize(stmt_insert);
 		stmt_insert = dc_sqlite3_prepare(context->sql,
 				"INSERT INTO locations "
 				" (latitude, longitude, accuracy, timestamp, chat_id, from_id)"
@@ -772,6 +1232,64 @@ static int is_marker(const char* txt)
 }
 
 
+#define LOCATION_FIELDS " l.id, l.latitude, l.longitude, l.accuracy, l.timestamp, l.independent, " \
+                        " m.id, l.from_id, l.chat_id, m.txt "
+
+
+static void location_from_stmt(sqlite3_stmt* stmt, dc_location_t* loc)
+{
+	/* fill a location from a row selected with LOCATION_FIELDS */
+	memset(loc, 0, sizeof(dc_location_t));
+
+	loc->location_id = sqlite3_column_int   (stmt, 0);
+	loc->latitude    = sqlite3_column_double(stmt, 1);
+	loc->longitude   = sqlite3_column_double(stmt, 2);
+	loc->accuracy    = sqlite3_column_double(stmt, 3);
+	loc->timestamp   = sqlite3_column_int64 (stmt, 4);
+	loc->independent = sqlite3_column_int   (stmt, 5);
+	loc->msg_id      = sqlite3_column_int   (stmt, 6);
+	loc->contact_id  = sqlite3_column_int   (stmt, 7);
+	loc->chat_id     = sqlite3_column_int   (stmt, 8);
+	if (loc->msg_id) {
+		const char* txt = (const char*)sqlite3_column_text(stmt, 9);
+		if (is_marker(txt)) {
+			loc->marker = strdup(txt);
+		}
+	}
+}
+
+
+static char* get_locations_filter(uint32_t chat_id, uint32_t contact_id)
+{
+	/* a condition that does not hide the ids from the query planner,
+	as `(? OR l.chat_id=?)` would do */
+	if (chat_id && contact_id) {
+		return dc_mprintf("l.chat_id=%i AND l.from_id=%i", (int)chat_id, (int)contact_id);
+	}
+	else if (chat_id) {
+		return dc_mprintf("l.chat_id=%i", (int)chat_id);
+	}
+	else if (contact_id) {
+		return dc_mprintf("l.from_id=%i", (int)contact_id);
+	}
+	return dc_strdup("1");
+}
+
+
+static void bind_area(sqlite3_stmt* stmt,
+                      double latitude_min, double longitude_min,
+                      double latitude_max, double longitude_max,
+                      time_t timestamp_from, time_t timestamp_to)
+{
+	sqlite3_bind_double(stmt, 1, latitude_min);
+	sqlite3_bind_double(stmt, 2, longitude_min);
+	sqlite3_bind_double(stmt, 3, latitude_max);
+	sqlite3_bind_double(stmt, 4, longitude_max);
+	sqlite3_bind_int64 (stmt, 5, timestamp_from);
+	sqlite3_bind_int64 (stmt, 6, timestamp_to);
+}
+
+
 /**
  * Get shared locations from the database.
  * The locations can be filtered by the chat-id, the contact-id
@@ -783,6 +1301,7 @@ static int is_marker(const char* txt)
  * dc_array_get_accuracy(), dc_array_get_timestamp(), dc_array_get_contact_id()
  * and dc_array_get_msg_id().
  * The latter returns 0 if there is no message bound to the location.
+ * Locations older than 7 days are stored in a compact way, dc_array_get_id() returns 0 for them.
  *
  * Note that only if dc_array_is_independent() returns 0,
  * the location is the current or a past position of the user.
@@ -839,6 +1358,9 @@ dc_array_t* dc_get_locations(dc_context_t* context,
 {
 	dc_array_t*   ret = dc_array_new_typed(context, DC_ARRAY_LOCATIONS, 500);
 	sqlite3_stmt* stmt = NULL;
+	char*         filter = NULL;
+	char*         q3 = NULL;
+	track_filter_t tf;
 
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
 		goto cleanup;
@@ -848,49 +1370,186 @@ dc_array_t* dc_get_locations(dc_context_t* context,
 		timestamp_to = time(NULL) + 10/*messages may be inserted by another thread just now*/;
 	}
 
-	stmt = dc_sqlite3_prepare(context->sql,
-			"SELECT l.id, l.latitude, l.longitude, l.accuracy, l.timestamp, l.independent, "
-			"       m.id, l.from_id, l.chat_id, m.txt "
+	// the timespan and the independent locations are selected separately
+	// so that the (chat_id, timestamp) resp. (from_id, timestamp) indexes can be used for the timespan.
+	filter = get_locations_filter(chat_id, contact_id);
+	q3 = sqlite3_mprintf(
+			"SELECT " LOCATION_FIELDS
+			" FROM locations l "
+			" LEFT JOIN msgs m ON l.id=m.location_id "
+			" WHERE %s AND l.timestamp>=? AND l.timestamp<=? AND l.independent=0 "
+			" UNION ALL "
+			"SELECT " LOCATION_FIELDS
 			" FROM locations l "
 			" LEFT JOIN msgs m ON l.id=m.location_id "
-			" WHERE (? OR l.chat_id=?) "
-			"   AND (? OR l.from_id=?) "
-			"   AND (l.independent=1 OR (l.timestamp>=? AND l.timestamp<=?)) "
-			" ORDER BY l.timestamp DESC, l.id DESC, m.id DESC;");
-	sqlite3_bind_int(stmt, 1, chat_id==0? 1 : 0);
-	sqlite3_bind_int(stmt, 2, chat_id);
-	sqlite3_bind_int(stmt, 3, contact_id==0? 1 : 0);
-	sqlite3_bind_int(stmt, 4, contact_id);
-	sqlite3_bind_int(stmt, 5, timestamp_from);
-	sqlite3_bind_int(stmt, 6, timestamp_to);
+			" WHERE %s AND l.independent=1 "
+			" ORDER BY 5 DESC, 1 DESC, 7 DESC;",
+			filter, filter);
+	stmt = dc_sqlite3_prepare(context->sql, q3);
+	sqlite3_bind_int64(stmt, 1, timestamp_from);
+	sqlite3_bind_int64(stmt, 2, timestamp_to);
 
 	while (sqlite3_step(stmt)==SQLITE_ROW) {
-        struct _dc_location* loc = calloc(1, sizeof(struct _dc_location));
-        if (loc==NULL) {
-			goto cleanup;
-        }
+		dc_location_t loc;
+		location_from_stmt(stmt, &loc);
+		dc_array_add_location(ret, &loc);
+	}
 
-		loc->location_id = sqlite3_column_double(stmt, 0);
-		loc->latitude    = sqlite3_column_double(stmt, 1);
-		loc->longitude   = sqlite3_column_double(stmt, 2);
-		loc->accuracy    = sqlite3_column_double(stmt, 3);
-		loc->timestamp   = sqlite3_column_int64 (stmt, 4);
-		loc->independent = sqlite3_column_int   (stmt, 5);
-		loc->msg_id      = sqlite3_column_int   (stmt, 6);
-		loc->contact_id  = sqlite3_column_int   (stmt, 7);
-		loc->chat_id     = sqlite3_column_int   (stmt, 8);
-		if (loc->msg_id) {
-			const char* txt = (const char*)sqlite3_column_text(stmt, 9);
-			if (is_marker(txt)) {
-				loc->marker = strdup(txt);
-			}
+	memset(&tf, 0, sizeof(track_filter_t));
+	tf.timestamp_from = timestamp_from;
+	tf.timestamp_to   = timestamp_to;
+	add_compacted_locations(context, ret, filter, &tf);
+
+cleanup:
+	sqlite3_finalize(stmt);
+	sqlite3_free(q3);
+	free(filter);
+	return ret;
+}
+
+
+/**
+ * Get shared locations inside a given area.
+ * This function is meant for map views that show only a part of the world;
+ * in contrast to dc_get_locations(), the number of returned locations is limited,
+ * if there are more locations in the area, they are downsampled evenly over the timespan.
+ * Locations marked by the user, see dc_array_is_independent(), are always returned.
+ *
+ * If the underlying SQLite library supports R*Tree indexes,
+ * the area is looked up using such an index, otherwise the timespan is scanned.
+ *
+ * @memberof dc_context_t
+ * @param context The context object.
+ * @param chat_id Chat-id to get location information for.
+ *     0 to get locations independently of the chat.
+ * @param contact_id Contact-id to get location information for.
+ *     0 to get locations independently of the contact.
+ * @param latitude_min South border of the area.
+ * @param longitude_min West border of the area.
+ * @param latitude_max North border of the area.
+ * @param longitude_max East border of the area.
+ *     If the area crosses the antimeridian, longitude_max is smaller than longitude_min,
+ *     eg. 170.0 to -170.0 for the 20 degrees around the antimeridian.
+ * @param timestamp_from Start of timespan to return.
+ *     0 for "start from the beginning".
+ * @param timestamp_to End of timespan to return.
+ *     0 for "all up to now".
+ * @param max_cnt Maximal number of locations to return, not counting independent locations.
+ *     0 for the default of 1000 locations.
+ * @return Array of locations, NULL is never returned.
+ *     The array is sorted as the one returned by dc_get_locations().
+ *     The returned array must be freed using dc_array_unref().
+ */
+dc_array_t* dc_get_locations_in_area(dc_context_t* context,
+                                     uint32_t chat_id, uint32_t contact_id,
+                                     double latitude_min, double longitude_min,
+                                     double latitude_max, double longitude_max,
+                                     time_t timestamp_from, time_t timestamp_to,
+                                     int max_cnt)
+{
+	#define DEFAULT_MAX_AREA_LOCATIONS 1000
+	dc_array_t*   ret = dc_array_new_typed(context, DC_ARRAY_LOCATIONS, 100);
+	sqlite3_stmt* stmt = NULL;
+	char*         filter = NULL;
+	char*         area = NULL;
+	const char*   lon_op = NULL;
+	char*         q3 = NULL;
+	int           cnt = 0;
+	int           step = 1;
+	int           row = 0;
+	track_filter_t tf;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		goto cleanup;
+	}
+
+	if (timestamp_to==0) {
+		timestamp_to = time(NULL) + 10/*messages may be inserted by another thread just now*/;
+	}
+
+	if (max_cnt<=0) {
+		max_cnt = DEFAULT_MAX_AREA_LOCATIONS;
+	}
+
+	// if longitude_min is larger than longitude_max, the area crosses the antimeridian
+	lon_op = longitude_min>longitude_max? "OR" : "AND";
+
+	filter = get_locations_filter(chat_id, contact_id);
+	if (sqlite3_compileoption_used("ENABLE_RTREE") && dc_sqlite3_table_exists(context->sql, "locations_rtree")) {
+		// the R*Tree stores 32 bit floats that are rounded outwards,
+		// so we look for overlapping boxes there and compare the exact values afterwards
+		area = dc_mprintf("l.id IN (SELECT id FROM locations_rtree"
+			" WHERE max_lat>=?1 AND min_lat<=?3 AND (max_lon>=?2 %s min_lon<=?4))"
+			" AND l.latitude>=?1 AND l.latitude<=?3 AND (l.longitude>=?2 %s l.longitude<=?4)",
+			lon_op, lon_op);
+	}
+	else {
+		area = dc_mprintf("l.latitude>=?1 AND l.latitude<=?3 AND (l.longitude>=?2 %s l.longitude<=?4)",
+			lon_op);
+	}
+
+	// count the locations to calculate the downsampling step
+	q3 = sqlite3_mprintf(
+			"SELECT COUNT(*) FROM locations l"
+			" WHERE %s AND %s AND l.timestamp>=?5 AND l.timestamp<=?6 AND l.independent=0;",
+			area, filter);
+	stmt = dc_sqlite3_prepare(context->sql, q3);
+	bind_area(stmt, latitude_min, longitude_min, latitude_max, longitude_max, timestamp_from, timestamp_to);
+	if (sqlite3_step(stmt)==SQLITE_ROW) {
+		cnt = sqlite3_column_int(stmt, 0);
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+	sqlite3_free(q3);
+
+	step = (cnt+max_cnt-1)/max_cnt;
+	if (step<1) {
+		step = 1;
+	}
+
+	q3 = sqlite3_mprintf(
+			"SELECT " LOCATION_FIELDS
+			" FROM locations l "
+			" LEFT JOIN msgs m ON l.id=m.location_id "
+			" WHERE %s AND %s AND l.timestamp>=?5 AND l.timestamp<=?6 AND l.independent=0 "
+			" UNION ALL "
+			"SELECT " LOCATION_FIELDS
+			" FROM locations l "
+			" LEFT JOIN msgs m ON l.id=m.location_id "
+			" WHERE %s AND %s AND l.independent=1 "
+			" ORDER BY 5 DESC, 1 DESC, 7 DESC;",
+			area, filter, area, filter);
+	stmt = dc_sqlite3_prepare(context->sql, q3);
+	bind_area(stmt, latitude_min, longitude_min, latitude_max, longitude_max, timestamp_from, timestamp_to);
+
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		if (sqlite3_column_int(stmt, 5)==0/*independent*/ && (row++)%step!=0) {
+			continue;
 		}
 
-		dc_array_add_ptr(ret, loc);
+		dc_location_t loc;
+		location_from_stmt(stmt, &loc);
+		dc_array_add_location(ret, &loc);
 	}
 
+	// compacted tracks are downsampled with the same step, they are not part of the count above
+	memset(&tf, 0, sizeof(track_filter_t));
+	tf.timestamp_from = timestamp_from;
+	tf.timestamp_to   = timestamp_to;
+	tf.has_area       = 1;
+	tf.latitude_min   = latitude_min;
+	tf.longitude_min  = longitude_min;
+	tf.latitude_max   = latitude_max;
+	tf.longitude_max  = longitude_max;
+	tf.step           = step;
+	tf.row            = &row;
+	add_compacted_locations(context, ret, filter, &tf);
+
 cleanup:
 	sqlite3_finalize(stmt);
+	sqlite3_free(q3);
+	free(filter);
+	free(area);
 	return ret;
 }
 
@@ -917,6 +1576,11 @@ void dc_delete_all_locations(dc_context_t* context)
 	stmt = dc_sqlite3_prepare(context->sql,
 		"DELETE FROM locations;");
 	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"DELETE FROM locations_tracks;");
+	sqlite3_step(stmt);
 
 	context->cb(context, DC_EVENT_LOCATION_CHANGED, 0, 0);
 
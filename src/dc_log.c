@@ -20,6 +20,10 @@ static void log_vprintf(dc_context_t* context, int event, int data1, const char*
 		return;
 	}
 
+	if (event<context->min_log_level && event>=DC_EVENT_INFO && event<DC_EVENT_ERROR) {
+		return; /* skip formatting of unwanted info and warnings; errors are always reported */
+	}
+
 	if (msg_format)
 	{
 		#define BUFSIZE 1024
@@ -88,3 +92,264 @@ void dc_log_error(dc_context_t* context, int data1, const char* msg, ...)
 		log_vprintf(context, DC_EVENT_ERROR, data1, msg, va);
 	va_end(va);
 }
+
+
+/*******************************************************************************
+ * Log level and event queue
+ ******************************************************************************/
+
+
+#define EVENT_QUEUE_LOCK   { pthread_mutex_lock(&context->event_queue_critical); }
+#define EVENT_QUEUE_UNLOCK { pthread_mutex_unlock(&context->event_queue_critical); }
+
+// the i-th queued event, 0 is the oldest one
+#define QUEUE_SLOT(i)         (&context->event_queue[(context->event_queue_first+(i)) % context->event_queue_size])
+
+// info and warnings are dropped first if the queue is full, errors are kept
+#define IS_DROPPABLE_EVENT(e) ((e)>=DC_EVENT_INFO && (e)<DC_EVENT_ERROR)
+
+
+/**
+ * Set the minimal level of log events passed to the callback or to the event queue.
+ * Info and warnings below the level are dropped before the message is even formatted,
+ * errors are always reported.
+ *
+ * @memberof dc_context_t
+ * @param context The context object as created by dc_context_new().
+ * @param event One of DC_EVENT_INFO, DC_EVENT_WARNING or DC_EVENT_ERROR.
+ *     The default is DC_EVENT_INFO, all log events are reported then.
+ * @return None.
+ */
+void dc_set_min_log_level(dc_context_t* context, int event)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return;
+	}
+
+	context->min_log_level = event;
+}
+
+
+static void event_slot_empty(dc_event_slot_t* slot)
+{
+	if (DC_EVENT_DATA1_IS_STRING(slot->event)) {
+		free((char*)slot->data1);
+	}
+
+	if (DC_EVENT_DATA2_IS_STRING(slot->event)) {
+		free((char*)slot->data2);
+	}
+
+	memset(slot, 0, sizeof(dc_event_slot_t));
+}
+
+
+static int coalesce_event(dc_context_t* context, int event, uintptr_t data1, uintptr_t data2)
+{
+	/* merge repeated events for the same chat into a pending one.
+	this is fine as the ui reads the current state from the database when handling the event anyway.
+	the caller must hold event_queue_critical. */
+	if (event!=DC_EVENT_MSGS_CHANGED && event!=DC_EVENT_INCOMING_MSG) {
+		return 0;
+	}
+
+	for (int i = context->event_queue_cnt-1; i>=0; i--)
+	{
+		dc_event_slot_t* slot = QUEUE_SLOT(i);
+		if (slot->event!=event) {
+			continue;
+		}
+
+		if (event==DC_EVENT_MSGS_CHANGED)
+		{
+			if (slot->data1==0 && slot->data2==0) {
+				return 1; /* everything is reloaded anyway */
+			}
+			else if (slot->data1==data1) {
+				if (slot->data2!=data2) {
+					slot->data2 = 0; /* several messages changed */
+				}
+				return 1;
+			}
+		}
+		else if (slot->data1==data1)
+		{
+			slot->data2 = data2; /* notify about the newest message of the chat only */
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+static uintptr_t cb_queue_event(dc_context_t* context, int event, uintptr_t data1, uintptr_t data2)
+{
+	dc_event_slot_t* slot = NULL;
+
+	if (DC_EVENT_RETURNS_INT(event) || DC_EVENT_RETURNS_STRING(event) || event==DC_EVENT_HTTP_POST) {
+		return context->queue_user_cb(context, event, data1, data2);
+	}
+
+	EVENT_QUEUE_LOCK
+
+		if (context->event_queue==NULL) {
+			EVENT_QUEUE_UNLOCK
+			return context->queue_user_cb(context, event, data1, data2); /* just disabled */
+		}
+
+		if (coalesce_event(context, event, data1, data2)) {
+			goto cleanup;
+		}
+
+		if (context->event_queue_cnt>=context->event_queue_size)
+		{
+			/* the queue is full; rather lose log messages than changes:
+			drop the oldest queued log event, only if there is none, drop the oldest event */
+			context->event_queue_dropped++;
+			if (IS_DROPPABLE_EVENT(event)) {
+				goto cleanup;
+			}
+
+			int victim = 0;
+			for (int i = 0; i < context->event_queue_cnt; i++) {
+				if (IS_DROPPABLE_EVENT(QUEUE_SLOT(i)->event)) {
+					victim = i;
+					break;
+				}
+			}
+
+			event_slot_empty(QUEUE_SLOT(victim));
+			for (int i = victim; i > 0; i--) {
+				*QUEUE_SLOT(i) = *QUEUE_SLOT(i-1); /* move the older events up, the order is kept */
+			}
+			memset(QUEUE_SLOT(0), 0, sizeof(dc_event_slot_t));
+			context->event_queue_first = (context->event_queue_first+1) % context->event_queue_size;
+			context->event_queue_cnt--;
+		}
+
+		slot = QUEUE_SLOT(context->event_queue_cnt);
+		slot->event = event;
+		slot->data1 = DC_EVENT_DATA1_IS_STRING(event)? (uintptr_t)dc_strdup_keep_null((char*)data1) : data1;
+		slot->data2 = DC_EVENT_DATA2_IS_STRING(event)? (uintptr_t)dc_strdup_keep_null((char*)data2) : data2;
+		context->event_queue_cnt++;
+
+cleanup:
+	EVENT_QUEUE_UNLOCK
+	return 0;
+}
+
+
+/**
+ * Queue events instead of passing them to the callback.
+ *
+ * Once enabled, events that do not require an answer are not passed to the
+ * callback given to dc_context_new() but are added to a bounded queue
+ * that can be drained by dc_get_next_event() from any thread.
+ * Events that require an answer, eg. #DC_EVENT_GET_STRING or #DC_EVENT_HTTP_GET,
+ * are still passed to the callback on the calling thread.
+ *
+ * Repeated #DC_EVENT_MSGS_CHANGED events for the same chat are merged to a single one,
+ * with data2 set to 0 if several messages are affected.
+ * Repeated #DC_EVENT_INCOMING_MSG events for the same chat are merged to a single one
+ * referring to the newest message.
+ *
+ * If the queue is full, log events are dropped, if there are no more log events,
+ * the oldest events are dropped.  The number of dropped events is reported
+ * by a #DC_EVENT_WARNING then.
+ *
+ * @memberof dc_context_t
+ * @param context The context object as created by dc_context_new().
+ * @param max_events The maximal number of events to hold in the queue.
+ *     0 disables the queue; pending events are discarded and events are passed to the callback again.
+ * @return None.
+ */
+void dc_enable_event_queue(dc_context_t* context, int max_events)
+{
+	dc_event_slot_t* new_queue = NULL;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return;
+	}
+
+	if (max_events>0 && (new_queue=calloc(max_events, sizeof(dc_event_slot_t)))==NULL) {
+		exit(69);
+	}
+
+	EVENT_QUEUE_LOCK
+
+		for (int i = 0; i<context->event_queue_cnt; i++) {
+			event_slot_empty(QUEUE_SLOT(i));
+		}
+		event_slot_empty(&context->event_current);
+		free(context->event_queue);
+
+		context->event_queue         = new_queue;
+		context->event_queue_size    = max_events>0? max_events : 0;
+		context->event_queue_first   = 0;
+		context->event_queue_cnt     = 0;
+		context->event_queue_dropped = 0;
+
+		/* queue_user_cb is never reset as other threads may just be in cb_queue_event() */
+		if (new_queue && context->cb!=cb_queue_event) {
+			context->queue_user_cb = context->cb;
+			context->cb = cb_queue_event;
+		}
+		else if (new_queue==NULL && context->cb==cb_queue_event) {
+			context->cb = context->queue_user_cb;
+		}
+
+	EVENT_QUEUE_UNLOCK
+}
+
+
+/**
+ * Get the next event from the queue enabled by dc_enable_event_queue().
+ *
+ * Strings referenced by data1 or data2 are owned by the context
+ * and are valid until the next call of dc_get_next_event().
+ *
+ * @memberof dc_context_t
+ * @param context The context object as created by dc_context_new().
+ * @param ret_event Pointer to receive the event, one of the @ref DC_EVENT constants.
+ * @param ret_data1 Pointer to receive the first parameter of the event.
+ * @param ret_data2 Pointer to receive the second parameter of the event.
+ * @return 1=an event was returned, 0=the queue is empty or not enabled.
+ */
+int dc_get_next_event(dc_context_t* context, int* ret_event, uintptr_t* ret_data1, uintptr_t* ret_data2)
+{
+	int success = 0;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || ret_event==NULL || ret_data1==NULL || ret_data2==NULL) {
+		return 0;
+	}
+
+	EVENT_QUEUE_LOCK
+
+		event_slot_empty(&context->event_current);
+
+		if (context->event_queue_dropped)
+		{
+			context->event_current.event = DC_EVENT_WARNING;
+			context->event_current.data2 = (uintptr_t)dc_mprintf("%i events dropped, the event queue is full.", context->event_queue_dropped);
+			context->event_queue_dropped = 0;
+		}
+		else if (context->event_queue_cnt>0)
+		{
+			context->event_current = context->event_queue[context->event_queue_first];
+			memset(&context->event_queue[context->event_queue_first], 0, sizeof(dc_event_slot_t));
+			context->event_queue_first = (context->event_queue_first+1) % context->event_queue_size;
+			context->event_queue_cnt--;
+		}
+
+		if (context->event_current.event) {
+			*ret_event = context->event_current.event;
+			*ret_data1 = context->event_current.data1;
+			*ret_data2 = context->event_current.data2;
+			success = 1;
+		}
+
+	EVENT_QUEUE_UNLOCK
+
+	return success;
+}
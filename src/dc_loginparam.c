@@ -44,6 +44,29 @@ void dc_loginparam_empty(dc_loginparam_t* loginparam)
 }
 
 
+dc_loginparam_t* dc_loginparam_duplicate(const dc_loginparam_t* loginparam)
+{
+	dc_loginparam_t* ret = dc_loginparam_new();
+
+	if (loginparam==NULL) {
+		return ret;
+	}
+
+	ret->addr         = dc_strdup_keep_null(loginparam->addr);
+	ret->mail_server  = dc_strdup_keep_null(loginparam->mail_server);
+	ret->mail_port    =                     loginparam->mail_port;
+	ret->mail_user    = dc_strdup_keep_null(loginparam->mail_user);
+	ret->mail_pw      = dc_strdup_keep_null(loginparam->mail_pw);
+	ret->send_server  = dc_strdup_keep_null(loginparam->send_server);
+	ret->send_port    =                     loginparam->send_port;
+	ret->send_user    = dc_strdup_keep_null(loginparam->send_user);
+	ret->send_pw      = dc_strdup_keep_null(loginparam->send_pw);
+	ret->server_flags =                     loginparam->server_flags;
+
+	return ret;
+}
+
+
 void dc_loginparam_read(dc_loginparam_t* loginparam, dc_sqlite3_t* sql, const char* prefix)
 {
 	char* key = NULL;
@@ -36,6 +36,7 @@ struct _dc_loginparam
 dc_loginparam_t* dc_loginparam_new          ();
 void             dc_loginparam_unref        (dc_loginparam_t*);
 void             dc_loginparam_empty        (dc_loginparam_t*); /* clears all data and frees its memory. All pointers are NULL after this function is called. */
+dc_loginparam_t* dc_loginparam_duplicate    (const dc_loginparam_t*);
 void             dc_loginparam_read         (dc_loginparam_t*, dc_sqlite3_t*, const char* prefix);
 void             dc_loginparam_write        (const dc_loginparam_t*, dc_sqlite3_t*, const char* prefix);
 char*            dc_loginparam_get_readable (const dc_loginparam_t*);
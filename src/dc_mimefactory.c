@@ -64,10 +64,14 @@ void dc_mimefactory_empty(dc_mimefactory_t* factory)
 	free(factory->references);
 	factory->references = NULL;
 
+	free(factory->mdn_more_mids);
+	factory->mdn_more_mids = NULL;
+
 	if (factory->out) {
 		mmap_string_free(factory->out);
 		factory->out = NULL;
 	}
+	factory->out_bytes = 0;
 	factory->out_encrypted = 0;
 	factory->loaded = DC_MF_NOTHING_LOADED;
 
@@ -200,36 +204,59 @@ cleanup:
 }
 
 
-int dc_mimefactory_load_mdn(dc_mimefactory_t* factory, uint32_t msg_id)
+int dc_mimefactory_load_mdn(dc_mimefactory_t* factory, const dc_array_t* msg_ids)
 {
-	int           success = 0;
-	dc_contact_t* contact = NULL;
+	int             success = 0;
+	dc_contact_t*   contact = NULL;
+	dc_msg_t*       msg = NULL;
+	dc_strbuilder_t more_mids;
+	dc_strbuilder_init(&more_mids, 0);
 
-	if (factory==NULL) {
+	if (factory==NULL || msg_ids==NULL) {
 		goto cleanup;
 	}
 
 	factory->recipients_names = clist_new();
 	factory->recipients_addr  = clist_new();
-	factory->msg              = dc_msg_new_untyped(factory->context);
 
 	if (!dc_sqlite3_get_config_int(factory->context->sql, "mdns_enabled", DC_MDNS_DEFAULT_ENABLED)) {
 		goto cleanup; /* MDNs not enabled - check this is late, in the job. the use may have changed its choice while offline ... */
 	}
 
-	contact = dc_contact_new(factory->context);
-	if (!dc_msg_load_from_db(factory->msg, factory->context, msg_id)
-	 || !dc_contact_load_from_db(contact, factory->context->sql, factory->msg->from_id)) {
-		goto cleanup;
+	/* the first usable message becomes factory->msg, the others must be from the same sender
+	and are only listed by their Message-ID, see the `Additional-Message-IDs` field in dc_mimefactory_render() */
+	for (size_t i = 0; i<dc_array_get_cnt(msg_ids); i++)
+	{
+		dc_msg_unref(msg);
+		msg = dc_msg_new_untyped(factory->context);
+		if (!dc_msg_load_from_db(msg, factory->context, dc_array_get_id(msg_ids, i))
+		 || msg->chat_id<=DC_CHAT_ID_LAST_SPECIAL/* Do not send MDNs trash etc.; chats.blocked is already checked by the caller in dc_markseen_msgs() */
+		 || msg->from_id<=DC_CONTACT_ID_LAST_SPECIAL
+		 || msg->rfc724_mid==NULL || msg->rfc724_mid[0]==0) {
+			continue;
+		}
+
+		if (factory->msg==NULL) {
+			contact = dc_contact_new(factory->context);
+			if (!dc_contact_load_from_db(contact, factory->context->sql, msg->from_id)
+			 || contact->blocked) {
+				goto cleanup;
+			}
+			factory->msg = msg;
+			msg = NULL;
+		}
+		else if (msg->from_id==factory->msg->from_id) {
+			dc_strbuilder_catf(&more_mids, "%s<%s>", more_mids.eos==more_mids.buf? "" : LINEEND " ", msg->rfc724_mid);
+		}
 	}
 
-	if (contact->blocked
-	 || factory->msg->chat_id<=DC_CHAT_ID_LAST_SPECIAL/* Do not send MDNs trash etc.; chats.blocked is already checked by the caller in dc_markseen_msgs() */) {
+	if (factory->msg==NULL) {
 		goto cleanup;
 	}
 
-	if (factory->msg->from_id <= DC_CONTACT_ID_LAST_SPECIAL) {
-		goto cleanup;
+	if (more_mids.buf[0]) {
+		factory->mdn_more_mids = more_mids.buf;
+		more_mids.buf = NULL;
 	}
 
 	clist_append(factory->recipients_names, (void*)((contact->authname&&contact->authname[0])? dc_strdup(contact->authname) : NULL));
@@ -244,7 +271,9 @@ int dc_mimefactory_load_mdn(dc_mimefactory_t* factory, uint32_t msg_id)
 	factory->loaded = DC_MF_MDN_LOADED;
 
 cleanup:
+	dc_msg_unref(msg);
 	dc_contact_unref(contact);
+	free(more_mids.buf);
 	return success;
 }
 
@@ -427,7 +456,40 @@ static char* get_subject(const dc_chat_t* chat, const dc_msg_t* msg, int afwd_em
 }
 
 
-int dc_mimefactory_render(dc_mimefactory_t* factory)
+static int write_to_file(dc_context_t* context, const char* pathNfilename, struct mailmime* message, size_t* ret_bytes)
+{
+	int   success = 0;
+	int   col = 0;
+	char* pathNfilename_abs = NULL;
+	FILE* f = NULL;
+
+	if ((pathNfilename_abs=dc_get_abs_path(context, pathNfilename))==NULL) {
+		goto cleanup;
+	}
+
+	if ((f=fopen(pathNfilename_abs, "wb"))==NULL) {
+		dc_log_warning(context, 0, "Cannot open \"%s\" for writing.", pathNfilename);
+		goto cleanup;
+	}
+
+	if (mailmime_write_file(f, &col, message)!=MAILIMF_NO_ERROR || fflush(f)!=0 || ferror(f)) {
+		dc_log_warning(context, 0, "Cannot write message to \"%s\".", pathNfilename);
+		goto cleanup;
+	}
+
+	*ret_bytes = (size_t)ftell(f);
+	success = 1;
+
+cleanup:
+	if (f) {
+		fclose(f);
+	}
+	free(pathNfilename_abs);
+	return success;
+}
+
+
+static int render(dc_mimefactory_t* factory, const char* pathNfilename)
 {
 	struct mailimf_fields* imf_fields = NULL;
 	struct mailmime*       message = NULL;
@@ -444,9 +506,10 @@ int dc_mimefactory_render(dc_mimefactory_t* factory)
 	int                    do_gossip = 0;
 	char*                  grpimage = NULL;
 	dc_e2ee_helper_t       e2ee_helper;
+	uint64_t               stats_start = dc_stats_now();
 	memset(&e2ee_helper, 0, sizeof(dc_e2ee_helper_t));
 
-	if (factory==NULL || factory->loaded==DC_MF_NOTHING_LOADED || factory->out/*call empty() before*/) {
+	if (factory==NULL || factory->loaded==DC_MF_NOTHING_LOADED || factory->out || factory->out_bytes/*call empty() before*/) {
 		set_error(factory, "Invalid use of mimefactory-object.");
 		goto cleanup;
 	}
@@ -769,11 +832,15 @@ int dc_mimefactory_render(dc_mimefactory_t* factory)
 			"Original-Recipient: rfc822;%s" LINEEND
 			"Final-Recipient: rfc822;%s" LINEEND
 			"Original-Message-ID: <%s>" LINEEND
+			"%s%s%s"
 			"Disposition: manual-action/MDN-sent-automatically; displayed" LINEEND, /* manual-action: the user has configured the MUA to send MDNs (automatic-action implies the receipts cannot be disabled) */
 			DC_VERSION_STR,
 			factory->from_addr,
 			factory->from_addr,
-			factory->msg->rfc724_mid);
+			factory->msg->rfc724_mid,
+			factory->mdn_more_mids? "Additional-Message-IDs: " : "", /* extension field, RFC 8098 allows only one Original-Message-ID, other MUAs will just see a receipt for the first message */
+			factory->mdn_more_mids? factory->mdn_more_mids : "",
+			factory->mdn_more_mids? LINEEND : "");
 
 		struct mailmime_content* content_type = mailmime_content_new_with_str("message/disposition-notification");
 		struct mailmime_fields* mime_fields = mailmime_fields_new_encoding(MAILMIME_MECHANISM_8BIT);
@@ -826,12 +893,22 @@ int dc_mimefactory_render(dc_mimefactory_t* factory)
 		}
 	}
 
-	/* create the full mail and return */
-	factory->out = mmap_string_new("");
-	mailmime_write_mem(factory->out, &col, message);
+	/* create the full mail and return; when writing to a file, encrypted data and
+	attachments go from their buffers and files to the file without another copy in memory */
+	if (pathNfilename) {
+		if (!write_to_file(factory->context, pathNfilename, message, &factory->out_bytes)) {
+			goto cleanup;
+		}
+	}
+	else {
+		factory->out = mmap_string_new("");
+		mailmime_write_mem(factory->out, &col, message);
+		factory->out_bytes = factory->out->len;
+	}
 
 	//{char* t4=dc_null_terminate(ret->str,ret->len); printf("MESSAGE:\n%s\n",t4);free(t4);}
 
+	dc_stats_add(factory->context, DC_STATS_MIME_RENDER, stats_start);
 	success = 1;
 
 cleanup:
@@ -846,3 +923,22 @@ cleanup:
 	return success;
 }
 
+
+int dc_mimefactory_render(dc_mimefactory_t* factory)
+{
+	return render(factory, NULL);
+}
+
+
+// same as dc_mimefactory_render() but the message is written part by part to the given file
+// instead of being collected in factory->out; only factory->out_bytes is set then.
+// write errors are logged but do not set factory->error. on failure, a partially written file is left on disk;
+// the caller is responsible for deleting it, as render_to_blobfile() in dc_job.c does.
+int dc_mimefactory_render_to_file(dc_mimefactory_t* factory, const char* pathNfilename)
+{
+	if (pathNfilename==NULL) {
+		return 0;
+	}
+	return render(factory, pathNfilename);
+}
+
@@ -50,9 +50,12 @@ struct _dc_mimefactory {
 	char*         in_reply_to;
 	char*         references;
 	int           req_mdn;
+	char*         mdn_more_mids; /* aggregated MDNs: Message-IDs reported in addition to msg, one per folded line */
 
-	// out: after a call to dc_mimefactory_render(), here's the data or the error
+	// out: after a call to dc_mimefactory_render(), here's the data or the error;
+	// dc_mimefactory_render_to_file() leaves `out` empty and only sets `out_bytes`
 	MMAPString*   out;
+	size_t        out_bytes;
 	int           out_encrypted;
 	int           out_gossiped;
 	uint32_t      out_last_added_location_id;
@@ -67,8 +70,9 @@ struct _dc_mimefactory {
 void        dc_mimefactory_init              (dc_mimefactory_t*, dc_context_t*);
 void        dc_mimefactory_empty             (dc_mimefactory_t*);
 int         dc_mimefactory_load_msg          (dc_mimefactory_t*, uint32_t msg_id);
-int         dc_mimefactory_load_mdn          (dc_mimefactory_t*, uint32_t msg_id);
+int         dc_mimefactory_load_mdn          (dc_mimefactory_t*, const dc_array_t* msg_ids);
 int         dc_mimefactory_render            (dc_mimefactory_t*);
+int         dc_mimefactory_render_to_file    (dc_mimefactory_t*, const char* pathNfilename);
 
 
 #ifdef __cplusplus
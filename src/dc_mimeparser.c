@@ -3,9 +3,12 @@
 #include "dc_mimefactory.h"
 #include "dc_pgp.h"
 #include "dc_simplify.h"
+#include "dc_codec.h"
 
 
 static void hash_header(dc_hash_t* out, const struct mailimf_fields* in, dc_context_t* context);
+static void set_basic_header_data(dc_mimeparser_t*);
+static void parse_body(dc_mimeparser_t*, const char* body_not_terminated, size_t body_bytes);
 
 
 // deprecated: flag to switch generation of compound messages on and off.
@@ -526,12 +529,10 @@ int mailmime_transfer_decode(struct mailmime* mime, const char** ret_decoded_dat
 	}
 	else
 	{
-		int r;
-		size_t current_index = 0;
-		r = mailmime_part_parse(mime_data->dt_data.dt_text.dt_data, mime_data->dt_data.dt_text.dt_length,
-			&current_index, mime_transfer_encoding,
-			&transfer_decoding_buffer, &decoded_data_bytes);
-		if (r!=MAILIMF_NO_ERROR || transfer_decoding_buffer==NULL || decoded_data_bytes <= 0) {
+		if (!dc_transfer_decode(mime_data->dt_data.dt_text.dt_data, mime_data->dt_data.dt_text.dt_length,
+		        mime_transfer_encoding, &transfer_decoding_buffer, &decoded_data_bytes)
+		 || transfer_decoding_buffer==NULL || decoded_data_bytes <= 0) {
+			if (transfer_decoding_buffer) { mmap_string_unref(transfer_decoding_buffer); }
 			return 0;
 		}
 		decoded_data = transfer_decoding_buffer;
@@ -788,35 +789,40 @@ static int mailmime_get_mime_type(struct mailmime* mime, int* msg_type,
  ******************************************************************************/
 
 
-static dc_mimepart_t* dc_mimepart_new(void)
+static dc_mimepart_t* dc_mimepart_new(dc_mimeparser_t* mimeparser)
 {
-	dc_mimepart_t* mimepart = NULL;
-
-	if ((mimepart=calloc(1, sizeof(dc_mimepart_t)))==NULL) {
-		exit(33);
-	}
+	/* the part is allocated from the arena, only the param object is reused from released parts */
+	dc_mimepart_t* mimepart = dc_arena_calloc(&mimeparser->arena, sizeof(dc_mimepart_t));
 
 	mimepart->type    = 0;
-	mimepart->param   = dc_param_new();
+
+	unsigned int spare_cnt = carray_count(mimeparser->spare_params);
+	if (spare_cnt) {
+		mimepart->param = (dc_param_t*)carray_get(mimeparser->spare_params, spare_cnt-1);
+		carray_set_size(mimeparser->spare_params, spare_cnt-1);
+	}
+	else {
+		mimepart->param = dc_param_new();
+	}
 
 	return mimepart;
 }
 
 
-static void dc_mimepart_unref(dc_mimepart_t* mimepart)
+static void dc_mimepart_unref(dc_mimeparser_t* mimeparser, dc_mimepart_t* mimepart)
 {
+	/* the part itself and msg_raw are released with the arena */
 	if (mimepart==NULL) {
 		return;
 	}
 
 	free(mimepart->msg);
 	mimepart->msg = NULL;
-
-	free(mimepart->msg_raw);
 	mimepart->msg_raw = NULL;
 
-	dc_param_unref(mimepart->param);
-	free(mimepart);
+	dc_param_empty(mimepart->param);
+	carray_add(mimeparser->spare_params, mimepart->param, NULL);
+	mimepart->param = NULL;
 }
 
 
@@ -846,6 +852,8 @@ dc_mimeparser_t* dc_mimeparser_new(const char* blobdir, dc_context_t* context)
 	mimeparser->blobdir = blobdir; /* no need to copy the string at the moment */
 	mimeparser->reports = carray_new(16);
 	mimeparser->e2ee_helper = calloc(1, sizeof(dc_e2ee_helper_t));
+	mimeparser->spare_params = carray_new(16);
+	dc_arena_init(&mimeparser->arena, 64*1024);
 
 	dc_hash_init(&mimeparser->header, DC_HASH_STRING, 0/* do not copy key */);
 
@@ -878,6 +886,14 @@ void dc_mimeparser_unref(dc_mimeparser_t* mimeparser)
 		carray_free(mimeparser->reports);
 	}
 
+	if (mimeparser->spare_params) {
+		for (unsigned int i = 0; i < carray_count(mimeparser->spare_params); i++) {
+			dc_param_unref((dc_param_t*)carray_get(mimeparser->spare_params, i));
+		}
+		carray_free(mimeparser->spare_params);
+	}
+
+	dc_arena_free(&mimeparser->arena);
 	free(mimeparser->e2ee_helper);
 	free(mimeparser);
 }
@@ -887,7 +903,9 @@ void dc_mimeparser_unref(dc_mimeparser_t* mimeparser)
  * Empty all data in a MIME-parser object.
  *
  * This function is called implicitly by dc_mimeparser_parse() to free
- * previously allocated data.
+ * previously allocated data.  The parts are released together with the arena;
+ * the memory of the arena and the param objects of the parts are kept,
+ * so parsing the next message with the same object needs only few allocations.
  *
  * @private @memberof dc_mimeparser_t
  * @param mimeparser The MIME-parser object.
@@ -905,7 +923,7 @@ void dc_mimeparser_empty(dc_mimeparser_t* mimeparser)
 		for (i = 0; i < cnt; i++) {
 			dc_mimepart_t* part = (dc_mimepart_t*)carray_get(mimeparser->parts, i);
 			if (part) {
-				dc_mimepart_unref(part);
+				dc_mimepart_unref(mimeparser, part);
 			}
 		}
 		carray_set_size(mimeparser->parts, 0);
@@ -914,6 +932,15 @@ void dc_mimeparser_empty(dc_mimeparser_t* mimeparser)
 	mimeparser->header_root  = NULL; /* a pointer somewhere to the MIME data, must NOT be freed */
 	dc_hash_clear(&mimeparser->header);
 
+	if (mimeparser->header_preparsed) {
+		mailimf_fields_free(mimeparser->header_preparsed);
+		mimeparser->header_preparsed = NULL;
+	}
+
+	mimeparser->body_not_terminated = NULL;
+	mimeparser->body_bytes = 0;
+	mimeparser->body_parsed = 0;
+
 	if (mimeparser->header_protected) {
 		mailimf_fields_free(mimeparser->header_protected); /* allocated as needed, MUST be freed */
 		mimeparser->header_protected = NULL;
@@ -946,6 +973,8 @@ void dc_mimeparser_empty(dc_mimeparser_t* mimeparser)
 
 	dc_kml_unref(mimeparser->message_kml);
 	mimeparser->message_kml = NULL;
+
+	dc_arena_reset(&mimeparser->arena);
 }
 
 
@@ -970,7 +999,7 @@ void dc_mimeparser_repl_msg_by_error(dc_mimeparser_t* mimeparser,
 	for (i = 1; i < carray_count(mimeparser->parts); i++) {
 		part = (dc_mimepart_t*)carray_get(mimeparser->parts, i);
 		if (part) {
-			dc_mimepart_unref(part);
+			dc_mimepart_unref(mimeparser, part);
 		}
 	}
 
@@ -1009,7 +1038,7 @@ static void do_add_single_file_part(dc_mimeparser_t* parser, int msg_type, int m
 		goto cleanup;
 	}
 
-	part = dc_mimepart_new();
+	part = dc_mimepart_new(parser);
 	part->type  = msg_type;
 	part->int_mimetype = mime_type;
 	part->bytes = decoded_data_bytes;
@@ -1029,7 +1058,7 @@ static void do_add_single_file_part(dc_mimeparser_t* parser, int msg_type, int m
 
 cleanup:
 	free(pathNfilename);
-	dc_mimepart_unref(part);
+	dc_mimepart_unref(parser, part);
 }
 
 
@@ -1047,6 +1076,7 @@ static int dc_mimeparser_add_single_part_if_known(dc_mimeparser_t* mimeparser, s
 
 	char*                        transfer_decoding_buffer = NULL; /* mmap_string_unref()'d if set */
 	char*                        charset_buffer = NULL; /* charconv_buffer_free()'d if set (just calls mmap_string_unref()) */
+	char*                        charset_8bit_buffer = NULL; /* free()'d if set */
 	const char*                  decoded_data = NULL; /* must not be free()'d */
 	size_t                       decoded_data_bytes = 0;
 	dc_simplify_t*               simplifier = NULL;
@@ -1085,18 +1115,35 @@ static int dc_mimeparser_add_single_part_if_known(dc_mimeparser_t* mimeparser, s
 				}
 
 				const char* charset = mailmime_content_charset_get(mime->mm_content_type); /* get from `Content-Type: text/...; charset=utf-8`; must not be free()'d */
-				if (charset!=NULL && strcmp(charset, "utf-8")!=0 && strcmp(charset, "UTF-8")!=0) {
-					size_t ret_bytes = 0;
-					int r = charconv_buffer("utf-8", charset, decoded_data, decoded_data_bytes, &charset_buffer, &ret_bytes);
+				if (charset!=NULL && strcasecmp(charset, "utf-8")!=0
+				 && !(dc_charset_is_ascii_based(charset) && dc_is_ascii(decoded_data, decoded_data_bytes))) { /* ASCII-only text is used as is, without a copy */
+					size_t      ret_bytes = 0;
+					const char* converted = NULL;
+					int         r = MAIL_CHARCONV_ERROR_UNKNOWN_CHARSET;
+
+					if (dc_charset_is_8bit(charset)) {
+						/* common 8-bit charsets are converted without iconv; each byte takes up to 3 bytes in UTF-8 */
+						ret_bytes = decoded_data_bytes*3;
+						if ((charset_8bit_buffer=malloc(ret_bytes+1))==NULL) {
+							exit(72);
+						}
+						r = dc_charconv_8bit("utf-8", charset, decoded_data, decoded_data_bytes, charset_8bit_buffer, &ret_bytes);
+						converted = charset_8bit_buffer;
+					}
+					else {
+						r = charconv_buffer("utf-8", charset, decoded_data, decoded_data_bytes, &charset_buffer, &ret_bytes);
+						converted = charset_buffer;
+					}
+
 					if (r!=MAIL_CHARCONV_NO_ERROR) {
 						dc_log_warning(mimeparser->context, 0, "Cannot convert %i bytes from \"%s\" to \"utf-8\"; errorcode is %i.", /* if this warning comes up for usual character sets, maybe libetpan is compiled without iconv? */
 							(int)decoded_data_bytes, charset, (int)r); /* continue, however */
 					}
-					else if (charset_buffer==NULL || ret_bytes <= 0) {
+					else if (converted==NULL || ret_bytes <= 0) {
 						goto cleanup; /* no error - but nothing to add */
 					}
 					else  {
-						decoded_data = charset_buffer;
+						decoded_data = converted;
 						decoded_data_bytes = ret_bytes;
 					}
 				}
@@ -1110,11 +1157,11 @@ static int dc_mimeparser_add_single_part_if_known(dc_mimeparser_t* mimeparser, s
 					is_msgrmsg);
 				if (simplified_txt && simplified_txt[0])
 				{
-					part = dc_mimepart_new();
+					part = dc_mimepart_new(mimeparser);
 					part->type = DC_MSG_TEXT;
 					part->int_mimetype = mime_type;
 					part->msg = simplified_txt;
-					part->msg_raw = strndup(decoded_data, decoded_data_bytes);
+					part->msg_raw = dc_arena_strndup(&mimeparser->arena, decoded_data, decoded_data_bytes);
 					do_add_single_part(mimeparser, part);
 					part = NULL;
 				}
@@ -1225,10 +1272,11 @@ static int dc_mimeparser_add_single_part_if_known(dc_mimeparser_t* mimeparser, s
 cleanup:
 	dc_simplify_unref(simplifier);
 	if (charset_buffer) { charconv_buffer_free(charset_buffer); }
+	free(charset_8bit_buffer);
 	if (transfer_decoding_buffer) { mmap_string_unref(transfer_decoding_buffer); }
 	free(file_suffix);
 	free(desired_filename);
-	dc_mimepart_unref(part);
+	dc_mimepart_unref(mimeparser, part);
 	free(raw_mime);
 
 	return carray_count(mimeparser->parts)>old_part_count? 1 : 0; /* any part added? */
@@ -1322,12 +1370,12 @@ static int dc_mimeparser_parse_mime_recursive(dc_mimeparser_t* mimeparser, struc
 
 				case DC_MIMETYPE_MP_NOT_DECRYPTABLE:
 					{
-						dc_mimepart_t* part = dc_mimepart_new();
+						dc_mimepart_t* part = dc_mimepart_new(mimeparser);
 						part->type = DC_MSG_TEXT;
 
 						char* msg_body = dc_stock_str(mimeparser->context, DC_STR_CANTDECRYPT_MSG_BODY);
 						part->msg = dc_mprintf(DC_EDITORIAL_OPEN "%s" DC_EDITORIAL_CLOSE, msg_body);
-						part->msg_raw = dc_strdup(part->msg);
+						part->msg_raw = dc_arena_strdup(&mimeparser->arena, part->msg);
 						free(msg_body);
 
 						carray_add(mimeparser->parts, (void*)part, NULL);
@@ -1497,13 +1545,101 @@ static void hash_header(dc_hash_t* out, const struct mailimf_fields* in, dc_cont
  * @return None.
  */
 void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_terminated, size_t body_bytes)
+{
+	dc_mimeparser_parse_headers(mimeparser, body_not_terminated, body_bytes);
+	dc_mimeparser_parse_body(mimeparser);
+}
+
+
+/**
+ * Parse only the header of raw MIME-data.
+ *
+ * Afterwards, dc_mimeparser_lookup_field() and dc_mimeparser_lookup_optional_field()
+ * return the unprotected header fields, the subject and is_send_by_messenger are set.
+ * There are no parts yet, the body is not decrypted and the protected header fields are not merged;
+ * for this, call dc_mimeparser_parse_body() before the parts are needed.
+ *
+ * The raw data must stay valid until dc_mimeparser_parse_body() is called.
+ *
+ * @private @memberof dc_mimeparser_t
+ * @param mimeparser The MIME-parser object.
+ * @param body_not_terminated Plain text, no need to be null-terminated.
+ * @param body_bytes The number of bytes to read from body_not_terminated.
+ * @return None.
+ */
+void dc_mimeparser_parse_headers(dc_mimeparser_t* mimeparser, const char* body_not_terminated, size_t body_bytes)
+{
+	size_t index = 0;
+
+	dc_mimeparser_empty(mimeparser);
+
+	mimeparser->body_not_terminated = body_not_terminated;
+	mimeparser->body_bytes = body_bytes;
+
+	if (mailimf_fields_parse(body_not_terminated, body_bytes, &index, &mimeparser->header_preparsed)!=MAILIMF_NO_ERROR
+	 || mimeparser->header_preparsed==NULL) {
+		return;
+	}
+
+	mimeparser->header_root = mimeparser->header_preparsed;
+	hash_header(&mimeparser->header, mimeparser->header_root, mimeparser->context);
+
+	set_basic_header_data(mimeparser);
+}
+
+
+/**
+ * Parse and decrypt the body of the MIME-data given to dc_mimeparser_parse_headers().
+ *
+ * This replaces all data found by dc_mimeparser_parse_headers(),
+ * afterwards, the mimeparser is in the same state as after dc_mimeparser_parse().
+ * Field pointers returned before must not be used any longer.
+ * If the body is already parsed, nothing happens.
+ *
+ * @private @memberof dc_mimeparser_t
+ * @param mimeparser The MIME-parser object.
+ * @return None.
+ */
+void dc_mimeparser_parse_body(dc_mimeparser_t* mimeparser)
+{
+	const char* body_not_terminated = mimeparser->body_not_terminated;
+	size_t      body_bytes = mimeparser->body_bytes;
+
+	if (mimeparser->body_parsed || body_not_terminated==NULL) {
+		return;
+	}
+
+	dc_mimeparser_empty(mimeparser);
+	mimeparser->body_not_terminated = body_not_terminated;
+	mimeparser->body_bytes = body_bytes;
+	mimeparser->body_parsed = 1;
+
+	uint64_t stats_start = dc_stats_now();
+	parse_body(mimeparser, body_not_terminated, body_bytes);
+	dc_stats_add(mimeparser->context, DC_STATS_MIME_PARSE, stats_start);
+}
+
+
+static void set_basic_header_data(dc_mimeparser_t* mimeparser)
+{
+	struct mailimf_field* field = dc_mimeparser_lookup_field(mimeparser, "Subject");
+	if (field && field->fld_type==MAILIMF_FIELD_SUBJECT) {
+		free(mimeparser->subject);
+		mimeparser->subject = dc_decode_header_words(field->fld_data.fld_subject->sbj_value);
+	}
+
+	if (dc_mimeparser_lookup_optional_field(mimeparser, "Chat-Version")) {
+		mimeparser->is_send_by_messenger = 1;
+	}
+}
+
+
+static void parse_body(dc_mimeparser_t* mimeparser, const char* body_not_terminated, size_t body_bytes)
 {
 	int                            r = 0;
 	size_t                         index = 0;
 	struct mailimf_optional_field* optional_field = NULL;
 
-	dc_mimeparser_empty(mimeparser);
-
 	/* parse body */
 	r = mailmime_parse(body_not_terminated, body_bytes, &index, &mimeparser->mimeroot);
 	if(r!=MAILIMF_NO_ERROR || mimeparser->mimeroot==NULL) {
@@ -1522,16 +1658,7 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 	dc_mimeparser_parse_mime_recursive(mimeparser, mimeparser->mimeroot);
 
 	/* set some basic data */
-	{
-		struct mailimf_field* field = dc_mimeparser_lookup_field(mimeparser, "Subject");
-		if (field && field->fld_type==MAILIMF_FIELD_SUBJECT) {
-			mimeparser->subject = dc_decode_header_words(field->fld_data.fld_subject->sbj_value);
-		}
-	}
-
-	if (dc_mimeparser_lookup_optional_field(mimeparser, "Chat-Version")) {
-		mimeparser->is_send_by_messenger = 1;
-	}
+	set_basic_header_data(mimeparser);
 
 	if (dc_mimeparser_lookup_field(mimeparser, "Autocrypt-Setup-Message")) {
 		/* Autocrypt-Setup-Message header found - check if there is an application/autocrypt-setup part */
@@ -1548,7 +1675,7 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 			for (i = 0; i < carray_count(mimeparser->parts); i++) {
 				dc_mimepart_t* part = (dc_mimepart_t*)carray_get(mimeparser->parts, i);
 				if (part->int_mimetype!=DC_MIMETYPE_AC_SETUP_FILE) {
-					dc_mimepart_unref(part);
+					dc_mimepart_unref(mimeparser, part);
 					carray_delete_slow(mimeparser->parts, i);
 					i--; /* start over with the same index */
 				}
@@ -1592,7 +1719,7 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 			free(filepart->msg);
 			filepart->msg = textpart->msg;
 			textpart->msg = NULL;
-			dc_mimepart_unref(textpart);
+			dc_mimepart_unref(mimeparser, textpart);
 			carray_delete_slow(mimeparser->parts, 0);
 		}
 	}
@@ -1709,7 +1836,7 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 	/* Cleanup - and try to create at least an empty part if there are no parts yet */
 cleanup:
 	if (!dc_mimeparser_has_nonmeta(mimeparser) && carray_count(mimeparser->reports)==0) {
-		dc_mimepart_t* part = dc_mimepart_new();
+		dc_mimepart_t* part = dc_mimepart_new(mimeparser);
 		part->type = DC_MSG_TEXT;
 		if (mimeparser->subject && !mimeparser->is_send_by_messenger) {
 			part->msg = dc_strdup(mimeparser->subject);
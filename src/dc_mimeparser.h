@@ -12,6 +12,7 @@ extern "C" {
 
 #include "dc_hash.h"
 #include "dc_param.h"
+#include "dc_arena.h"
 
 
 typedef struct _dc_mimepart    dc_mimepart_t;
@@ -24,8 +25,8 @@ struct _dc_mimepart
 	int                 type; /*one of DC_MSG_* */
 	int                 is_meta; /*meta parts contain eg. profile or group images and are only present if there is at least one "normal" part*/
 	int                 int_mimetype;
-	char*               msg;
-	char*               msg_raw;
+	char*               msg;      /* free()'d when the part is released */
+	char*               msg_raw;  /* allocated from dc_mimeparser_t::arena, MUST NOT be free()'d */
 	int                 bytes;
 	dc_param_t*          param;
 
@@ -66,6 +67,16 @@ struct _dc_mimeparser
 
 	struct _dc_kml*        location_kml;
 	struct _dc_kml*        message_kml;
+
+	/* set by dc_mimeparser_parse_headers(), the body is parsed on demand by dc_mimeparser_parse_body() */
+	struct mailimf_fields* header_preparsed;  /* MUST be freed, do not use for query, used as header_root until the body is parsed */
+	const char*            body_not_terminated;
+	size_t                 body_bytes;
+	int                    body_parsed;
+
+	/* scratch memory of the current message, eg. the parts, released at once by dc_mimeparser_empty() */
+	dc_arena_t             arena;
+	carray*                spare_params;      /* dc_param_t objects of released parts, reused for new parts */
 };
 
 
@@ -74,6 +85,8 @@ void             dc_mimeparser_unref                  (dc_mimeparser_t*);
 void             dc_mimeparser_empty                  (dc_mimeparser_t*);
 
 void             dc_mimeparser_parse                  (dc_mimeparser_t*, const char* body_not_terminated, size_t body_bytes);
+void             dc_mimeparser_parse_headers          (dc_mimeparser_t*, const char* body_not_terminated, size_t body_bytes);
+void             dc_mimeparser_parse_body             (dc_mimeparser_t*);
 
 
 /* the following functions can be used only after a call to dc_mimeparser_parse() */
@@ -1085,7 +1085,7 @@ void dc_msg_save_param_to_disk(dc_msg_t* msg)
 
 	sqlite3_stmt* stmt = dc_sqlite3_prepare(msg->context->sql,
 		"UPDATE msgs SET param=? WHERE id=?;");
-	sqlite3_bind_text(stmt, 1, msg->param->packed, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 1, dc_param_get_packed(msg->param), -1, SQLITE_STATIC);
 	sqlite3_bind_int (stmt, 2, msg->id);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
@@ -1349,7 +1349,7 @@ void dc_set_msg_failed(dc_context_t* context, uint32_t msg_id, const char* error
 	stmt = dc_sqlite3_prepare(context->sql,
 		"UPDATE msgs SET state=?, param=? WHERE id=?;");
 	sqlite3_bind_int (stmt, 1, msg->state);
-	sqlite3_bind_text(stmt, 2, msg->param->packed, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, dc_param_get_packed(msg->param), -1, SQLITE_STATIC);
 	sqlite3_bind_int (stmt, 3, msg_id);
 	sqlite3_step(stmt);
 
@@ -1486,6 +1486,328 @@ void dc_update_server_uid(dc_context_t* context, const char* rfc724_mid, const c
 }
 
 
+/*******************************************************************************
+ * Known Message-IDs
+ ******************************************************************************/
+
+
+/* Most messages seen by the IMAP prefetch are new, to avoid a database lookup for each of them,
+a bloom filter of all Message-IDs in the database is kept in memory.
+False positives are resolved by dc_lookup_rfc724_mids(); a false negative, eg. a Message-ID added
+by another process, only results in downloading the message, dc_receive_imf() ignores it then. */
+#define KNOWN_MIDS_BLOOM_HASHES          4
+#define KNOWN_MIDS_BLOOM_MIN_BITS        (1<<16)
+#define KNOWN_MIDS_BLOOM_BITS_PER_ENTRY  16  /* with 4 hashes, about 0.25% false positives */
+#define LOOKUP_MIDS_PER_QUERY            100
+
+#define KNOWN_MIDS_LOCK   { pthread_mutex_lock(&context->known_mids_critical); }
+#define KNOWN_MIDS_UNLOCK { pthread_mutex_unlock(&context->known_mids_critical); }
+
+
+static uint64_t hash_rfc724_mid(const char* rfc724_mid)
+{
+	/* FNV-1a, the two halves are used for double hashing */
+	uint64_t h = 14695981039346656037ULL;
+	for (const unsigned char* p = (const unsigned char*)rfc724_mid; *p; p++) {
+		h ^= *p;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+
+static void bloom_add(dc_context_t* context, const char* rfc724_mid)
+{
+	uint64_t h = hash_rfc724_mid(rfc724_mid);
+	uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h>>32) | 1;
+	for (int i = 0; i < KNOWN_MIDS_BLOOM_HASHES; i++) {
+		size_t bit = (h1 + i*h2) & (context->known_mids_bloom_bits-1);
+		context->known_mids_bloom[bit>>3] |= (1<<(bit&7));
+	}
+	context->known_mids_cnt++;
+}
+
+
+static int bloom_may_contain(dc_context_t* context, const char* rfc724_mid)
+{
+	uint64_t h = hash_rfc724_mid(rfc724_mid);
+	uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h>>32) | 1;
+	for (int i = 0; i < KNOWN_MIDS_BLOOM_HASHES; i++) {
+		size_t bit = (h1 + i*h2) & (context->known_mids_bloom_bits-1);
+		if (!(context->known_mids_bloom[bit>>3] & (1<<(bit&7)))) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+static void bloom_build(dc_context_t* context)
+{
+	/* must be called with KNOWN_MIDS_LOCK held */
+	sqlite3_stmt* stmt = NULL;
+	size_t        cnt = 0;
+	size_t        bits = KNOWN_MIDS_BLOOM_MIN_BITS;
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT (SELECT COUNT(*) FROM msgs) + (SELECT COUNT(*) FROM reports_processed);");
+	if (sqlite3_step(stmt)==SQLITE_ROW) {
+		cnt = sqlite3_column_int(stmt, 0);
+	}
+	sqlite3_finalize(stmt);
+
+	// leave room for twice the current number of Message-IDs before the filter is rebuilt
+	while (bits < cnt*2*KNOWN_MIDS_BLOOM_BITS_PER_ENTRY) {
+		bits <<= 1;
+	}
+
+	free(context->known_mids_bloom);
+	if ((context->known_mids_bloom=calloc(1, bits/8))==NULL) {
+		exit(57);
+	}
+	context->known_mids_bloom_bits = bits;
+	context->known_mids_cnt = 0;
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT rfc724_mid FROM msgs WHERE rfc724_mid!=''"
+		" UNION ALL SELECT rfc724_mid FROM reports_processed;");
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		bloom_add(context, (const char*)sqlite3_column_text(stmt, 0));
+	}
+	sqlite3_finalize(stmt);
+
+	dc_log_info(context, 0, "Bloom filter for %i Message-IDs built, %i KiB.",
+		(int)context->known_mids_cnt, (int)(bits/8/1024));
+}
+
+
+/**
+ * Add a Message-ID to the in-memory filter of known Message-IDs.
+ * Must be called whenever a Message-ID is added to the msgs or reports_processed tables.
+ *
+ * @private @memberof dc_context_t
+ */
+void dc_add_known_rfc724_mid(dc_context_t* context, const char* rfc724_mid)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || rfc724_mid==NULL || rfc724_mid[0]==0) {
+		return;
+	}
+
+	KNOWN_MIDS_LOCK
+		if (context->known_mids_bloom) {
+			if ((context->known_mids_cnt+1)*KNOWN_MIDS_BLOOM_BITS_PER_ENTRY > context->known_mids_bloom_bits) {
+				// the filter is full, rebuild it on the next lookup
+				free(context->known_mids_bloom);
+				context->known_mids_bloom = NULL;
+			}
+			else {
+				bloom_add(context, rfc724_mid);
+			}
+		}
+	KNOWN_MIDS_UNLOCK
+}
+
+
+/**
+ * Forget the in-memory filter of known Message-IDs,
+ * called when the database is closed.
+ *
+ * @private @memberof dc_context_t
+ */
+void dc_reset_known_rfc724_mids(dc_context_t* context)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return;
+	}
+
+	KNOWN_MIDS_LOCK
+		free(context->known_mids_bloom);
+		context->known_mids_bloom = NULL;
+		context->known_mids_bloom_bits = 0;
+		context->known_mids_cnt = 0;
+	KNOWN_MIDS_UNLOCK
+}
+
+
+/**
+ * Remember the Message-ID of a processed report, eg. a MDN,
+ * that does not result in a message in the database.
+ * If the report is seen again, eg. after it was moved to another folder,
+ * it is skipped by the precheck and not downloaded again.
+ *
+ * @private @memberof dc_context_t
+ */
+void dc_add_processed_report(dc_context_t* context, const char* rfc724_mid)
+{
+	sqlite3_stmt* stmt = NULL;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || rfc724_mid==NULL || rfc724_mid[0]==0) {
+		goto cleanup;
+	}
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"INSERT OR IGNORE INTO reports_processed (rfc724_mid, timestamp) VALUES (?, ?);");
+	sqlite3_bind_text (stmt, 1, rfc724_mid, -1, SQLITE_STATIC);
+	sqlite3_bind_int64(stmt, 2, time(NULL));
+	if (sqlite3_step(stmt)==SQLITE_DONE) {
+		dc_add_known_rfc724_mid(context, rfc724_mid);
+	}
+
+cleanup:
+	sqlite3_finalize(stmt);
+}
+
+
+/**
+ * Forget the Message-IDs of reports processed long ago,
+ * called by dc_housekeeping().
+ * Most servers do not keep messages that long in the folders we're watching,
+ * if a report is seen again nevertheless, it is only downloaded and processed again.
+ *
+ * @private @memberof dc_context_t
+ */
+void dc_delete_old_processed_reports(dc_context_t* context)
+{
+	#define KEEP_PROCESSED_REPORTS_SECONDS (365*24*60*60)
+	sqlite3_stmt* stmt = NULL;
+	time_t        delete_older_than = time(NULL)-KEEP_PROCESSED_REPORTS_SECONDS;
+	int           cnt = 0;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		goto cleanup;
+	}
+
+	// sqlite3_changes() must not be used, see dc_sqlite3.c, so count before
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT COUNT(*) FROM reports_processed WHERE timestamp<?;");
+	sqlite3_bind_int64(stmt, 1, delete_older_than);
+	if (sqlite3_step(stmt)==SQLITE_ROW) {
+		cnt = sqlite3_column_int(stmt, 0);
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	if (cnt==0) {
+		goto cleanup;
+	}
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"DELETE FROM reports_processed WHERE timestamp<?;");
+	sqlite3_bind_int64(stmt, 1, delete_older_than);
+	sqlite3_step(stmt);
+
+	dc_log_info(context, 0, "%i old processed reports deleted.", cnt);
+
+	// a bloom filter cannot forget entries, build it again on the next lookup
+	dc_reset_known_rfc724_mids(context);
+
+cleanup:
+	sqlite3_finalize(stmt);
+}
+
+
+/**
+ * Look up a list of Message-IDs at once.
+ * Message-IDs not in the bloom filter are not looked up in the database at all,
+ * the others are looked up in chunks of LOOKUP_MIDS_PER_QUERY using a single query per chunk.
+ *
+ * For each Message-ID, ret_msg_ids is set to the ID of a message with this Message-ID or to 0,
+ * ret_server_folders and ret_server_uids are set as by dc_rfc724_mid_exists()
+ * and ret_processed_reports is set to 1 if the Message-ID is a report already processed.
+ * The caller must free() the returned server folders.
+ *
+ * @private @memberof dc_context_t
+ */
+void dc_lookup_rfc724_mids(dc_context_t* context, int cnt, const char** rfc724_mids,
+                           uint32_t* ret_msg_ids, char** ret_server_folders, uint32_t* ret_server_uids,
+                           int* ret_processed_reports)
+{
+	sqlite3_stmt*   stmt = NULL;
+	int*            candidates = NULL;
+	int             candidates_cnt = 0;
+	dc_strbuilder_t q3;
+	dc_strbuilder_init(&q3, 0);
+
+	for (int i = 0; i < cnt; i++) {
+		ret_msg_ids[i] = 0;
+		ret_server_folders[i] = NULL;
+		ret_server_uids[i] = 0;
+		ret_processed_reports[i] = 0;
+	}
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || cnt<=0
+	 || (candidates=malloc(sizeof(int)*cnt))==NULL) {
+		goto cleanup;
+	}
+
+	KNOWN_MIDS_LOCK
+		if (context->known_mids_bloom==NULL) {
+			bloom_build(context);
+		}
+
+		for (int i = 0; i < cnt; i++) {
+			if (rfc724_mids[i] && rfc724_mids[i][0] && bloom_may_contain(context, rfc724_mids[i])) {
+				candidates[candidates_cnt++] = i;
+			}
+		}
+	KNOWN_MIDS_UNLOCK
+
+	dc_log_info(context, 0, "%i of %i Message-IDs may be known.", candidates_cnt, cnt);
+
+	for (int chunk = 0; chunk < candidates_cnt; chunk += LOOKUP_MIDS_PER_QUERY)
+	{
+		int chunk_cnt = DC_MIN(candidates_cnt-chunk, LOOKUP_MIDS_PER_QUERY);
+
+		free(q3.buf);
+		dc_strbuilder_init(&q3, 0);
+		dc_strbuilder_cat(&q3, "SELECT rfc724_mid, id, server_folder, server_uid FROM msgs WHERE rfc724_mid IN (?");
+		for (int i = 1; i < chunk_cnt; i++) {
+			dc_strbuilder_cat(&q3, ",?");
+		}
+		dc_strbuilder_cat(&q3, ") UNION ALL SELECT rfc724_mid, 0, '', 0 FROM reports_processed WHERE rfc724_mid IN (?");
+		for (int i = 1; i < chunk_cnt; i++) {
+			dc_strbuilder_cat(&q3, ",?");
+		}
+		dc_strbuilder_cat(&q3, ");");
+
+		stmt = dc_sqlite3_prepare(context->sql, q3.buf);
+		for (int i = 0; i < chunk_cnt; i++) {
+			sqlite3_bind_text(stmt, i+1,           rfc724_mids[candidates[chunk+i]], -1, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, chunk_cnt+i+1, rfc724_mids[candidates[chunk+i]], -1, SQLITE_STATIC);
+		}
+
+		while (sqlite3_step(stmt)==SQLITE_ROW)
+		{
+			const char* rfc724_mid = (const char*)sqlite3_column_text(stmt, 0);
+			uint32_t    msg_id     = sqlite3_column_int(stmt, 1);
+			for (int i = 0; i < chunk_cnt; i++) {
+				int j = candidates[chunk+i];
+				if (strcmp(rfc724_mids[j], rfc724_mid)!=0) {
+					continue;
+				}
+
+				if (msg_id==0) {
+					ret_processed_reports[j] = 1;
+				}
+				else if (ret_msg_ids[j]==0) {
+					ret_msg_ids[j] = msg_id;
+					ret_server_folders[j] = dc_strdup((const char*)sqlite3_column_text(stmt, 2));
+					ret_server_uids[j] = sqlite3_column_int(stmt, 3); /* may be 0 */
+				}
+			}
+		}
+
+		sqlite3_finalize(stmt);
+		stmt = NULL;
+	}
+
+cleanup:
+	sqlite3_finalize(stmt);
+	free(candidates);
+	free(q3.buf);
+}
+
+
 /**
  * Get a single message object of the type dc_msg_t.
  * For a list of messages in a chat, see dc_get_chat_msgs()
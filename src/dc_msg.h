@@ -108,6 +108,11 @@ size_t          dc_get_deaddrop_msg_cnt                    (dc_context_t*);
 int             dc_rfc724_mid_cnt                          (dc_context_t*, const char* rfc724_mid);
 uint32_t        dc_rfc724_mid_exists                       (dc_context_t*, const char* rfc724_mid, char** ret_server_folder, uint32_t* ret_server_uid);
 void            dc_update_server_uid                       (dc_context_t*, const char* rfc724_mid, const char* server_folder, uint32_t server_uid);
+void            dc_lookup_rfc724_mids                      (dc_context_t*, int cnt, const char** rfc724_mids, uint32_t* ret_msg_ids, char** ret_server_folders, uint32_t* ret_server_uids, int* ret_processed_reports);
+void            dc_add_known_rfc724_mid                    (dc_context_t*, const char* rfc724_mid);
+void            dc_add_processed_report                    (dc_context_t*, const char* rfc724_mid);
+void            dc_reset_known_rfc724_mids                 (dc_context_t*);
+void            dc_delete_old_processed_reports            (dc_context_t*);
 
 
 #ifdef __cplusplus
@@ -1,39 +1,85 @@
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include "dc_context.h"
 #include "dc_tools.h"
 
 
-static char* find_param(char* haystack, int key, char** ret_p2)
+#define IS_VALID_KEY(key) ((key)>0 && (key)<DC_PARAM_KEY_SLOTS)
+
+
+static const char* get_value(const dc_param_t* param, int key)
+{
+	if (!IS_VALID_KEY(key) || param->index[key]==0) {
+		return NULL;
+	}
+	return param->values[param->index[key]-1];
+}
+
+
+static void set_value(dc_param_t* param, int key, const char* value, size_t value_len)
 {
-	char* p1 = NULL;
-	char* p2 = NULL;
-
-	/* let p1 point to the start of the */
-	p1 = haystack;
-	while (1) {
-		if (p1==NULL || *p1==0) {
-			return NULL;
+	/* sets, replaces or removes (value=NULL) a parameter;
+	new parameters are appended so that the serialized order is kept stable */
+	int pos = param->index[key];
+
+	if (pos)
+	{
+		free(param->values[pos-1]);
+		if (value) {
+			param->values[pos-1] = dc_null_terminate(value, (int)value_len);
+			return;
 		}
-		else if (*p1==key && p1[1]=='=') {
-			break;
+
+		for (int i = pos; i<param->cnt; i++) {
+			param->keys[i-1]   = param->keys[i];
+			param->values[i-1] = param->values[i];
+			param->index[(int)param->keys[i-1]] = i;
 		}
-		else {
-			p1 = strchr(p1, '\n'); /* if `\r\n` is used, this `\r` is also skipped by this*/
-			if (p1) {
-				p1++;
+		param->cnt--;
+		param->index[key] = 0;
+	}
+	else if (value)
+	{
+		if (param->cnt>=param->allocated) {
+			param->allocated = param->allocated? param->allocated*2 : 8;
+			param->keys   = realloc(param->keys,   param->allocated*sizeof(char));
+			param->values = realloc(param->values, param->allocated*sizeof(char*));
+			if (param->keys==NULL || param->values==NULL) {
+				exit(70);
 			}
 		}
-	}
 
-	/* let p2 point to the character _after_ the value - eiter `\n` or `\0` */
-	p2 = strchr(p1, '\n');
-	if (p2==NULL) {
-		p2 = &p1[strlen(p1)];
+		param->keys[param->cnt]   = key;
+		param->values[param->cnt] = dc_null_terminate(value, (int)value_len);
+		param->cnt++;
+		param->index[key] = param->cnt;
 	}
+}
+
 
-	*ret_p2 = p2;
-	return p1;
+static void parse_packed(dc_param_t* param, const char* packed, char separator)
+{
+	/* each line has the form `k=value`, other lines are ignored;
+	if a key is used several times, the first occurrence wins, as before */
+	const char* p1 = packed;
+
+	while (p1 && *p1)
+	{
+		const char* p2 = strchr(p1, separator);
+		const char* end = p2? p2 : &p1[strlen(p1)];
+
+		if (IS_VALID_KEY((unsigned char)p1[0]) && p1[1]=='=' && param->index[(unsigned char)p1[0]]==0)
+		{
+			const char* value_end = end;
+			while (value_end>p1+2 && isspace((unsigned char)value_end[-1])) {
+				value_end--; /* to be safe with '\r' characters ... */
+			}
+			set_value(param, (unsigned char)p1[0], p1+2, value_end-(p1+2));
+		}
+
+		p1 = p2? p2+1 : NULL;
+	}
 }
 
 
@@ -51,8 +97,6 @@ dc_param_t* dc_param_new()
 		exit(28); /* cannot allocate little memory, unrecoverable error */
 	}
 
-	param->packed = calloc(1, 1);
-
     return param;
 }
 
@@ -70,7 +114,8 @@ void dc_param_unref(dc_param_t* param)
 	}
 
 	dc_param_empty(param);
-	free(param->packed);
+	free(param->keys);
+	free(param->values);
 	free(param);
 }
 
@@ -88,7 +133,14 @@ void dc_param_empty(dc_param_t* param)
 		return;
 	}
 
-	param->packed[0] = 0;
+	for (int i = 0; i<param->cnt; i++) {
+		free(param->values[i]);
+	}
+	memset(param->index, 0, sizeof(param->index));
+	param->cnt = 0;
+
+	free(param->packed);
+	param->packed = NULL;
 }
 
 
@@ -110,11 +162,7 @@ void dc_param_set_packed(dc_param_t* param, const char* packed)
 	}
 
 	dc_param_empty(param);
-
-	if (packed) {
-		free(param->packed);
-		param->packed = dc_strdup(packed);
-	}
+	parse_packed(param, packed, '\n');
 }
 
 
@@ -129,12 +177,38 @@ void dc_param_set_urlencoded(dc_param_t* param, const char* urlencoded)
 	}
 
 	dc_param_empty(param);
+	parse_packed(param, urlencoded, '&');
+}
+
+
+/**
+ * Get the parameters in the packed form as `a=value1\nb=value2`,
+ * as used to store them in the database.
+ *
+ * @private @memberof dc_param_t
+ * @param param Parameter object to serialize.
+ * @return The packed parameters, never NULL.  The string is owned by the object
+ *     and is valid until the object is modified or freed.
+ */
+const char* dc_param_get_packed(dc_param_t* param)
+{
+	if (param==NULL) {
+		return "";
+	}
 
-	if (urlencoded) {
-		free(param->packed);
-		param->packed = dc_strdup(urlencoded);
-		dc_str_replace(&param->packed, "&", "\n");
+	if (param->packed==NULL)
+	{
+		dc_strbuilder_t ret;
+		dc_strbuilder_init(&ret, 0);
+		for (int i = 0; i<param->cnt; i++) {
+			char key_str[4] = { '\n', param->keys[i], '=', 0 };
+			dc_strbuilder_cat(&ret, i? key_str : &key_str[1]);
+			dc_strbuilder_cat(&ret, param->values[i]);
+		}
+		param->packed = ret.buf;
 	}
+
+	return param->packed;
 }
 
 
@@ -148,13 +222,11 @@ void dc_param_set_urlencoded(dc_param_t* param, const char* urlencoded)
  */
 int dc_param_exists(dc_param_t* param, int key)
 {
-	char *p2 = NULL;
-
 	if (param==NULL || key==0) {
 		return 0;
 	}
 
-	return find_param(param->packed, key, &p2)? 1 : 0;
+	return get_value(param, key)? 1 : 0;
 }
 
 
@@ -169,28 +241,13 @@ int dc_param_exists(dc_param_t* param, int key)
  */
 char* dc_param_get(const dc_param_t* param, int key, const char* def)
 {
-	char* p1 = NULL;
-	char* p2 = NULL;
-	char  bak = 0;
-	char* ret = NULL;
+	const char* value = NULL;
 
-	if (param==NULL || key==0) {
-		return def? dc_strdup(def) : NULL;
-	}
-
-	p1 = find_param(param->packed, key, &p2);
-	if (p1==NULL) {
+	if (param==NULL || key==0 || (value=get_value(param, key))==NULL) {
 		return def? dc_strdup(def) : NULL;
 	}
 
-	p1 += 2; /* skip key and "=" (safe as find_param checks for its existance) */
-
-	bak = *p2;
-	*p2 = 0;
-	ret = dc_strdup(p1);
-	dc_rtrim(ret); /* to be safe with '\r' characters ... */
-	*p2 = bak;
-	return ret;
+	return dc_strdup(value);
 }
 
 
@@ -205,17 +262,13 @@ char* dc_param_get(const dc_param_t* param, int key, const char* def)
  */
 int32_t dc_param_get_int(const dc_param_t* param, int key, int32_t def)
 {
-	if (param==NULL || key==0) {
+	const char* value = NULL;
+
+	if (param==NULL || key==0 || (value=get_value(param, key))==NULL) {
 		return def;
 	}
 
-    char* str = dc_param_get(param, key, NULL);
-    if (str==NULL) {
-		return def;
-    }
-    int32_t ret = atol(str);
-    free(str);
-    return ret;
+	return atol(value);
 }
 
 
@@ -230,17 +283,13 @@ int32_t dc_param_get_int(const dc_param_t* param, int key, int32_t def)
  */
 double dc_param_get_float(const dc_param_t* param, int key, double def)
 {
-	if (param==NULL || key==0) {
-		return def;
-	}
+	const char* value = NULL;
 
-	char* str = dc_param_get(param, key, NULL);
-	if (str==NULL) {
+	if (param==NULL || key==0 || (value=get_value(param, key))==NULL) {
 		return def;
 	}
-	double ret = dc_atof(str);
-	free(str);
-	return ret;
+
+	return dc_atof(value);
 }
 
 
@@ -255,55 +304,18 @@ double dc_param_get_float(const dc_param_t* param, int key, double def)
  */
 void dc_param_set(dc_param_t* param, int key, const char* value)
 {
-	char* old1 = NULL;
-	char* old2 = NULL;
-	char* new1 = NULL;
-
-	if (param==NULL || key==0) {
+	if (param==NULL || !IS_VALID_KEY(key)) {
 		return;
 	}
 
-	old1 = param->packed;
-	old2 = NULL;
-
-	/* remove existing parameter from packed string, if any */
-	if (old1) {
-		char *p1, *p2;
-		p1 = find_param(old1, key, &p2);
-		if (p1 != NULL) {
-			*p1 = 0;
-			old2 = p2;
-		}
-		else if (value==NULL) {
-			return; /* parameter does not exist and should be cleared -> done. */
-		}
+	if (value==NULL && param->index[key]==0) {
+		return; /* parameter does not exist and should be cleared -> done. */
 	}
 
-	dc_rtrim(old1); /* trim functions are null-pointer-safe */
-	dc_ltrim(old2);
-
-	if (old1 && old1[0]==0) { old1 = NULL; }
-	if (old2 && old2[0]==0) { old2 = NULL; }
-
-	/* create new string */
-	if (value) {
-		new1 = dc_mprintf("%s%s%c=%s%s%s",
-			old1?  old1 : "",
-			old1?  "\n" : "",
-			key,
-			value,
-			old2?  "\n" : "",
-			old2?  old2 : "");
-	}
-	else {
-		new1 = dc_mprintf("%s%s%s",
-			old1?         old1 : "",
-			(old1&&old2)? "\n" : "",
-			old2?         old2 : "");
-	}
+	set_value(param, key, value, value? strlen(value) : 0);
 
 	free(param->packed);
-	param->packed = new1;
+	param->packed = NULL;
 }
 
 
@@ -322,12 +334,9 @@ void dc_param_set_int(dc_param_t* param, int key, int32_t value)
 		return;
 	}
 
-    char* value_str = dc_mprintf("%i", (int)value);
-    if (value_str==NULL) {
-		return;
-    }
-    dc_param_set(param, key, value_str);
-    free(value_str);
+	char value_str[16];
+	snprintf(value_str, sizeof(value_str), "%i", (int)value);
+	dc_param_set(param, key, value_str);
 }
 
 
@@ -22,7 +22,13 @@ typedef struct _dc_param dc_param_t;
 struct _dc_param
 {
 	/** @privatesection */
-	char*           packed;    /**< Always set, never NULL. */
+	#define         DC_PARAM_KEY_SLOTS 128
+	uint8_t         index[DC_PARAM_KEY_SLOTS]; /**< 1-based position of the key in keys[] and values[], 0 if unset. */
+	int             cnt;       /**< Number of parameters set. */
+	int             allocated; /**< Number of allocated entries in keys[] and values[]. */
+	char*           keys;      /**< Keys in the order they were set, used for serializing. */
+	char**          values;    /**< Values, never NULL for the first cnt entries. */
+	char*           packed;    /**< Serialized form as returned by dc_param_get_packed(), NULL if not yet built or outdated. */
 };
 
 
@@ -76,6 +82,7 @@ void            dc_param_empty          (dc_param_t*);
 void            dc_param_unref          (dc_param_t*);
 void            dc_param_set_packed     (dc_param_t*, const char*);
 void            dc_param_set_urlencoded (dc_param_t*, const char*);
+const char*     dc_param_get_packed     (dc_param_t*);
 
 
 #ifdef __cplusplus
@@ -30,11 +30,9 @@ static void add_or_lookup_contact_by_addr(dc_context_t* context, const char* dis
 
 	*check_self = 0;
 
-	char* self_addr = dc_sqlite3_get_config(context->sql, "configured_addr", "");
-		if (dc_addr_cmp(self_addr, addr_spec)==0) {
-			*check_self = 1;
-		}
-	free(self_addr);
+	if (dc_addr_equals_self(context, addr_spec)) {
+		*check_self = 1;
+	}
 
 	if (*check_self) {
 		return;
@@ -52,9 +50,7 @@ static void add_or_lookup_contact_by_addr(dc_context_t* context, const char* dis
 	free(display_name_dec);
 
 	if (row_id) {
-		if (!dc_array_search_id(ids, row_id, NULL)) {
-			dc_array_add_id(ids, row_id);
-		}
+		dc_array_add_id(ids, row_id); /* duplicates are removed by the callers */
 	}
 }
 
@@ -71,6 +67,8 @@ static void dc_add_or_lookup_contacts_by_mailbox_list(dc_context_t* context, con
 			add_or_lookup_contact_by_addr(context, mb->mb_display_name, mb->mb_addr_spec, origin, ids, check_self);
 		}
 	}
+
+	dc_array_unique_ids(ids);
 }
 
 
@@ -97,6 +95,8 @@ static void dc_add_or_lookup_contacts_by_address_list(dc_context_t* context, con
 			}
 		}
 	}
+
+	dc_array_unique_ids(ids);
 }
 
 
@@ -303,84 +303,54 @@ static void calc_timestamps(dc_context_t* context, uint32_t chat_id, uint32_t fr
 
 static dc_array_t* search_chat_ids_by_contact_ids(dc_context_t* context, const dc_array_t* unsorted_contact_ids)
 {
-	/* searches chat_id's by the given contact IDs, may return zero, one or more chat_id's */
+	/* searches chat_id's by the given contact IDs, may return zero, one or more chat_id's;
+	the chats are looked up by chats.members_key, a sorted list of the member IDs without SELF,
+	see dc_update_chat_members_key() */
 	sqlite3_stmt* stmt = NULL;
 	dc_array_t*   contact_ids = dc_array_new(context, 23);
-	char*         contact_ids_str = NULL;
-	char*         q3 = NULL;
+	char*         members_key = NULL;
 	dc_array_t*   chat_ids = dc_array_new(context, 23);
 
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
 		goto cleanup;
 	}
 
-	/* copy array, remove duplicates and SELF, sort by ID */
+	/* copy array, sort by ID, remove duplicates and SELF */
 	{
 		int i, iCnt = dc_array_get_cnt(unsorted_contact_ids);
 		if (iCnt <= 0) {
 			goto cleanup;
 		}
 
+		dc_array_t* sorted_ids = dc_array_duplicate(unsorted_contact_ids);
+		dc_array_sort_ids(sorted_ids);
 		for (i = 0; i < iCnt; i++) {
-			uint32_t curr_id = dc_array_get_id(unsorted_contact_ids, i);
-			if (curr_id!=DC_CONTACT_ID_SELF && !dc_array_search_id(contact_ids, curr_id, NULL)) {
+			uint32_t curr_id = dc_array_get_id(sorted_ids, i);
+			if (curr_id!=DC_CONTACT_ID_SELF && (i==0 || curr_id!=dc_array_get_id(sorted_ids, i-1))) {
 				dc_array_add_id(contact_ids, curr_id);
 			}
 		}
+		dc_array_unref(sorted_ids);
 
 		if (dc_array_get_cnt(contact_ids)==0) {
 			goto cleanup;
 		}
-
-		dc_array_sort_ids(contact_ids); /* for easy comparison, we also sort the sql result below */
 	}
 
-	/* collect all possible chats with the contact count as the data (as contact_ids have no doubles, this is sufficient) */
-	contact_ids_str = dc_array_get_string(contact_ids, ",");
-	q3 = sqlite3_mprintf("SELECT DISTINCT cc.chat_id, cc.contact_id "
-	                     " FROM chats_contacts cc "
-	                     " LEFT JOIN chats c ON c.id=cc.chat_id "
-	                     " WHERE cc.chat_id IN(SELECT chat_id FROM chats_contacts WHERE contact_id IN(%s))"
-	                     "   AND c.type=" DC_STRINGIFY(DC_CHAT_TYPE_GROUP) /* no verified groups and no single chats (which are equal to a group with a single member and without SELF) */
-	                     "   AND cc.contact_id!=" DC_STRINGIFY(DC_CONTACT_ID_SELF) /* ignore SELF, we've also removed it above - if the user has left the group, it is still the same group */
-	                     " ORDER BY cc.chat_id, cc.contact_id;",
-	                     contact_ids_str);
-	stmt = dc_sqlite3_prepare(context->sql, q3);
-	{
-		uint32_t last_chat_id = 0, matches = 0, mismatches = 0;
-
-		while (sqlite3_step(stmt)==SQLITE_ROW)
-		{
-			uint32_t chat_id    = sqlite3_column_int(stmt, 0);
-			uint32_t contact_id = sqlite3_column_int(stmt, 1);
-
-			if (chat_id!=last_chat_id) {
-				if (matches==dc_array_get_cnt(contact_ids) && mismatches==0) {
-					dc_array_add_id(chat_ids, last_chat_id);
-				}
-				last_chat_id = chat_id;
-				matches = 0;
-				mismatches = 0;
-			}
-
-			if (contact_id==dc_array_get_id(contact_ids, matches)) {
-				matches++;
-			}
-			else {
-				mismatches++;
-			}
-		}
-
-		if (matches==dc_array_get_cnt(contact_ids) && mismatches==0) {
-			dc_array_add_id(chat_ids, last_chat_id);
-		}
+	members_key = dc_array_get_string(contact_ids, ",");
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT id FROM chats"
+		" WHERE members_key=? AND type=" DC_STRINGIFY(DC_CHAT_TYPE_GROUP) /* no verified groups and no single chats (which are equal to a group with a single member and without SELF) */
+		" ORDER BY id;");
+	sqlite3_bind_text(stmt, 1, members_key, -1, SQLITE_STATIC);
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_array_add_id(chat_ids, sqlite3_column_int(stmt, 0));
 	}
 
 cleanup:
 	sqlite3_finalize(stmt);
-	free(contact_ids_str);
+	free(members_key);
 	dc_array_unref(contact_ids);
-	sqlite3_free(q3);
 	return chat_ids;
 }
 
@@ -957,6 +927,7 @@ static void create_or_lookup_group(dc_context_t* context, dc_mimeparser_t* mime_
 		sqlite3_bind_int (stmt, 1, chat_id);
 		sqlite3_step(stmt);
 		sqlite3_finalize(stmt);
+		dc_update_chat_members_key(context, chat_id);
 
 		if (skip==NULL || dc_addr_cmp(self_addr, skip)!=0) {
 			dc_add_to_chat_contacts_table(context, chat_id, DC_CONTACT_ID_SELF);
@@ -1014,6 +985,65 @@ cleanup:
  ******************************************************************************/
 
 
+#define MIMEPARSER_POOL_MAX 4 /* inbox, mvbox and sentbox thread plus an import */
+
+
+static dc_mimeparser_t* get_mimeparser(dc_context_t* context)
+{
+	/* reusing the parser keeps the memory of its arena and param objects over a fetch loop */
+	dc_mimeparser_t* mime_parser = NULL;
+
+	pthread_mutex_lock(&context->mimeparser_pool_critical);
+		unsigned int cnt = carray_count(context->mimeparser_pool);
+		if (cnt) {
+			mime_parser = (dc_mimeparser_t*)carray_get(context->mimeparser_pool, cnt-1);
+			carray_set_size(context->mimeparser_pool, cnt-1);
+		}
+	pthread_mutex_unlock(&context->mimeparser_pool_critical);
+
+	if (mime_parser==NULL) {
+		mime_parser = dc_mimeparser_new(context->blobdir, context);
+	}
+
+	mime_parser->blobdir = context->blobdir; /* may have changed since the parser was pooled */
+	return mime_parser;
+}
+
+
+static void release_mimeparser(dc_context_t* context, dc_mimeparser_t* mime_parser)
+{
+	if (mime_parser==NULL) {
+		return;
+	}
+
+	dc_mimeparser_empty(mime_parser); /* free the message data now, only the scratch memory is kept */
+
+	pthread_mutex_lock(&context->mimeparser_pool_critical);
+		if (carray_count(context->mimeparser_pool) < MIMEPARSER_POOL_MAX) {
+			carray_add(context->mimeparser_pool, mime_parser, NULL);
+			mime_parser = NULL;
+		}
+	pthread_mutex_unlock(&context->mimeparser_pool_critical);
+
+	dc_mimeparser_unref(mime_parser);
+}
+
+
+void dc_reset_mimeparser_pool(dc_context_t* context)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || context->mimeparser_pool==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&context->mimeparser_pool_critical);
+		for (unsigned int i = 0; i < carray_count(context->mimeparser_pool); i++) {
+			dc_mimeparser_unref((dc_mimeparser_t*)carray_get(context->mimeparser_pool, i));
+		}
+		carray_set_size(context->mimeparser_pool, 0);
+	pthread_mutex_unlock(&context->mimeparser_pool_critical);
+}
+
+
 void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, size_t imf_raw_bytes,
                            const char* server_folder, uint32_t server_uid, uint32_t flags)
 {
@@ -1043,7 +1073,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 	time_t           sort_timestamp = DC_INVALID_TIMESTAMP;
 	time_t           sent_timestamp = DC_INVALID_TIMESTAMP;
 	time_t           rcvd_timestamp = DC_INVALID_TIMESTAMP;
-	dc_mimeparser_t* mime_parser = dc_mimeparser_new(context->blobdir, context);
+	dc_mimeparser_t* mime_parser = get_mimeparser(context);
 	int              transaction_pending = 0;
 	const struct mailimf_field* field;
 	char*            mime_in_reply_to = NULL;
@@ -1054,7 +1084,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 
 	carray*          rr_event_to_send = carray_new(16);
 
-	char*            txt_raw = NULL;
+	char*            txt_raw = NULL; /* allocated from the arena of the mime parser */
 
 	dc_log_info(context, 0, "Receiving message %s/%lu...", server_folder? server_folder:"?", server_uid);
 
@@ -1075,13 +1105,38 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 	   };
 	normally, this is done by mailimf_message_parse(), however, as we also need the MIME data,
 	we use mailmime_parse() through dc_mimeparser (both call mailimf_struct_multiple_parse() somewhen, I did not found out anything
-	that speaks against this approach yet) */
-	dc_mimeparser_parse(mime_parser, imf_raw_not_terminated, imf_raw_bytes);
+	that speaks against this approach yet).
+	the header is parsed first as it may already decide the outcome, the body is parsed and decrypted only if needed. */
+	dc_mimeparser_parse_headers(mime_parser, imf_raw_not_terminated, imf_raw_bytes);
 	if (dc_hash_cnt(&mime_parser->header)==0) {
 		dc_log_info(context, 0, "No header.");
 		goto cleanup; /* Error - even adding an empty record won't help as we do not know the message ID */
 	}
 
+	/* messages already in the database, eg. moved between folders or copies sent to self, need no further processing;
+	just update the folder/uid, this is the same as the check below, but without parsing the body */
+	if ((field=dc_mimeparser_lookup_field(mime_parser, "Message-ID"))!=NULL && field->fld_type==MAILIMF_FIELD_MESSAGE_ID
+	 && field->fld_data.fld_message_id && field->fld_data.fld_message_id->mid_value)
+	{
+		char*    old_server_folder = NULL;
+		uint32_t old_server_uid = 0;
+		const char* header_rfc724_mid = field->fld_data.fld_message_id->mid_value;
+		if (dc_rfc724_mid_exists(context, header_rfc724_mid, &old_server_folder, &old_server_uid)) {
+			if (strcmp(old_server_folder, server_folder)!=0 || old_server_uid!=server_uid) {
+				dc_update_server_uid(context, header_rfc724_mid, server_folder, server_uid);
+			}
+			free(old_server_folder);
+			dc_log_info(context, 0, "Message already in DB, body not parsed.");
+			goto cleanup;
+		}
+	}
+
+	dc_mimeparser_parse_body(mime_parser);
+	if (dc_hash_cnt(&mime_parser->header)==0) {
+		dc_log_info(context, 0, "Cannot parse body.");
+		goto cleanup;
+	}
+
 	/* messages without a Return-Path header typically are outgoing, however, if the Return-Path header
 	is missing for other reasons, see issue #150, foreign messages appear as own messages, this is very confusing.
 	as it may even be confusing when _own_ messages sent from other devices with other e-mail-adresses appear as being sent from SELF
@@ -1432,7 +1487,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 				}
 
 				if (part->type==DC_MSG_TEXT) {
-					txt_raw = dc_mprintf("%s\n\n%s", mime_parser->subject? mime_parser->subject : "", part->msg_raw);
+					txt_raw = dc_arena_mprintf(&mime_parser->arena, "%s\n\n%s", mime_parser->subject? mime_parser->subject : "", part->msg_raw);
 				}
 
 				if (mime_parser->is_system_message) {
@@ -1454,7 +1509,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 				sqlite3_bind_int  (stmt, 12, msgrmsg);
 				sqlite3_bind_text (stmt, 13, part->msg? part->msg : "", -1, SQLITE_STATIC);
 				sqlite3_bind_text (stmt, 14, txt_raw? txt_raw : "", -1, SQLITE_STATIC);
-				sqlite3_bind_text (stmt, 15, part->param->packed, -1, SQLITE_STATIC);
+				sqlite3_bind_text (stmt, 15, dc_param_get_packed(part->param), -1, SQLITE_STATIC);
 				sqlite3_bind_int  (stmt, 16, part->bytes);
 				sqlite3_bind_int  (stmt, 17, hidden);
 				sqlite3_bind_text (stmt, 18, save_mime_headers? imf_raw_not_terminated : NULL, header_bytes, SQLITE_STATIC);
@@ -1465,7 +1520,6 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 					goto cleanup; /* i/o error - there is nothing more we can do - in other cases, we try to write at least an empty record */
 				}
 
-				free(txt_raw);
 				txt_raw = NULL;
 
 				insert_msg_id = dc_sqlite3_get_rowid(context->sql, "msgs", "rfc724_mid", rfc724_mid);
@@ -1474,6 +1528,10 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 				carray_add(created_db_entries, (void*)(uintptr_t)insert_msg_id, NULL);
 			}
 
+			if (insert_msg_id) {
+				dc_add_known_rfc724_mid(context, rfc724_mid);
+			}
+
 			dc_log_info(context, 0, "Message has %i parts and is assigned to chat #%i.", icnt, chat_id);
 
 			/* check event to send */
@@ -1515,6 +1573,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 			 *****************************************************************/
 
 			int mdns_enabled = dc_sqlite3_get_config_int(context->sql, "mdns_enabled", DC_MDNS_DEFAULT_ENABLED);
+			int reports_moved = 0;
 			icnt = carray_count(mime_parser->reports);
 			for (i = 0; i < icnt; i++)
 			{
@@ -1568,6 +1627,31 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 												mdn_consumed = (msg_id!=0);
 												free(rfc724_mid);
 											}
+
+											/* aggregated MDNs as sent by dc_send_mdn() report further messages of the same sender */
+											struct mailimf_optional_field* of_more_msgids = mailimf_find_optional_field(report_fields, "Additional-Message-IDs");
+											if (of_more_msgids && of_more_msgids->fld_value)
+											{
+												const char* more_msgids = of_more_msgids->fld_value;
+												size_t      more_msgids_bytes = strlen(more_msgids);
+												dummy = 0;
+												rfc724_mid = NULL;
+												while (mailimf_msg_id_parse(more_msgids, more_msgids_bytes, &dummy, &rfc724_mid)==MAIL_NO_ERROR
+												 && rfc724_mid!=NULL)
+												{
+													uint32_t chat_id = 0;
+													uint32_t msg_id = 0;
+													if (dc_mdn_from_ext(context, from_id, rfc724_mid, sent_timestamp, &chat_id, &msg_id)) {
+														carray_add(rr_event_to_send, (void*)(uintptr_t)chat_id, NULL);
+														carray_add(rr_event_to_send, (void*)(uintptr_t)msg_id, NULL);
+													}
+													if (msg_id) {
+														mdn_consumed = 1;
+													}
+													free(rfc724_mid);
+													rfc724_mid = NULL;
+												}
+											}
 										}
 									}
 									mailmime_free(report_parsed);
@@ -1591,13 +1675,21 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 						 && dc_sqlite3_get_config_int(context->sql, "mvbox_move", DC_MVBOX_MOVE_DEFAULT)) {
 							dc_param_set_int(param, DC_PARAM_ALSO_MOVE, 1);
 						}
-						dc_job_add(context, DC_JOB_MARKSEEN_MDN_ON_IMAP, 0, param->packed, 0);
+						dc_job_add(context, DC_JOB_MARKSEEN_MDN_ON_IMAP, 0, dc_param_get_packed(param), 0);
 						dc_param_unref(param);
+						reports_moved = 1;
 					}
 				}
 
 			} /* for() */
 
+			/* remember moved reports, so that they are skipped by the precheck when they pop up in the other folder */
+			if (reports_moved && insert_msg_id==0
+			 && (field=dc_mimeparser_lookup_field(mime_parser, "Message-ID"))!=NULL && field->fld_type==MAILIMF_FIELD_MESSAGE_ID
+			 && field->fld_data.fld_message_id) {
+				dc_add_processed_report(context, field->fld_data.fld_message_id->mid_value);
+			}
+
 		}
 
 		{
@@ -1652,7 +1744,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 cleanup:
 	if (transaction_pending) { dc_sqlite3_rollback(context->sql); }
 
-	dc_mimeparser_unref(mime_parser);
+	release_mimeparser(context, mime_parser);
 	free(rfc724_mid);
 	free(mime_in_reply_to);
 	free(mime_references);
@@ -1676,6 +1768,5 @@ cleanup:
 		carray_free(rr_event_to_send);
 	}
 
-	free(txt_raw);
 	sqlite3_finalize(stmt);
 }
@@ -33,7 +33,8 @@ static const char* s_ent[] = {
 
 	- The first strings MUST NOT start with `&` and MUST end with `;`.
 	- take care not to miss a comma between the strings.
-	- It's also possible to specify the destination as a character reference as `&#34;` (they are converted in a second pass without a table). */
+	- The destination MUST NOT be longer than the entity with the leading `&`, as entities are decoded in-place.
+	- When adding longer names, adapt ENT_MAX_NAME. */
 
 	/* basic XML/HTML */
 	"lt;",      "<",	"gt;",      ">",	"quot;",    "\"",	"apos;",    "'",
@@ -108,103 +109,178 @@ static const char* s_ent[] = {
 };
 
 
-/* Recursively decodes entity and character references and normalizes new lines.
-set "type" to ...
-'&' for general entity decoding,
-'%' for parameter entity decoding (currently not needed),
-'c' for cdata sections,
-' ' for attribute normalization, or
-'*' for non-cdata attribute normalization (currently not needed).
-Returns s, or if the decoded string is longer than s, returns a malloced string
-that must be freed.
-Function based upon ezxml_decode() from the "ezxml" parser which is
-Copyright 2004-2006 Aaron Voisine <aaron@voisine.org> */
-static char* xml_decode(char* s, char type)
+/* The entities are looked up by a hash table, built once from s_ent.
+The table is filled less than half, so a lookup typically hits the wanted
+entity or an empty slot directly. */
+#define ENT_MAX_NAME   8   /* longest name in s_ent, without `;` */
+#define ENT_HASH_SLOTS 512 /* power of two, more than twice the number of entities */
+
+static uint16_t       s_ent_hash[ENT_HASH_SLOTS]; /* index in s_ent plus 1, 0 for free slots */
+static pthread_once_t s_ent_hash_once = PTHREAD_ONCE_INIT;
+
+
+static uint32_t ent_hash(const char* name, size_t name_len)
+{
+	uint32_t h = 2166136261u; /* FNV-1a */
+	for (size_t i = 0; i < name_len; i++) {
+		h = (h ^ (unsigned char)name[i]) * 16777619u;
+	}
+	return h;
+}
+
+
+static void build_ent_hash(void)
 {
-	char*       e = NULL;
-	char*       r = s;
-	const char* original_buf = s;
-	long        b = 0;
-	long        c = 0;
-	long        d = 0;
-	long        l = 0;
-
-	for (; *s; s++) { /* normalize line endings */
-		while (*s == '\r') {
-			*(s++) = '\n';
-			if (*s == '\n') memmove(s, (s + 1), strlen(s));
+	for (int i = 0; s_ent[i]; i += 2) {
+		uint32_t slot = ent_hash(s_ent[i], strlen(s_ent[i])-1/*`;`*/) & (ENT_HASH_SLOTS-1);
+		while (s_ent_hash[slot]) {
+			slot = (slot+1) & (ENT_HASH_SLOTS-1); /* an earlier, equal name is found first */
 		}
+		s_ent_hash[slot] = i+1;
 	}
+}
 
-	for (s = r; ;) {
-		while (*s && *s != '&' /*&& (*s != '%' || type != '%')*/ && !isspace(*s)) s++;
 
-		if (! *s)
-		{
-			break;
+static const char* find_ent(const char* name, size_t name_len)
+{
+	pthread_once(&s_ent_hash_once, build_ent_hash);
+
+	for (uint32_t slot = ent_hash(name, name_len) & (ENT_HASH_SLOTS-1); s_ent_hash[slot]; slot = (slot+1) & (ENT_HASH_SLOTS-1)) {
+		const char* ent = s_ent[s_ent_hash[slot]-1];
+		if (strncmp(ent, name, name_len)==0 && ent[name_len]==';') {
+			return s_ent[s_ent_hash[slot]];
 		}
-		else if (type != 'c' && ! strncmp(s, "&#", 2))
+	}
+
+	return NULL;
+}
+
+
+static int decode_char_ref(const char* s, char** w, const char** ret_end)
+{
+	/* decode `&#1234;` or `&#x12AB;` starting at s to UTF-8 at *w, returns 0 if this is no valid character reference */
+	const char* p = s + 2;
+	uint32_t    c = 0;
+	int         digits = 0;
+	int         base = 10;
+
+	if (*p=='x') {
+		base = 16;
+		p++;
+	}
+
+	for (;; p++, digits++) {
+		int d;
+		if (*p>='0' && *p<='9')                   { d = *p - '0'; }
+		else if (base==16 && *p>='a' && *p<='f') { d = *p - 'a' + 10; }
+		else if (base==16 && *p>='A' && *p<='F') { d = *p - 'A' + 10; }
+		else                                      { break; }
+		if (c <= 0x10FFFF) {
+			c = c*base + d; /* stays above 0x10FFFF once there, so no overflow */
+		}
+	}
+
+	if (digits==0 || *p!=';' || c==0 || c > 0x10FFFF) {
+		return 0;
+	}
+
+	char* o = *w;
+	if (c < 0x80) {
+		*o++ = c;
+	}
+	else if (c < 0x800) {
+		*o++ = 0xC0 | (c>>6);
+		*o++ = 0x80 | (c&0x3F);
+	}
+	else if (c < 0x10000) {
+		*o++ = 0xE0 | (c>>12);
+		*o++ = 0x80 | ((c>>6)&0x3F);
+		*o++ = 0x80 | (c&0x3F);
+	}
+	else {
+		*o++ = 0xF0 | (c>>18);
+		*o++ = 0x80 | ((c>>12)&0x3F);
+		*o++ = 0x80 | ((c>>6)&0x3F);
+		*o++ = 0x80 | (c&0x3F);
+	}
+
+	*w = o;
+	*ret_end = p + 1;
+	return 1;
+}
+
+
+/* Decodes entity and character references and normalizes new lines in-place.
+set "type" to ...
+'&' for general entity decoding,
+'c' for cdata sections (only new lines are normalized), or
+' ' for attribute normalization (whitespace is converted to spaces).
+The decoded string is never longer than the original one
+(a reference takes at least as many bytes as its UTF-8 replacement),
+so this function does not allocate memory.  Replacements are not decoded again,
+eg. `&amp;lt;` results in `&lt;`.
+Returns the length of the decoded, null-terminated string.
+Function based upon ezxml_decode() from the "ezxml" parser which is
+Copyright 2004-2006 Aaron Voisine <aaron@voisine.org> */
+static size_t xml_decode(char* s, char type)
+{
+	const char* r = s;
+	char*       w = s;
+
+	while (*r)
+	{
+		if (*r=='\r')
 		{
-			/* character reference */
-			if (s[2] == 'x') c = strtol(s + 3, &e, 16); /* base 16 */
-			else c = strtol(s + 2, &e, 10); /* base 10 */
-			if (! c || *e != ';') { s++; continue; } /* not a character ref */
-
-			if (c < 0x80) *(s++) = c; /* US-ASCII subset */
-			else { /* multi-byte UTF-8 sequence */
-				for (b = 0, d = c; d; d /= 2) b++; /* number of bits in c */
-				b = (b - 2) / 5; /* number of bytes in payload */
-				*(s++) = (0xFF << (7 - b)) | (c >> (6 * b)); /* head */
-				while (b) *(s++) = 0x80 | ((c >> (6 * --b)) & 0x3F); /* payload */
+			/* normalize `\r\n` and single `\r` to `\n` */
+			*w++ = (type==' ')? ' ' : '\n';
+			r++;
+			if (*r=='\n') {
+				r++;
 			}
-
-			memmove(s, strchr(s, ';') + 1, strlen(strchr(s, ';')));
 		}
-		else if ((*s == '&' && (type == '&' || type == ' ' /*|| type == '*'*/))
-		    /*|| (*s == '%' && type == '%')*/)
+		else if (*r=='&' && type!='c')
 		{
-			/* entity reference */
-			for (b = 0; s_ent[b] && strncmp(s + 1, s_ent[b], strlen(s_ent[b])); b += 2)
-				; /* find entity in entity list */
-
-			if (s_ent[b++]) { /* found a match */
-				if ((c = strlen(s_ent[b])) - 1 > (e = strchr(s, ';')) - s) {
-					/* the replacement is larger than the entity: enlarge buffer */
-					l = (d = (s - r)) + c + strlen(e); /* new length */
-					if (r == original_buf) {
-						char* new_ret = malloc(l); if (new_ret == NULL) { return r; }
-						strcpy(new_ret, r);
-						r = new_ret;
-					}
-					else {
-						char* new_ret = realloc(r, l); if (new_ret == NULL) { return r; }
-						r = new_ret;
-					}
-					e = strchr((s = r + d), ';'); /* fix up pointers */
+			const char* end = NULL;
+			if (r[1]=='#')
+			{
+				if (decode_char_ref(r, &w, &end)) {
+					r = end;
+					continue;
+				}
+			}
+			else
+			{
+				const char* name = r + 1;
+				const char* name_end = name;
+				while (name_end-name < ENT_MAX_NAME && isalnum((unsigned char)*name_end)) {
+					name_end++;
 				}
 
-				memmove(s + c, e + 1, strlen(e)); /* shift rest of string */
-				strncpy(s, s_ent[b], c); /* copy in replacement text */
+				const char* replacement = NULL;
+				if (*name_end==';' && (replacement=find_ent(name, name_end-name))!=NULL) {
+					size_t replacement_len = strlen(replacement);
+					memcpy(w, replacement, replacement_len);
+					w += replacement_len;
+					r = name_end + 1;
+					continue;
+				}
 			}
-			else s++; /* not a known entity */
+
+			*w++ = *r++; /* not a known reference, keep as is */
 		}
-		else if ((type == ' ' /*|| type == '*'*/) && isspace(*s))
+		else if (type==' ' && isspace((unsigned char)*r))
 		{
-			*(s++) = ' ';
+			*w++ = ' ';
+			r++;
 		}
-		else s++; /* no decoding needed */
-	}
-
-	/* normalize spaces for non-cdata attributes
-	if (type == '*') {
-		for (s = r; *s; s++) {
-			if ((l = strspn(s, " "))) memmove(s, s + l, strlen(s + l) + 1);
-			while (*s && *s != ' ') s++;
+		else
+		{
+			*w++ = *r++;
 		}
-		if (--s >= r && *s == ' ') *s = '\0';
-	}*/
+	}
 
-	return r;
+	*w = 0;
+	return w - s;
 }
 
 
@@ -225,34 +301,17 @@ static void call_text_cb(dc_saxparser_t* saxparser, char* text, size_t len, char
 {
 	if (text && len)
 	{
-		char bak = text[len], *text_new;
+		char bak = text[len];
 
 		text[len] = '\0';
-		text_new = xml_decode(text, type);
-		saxparser->text_cb(saxparser->userdata, text_new, len);
-		if (text != text_new) { free(text_new); }
+		size_t decoded_len = xml_decode(text, type); /* in-place, the text before the current position is not needed anymore */
+		saxparser->text_cb(saxparser->userdata, text, decoded_len);
 
 		text[len] = bak;
 	}
 }
 
 
-static void do_free_attr(char** attr, int* free_attr)
-{
-	/* "attr" are key/value pairs; the function frees the data if the corresponding bit in "free_attr" is set.
-	(we need this as we try to use the strings from the "main" document instead of allocating small strings) */
-	#define FREE_KEY    0x01
-	#define FREE_VALUE  0x02
-	int i = 0;
-	while (attr[i]) {
-		if (free_attr[i>>1]&FREE_KEY   && attr[i])   { free(attr[i]); }
-		if (free_attr[i>>1]&FREE_VALUE && attr[i+1]) { free(attr[i+1]); }
-		i += 2;
-	}
-	attr[0] = NULL; /* set list to zero-length */
-}
-
-
 /*******************************************************************************
  * Main interface
  ******************************************************************************/
@@ -312,10 +371,10 @@ void dc_saxparser_parse(dc_saxparser_t* saxparser, const char* buf_start__)
 	char* p = NULL;
 
 	#define MAX_ATTR 100 /* attributes per tag - a fixed border here is a security feature, not a limit */
-	char*   attr[(MAX_ATTR+1)*2]; /* attributes as key/value pairs, +1 for terminating the list */
-	int     free_attr[MAX_ATTR]; /* free the value at attr[i*2+1]? */
+	char*   attr[(MAX_ATTR+1)*2]; /* attributes as key/value pairs, +1 for terminating the list; all strings point into buf_start */
+	static char empty_value[1] = { 0 }; /* used for attributes without value, never modified */
 
-	attr[0] = NULL; /* null-terminate list, this also terminates "free_values" */
+	attr[0] = NULL; /* null-terminate list */
 
 	if (saxparser==NULL) {
 		return;
@@ -412,20 +471,22 @@ void dc_saxparser_parse(dc_saxparser_t* saxparser, const char* buf_start__)
 					/* process <tag attr1="val" attr2='val' attr3=val ..>
 					 **************************************************************/
 
-					do_free_attr(attr, free_attr);
+					attr[0] = NULL;
 
 					char* beg_tag_name = p;
 					p += strcspn(p, XML_WS "/>"); /* find character after tagname */
 					if (p != beg_tag_name)
 					{
 						char* after_tag_name = p;
+						char* after_attr = NULL; /* a `/` or `>` that is temporarily overwritten by the null-terminator of the last attribute */
+						char  after_attr_bak = 0;
 
 						/* scan for attributes */
 						int attr_index = 0;
 						while (isspace(*p)) { p++; } /* forward to first attribute name beginning */
 						while (*p && *p!='/' && *p!='>')
 						{
-							char *beg_attr_name = p, *beg_attr_value = NULL, *beg_attr_value_new = NULL;
+							char *beg_attr_name = p, *beg_attr_value = NULL;
 							if ('='==*beg_attr_name) {
 								p++; // otherwise eg. `"val"=` causes a deadlock as the second `=` is no exit condition and is not skipped by strcspn()
 								continue;
@@ -452,49 +513,45 @@ void dc_saxparser_parse(dc_saxparser_t* saxparser, const char* buf_start__)
 											*p = '\0'; /* null terminate attribute val */
 											p++;
 										}
-
-										beg_attr_value_new = xml_decode(beg_attr_value, ' ');
 									}
 									else
 									{
-										/* unquoted attribute value, as the needed null-terminated may overwrite important characters, we'll create a copy */
+										/* unquoted attribute value; a following whitespace can be overwritten by the null-terminator,
+										a following `/` or `>` is needed below and is restored after the tag is reported */
 										beg_attr_value = p;
 										p += strcspn(p, XML_WS "/>"); /* get end of attribute value */
-										bak = *p;
-										*p = '\0';
-											char* temp = dc_strdup(beg_attr_value);
-											beg_attr_value_new = xml_decode(temp, ' ');
-											if (beg_attr_value_new!=temp) { free(temp); }
-										*p = bak;
+										if (*p=='/' || *p=='>') {
+											after_attr = p;
+											after_attr_bak = *p;
+											*p = '\0'; /* ends the attribute loop */
+										}
+										else if (*p) {
+											*p = '\0';
+											p++;
+										}
 									}
+
+									xml_decode(beg_attr_value, ' ');
 								}
 								else
 								{
-									beg_attr_value_new = dc_strdup(NULL);
+									beg_attr_value = empty_value;
+								}
+
+								if (after_attr_name==p && *p) {
+									/* attribute without value directly before `/` or `>`, eg. `<tag attrWithoutValue>` */
+									after_attr = p;
+									after_attr_bak = *p;
 								}
+								*after_attr_name = '\0';
 
 								/* add attribute */
 								if (attr_index < MAX_ATTR)
 								{
-									char* beg_attr_name_new = beg_attr_name;
-									int   free_bits = (beg_attr_value_new != beg_attr_value)? FREE_VALUE : 0;
-									if (after_attr_name==p) {
-										/* take care not to overwrite the current pointer (happens eg. for `<tag attrWithoutValue>` */
-										bak = *after_attr_name;
-										*after_attr_name = '\0';
-										beg_attr_name_new = dc_strdup(beg_attr_name);
-										*after_attr_name = bak;
-										free_bits |= FREE_KEY;
-									}
-									else {
-										*after_attr_name = '\0';
-									}
-
-									dc_strlower_in_place(beg_attr_name_new);
-									attr[attr_index]         = beg_attr_name_new;
-									attr[attr_index+1]       = beg_attr_value_new;
+									dc_strlower_in_place(beg_attr_name);
+									attr[attr_index]         = beg_attr_name;
+									attr[attr_index+1]       = beg_attr_value;
 									attr[attr_index+2]       = NULL; /* null-terminate list */
-									free_attr[attr_index>>1] = free_bits;
 									attr_index += 2;
 								}
 							}
@@ -507,6 +564,9 @@ void dc_saxparser_parse(dc_saxparser_t* saxparser, const char* buf_start__)
 						dc_strlower_in_place(beg_tag_name);
 						saxparser->starttag_cb(saxparser->userdata, beg_tag_name, attr);
 						*after_tag_name = bak;
+						if (after_attr) {
+							*after_attr = after_attr_bak;
+						}
 
 						/* self-closing tag */
 						p += strspn(p, XML_WS); /* skip whitespace before possible `/` */
@@ -537,7 +597,6 @@ void dc_saxparser_parse(dc_saxparser_t* saxparser, const char* buf_start__)
 	call_text_cb(saxparser, last_text_start, p - last_text_start, '&'); /* flush pending text */
 
 cleanup:
-	do_free_attr(attr, free_attr);
 	free(buf_start);
 }
 
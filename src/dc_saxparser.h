@@ -10,7 +10,7 @@ typedef struct _dc_saxparser dc_saxparser_t;
 
 typedef void (*dc_saxparser_starttag_cb_t) (void* userdata, const char* tag, char** attr);
 typedef void (*dc_saxparser_endtag_cb_t)   (void* userdata, const char* tag);
-typedef void (*dc_saxparser_text_cb_t)     (void* userdata, const char* text, int len); /* len is only informational, text is already null-terminated */
+typedef void (*dc_saxparser_text_cb_t)     (void* userdata, const char* text, int len); /* len is the length of the decoded text, text is null-terminated */
 
 
 struct _dc_saxparser
@@ -13,10 +13,20 @@
  ******************************************************************************/
 
 
-static int is_empty_line(const char* buf)
+/* the text is not split into single strings, a line is a pointer into the text
+and its length, the line end is not included */
+typedef struct line_t
 {
-	const unsigned char* p1 = (const unsigned char*)buf; /* force unsigned - otherwise the `> ' '` comparison will fail */
-	while (*p1) {
+	const char* p;
+	int         len;
+} line_t;
+
+
+static int is_empty_line(const line_t* line)
+{
+	const unsigned char* p1 = (const unsigned char*)line->p; /* force unsigned - otherwise the `> ' '` comparison will fail */
+	const unsigned char* end = p1 + line->len;
+	while (p1 < end) {
 		if (*p1 > ' ') {
 			return 0; /* at least one character found - buffer is not empty */
 		}
@@ -26,30 +36,28 @@ static int is_empty_line(const char* buf)
 }
 
 
-static int is_plain_quote(const char* buf)
+static int is_plain_quote(const line_t* line)
 {
-	if (buf[0]=='>') {
+	if (line->len > 0 && line->p[0]=='>') {
 		return 1;
 	}
 	return 0;
 }
 
 
-static int is_quoted_headline(const char* buf)
+static int is_quoted_headline(const line_t* line)
 {
 	/* This function may be called for the line _directly_ before a quote.
 	The function checks if the line contains sth. like "On 01.02.2016, xy@z wrote:" in various languages.
 	- Currently, we simply check if the last character is a ':'.
 	- Checking for the existance of an email address may fail (headlines may show the user's name instead of the address) */
 
-	int buf_len = strlen(buf);
-
-	if (buf_len > 80) {
+	if (line->len > 80) {
 		return 0; /* the buffer is too long to be a quoted headline (some mailprograms (eg. "Mail" from Stock Android)
 		          forget to insert a line break between the answer and the quoted headline ...)) */
 	}
 
-	if (buf_len > 0 && buf[buf_len-1]==':') {
+	if (line->len > 0 && line->p[line->len-1]==':') {
 		return 1; /* the buffer is a quoting headline in the meaning described above) */
 	}
 
@@ -57,6 +65,19 @@ static int is_quoted_headline(const char* buf)
 }
 
 
+static int line_equals(const line_t* line, const char* str)
+{
+	size_t str_len = strlen(str);
+	return (size_t)line->len==str_len && memcmp(line->p, str, str_len)==0;
+}
+
+
+static int line_starts_with(const line_t* line, const char* prefix)
+{
+	size_t prefix_len = strlen(prefix);
+	return (size_t)line->len>=prefix_len && memcmp(line->p, prefix, prefix_len)==0;
+}
+
 
 /*******************************************************************************
  * Main interface
@@ -90,8 +111,16 @@ void dc_simplify_unref(dc_simplify_t* simplify)
  ******************************************************************************/
 
 
+/* the simplified text is written to the same buffer as the text is read from,
+the buffer must have DC_SIMPLIFY_HEAD bytes before and DC_SIMPLIFY_TAIL bytes after the text.
+as the lines are copied in order and never more linebreaks are written than read,
+the written text does not overtake the text still to be read. */
+#define DC_SIMPLIFY_HEAD (sizeof(DC_EDITORIAL_ELLIPSE " ")-1)
+#define DC_SIMPLIFY_TAIL (sizeof(" " DC_EDITORIAL_ELLIPSE))
+
+
 static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
-                                             const char* buf_terminated,
+                                             char* buf, int buf_bytes,
                                              int is_msgrmsg)
 {
 	/* This function ...
@@ -100,12 +129,37 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 	    these are all lines starting with the character `>`
 	... remove a non-empty line before the removed quote (contains sth. like "On 2.9.2016, Bjoern wrote:" in different formats and lanugages) */
 
+	const char* text = buf + DC_SIMPLIFY_HEAD;
+	const char* text_end = text + buf_bytes;
+	const char* p1 = NULL;
+	const char* p2 = NULL;
+	int         lines_cnt = 1;
+
 	/* split the given buffer into lines */
-	carray* lines = dc_split_into_lines(buf_terminated);
+	for (p1 = text; (p1=memchr(p1, '\n', text_end-p1))!=NULL; p1++) {
+		lines_cnt++;
+	}
+
+	line_t* lines = malloc(sizeof(line_t)*lines_cnt);
+	if (lines==NULL) {
+		exit(65);
+	}
+
+	p1 = text;
+	for (int i = 0; i < lines_cnt; i++) {
+		p2 = memchr(p1, '\n', text_end-p1);
+		if (p2==NULL) {
+			p2 = text_end;
+		}
+		lines[i].p   = p1;
+		lines[i].len = p2-p1;
+		p1 = p2+1;
+	}
+
 	int     l = 0;
 	int     l_first = 0;
-	int     l_last = carray_count(lines)-1; /* if l_last is -1, there are no lines */
-	char*   line = NULL;
+	int     l_last = lines_cnt-1; /* if l_last is -1, there are no lines */
+	line_t* line = NULL;
 
 	/* search for the line `-- ` and ignore this and all following lines
 	If the line contains more characters, it is _not_ treated as the footer start mark (hi, Thorsten) */
@@ -114,16 +168,16 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 		for (l = l_first; l <= l_last; l++)
 		{
 			/* hide standard footer, "-- " - we do not set is_cut_at_end if we find this mark */
-			line = (char*)carray_get(lines, l);
-			if (strcmp(line, "-- ")==0
-			 || strcmp(line, "--  ")==0) { /* quoted-printable may encode `-- ` to `-- =20` which is converted back to `--  ` ... */
+			line = &lines[l];
+			if (line_equals(line, "-- ")
+			 || line_equals(line, "--  ")) { /* quoted-printable may encode `-- ` to `-- =20` which is converted back to `--  ` ... */
 				footer_mark = 1;
 			}
 
 			/* also hide some non-standard footers - they got is_cut_at_end set, however  */
-			if (strcmp(line, "--")==0
-			 || strcmp(line, "---")==0
-			 || strcmp(line, "----")==0) {
+			if (line_equals(line, "--")
+			 || line_equals(line, "---")
+			 || line_equals(line, "----")) {
 				footer_mark = 1;
 				simplify->is_cut_at_end = 1;
 			}
@@ -137,12 +191,9 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 
 	/* check for "forwarding header" */
 	if ((l_last-l_first+1) >= 3) {
-		char* line0 = (char*)carray_get(lines, l_first);
-		char* line1 = (char*)carray_get(lines, l_first+1);
-		char* line2 = (char*)carray_get(lines, l_first+2);
-		if (strcmp(line0, "---------- Forwarded message ----------")==0 /* do not chage this! sent exactly in this form in dc_chat.c! */
-		 && strncmp(line1, "From: ", 6)==0
-		 && line2[0]==0)
+		if (line_equals(&lines[l_first], "---------- Forwarded message ----------") /* do not chage this! sent exactly in this form in dc_chat.c! */
+		 && line_starts_with(&lines[l_first+1], "From: ")
+		 && lines[l_first+2].len==0)
 		{
             simplify->is_forwarded = 1; /* nothing is cutted, the forward state should displayed explicitly in the ui */
             l_first += 3;
@@ -153,12 +204,12 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 	also loose forwarded messages, however, the user has always the option to show the full mail text. */
 	for (l = l_first; l <= l_last; l++)
 	{
-		line = (char*)carray_get(lines, l);
-		if (strncmp(line, "-----", 5)==0
-		 || strncmp(line, "_____", 5)==0
-		 || strncmp(line, "=====", 5)==0
-		 || strncmp(line, "*****", 5)==0
-		 || strncmp(line, "~~~~~", 5)==0)
+		line = &lines[l];
+		if (line_starts_with(line, "-----")
+		 || line_starts_with(line, "_____")
+		 || line_starts_with(line, "=====")
+		 || line_starts_with(line, "*****")
+		 || line_starts_with(line, "~~~~~"))
 		{
 			l_last = l - 1; /* if l_last is -1, there are no lines */
 			simplify->is_cut_at_end = 1;
@@ -172,7 +223,7 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 		int l_lastQuotedLine = -1;
 
 		for (l = l_last; l >= l_first; l--) {
-			line = (char*)carray_get(lines, l);
+			line = &lines[l];
 			if (is_plain_quote(line)) {
 				l_lastQuotedLine = l;
 			}
@@ -187,14 +238,13 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 			simplify->is_cut_at_end = 1;
 
 			if (l_last > 0) {
-				if (is_empty_line((char*)carray_get(lines, l_last))) { /* allow one empty line between quote and quote headline (eg. mails from Jürgen) */
+				if (is_empty_line(&lines[l_last])) { /* allow one empty line between quote and quote headline (eg. mails from Jürgen) */
 					l_last--;
 				}
 			}
 
 			if (l_last > 0) {
-				line = (char*)carray_get(lines, l_last);
-				if (is_quoted_headline(line)) {
+				if (is_quoted_headline(&lines[l_last])) {
 					l_last--;
 				}
 			}
@@ -208,7 +258,7 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 		int hasQuotedHeadline = 0;
 
 		for (l = l_first; l <= l_last; l++) {
-			line = (char*)carray_get(lines, l);
+			line = &lines[l];
 			if (is_plain_quote(line)) {
 				l_lastQuotedLine = l;
 			}
@@ -229,12 +279,12 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 		}
 	}
 
-	/* re-create buffer from the remaining lines */
-	dc_strbuilder_t ret;
-	dc_strbuilder_init(&ret, strlen(buf_terminated));
+	/* re-create buffer from the remaining lines, in-place, see DC_SIMPLIFY_HEAD */
+	char* w = buf;
 
 	if (simplify->is_cut_at_begin) {
-		dc_strbuilder_cat(&ret, DC_EDITORIAL_ELLIPSE " ");
+		memcpy(w, DC_EDITORIAL_ELLIPSE " ", DC_SIMPLIFY_HEAD);
+		w += DC_SIMPLIFY_HEAD;
 	}
 
 	int pending_linebreaks = 0; /* we write empty lines only in case and non-empty line follows */
@@ -242,7 +292,7 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 
 	for (l = l_first; l <= l_last; l++)
 	{
-		line = (char*)carray_get(lines, l);
+		line = &lines[l];
 
 		if (is_empty_line(line))
 		{
@@ -254,12 +304,13 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 			{
 				if (pending_linebreaks > 2) { pending_linebreaks = 2; } /* ignore more than one empty line (however, regard normal line ends) */
 				while (pending_linebreaks) {
-					dc_strbuilder_cat(&ret, "\n");
+					*w++ = '\n';
 					pending_linebreaks--;
 				}
 			}
 
-			dc_strbuilder_cat(&ret, line);
+			memmove(w, line->p, line->len);
+			w += line->len;
 			content_lines_added++;
 			pending_linebreaks = 1;
 		}
@@ -267,12 +318,15 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 
 	if (simplify->is_cut_at_end
 	 && (!simplify->is_cut_at_begin || content_lines_added) /* avoid two `[...]` without content */) {
-		dc_strbuilder_cat(&ret, " " DC_EDITORIAL_ELLIPSE);
+		memcpy(w, " " DC_EDITORIAL_ELLIPSE, DC_SIMPLIFY_TAIL-1);
+		w += DC_SIMPLIFY_TAIL-1;
 	}
 
-	dc_free_splitted_lines(lines);
+	*w = 0;
 
-	return ret.buf;
+	free(lines);
+
+	return buf;
 }
 
 
@@ -284,9 +338,11 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify,
 char* dc_simplify_simplify(dc_simplify_t* simplify, const char* in_unterminated,
                            int in_bytes, int is_html, int is_msgrmsg)
 {
-	/* create a copy of the given buffer */
-	char* out = NULL;
-	char* temp = NULL;
+	char*       html = NULL;
+	char*       buf = NULL;
+	const char* p1 = NULL;
+	const char* in_end = NULL;
+	char*       w = NULL;
 
 	if (simplify==NULL || in_unterminated==NULL || in_bytes <= 0) {
 		return dc_strdup("");
@@ -296,28 +352,34 @@ char* dc_simplify_simplify(dc_simplify_t* simplify, const char* in_unterminated,
 	simplify->is_cut_at_begin = 0;
 	simplify->is_cut_at_end   = 0;
 
-	out = strndup((char*)in_unterminated, in_bytes); /* strndup() makes sure, the string is null-terminated */
-	if (out==NULL) {
-		return dc_strdup("");
-	}
-
 	/* convert HTML to text, if needed */
 	if (is_html) {
-		if ((temp = dc_dehtml(out)) != NULL) { /* dc_dehtml() returns way too much lineends, however they're removed in the simplification below */
-			free(out);
-			out = temp;
+		if ((html=strndup(in_unterminated, in_bytes))==NULL) { /* strndup() makes sure, the string is null-terminated */
+			return dc_strdup("");
 		}
+		char* temp = dc_dehtml(html); /* dc_dehtml() returns way too much lineends, however they're removed in the simplification below */
+		free(html);
+		html = temp;
+		in_unterminated = html;
+		in_bytes = strlen(html);
 	}
 
-	/* simplify the text in the buffer (characters to remove may be marked by `\r`) */
-	dc_remove_cr_chars(out); /* make comparisons easier, eg. for line `-- ` */
-	if ((temp = dc_simplify_simplify_plain_text(simplify, out, is_msgrmsg)) != NULL) {
-		free(out);
-		out = temp;
+	/* copy the text to a buffer with some space for the editorial ellipses;
+	characters to remove may be marked by `\r`, they are skipped here, which also makes comparisons easier, eg. for line `-- ` */
+	if ((buf=malloc(DC_SIMPLIFY_HEAD + in_bytes + DC_SIMPLIFY_TAIL))==NULL) {
+		exit(66);
+	}
+
+	w = buf + DC_SIMPLIFY_HEAD;
+	in_end = in_unterminated + in_bytes;
+	for (p1 = in_unterminated; p1 < in_end && *p1; p1++) { /* stop at a null-byte, as strndup() did before */
+		if (*p1!='\r') {
+			*w++ = *p1;
+		}
 	}
 
-	/* remove all `\r` from string */
-	dc_remove_cr_chars(out);
+	buf = dc_simplify_simplify_plain_text(simplify, buf, w-(buf+DC_SIMPLIFY_HEAD), is_msgrmsg);
 
-	return out;
+	free(html);
+	return buf;
 }
@@ -259,6 +259,7 @@ int dc_smtp_send_msg(dc_smtp_t* smtp, const clist* recipients, const char* data_
 	int        success = 0;
 	int        r = 0;
 	clistiter* iter = NULL;
+	uint64_t   stats_start = dc_stats_now();
 
 	if (smtp==NULL) {
 		goto cleanup;
@@ -311,6 +312,7 @@ int dc_smtp_send_msg(dc_smtp_t* smtp, const clist* recipients, const char* data_
 
     dc_log_event(smtp->context, DC_EVENT_SMTP_MESSAGE_SENT, 0,
                  "Message was sent to SMTP server");
+	dc_stats_add(smtp->context, DC_STATS_SMTP_SEND, stats_start);
 	success = 1;
 
 cleanup:
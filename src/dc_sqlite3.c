@@ -3,6 +3,7 @@
 #include <sys/stat.h>
 #include "dc_context.h"
 #include "dc_apeerstate.h"
+#include "dc_contact.h"
 
 
 /* This class wraps around SQLite.
@@ -53,6 +54,7 @@ void dc_sqlite3_log_error(dc_sqlite3_t* sql, const char* msg_format, ...)
 sqlite3_stmt* dc_sqlite3_prepare(dc_sqlite3_t* sql, const char* querystr)
 {
 	sqlite3_stmt* stmt = NULL;
+	uint64_t      stats_start = dc_stats_now();
 
 	if (sql==NULL || querystr==NULL || sql->cobj==NULL) {
 		return NULL;
@@ -67,6 +69,8 @@ sqlite3_stmt* dc_sqlite3_prepare(dc_sqlite3_t* sql, const char* querystr)
 		return NULL;
 	}
 
+	dc_stats_add(sql->context, DC_STATS_SQL_PREPARE, stats_start);
+
 	/* success - the result must be freed using sqlite3_finalize() */
 	return stmt;
 }
@@ -190,6 +194,65 @@ void dc_sqlite3_unref(dc_sqlite3_t* sql)
 }
 
 
+#if SQLITE_VERSION_NUMBER>=3014000
+static int trace_profile(unsigned type, void* userdata, void* stmt, void* nanoseconds)
+{
+	dc_sqlite3_t* sql = (dc_sqlite3_t*)userdata;
+	if (type==SQLITE_TRACE_PROFILE) {
+		dc_stats_add_us(sql->context, DC_STATS_SQL_EXEC, *(sqlite3_int64*)nanoseconds/1000);
+	}
+	return 0;
+}
+#endif
+
+
+static void update_locations_rtree(dc_sqlite3_t* sql)
+{
+	/* the spatial index for dc_get_locations_in_area() is kept up to date by triggers.
+	the database may be opened by an sqlite library compiled without SQLITE_ENABLE_RTREE,
+	eg. a system library or another device importing a backup; the triggers would make all writes to `locations` fail then.
+	so, without R*Tree support, the triggers are dropped and the index is rebuilt on the next open with R*Tree support. */
+	sqlite3_stmt* stmt = NULL;
+	int           has_triggers = 0;
+
+	stmt = dc_sqlite3_prepare(sql, "SELECT COUNT(*) FROM sqlite_master WHERE type='trigger' AND name LIKE 'locations_rtree_%';");
+	if (sqlite3_step(stmt)==SQLITE_ROW) {
+		has_triggers = sqlite3_column_int(stmt, 0)==3;
+	}
+	sqlite3_finalize(stmt);
+
+	if (!sqlite3_compileoption_used("ENABLE_RTREE")) {
+		// a virtual table cannot be dropped without its module, however, it is not used without the triggers
+		dc_sqlite3_execute(sql, "DROP TRIGGER IF EXISTS locations_rtree_insert;");
+		dc_sqlite3_execute(sql, "DROP TRIGGER IF EXISTS locations_rtree_update;");
+		dc_sqlite3_execute(sql, "DROP TRIGGER IF EXISTS locations_rtree_delete;");
+		return;
+	}
+
+	if (has_triggers) {
+		return;
+	}
+
+	dc_sqlite3_execute(sql, "BEGIN;");
+		dc_sqlite3_execute(sql, "DROP TRIGGER IF EXISTS locations_rtree_insert;");
+		dc_sqlite3_execute(sql, "DROP TRIGGER IF EXISTS locations_rtree_update;");
+		dc_sqlite3_execute(sql, "DROP TRIGGER IF EXISTS locations_rtree_delete;");
+		dc_sqlite3_execute(sql, "DROP TABLE IF EXISTS locations_rtree;");
+		dc_sqlite3_execute(sql, "CREATE VIRTUAL TABLE locations_rtree USING rtree(id, min_lat, max_lat, min_lon, max_lon);");
+		dc_sqlite3_execute(sql, "INSERT INTO locations_rtree SELECT id, latitude, latitude, longitude, longitude FROM locations;");
+		dc_sqlite3_execute(sql, "CREATE TRIGGER locations_rtree_insert AFTER INSERT ON locations BEGIN"
+		                        " INSERT INTO locations_rtree VALUES (new.id, new.latitude, new.latitude, new.longitude, new.longitude);"
+		                        " END;");
+		dc_sqlite3_execute(sql, "CREATE TRIGGER locations_rtree_update AFTER UPDATE OF latitude, longitude ON locations BEGIN"
+		                        " UPDATE locations_rtree SET min_lat=new.latitude, max_lat=new.latitude, min_lon=new.longitude, max_lon=new.longitude WHERE id=new.id;"
+		                        " END;");
+		dc_sqlite3_execute(sql, "CREATE TRIGGER locations_rtree_delete AFTER DELETE ON locations BEGIN"
+		                        " DELETE FROM locations_rtree WHERE id=old.id;"
+		                        " END;");
+	dc_sqlite3_execute(sql, "COMMIT;");
+}
+
+
 int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 {
 	if (dc_sqlite3_is_open(sql)) {
@@ -236,6 +299,11 @@ int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 	// (without a busy_timeout, sqlite3_step() would return SQLITE_BUSY at once)
 	sqlite3_busy_timeout(sql->cobj, 10*1000);
 
+	#if SQLITE_VERSION_NUMBER>=3014000
+		// time all statements for dc_get_stats()
+		sqlite3_trace_v2(sql->cobj, SQLITE_TRACE_PROFILE, trace_profile, sql);
+	#endif
+
 	if (!(flags&DC_OPEN_READONLY))
 	{
 		int exists_before_update = 0;
@@ -338,6 +406,8 @@ int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 
 		int dbversion = dbversion_before_update;
 		int recalc_fingerprints = 0;
+		int rebuild_contacts_search = 0;
+		int rebuild_members_keys = 0;
 		int update_file_paths = 0;
 
 		#define NEW_DB_VERSION 1
@@ -637,6 +707,97 @@ int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 			}
 		#undef NEW_DB_VERSION
 
+		#define NEW_DB_VERSION 56
+			if (dbversion < NEW_DB_VERSION)
+			{
+				// locations are typically queried by chat or by contact and a timespan
+				dc_sqlite3_execute(sql, "DROP INDEX IF EXISTS locations_index1;");
+				dc_sqlite3_execute(sql, "CREATE INDEX locations_index3 ON locations (chat_id, timestamp);");
+				dc_sqlite3_execute(sql, "CREATE INDEX locations_index4 ON locations (from_id, timestamp);");
+
+				// the spatial index for dc_get_locations_in_area() is created by update_locations_rtree()
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
+		#define NEW_DB_VERSION 57
+			if (dbversion < NEW_DB_VERSION)
+			{
+				// old tracks are moved here by dc_housekeeping(), one row per chat, contact and day;
+				// the points are stored as delta-encoded varints, see dc_compact_locations()
+				dc_sqlite3_execute(sql, "CREATE TABLE locations_tracks ("
+				                        " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+				                        " chat_id INTEGER DEFAULT 0,"
+				                        " from_id INTEGER DEFAULT 0,"
+				                        " timestamp_begin INTEGER DEFAULT 0,"
+				                        " timestamp_end INTEGER DEFAULT 0,"
+				                        " latitude_min REAL DEFAULT 0.0,"
+				                        " latitude_max REAL DEFAULT 0.0,"
+				                        " longitude_min REAL DEFAULT 0.0,"
+				                        " longitude_max REAL DEFAULT 0.0,"
+				                        " points BLOB);");
+				dc_sqlite3_execute(sql, "CREATE INDEX locations_tracks_index1 ON locations_tracks (chat_id, timestamp_end);");
+				dc_sqlite3_execute(sql, "CREATE INDEX locations_tracks_index2 ON locations_tracks (from_id, timestamp_end);");
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
+		#define NEW_DB_VERSION 58
+			if (dbversion < NEW_DB_VERSION)
+			{
+				// prefix search index for dc_get_contacts(), filled in part (2) below
+				dc_sqlite3_execute(sql, "CREATE TABLE contacts_search (token TEXT DEFAULT '', contact_id INTEGER DEFAULT 0);");
+				dc_sqlite3_execute(sql, "CREATE INDEX contacts_search_index1 ON contacts_search (token);");
+				dc_sqlite3_execute(sql, "CREATE INDEX contacts_search_index2 ON contacts_search (contact_id);");
+				rebuild_contacts_search = 1;
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
+		#define NEW_DB_VERSION 59
+			if (dbversion < NEW_DB_VERSION)
+			{
+				// Message-IDs of processed reports that are not added to msgs, see dc_add_processed_report()
+				dc_sqlite3_execute(sql, "CREATE TABLE reports_processed (id INTEGER PRIMARY KEY, rfc724_mid TEXT DEFAULT '', timestamp INTEGER DEFAULT 0);");
+				dc_sqlite3_execute(sql, "CREATE UNIQUE INDEX reports_processed_index1 ON reports_processed (rfc724_mid);");
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
+		#define NEW_DB_VERSION 60
+			if (dbversion < NEW_DB_VERSION)
+			{
+				// sorted, comma-separated list of the member IDs without SELF, used to find ad-hoc groups by their members;
+				// see dc_update_chat_members_key(), filled in part (2) below.
+				dc_sqlite3_execute(sql, "ALTER TABLE chats ADD COLUMN members_key TEXT DEFAULT '';");
+				dc_sqlite3_execute(sql, "CREATE INDEX chats_index4 ON chats (members_key);");
+				rebuild_members_keys = 1;
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
+		#define NEW_DB_VERSION 61
+			if (dbversion < NEW_DB_VERSION)
+			{
+				// read receipts waiting to be sent, collected per sender by DC_JOB_MAYBE_SEND_MDNS
+				dc_sqlite3_execute(sql, "CREATE TABLE mdns_pending (id INTEGER PRIMARY KEY, msg_id INTEGER DEFAULT 0, from_id INTEGER DEFAULT 0, timestamp INTEGER DEFAULT 0);");
+				dc_sqlite3_execute(sql, "CREATE INDEX mdns_pending_index1 ON mdns_pending (from_id);");
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
 		// (2) updates that require high-level objects
 		// (the structure is complete now and all objects are usable)
 		// --------------------------------------------------------------------
@@ -655,6 +816,34 @@ int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 			sqlite3_finalize(stmt);
 		}
 
+		if (rebuild_contacts_search)
+		{
+			// dc_sqlite3_begin_transaction() may be compiled out,
+			// without a transaction, there would be several syncs per contact
+			dc_sqlite3_execute(sql, "BEGIN;");
+			sqlite3_stmt* stmt = dc_sqlite3_prepare(sql, "SELECT id, name, addr FROM contacts WHERE id>?;");
+			sqlite3_bind_int(stmt, 1, DC_CONTACT_ID_LAST_SPECIAL);
+				while (sqlite3_step(stmt)==SQLITE_ROW) {
+					dc_update_contact_search_index(sql->context, sqlite3_column_int(stmt, 0),
+						(const char*)sqlite3_column_text(stmt, 1), (const char*)sqlite3_column_text(stmt, 2));
+				}
+			sqlite3_finalize(stmt);
+			dc_sqlite3_execute(sql, "COMMIT;");
+		}
+
+		if (rebuild_members_keys)
+		{
+			// one transaction for all chats, see above
+			dc_sqlite3_execute(sql, "BEGIN;");
+			sqlite3_stmt* stmt = dc_sqlite3_prepare(sql, "SELECT id FROM chats WHERE id>?;");
+			sqlite3_bind_int(stmt, 1, DC_CHAT_ID_LAST_SPECIAL);
+				while (sqlite3_step(stmt)==SQLITE_ROW) {
+					dc_update_chat_members_key(sql->context, sqlite3_column_int(stmt, 0));
+				}
+			sqlite3_finalize(stmt);
+			dc_sqlite3_execute(sql, "COMMIT;");
+		}
+
 		if (update_file_paths)
 		{
 			// versions before 2018-08 save the absolute paths in the database files at "param.f=";
@@ -676,6 +865,11 @@ int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 			free(repl_from);
 			dc_sqlite3_set_config(sql, "backup_for", NULL);
 		}
+
+		// (3) updates that depend on the sqlite library, which may differ between opens
+		// --------------------------------------------------------------------
+
+		update_locations_rtree(sql);
 	}
 
 	dc_log_info(sql->context, 0, "Opened \"%s\".", dbfile);
@@ -699,6 +893,14 @@ void dc_sqlite3_close(dc_sqlite3_t* sql)
 		sql->cobj = NULL;
 	}
 
+	if (sql->context && sql==sql->context->sql) {
+		/* the database may be replaced, eg. by importing a backup,
+		forget everything cached from it */
+		dc_reset_known_rfc724_mids(sql->context);
+		dc_reset_contact_cache(sql->context);
+		dc_e2ee_reset_plans(sql->context);
+	}
+
 	dc_log_info(sql->context, 0, "Database closed."); /* We log the information even if not real closing took place; this is to detect logic errors. */
 }
 
@@ -812,6 +1014,14 @@ int dc_sqlite3_set_config(dc_sqlite3_t* sql, const char* key, const char* value)
 		return 0;
 	}
 
+	if (strcmp(key, "configured_addr")==0 && sql==sql->context->sql) {
+		dc_reset_contact_cache(sql->context); /* the cache also holds the self-address */
+	}
+
+	if ((strcmp(key, "configured_addr")==0 || strcmp(key, "e2ee_enabled")==0) && sql==sql->context->sql) {
+		dc_e2ee_reset_plans(sql->context); /* the own address and preference are cached with the plans */
+	}
+
 	return 1;
 }
 
@@ -924,6 +1134,12 @@ void dc_sqlite3_rollback(dc_sqlite3_t* sql)
 		dc_sqlite3_log_error(sql, "Cannot rollback transaction.");
 	}
 	sqlite3_finalize(stmt);
+
+	if (sql->context && sql==sql->context->sql) {
+		/* contacts cached during the transaction may not exist any longer
+		or may have an origin that was not saved */
+		dc_reset_contact_cache(sql->context);
+	}
 #endif
 }
 
@@ -1011,6 +1227,9 @@ void dc_housekeeping(dc_context_t* context)
 
 	dc_log_info(context, 0, "Start housekeeping...");
 
+	dc_compact_locations(context);
+	dc_delete_old_processed_reports(context);
+
 	/* collect all files in use */
 	maybe_add_from_param(context, &files_in_use,
 		"SELECT param FROM msgs "
@@ -0,0 +1,229 @@
+/* Counts and latency histograms of the hot paths.
+
+The numbers are collected always, recording a duration is cheap compared to
+the timed operations themselves.  They can be read by dc_get_stats() or,
+as a summary, by dc_get_info(); dc_reset_stats() starts over. */
+
+
+#include <time.h>
+#include "dc_context.h"
+
+
+static const char* s_names[DC_STATS_CNT] = {
+	"sql_prepare",
+	"sql_exec",
+	"imap_connect",
+	"imap_select",
+	"imap_prefetch",
+	"imap_fetch",
+	"imap_store",
+	"imap_move",
+	"smtp_send",
+	"pgp_encrypt",
+	"pgp_decrypt",
+	"mime_parse",
+	"mime_render",
+	"job",
+	"chatlist_load",
+	"get_chat_msgs",
+	"search_msgs"
+};
+
+
+/**
+ * Get a monotonic timestamp in microseconds to be passed to dc_stats_add() later.
+ *
+ * @private @memberof dc_context_t
+ * @return Microseconds since an arbitrary point in time.
+ */
+uint64_t dc_stats_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+
+void dc_stats_add_us(dc_context_t* context, dc_stats_what_t what, uint64_t duration_us)
+{
+	int bucket = 0;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || what<0 || what>=DC_STATS_CNT) {
+		return;
+	}
+
+	for (uint64_t v = duration_us; v && bucket<DC_STATS_BUCKETS-1; v >>= 1) {
+		bucket++;
+	}
+
+	pthread_mutex_lock(&context->stats_critical);
+		dc_stats_entry_t* entry = &context->stats[what];
+		entry->cnt++;
+		entry->total_us += duration_us;
+		if (duration_us>entry->max_us) {
+			entry->max_us = duration_us;
+		}
+		entry->buckets[bucket]++;
+	pthread_mutex_unlock(&context->stats_critical);
+}
+
+
+/**
+ * Record the duration of an operation.
+ *
+ * @private @memberof dc_context_t
+ * @param context The context object.
+ * @param what The operation that was timed.
+ * @param start_us The start of the operation as returned by dc_stats_now().
+ * @return None.
+ */
+void dc_stats_add(dc_context_t* context, dc_stats_what_t what, uint64_t start_us)
+{
+	uint64_t now_us = dc_stats_now();
+	dc_stats_add_us(context, what, now_us>start_us? now_us-start_us : 0);
+}
+
+
+static uint64_t get_percentile_us(const dc_stats_entry_t* entry, int percent)
+{
+	/* the upper bound of the bucket containing the percentile, this is an estimation by nature */
+	uint64_t wanted = (entry->cnt*percent+99)/100;
+	uint64_t seen = 0;
+
+	for (int i = 0; i<DC_STATS_BUCKETS; i++) {
+		seen += entry->buckets[i];
+		if (seen>=wanted && seen>0) {
+			uint64_t upper = i? ((uint64_t)1)<<i : 0;
+			return upper<entry->max_us? upper : entry->max_us;
+		}
+	}
+
+	return entry->max_us;
+}
+
+
+static void copy_stats(dc_context_t* context, dc_stats_entry_t* ret)
+{
+	pthread_mutex_lock(&context->stats_critical);
+		memcpy(ret, context->stats, sizeof(dc_stats_entry_t)*DC_STATS_CNT);
+	pthread_mutex_unlock(&context->stats_critical);
+}
+
+
+/**
+ * Get a summary of the stats as lines of `stats_<name>=...` as used by dc_get_info().
+ * Operations that were not executed are not listed.
+ *
+ * @private @memberof dc_context_t
+ * @param context The context object.
+ * @return String which must be free()'d after usage.  Never returns NULL.
+ */
+char* dc_stats_get_readable(dc_context_t* context)
+{
+	dc_stats_entry_t stats[DC_STATS_CNT];
+	dc_strbuilder_t  ret;
+	dc_strbuilder_init(&ret, 0);
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return ret.buf;
+	}
+
+	copy_stats(context, stats);
+
+	for (int i = 0; i<DC_STATS_CNT; i++) {
+		if (stats[i].cnt) {
+			dc_strbuilder_catf(&ret, "stats_%s=%llu calls, avg %.3f ms, p95 %.3f ms, max %.3f ms\n",
+				s_names[i], (unsigned long long)stats[i].cnt,
+				stats[i].total_us/1000.0/stats[i].cnt,
+				get_percentile_us(&stats[i], 95)/1000.0,
+				stats[i].max_us/1000.0);
+		}
+	}
+
+	return ret.buf;
+}
+
+
+/**
+ * Get the counts and durations of frequent or expensive operations.
+ *
+ * The numbers are collected since the context was created
+ * or since dc_reset_stats() was called last.
+ * The result is a JSON-object with one entry per operation, eg.
+ *
+ * ~~~
+ * {"sql_exec":{"count":1234,"total_us":98765,"max_us":5012,"p50_us":32,"p95_us":512,"p99_us":2048,
+ *   "histogram":[0,12,...]},
+ *  "imap_fetch":{...},
+ *  ...}
+ * ~~~
+ *
+ * `histogram[0]` is the number of calls that took less than 1 µs,
+ * `histogram[i]` the number of calls that took from 2^(i-1) µs up to 2^i µs.
+ * The percentiles are estimated from the histogram.
+ *
+ * Timed are: SQL statement preparation and execution (`sql_prepare`, `sql_exec`),
+ * IMAP connects and commands (`imap_connect`, `imap_select`, `imap_prefetch`,
+ * `imap_fetch`, `imap_store`, `imap_move`), sending by SMTP (`smtp_send`),
+ * encryption and decryption (`pgp_encrypt`, `pgp_decrypt`),
+ * parsing and rendering of MIME messages (`mime_parse`, `mime_render`),
+ * the execution of jobs (`job`) and some API calls
+ * (`chatlist_load`, `get_chat_msgs`, `search_msgs`).
+ * The resolution of `sql_exec` depends on the SQLite version and may be milliseconds.
+ *
+ * @memberof dc_context_t
+ * @param context The context as created by dc_context_new().
+ * @return JSON-string which must be free()'d after usage.  Never returns NULL.
+ */
+char* dc_get_stats(dc_context_t* context)
+{
+	dc_stats_entry_t stats[DC_STATS_CNT];
+	dc_strbuilder_t  ret;
+	dc_strbuilder_init(&ret, 0);
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		dc_strbuilder_cat(&ret, "{}");
+		return ret.buf;
+	}
+
+	copy_stats(context, stats);
+
+	dc_strbuilder_cat(&ret, "{");
+	for (int i = 0; i<DC_STATS_CNT; i++) {
+		dc_strbuilder_catf(&ret, "%s\"%s\":{\"count\":%llu,\"total_us\":%llu,\"max_us\":%llu,"
+			"\"p50_us\":%llu,\"p95_us\":%llu,\"p99_us\":%llu,\"histogram\":[",
+			i? "," : "", s_names[i],
+			(unsigned long long)stats[i].cnt,
+			(unsigned long long)stats[i].total_us,
+			(unsigned long long)stats[i].max_us,
+			(unsigned long long)get_percentile_us(&stats[i], 50),
+			(unsigned long long)get_percentile_us(&stats[i], 95),
+			(unsigned long long)get_percentile_us(&stats[i], 99));
+		for (int j = 0; j<DC_STATS_BUCKETS; j++) {
+			dc_strbuilder_catf(&ret, "%s%u", j? "," : "", stats[i].buckets[j]);
+		}
+		dc_strbuilder_cat(&ret, "]}");
+	}
+	dc_strbuilder_cat(&ret, "}");
+
+	return ret.buf;
+}
+
+
+/**
+ * Reset all counters returned by dc_get_stats().
+ *
+ * @memberof dc_context_t
+ * @param context The context as created by dc_context_new().
+ * @return None.
+ */
+void dc_reset_stats(dc_context_t* context)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return;
+	}
+
+	pthread_mutex_lock(&context->stats_critical);
+		memset(context->stats, 0, sizeof(dc_stats_entry_t)*DC_STATS_CNT);
+	pthread_mutex_unlock(&context->stats_critical);
+}
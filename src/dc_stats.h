@@ -0,0 +1,56 @@
+#ifndef __DC_STATS_H__
+#define __DC_STATS_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+
+// Things that are timed, the names are returned by dc_get_stats()
+typedef enum {
+	DC_STATS_SQL_PREPARE = 0,
+	DC_STATS_SQL_EXEC,
+	DC_STATS_IMAP_CONNECT,
+	DC_STATS_IMAP_SELECT,
+	DC_STATS_IMAP_PREFETCH,
+	DC_STATS_IMAP_FETCH,
+	DC_STATS_IMAP_STORE,
+	DC_STATS_IMAP_MOVE,
+	DC_STATS_SMTP_SEND,
+	DC_STATS_PGP_ENCRYPT,
+	DC_STATS_PGP_DECRYPT,
+	DC_STATS_MIME_PARSE,
+	DC_STATS_MIME_RENDER,
+	DC_STATS_JOB,
+	DC_STATS_CHATLIST_LOAD,
+	DC_STATS_GET_CHAT_MSGS,
+	DC_STATS_SEARCH_MSGS,
+	DC_STATS_CNT
+} dc_stats_what_t;
+
+
+// bucket 0 counts durations below 1 µs, bucket i counts durations from 2^(i-1) µs to 2^i µs
+#define DC_STATS_BUCKETS 32
+
+
+typedef struct _dc_stats_entry
+{
+	uint64_t cnt;
+	uint64_t total_us;
+	uint64_t max_us;
+	uint32_t buckets[DC_STATS_BUCKETS];
+} dc_stats_entry_t;
+
+
+uint64_t dc_stats_now                    (void);
+void     dc_stats_add                    (dc_context_t*, dc_stats_what_t, uint64_t start_us);
+void     dc_stats_add_us                 (dc_context_t*, dc_stats_what_t, uint64_t duration_us);
+char*    dc_stats_get_readable           (dc_context_t*);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_STATS_H__ */
@@ -858,3 +858,338 @@ cleanup:
 	free(charset);
 	return decoded? decoded : dc_strdup(to_decode);
 }
+
+
+/*******************************************************************************
+ * Charset conversion fast path
+ ******************************************************************************/
+
+
+/* Bytes 0x80-0xFF of common 8-bit charsets as Unicode code points.
+Bytes undefined in a charset are mapped to the C1 control with the same value,
+as done by the WHATWG encoding standard; iconv would fail on them. */
+
+
+static const uint16_t s_iso8859_2[128] = {
+	0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087,
+	0x0088, 0x0089, 0x008A, 0x008B, 0x008C, 0x008D, 0x008E, 0x008F,
+	0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097,
+	0x0098, 0x0099, 0x009A, 0x009B, 0x009C, 0x009D, 0x009E, 0x009F,
+	0x00A0, 0x0104, 0x02D8, 0x0141, 0x00A4, 0x013D, 0x015A, 0x00A7,
+	0x00A8, 0x0160, 0x015E, 0x0164, 0x0179, 0x00AD, 0x017D, 0x017B,
+	0x00B0, 0x0105, 0x02DB, 0x0142, 0x00B4, 0x013E, 0x015B, 0x02C7,
+	0x00B8, 0x0161, 0x015F, 0x0165, 0x017A, 0x02DD, 0x017E, 0x017C,
+	0x0154, 0x00C1, 0x00C2, 0x0102, 0x00C4, 0x0139, 0x0106, 0x00C7,
+	0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+	0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7,
+	0x0158, 0x016E, 0x00DA, 0x0170, 0x00DC, 0x00DD, 0x0162, 0x00DF,
+	0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+	0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F,
+	0x0111, 0x0144, 0x0148, 0x00F3, 0x00F4, 0x0151, 0x00F6, 0x00F7,
+	0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9
+};
+
+
+static const uint16_t s_iso8859_15[128] = {
+	0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087,
+	0x0088, 0x0089, 0x008A, 0x008B, 0x008C, 0x008D, 0x008E, 0x008F,
+	0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097,
+	0x0098, 0x0099, 0x009A, 0x009B, 0x009C, 0x009D, 0x009E, 0x009F,
+	0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x20AC, 0x00A5, 0x0160, 0x00A7,
+	0x0161, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x017D, 0x00B5, 0x00B6, 0x00B7,
+	0x017E, 0x00B9, 0x00BA, 0x00BB, 0x0152, 0x0153, 0x0178, 0x00BF,
+	0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+	0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+	0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+	0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+	0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+	0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+	0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+	0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF
+};
+
+
+static const uint16_t s_cp1250[128] = {
+	0x20AC, 0x0081, 0x201A, 0x0083, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x0088, 0x2030, 0x0160, 0x2039, 0x015A, 0x0164, 0x017D, 0x0179,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x0098, 0x2122, 0x0161, 0x203A, 0x015B, 0x0165, 0x017E, 0x017A,
+	0x00A0, 0x02C7, 0x02D8, 0x0141, 0x00A4, 0x0104, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x015E, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x017B,
+	0x00B0, 0x00B1, 0x02DB, 0x0142, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x0105, 0x015F, 0x00BB, 0x013D, 0x02DD, 0x013E, 0x017C,
+	0x0154, 0x00C1, 0x00C2, 0x0102, 0x00C4, 0x0139, 0x0106, 0x00C7,
+	0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+	0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7,
+	0x0158, 0x016E, 0x00DA, 0x0170, 0x00DC, 0x00DD, 0x0162, 0x00DF,
+	0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+	0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F,
+	0x0111, 0x0144, 0x0148, 0x00F3, 0x00F4, 0x0151, 0x00F6, 0x00F7,
+	0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9
+};
+
+
+static const uint16_t s_cp1251[128] = {
+	0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+	0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x0098, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+	0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7,
+	0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+	0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
+	0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+	0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+	0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+	0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+	0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+	0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+	0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+	0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+	0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F
+};
+
+
+static const uint16_t s_cp1252[128] = {
+	0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+	0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+	0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+	0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+	0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+	0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+	0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+	0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+	0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+	0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF
+};
+
+
+static const uint16_t s_koi8_r[128] = {
+	0x2500, 0x2502, 0x250C, 0x2510, 0x2514, 0x2518, 0x251C, 0x2524,
+	0x252C, 0x2534, 0x253C, 0x2580, 0x2584, 0x2588, 0x258C, 0x2590,
+	0x2591, 0x2592, 0x2593, 0x2320, 0x25A0, 0x2219, 0x221A, 0x2248,
+	0x2264, 0x2265, 0x00A0, 0x2321, 0x00B0, 0x00B2, 0x00B7, 0x00F7,
+	0x2550, 0x2551, 0x2552, 0x0451, 0x2553, 0x2554, 0x2555, 0x2556,
+	0x2557, 0x2558, 0x2559, 0x255A, 0x255B, 0x255C, 0x255D, 0x255E,
+	0x255F, 0x2560, 0x2561, 0x0401, 0x2562, 0x2563, 0x2564, 0x2565,
+	0x2566, 0x2567, 0x2568, 0x2569, 0x256A, 0x256B, 0x256C, 0x00A9,
+	0x044E, 0x0430, 0x0431, 0x0446, 0x0434, 0x0435, 0x0444, 0x0433,
+	0x0445, 0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E,
+	0x043F, 0x044F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0436, 0x0432,
+	0x044C, 0x044B, 0x0437, 0x0448, 0x044D, 0x0449, 0x0447, 0x044A,
+	0x042E, 0x0410, 0x0411, 0x0426, 0x0414, 0x0415, 0x0424, 0x0413,
+	0x0425, 0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E,
+	0x041F, 0x042F, 0x0420, 0x0421, 0x0422, 0x0423, 0x0416, 0x0412,
+	0x042C, 0x042B, 0x0417, 0x0428, 0x042D, 0x0429, 0x0427, 0x042A
+};
+
+
+typedef struct dc_8bit_charset_t
+{
+	const char*     name;  /* lowercase, without `-` and `_` */
+	const uint16_t* high;  /* NULL for ISO-8859-1 */
+} dc_8bit_charset_t;
+
+
+static const dc_8bit_charset_t s_8bit_charsets[] = {
+	{ "usascii",     s_cp1252 }, /* 8-bit data labeled as ASCII are usually windows-1252 */
+	{ "ascii",       s_cp1252 },
+	{ "iso88591",    NULL },
+	{ "latin1",      NULL },
+	{ "iso88592",    s_iso8859_2 },
+	{ "latin2",      s_iso8859_2 },
+	{ "iso885915",   s_iso8859_15 },
+	{ "latin9",      s_iso8859_15 },
+	{ "windows1250", s_cp1250 },
+	{ "cp1250",      s_cp1250 },
+	{ "windows1251", s_cp1251 },
+	{ "cp1251",      s_cp1251 },
+	{ "windows1252", s_cp1252 },
+	{ "cp1252",      s_cp1252 },
+	{ "koi8r",       s_koi8_r },
+	{ NULL,          NULL }
+};
+
+
+static void normalize_charset_name(const char* charset, char* ret, size_t ret_size)
+{
+	size_t i = 0;
+	for (const char* p = charset; *p && i<ret_size-1; p++) {
+		if (*p!='-' && *p!='_') {
+			ret[i++] = tolower((unsigned char)*p);
+		}
+	}
+	ret[i] = 0;
+}
+
+
+static const dc_8bit_charset_t* find_8bit_charset(const char* charset)
+{
+	char name[32];
+	normalize_charset_name(charset, name, sizeof(name));
+
+	for (const dc_8bit_charset_t* cs = s_8bit_charsets; cs->name; cs++) {
+		if (strcmp(cs->name, name)==0) {
+			return cs;
+		}
+	}
+	return NULL;
+}
+
+
+/**
+ * Check if a buffer contains only 7-bit characters.
+ * The buffer is checked in blocks of 32 bytes.
+ *
+ * @param buf The buffer to check, no need to be null-terminated.
+ * @param bytes The number of bytes to check.
+ * @return 1=the buffer contains only ASCII characters, 0=there is at least one byte >=0x80.
+ */
+int dc_is_ascii(const char* buf, size_t bytes)
+{
+	const unsigned char* p = (const unsigned char*)buf;
+	size_t               i = 0;
+	uint64_t             acc = 0;
+
+	if (buf==NULL) {
+		return 1;
+	}
+
+	for ( ; i+32<=bytes; i+=32) {
+		uint64_t v[4];
+		memcpy(v, &p[i], 32);
+		if ((v[0]|v[1]|v[2]|v[3]) & 0x8080808080808080ULL) {
+			return 0;
+		}
+	}
+
+	for ( ; i<bytes; i++) {
+		acc |= p[i];
+	}
+
+	return (acc&0x80)? 0 : 1;
+}
+
+
+/**
+ * Check if the ASCII characters of a charset are encoded as in ASCII.
+ * Text in such a charset needs no conversion to UTF-8 if it contains only ASCII characters.
+ * Stateful or wide encodings as ISO-2022-JP, UTF-7 or UTF-16 return 0.
+ *
+ * @param charset The name of the charset, as `ISO-8859-1`.
+ * @return 1=ASCII characters are encoded as in ASCII, 0=they may not or the charset is unknown.
+ */
+int dc_charset_is_ascii_based(const char* charset)
+{
+	static const char* s_prefixes[] = { "utf8", "iso8859", "windows", "cp125", "koi8", "gb", "big5",
+		"euc", "shiftjis", "sjis", "ksc5601", "tis620", "macintosh", NULL };
+	char name[32];
+
+	if (charset==NULL || find_8bit_charset(charset)) {
+		return 1;
+	}
+
+	normalize_charset_name(charset, name, sizeof(name));
+	for (const char** prefix = s_prefixes; *prefix; prefix++) {
+		if (strncmp(name, *prefix, strlen(*prefix))==0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * Check if a charset can be converted by dc_charconv_8bit().
+ *
+ * @private
+ * @param charset The name of the charset, as `ISO-8859-1`.
+ * @return 1=the charset is converted by dc_charconv_8bit(), 0=use iconv, eg. by charconv_buffer().
+ */
+int dc_charset_is_8bit(const char* charset)
+{
+	return (charset && find_8bit_charset(charset))? 1 : 0;
+}
+
+
+/**
+ * Convert text from common 8-bit charsets to UTF-8 without iconv.
+ *
+ * The function is called by the mime parser before charconv_buffer(), see dc_charset_is_8bit().
+ * It is not installed as libetpan's `extended_charconv` hook
+ * as charconv_buffer() does not fall back to iconv for charsets unknown to the hook.
+ * For other charsets MAIL_CHARCONV_ERROR_UNKNOWN_CHARSET is returned.
+ *
+ * @private
+ * @param tocode Only `utf-8` is handled.
+ * @param fromcode The charset to convert from.
+ * @param str The text to convert, no need to be null-terminated.
+ * @param length The number of bytes in `str`.
+ * @param result Buffer to write the result to.
+ * @param result_len On call, the size of the buffer, on return the number of bytes written.
+ * @return One of the MAIL_CHARCONV_* codes.
+ */
+int dc_charconv_8bit(const char* tocode, const char* fromcode, const char* str, size_t length,
+                     char* result, size_t* result_len)
+{
+	const dc_8bit_charset_t* cs = NULL;
+	const unsigned char*     p = (const unsigned char*)str;
+	char*                    out = result;
+	size_t                   needed = length;
+
+	if (tocode==NULL || fromcode==NULL || (strcasecmp(tocode, "utf-8")!=0 && strcasecmp(tocode, "utf8")!=0)
+	 || (cs=find_8bit_charset(fromcode))==NULL) {
+		return MAIL_CHARCONV_ERROR_UNKNOWN_CHARSET;
+	}
+
+	if (dc_is_ascii(str, length)) {
+		if (length>*result_len) {
+			return MAIL_CHARCONV_ERROR_MEMORY;
+		}
+		memcpy(result, str, length);
+		*result_len = length;
+		return MAIL_CHARCONV_NO_ERROR;
+	}
+
+	for (size_t i = 0; i<length; i++) {
+		if (p[i]>=0x80) {
+			needed += 2; /* all code points in the tables are below U+FFFF */
+		}
+	}
+
+	if (needed>*result_len) {
+		return MAIL_CHARCONV_ERROR_MEMORY;
+	}
+
+	for (size_t i = 0; i<length; i++) {
+		unsigned int c = p[i];
+		if (c<0x80) {
+			*out++ = (char)c;
+			continue;
+		}
+
+		if (cs->high) {
+			c = cs->high[c-0x80];
+		}
+
+		if (c<0x800) {
+			*out++ = (char)(0xC0 | (c>>6));
+			*out++ = (char)(0x80 | (c&0x3F));
+		}
+		else {
+			*out++ = (char)(0xE0 | (c>>12));
+			*out++ = (char)(0x80 | ((c>>6)&0x3F));
+			*out++ = (char)(0x80 | (c&0x3F));
+		}
+	}
+
+	*result_len = out-result;
+	return MAIL_CHARCONV_NO_ERROR;
+}
@@ -18,6 +18,11 @@ int     dc_needs_ext_header       (const char*);
 char*   dc_encode_ext_header      (const char*);
 char*   dc_decode_ext_header      (const char*);
 
+int     dc_is_ascii               (const char*, size_t bytes);
+int     dc_charset_is_ascii_based (const char*);
+int     dc_charset_is_8bit        (const char*);
+int     dc_charconv_8bit          (const char* tocode, const char* fromcode, const char* str, size_t length, char* result, size_t* result_len);
+
 
 #ifdef __cplusplus
 } // /extern "C"
@@ -227,11 +227,17 @@ char*           dc_get_blobdir               (const dc_context_t*);
 int             dc_set_config                (dc_context_t*, const char* key, const char* value);
 char*           dc_get_config                (dc_context_t*, const char* key);
 char*           dc_get_info                  (dc_context_t*);
+char*           dc_get_stats                 (dc_context_t*);
+void            dc_reset_stats               (dc_context_t*);
 char*           dc_get_oauth2_url            (dc_context_t*, const char* addr, const char* redirect);
 char*           dc_get_version_str           (void);
 void            dc_openssl_init_not_required (void);
 void            dc_no_compound_msgs          (void); // deprecated
 
+void            dc_set_min_log_level         (dc_context_t*, int event);
+void            dc_enable_event_queue        (dc_context_t*, int max_events);
+int             dc_get_next_event            (dc_context_t*, int* ret_event, uintptr_t* ret_data1, uintptr_t* ret_data2);
+
 
 // connect
 void            dc_configure                 (dc_context_t*);
@@ -323,6 +329,7 @@ int             dc_add_address_book          (dc_context_t*, const char*);
 #define         DC_GCL_VERIFIED_ONLY         0x01
 #define         DC_GCL_ADD_SELF              0x02
 dc_array_t*     dc_get_contacts              (dc_context_t*, uint32_t flags, const char* query);
+dc_array_t*     dc_search_contacts           (dc_context_t*, uint32_t flags, const char* query, int max_cnt);
 
 int             dc_get_blocked_cnt           (dc_context_t*);
 dc_array_t*     dc_get_blocked_contacts      (dc_context_t*);
@@ -365,6 +372,7 @@ void        dc_send_locations_to_chat       (dc_context_t*, uint32_t chat_id, in
 int         dc_is_sending_locations_to_chat (dc_context_t*, uint32_t chat_id);
 int         dc_set_location                 (dc_context_t*, double latitude, double longitude, double accuracy);
 dc_array_t* dc_get_locations                (dc_context_t*, uint32_t chat_id, uint32_t contact_id, time_t timestamp_begin, time_t timestamp_end);
+dc_array_t* dc_get_locations_in_area        (dc_context_t*, uint32_t chat_id, uint32_t contact_id, double latitude_min, double longitude_min, double latitude_max, double longitude_max, time_t timestamp_begin, time_t timestamp_end, int max_cnt);
 void        dc_delete_all_locations         (dc_context_t*);
 
 
@@ -397,7 +405,7 @@ char*            dc_array_get_marker         (const dc_array_t*, size_t index);
 int              dc_array_is_independent     (const dc_array_t*, size_t index);
 
 int              dc_array_search_id          (const dc_array_t*, uint32_t needle, size_t* indx);
-const uintptr_t* dc_array_get_raw            (const dc_array_t*);
+const uint32_t*  dc_array_get_raw            (const dc_array_t*);
 
 
 /**
@@ -1026,6 +1034,19 @@ time_t          dc_lot_get_timestamp     (const dc_lot_t*);
 #define DC_EVENT_CONFIGURE_PROGRESS       2041
 
 
+/**
+ * Inform about the progress of downloading the history of a folder.
+ * This event is only sent if `imap_catchup_days` or `imap_catchup_msgs`
+ * are set, see dc_set_config(), and a folder is fetched for the first time.
+ * As every watched folder is caught up on its own, the progress may go from 1 to 1000 several times.
+ *
+ * @param data1 (int) 0=error, 1-999=progress in permille, 1000=success and done
+ * @param data2 0
+ * @return 0
+ */
+#define DC_EVENT_CATCHUP_PROGRESS         2045
+
+
 /**
  * Inform about the import/export progress started by dc_imex().
  *
@@ -1116,6 +1137,8 @@ time_t          dc_lot_get_timestamp     (const dc_lot_t*);
  *     CAVE: The string will be free()'d by the core,
  *     so make sure it is allocated using malloc() or a compatible function.
  *     If you cannot provide the content, just return 0 or an empty string.
+ *     During configuration, several files are requested at the same time,
+ *     so the event may be sent from different threads concurrently.
  */
 #define DC_EVENT_HTTP_GET                 2100
 